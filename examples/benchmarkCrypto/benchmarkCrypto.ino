@@ -0,0 +1,179 @@
+/*
+  OpenEdgeStack - Crypto Microbenchmark
+
+  Measures the per-packet cost of the crypto primitives on the target board
+  so the effect of cached key schedules can be compared directly.
+
+  Benchmarks:
+  - AES-128-CTR on a short sensor frame, expanding the key on every call
+    (aes128_encrypt_ctr) vs. the session's cached context (aes128_encrypt_ctr_ctx).
+  - Session key derivation with a per-call appKey schedule vs. the cached one.
+  - HMAC-SHA256 over a full frame with mbedtls_md_hmac (key pads rehashed per
+    call) vs. the precomputed midstate fed as header/nonce/ciphertext segments.
+  - encryptAndPackage() with the keystream computed at send time vs. taken
+    from the precomputed keystream pool (the refill runs outside the timing,
+    as it would while the device idles).
+
+  Results are printed to Serial as microseconds per operation.
+
+  Notes:
+  - No radio traffic is generated; the radio globals only exist so the library links.
+  - The keys below are test values for benchmarking only. Never deploy them.
+*/
+
+#include <OpenEdgeStack.h>
+
+#include <RadioLib.h>
+
+// LoRa SX1262 pins for Heltec V3
+#define LORA_CS     8
+#define LORA_RST    12
+#define LORA_BUSY   13
+#define LORA_DIO1   14
+
+Module module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY); // Pin configuration
+SX1262 radioModule(&module); // Create SX1262 instance
+
+PhysicalLayer* lora = &radioModule; // Set global radio pointer
+
+// ───── Benchmark-only keys ────────────────────────────
+
+uint8_t devEUI[8] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77
+};
+
+uint8_t appEUI[8] = {
+  0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, 0x00
+};
+
+uint8_t appKey[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+
+const uint8_t hmacKey[16] = {
+  0x0F, 0x0E, 0x0D, 0x0C, 0x0B, 0x0A, 0x09, 0x08,
+  0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00
+};
+
+String globalReply = "";
+GroupConfig groupConfig = { 80, 4, 2 };
+
+volatile bool receivedFlag = false;
+volatile bool transmissonFlag = false;
+
+// ───── Benchmark Settings ─────────────────────────────
+#define BENCH_ITERATIONS 2000
+#define BENCH_PAYLOAD_LEN 5     // 1 type byte + 1 float, typical sensor frame
+
+void report(const char* label, unsigned long elapsedMicros) {
+  Serial.printf("[BENCH] %-32s %8.2f us/op\n", label, (float)elapsedMicros / BENCH_ITERATIONS);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("[BENCH] OpenEdgeStack crypto microbenchmark");
+
+  SessionInfo session = {};
+  session.devAddr = 0x01020304;
+  for (int i = 0; i < 16; i++) {
+    session.appSKey[i] = (uint8_t)(i * 7);
+    session.nwkSKey[i] = (uint8_t)(i * 13);
+  }
+
+  uint8_t nonce[16] = {0};
+  uint8_t input[BENCH_PAYLOAD_LEN] = {TYPE_FLOATS, 0x00, 0x00, 0x48, 0x41};
+  uint8_t output[BENCH_PAYLOAD_LEN];
+
+  // ── AES-CTR, key expanded per call ──
+  unsigned long start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    nonce[15] = (uint8_t)i;
+    aes128_encrypt_ctr(session.appSKey, nonce, input, sizeof(input), output);
+  }
+  report("CTR setkey per call", micros() - start);
+
+  // ── AES-CTR, cached session context ──
+  SessionCrypto& crypto = sessionCryptoFor(session);
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    nonce[15] = (uint8_t)i;
+    aes128_encrypt_ctr_ctx(&crypto.appSKeyCtx, nonce, input, sizeof(input), output);
+  }
+  report("CTR cached context", micros() - start);
+
+  // ── Key derivation, appKey expanded per call ──
+  uint8_t joinNonce[3] = {0x01, 0x02, 0x03};
+  uint8_t netID[3] = {0x01, 0x23, 0x45};
+  uint8_t devNonce[2] = {0xAA, 0x55};
+  uint8_t appKeyCopy[16];
+  memcpy(appKeyCopy, appKey, 16);
+  uint8_t outKey[16];
+
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    deriveSessionKey(outKey, 0x02, appKeyCopy, joinNonce, netID, devNonce);
+  }
+  report("deriveSessionKey setkey per call", micros() - start);
+
+  // ── Key derivation, cached appKey context ──
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    deriveSessionKey(outKey, 0x02, appKey, joinNonce, netID, devNonce);
+  }
+  report("deriveSessionKey cached appKey", micros() - start);
+
+  // ── HMAC, key pads rehashed per call ──
+  uint8_t frame[8 + 16 + BENCH_PAYLOAD_LEN];
+  memcpy(frame, devEUI, 8);
+  memcpy(frame + 8, nonce, 16);
+  memcpy(frame + 24, output, BENCH_PAYLOAD_LEN);
+  uint8_t mac[32];
+
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    computeHMAC_SHA256(hmacKey, sizeof(hmacKey), frame, sizeof(frame), mac);
+  }
+  report("HMAC mbedtls_md_hmac", micros() - start);
+
+  // ── HMAC, precomputed midstate + segments ──
+  HmacSegment segments[3] = {
+    { devEUI, 8 },
+    { nonce, 16 },
+    { output, BENCH_PAYLOAD_LEN }
+  };
+  const HmacKeyContext& hmacCtx = sharedHmacContext();
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    hmacCompute(hmacCtx, segments, 3, mac);
+  }
+  report("HMAC midstate segments", micros() - start);
+
+  // ── Full packet, keystream computed at send time ──
+  uint8_t packet[PACKET_MAX_LEN];
+  DataSegment payload = { input, BENCH_PAYLOAD_LEN };
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    encryptAndPackage(&payload, 1, session, devEUI, packet, sizeof(packet));
+  }
+  report("encryptAndPackage", micros() - start);
+
+  // ── Full packet, pooled keystream (refill not timed) ──
+  keystreamPoolBind(session, devEUI);
+  unsigned long elapsed = 0;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    keystreamPoolLoop();
+    start = micros();
+    encryptAndPackage(&payload, 1, session, devEUI, packet, sizeof(packet));
+    elapsed += micros() - start;
+  }
+  keystreamPoolUnbind();
+  report("encryptAndPackage pooled", elapsed);
+
+  Serial.println("[BENCH] Done.");
+}
+
+void loop() {
+  delay(1000);
+}
@@ -0,0 +1,147 @@
+/*
+  OpenEdgeStack - Session Lookup Benchmark
+
+  Compares the per-packet session lookup cost of the fixed-capacity session
+  table against the previous std::map<String, SessionInfo> approach.
+
+  For each table size (10, 100, 1000 sessions) it measures:
+  - map:   idToHexString() + std::map::find() + copy of SessionInfo
+  - table: findSession() on the raw 8-byte DevEUI, returning a pointer
+
+  Results are printed to Serial as microseconds per lookup, plus the free
+  heap before and after the lookups to show the table path does not allocate.
+
+  Notes:
+  - Sizes larger than SESSION_TABLE_CAPACITY are skipped. Build with
+    -DSESSION_TABLE_CAPACITY=1024 (platformio.ini build_flags) to run all sizes.
+  - Populating the table goes through storeSessionFor() and therefore NVS.
+    Raise -DSESSION_STORE_CAPACITY as well for sizes above 128.
+    The 'lora' NVS namespace is wiped at start and end. Do not run this on a
+    provisioned gateway.
+  - The keys below are test values for benchmarking only. Never deploy them.
+*/
+
+#include <OpenEdgeStack.h>
+
+#include <RadioLib.h>
+#include <map>
+
+// LoRa SX1262 pins for Heltec V3
+#define LORA_CS     8
+#define LORA_RST    12
+#define LORA_BUSY   13
+#define LORA_DIO1   14
+
+Module module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY); // Pin configuration
+SX1262 radioModule(&module); // Create SX1262 instance
+
+PhysicalLayer* lora = &radioModule; // Set global radio pointer
+
+// ───── Benchmark-only keys ────────────────────────────
+
+uint8_t devEUI[8] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77
+};
+
+uint8_t appEUI[8] = {
+  0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, 0x00
+};
+
+uint8_t appKey[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+
+const uint8_t hmacKey[16] = {
+  0x0F, 0x0E, 0x0D, 0x0C, 0x0B, 0x0A, 0x09, 0x08,
+  0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00
+};
+
+String globalReply = "";
+GroupConfig groupConfig = { 80, 4, 2 };
+
+volatile bool receivedFlag = false;
+volatile bool transmissonFlag = false;
+
+// ───── Benchmark Settings ─────────────────────────────
+#define BENCH_LOOKUPS 5000
+
+// Deterministic EUIs sharing a vendor prefix, like a real fleet
+void makeEUI(uint32_t n, uint8_t* eui) {
+  eui[0] = 0x70; eui[1] = 0xB3; eui[2] = 0xD5; eui[3] = 0x7E;
+  eui[4] = (n >> 24) & 0xFF;
+  eui[5] = (n >> 16) & 0xFF;
+  eui[6] = (n >> 8) & 0xFF;
+  eui[7] = n & 0xFF;
+}
+
+void runSize(size_t count) {
+  if (count > SESSION_TABLE_CAPACITY) {
+    Serial.printf("[BENCH] %4u sessions: skipped (SESSION_TABLE_CAPACITY=%u)\n",
+                  (unsigned)count, (unsigned)SESSION_TABLE_CAPACITY);
+    return;
+  }
+
+  flushAllSessions();
+  std::map<String, SessionInfo> mapTable;
+
+  uint8_t eui[8];
+  for (size_t i = 0; i < count; i++) {
+    makeEUI(i, eui);
+    SessionInfo session = {};
+    session.devAddr = i;
+    String hex = idToHexString(eui);
+    mapTable[hex] = session;
+    storeSessionFor(hex, session);
+  }
+
+  // ── std::map<String, SessionInfo> ──
+  uint32_t checksum = 0;
+  unsigned long start = micros();
+  for (int i = 0; i < BENCH_LOOKUPS; i++) {
+    makeEUI(i % count, eui);
+    String hex = idToHexString(eui);
+    auto it = mapTable.find(hex);
+    if (it != mapTable.end()) {
+      SessionInfo copy = it->second;
+      checksum += copy.devAddr;
+    }
+  }
+  unsigned long mapMicros = micros() - start;
+
+  // ── Fixed-capacity table ──
+  uint32_t heapBefore = ESP.getFreeHeap();
+  start = micros();
+  for (int i = 0; i < BENCH_LOOKUPS; i++) {
+    makeEUI(i % count, eui);
+    SessionInfo* session = nullptr;
+    if (findSession(eui, session) == SESSION_OK) {
+      checksum += session->devAddr;
+    }
+  }
+  unsigned long tableMicros = micros() - start;
+  uint32_t heapAfter = ESP.getFreeHeap();
+
+  Serial.printf("[BENCH] %4u sessions: map %.2f us/lookup | table %.2f us/lookup | heap %u -> %u (chk %u)\n",
+                (unsigned)count,
+                (float)mapMicros / BENCH_LOOKUPS,
+                (float)tableMicros / BENCH_LOOKUPS,
+                heapBefore, heapAfter, checksum);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("[BENCH] OpenEdgeStack session lookup benchmark");
+
+  runSize(10);
+  runSize(100);
+  runSize(1000);
+
+  flushAllSessions();
+  Serial.println("[BENCH] Done.");
+}
+
+void loop() {
+  delay(1000);
+}
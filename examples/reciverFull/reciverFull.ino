@@ -10,6 +10,7 @@
   - Verifies HMAC for data integrity.
   - Automatically responds to join requests and sends acknowledgment flags.
   - Provides structured handling for different data formats (text, bytes, floats).
+  - Buffers back-to-back uplinks in the RX queue so none are lost while decoding.
 
   Compared to `receiverSimple`, this example offers extended functionality,
   including encryption handling, HMAC verification, and dynamic session handling.
@@ -94,11 +95,41 @@ volatile bool transmissonFlag = false;
 
 
 void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
   if (!transmissonFlag) {
-    receivedFlag = true;
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
   }
 }
 
+// ───── Stream Completion ──────────────────────────────
+// Called once per fully reassembled stream (e.g. a group file).
+// `data` is only valid during the call; copy it if it must be kept.
+void onStreamComplete(const uint8_t* srcID, uint8_t streamId, const uint8_t* data, size_t length) {
+  Serial.println("\n===== FULL STREAM RECEIVED =====");
+  Serial.printf("[STREAM] Device %s, stream %u, %zu bytes\n",
+                idToHexString((uint8_t*)srcID).c_str(), streamId, length);
+
+  // Stored group files are TLV payloads themselves
+  TlvReader groupReader;
+  TlvRecord entry;
+  tlvBegin(groupReader, data, length);
+  if (groupReader.version == TLV_FORMAT_V1) {
+    while (tlvNext(groupReader, entry)) {
+      Serial.printf("[STREAM] Entry type 0x%02X, %zu bytes: ", entry.type, entry.length);
+      printHex(entry.value, entry.length, "");
+    }
+  } else {
+    String fullMsg = "";
+    fullMsg.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+      char c = (char)data[i];
+      if (isPrintable(c)) fullMsg += c;
+    }
+    Serial.println(fullMsg);
+  }
+  Serial.println("===== END OF STREAM =====\n");
+}
+
 // ───── Setup ──────────────────────────────────────────
 void setup() {
   // Mount SPIFFS to persist sessions across reboots
@@ -107,13 +138,15 @@ void setup() {
     while (true);  // prevent further operation
   }
 
-  flushAllSessions();
   // Start preferences for sessions  
   preferences.begin("lora", false);
 
   Serial.begin(115200);
   delay(100);
 
+  // Load all sessions that survived the reboot, devices keep their keys
+  preloadSessions();
+
   // Register the chosen radio module globally
   setRadioModule(&radioModule);  
   delay(1000);
@@ -125,6 +158,11 @@ void setup() {
     Serial.printf("Radio init failed: %d\n", state);
     while (true);
   }
+  // Hold frames back instead of exceeding the band's duty cycle. In the
+  // EU868 plan 915 MHz lies in no band, so TX stays unlimited there.
+  dutyCycleSetRegion(DUTY_CYCLE_EU868);
+  dutyCycleSetFrequency(frequency_plan);
+
   // Set flags  
   radioModule.setDio1Action(setFlags);
   radioModule.setPacketReceivedAction(setFlags);
@@ -135,40 +173,44 @@ void setup() {
     Serial.printf("[LoRa] startReceive failed: %d\n", state);
     while (true);
   }
+  // Read frames out of the radio in a task woken by DIO1
+  rxQueueBegin();
+  // Deliver reassembled streams to this sketch
+  setStreamCompleteCallback(onStreamComplete);
+
   Serial.println("[Setup] Setup complete.");
 
 }
 
 void loop() {
 
-  // Wait until the LoRa module signals a packet has been received
-  if (!receivedFlag) return;
+  // Finish the frame on air (ACKs, JoinAccepts) and start the next one
+  txQueueLoop();
 
-  // Clear the flag now that we're handling the packet
-  receivedFlag = false;
+  // Answer one pending JoinRequest inside its device's receive window
+  joinQueueLoop();
 
-  // Get the length of the received packet
-  int length = lora->getPacketLength();
-  if (length <= 0) {
-    Serial.println("[RX] No valid packet length.");
-    return;
-  }
+  // Move any pending frame out of the radio into the RX queue
+  captureRxFrame();
 
-  // Read the data into a buffer
-  uint8_t buffer[255];
-  int state = lora->readData(buffer, length);
-  if (state != RADIOLIB_ERR_NONE) {
-    Serial.print("[RX] Error reading data: ");
-    Serial.println(state);
-    return;
-  }
+  // Reclaim stream slots of devices that stopped mid-stream
+  streamReassemblyLoop();
+
+  // Take the oldest queued frame (the queue re-arms the receiver itself)
+  RxFrame frame;
+  if (!rxQueuePop(frame)) return;
+
+  uint8_t* buffer = frame.data;
+  int length = frame.length;
+  Serial.printf("[RX] RSSI: %.1f dBm | SNR: %.1f dB\n", frame.rssi, frame.snr);
 
   // ─────────────────────────────────────────────────────────────
-  // Handle JoinRequest packets (22 bytes)
+  // Handle JoinRequest packets (typed 23 bytes or legacy 22 bytes)
   // ─────────────────────────────────────────────────────────────
-  if (length == 22) {  
-      // Handle the join request if needed
-      handleJoinIfNeeded(buffer, length);
+  uint8_t frameType = frameTypeOf(buffer, length);
+  if (frameType == FTYPE_JOIN_REQUEST) {  
+      // Queue the join; joinQueueLoop() answers it in the device's RX1 or RX2
+      joinQueuePush(buffer, length, frame.timestamp);
       
   } else {
 
@@ -178,67 +220,59 @@ void loop() {
        
     // ─────────────────────────────────────────────────────────────
     // Handle Regular Encrypted Payload Packets
-    // Format: [8-byte SrcID][Payload][8-byte HMAC]
+    // Compact: [FType][DevAddr][FCnt][Payload][8-byte HMAC]
+    // Legacy:  [8-byte SrcID][16-byte Nonce][Payload][8-byte HMAC]
     // ─────────────────────────────────────────────────────────────
 
-    // ───── Updated Offsets ─────
-    uint8_t* srcID = buffer;           // 0–7
-    uint8_t* nonce = buffer + 8;       // 8–23 (new!)
-    uint8_t* payload = buffer + 24;    // 24–(end - 8)
-    uint8_t* receivedHMAC = buffer + length - 8;
-
-    size_t payloadLength = length - 8 /*HMAC*/ - 8 /*srcID*/ - 16 /*nonce*/;
-
-    String srcIDString = idToHexString(srcID);
+    // Resolve all field offsets once; the view points straight into `buffer`
+    PacketView view;
+    if (!parsePacket(buffer, length, view)) {
+      Serial.println("[ERROR] Packet too small");
+      return;
+    }
 
-    SessionInfo session;
-    SessionStatus status = verifySession(srcIDString, session);
+    SessionInfo* session = nullptr;
+    SessionStatus status = findPacketSession(view, session);
     if (status != SESSION_OK) {
       Serial.println("[ERROR] Session not found");
       return;
     }
-  
-    uint8_t localAppSKey[16], localNwkSKey[16];
-    memcpy(localAppSKey, session.appSKey, 16);
 
-    memcpy(localNwkSKey, session.nwkSKey, 16);
+    printHex(view.payload, view.payloadLength, "[INFO] Payload: ");
+    printHex(view.hmac, PACKET_HMAC_LEN, "[INFO] Received HMAC: ");
 
-    printHex(payload, payloadLength, "[INFO] Payload: ");
-    printHex(receivedHMAC, 8, "[INFO] Received HMAC: ");
-
-    SessionStatus Hmac = verifyHmac(buffer, length, receivedHMAC);
+    // Duplicates and replays are dropped here before any HMAC work
+    SessionStatus Hmac = authenticatePacket(view, *session);
+    if (Hmac == SESSION_REPLAY) {
+      Serial.println("[WARN] Duplicate frame dropped");
+      return;
+    }
     if (Hmac != SESSION_OK) {
     Serial.println("[WARN] HMAC MISMATCH!");
       return;
     }
 
-    // Decrypt the payload using the AppSKey
-    uint8_t decrypted[payloadLength];
-    decryptPayloadWithKey(localAppSKey, nonce, payload, payloadLength, decrypted);
-
     // Optional Send ack back
-    //sendDataAck(srcIDString, srcID);
+    //sendDataAck(idToHexString(view.srcID), view.srcID);
     
     // Optional: print the raw payload in binary format
-    printBinaryBits(payload, payloadLength);
+    printBinaryBits(view.payload, view.payloadLength);
+
+    // Decrypt the payload in place using the AppSKey
+    decryptInPlace(view, *session);
+    uint8_t* decrypted = view.payload;
+    size_t payloadLength = view.payloadLength;
 
-    uint8_t* ptr = decrypted;          // Pointer to current position in decrypted buffer
+    // Walk the records by their length prefix (legacy payloads are still understood)
+    TlvReader reader;
+    TlvRecord record;
+    tlvBegin(reader, decrypted, payloadLength);
     size_t index = 0;                  // Record index for logging
 
-    while (ptr < decrypted + payloadLength) {
-    uint8_t dataType = *ptr++;       // Read current data type and advance pointer
-    uint8_t* dataStart = ptr;        // Start of data for this type
-    size_t dataLength = 0;           // Length of data for this type
-
-    // Advance until next type or end of payload, counting data length
-    while (ptr < decrypted + payloadLength &&
-           *ptr != TYPE_TEXT &&
-           *ptr != TYPE_BYTES &&
-           *ptr != TYPE_FLOATS &&
-           *ptr != TYPE_STREAM) {     // Include TYPE_STREAM here so it is counted correctly
-        ptr++;
-        dataLength++;
-    }
+    while (tlvNext(reader, record)) {
+    uint8_t dataType = record.type;          // Data type of this record
+    const uint8_t* dataStart = record.value; // Start of data for this type
+    size_t dataLength = record.length;       // Length of data for this type
 
     Serial.printf("[INFO] Type: 0x%02X | Length: %zu\n", dataType, dataLength);
 
@@ -279,58 +313,18 @@ void loop() {
         }
 
         case TYPE_STREAM: {
-
-    static uint8_t* streamBuffer = nullptr;
-    static size_t streamLength = 0;
-
-    const size_t CHUNK_SIZE = 200;   // MUST MATCH SENDER
-
-    // Append chunk
-    uint8_t* newBuffer = new uint8_t[streamLength + dataLength];
-
-    if (streamBuffer) {
-        memcpy(newBuffer, streamBuffer, streamLength);
-        delete[] streamBuffer;
-    }
-
-    memcpy(newBuffer + streamLength, dataStart, dataLength);
-    streamBuffer = newBuffer;
-    streamLength += dataLength;
-
-    Serial.printf("[STREAM] Chunk received: %zu bytes, total: %zu\n",
-                  dataLength, streamLength);
-
-    // LAST CHUNK DETECTED
-    if (dataLength < CHUNK_SIZE) {
-
-        Serial.println("\n===== FULL STREAM RECEIVED =====");
-
-        String fullMsg = "";
-        fullMsg.reserve(streamLength);
-
-        for (size_t i = 0; i < streamLength; i++) {
-            char c = (char)streamBuffer[i];
-            if (c == 0x01) fullMsg += ' ';
-            else if (isPrintable(c)) fullMsg += c;
+            // Chunks are reassembled per device and stream id in preallocated
+            // buffers; onStreamComplete() runs once all chunks are in
+            StreamResult result = streamReassemblyPush(view.srcID, dataStart, dataLength);
+            Serial.printf("[STREAM] Chunk result: %d, streams in progress: %u\n",
+                          (int)result, (unsigned)streamSlotsInUse());
+            break;
         }
-
-        Serial.println(fullMsg);
-        Serial.println("===== END OF STREAM =====\n");
-
-        delete[] streamBuffer;
-        streamBuffer = nullptr;
-        streamLength = 0;
-    }
-
-    break;
-}
         default:
             Serial.printf("[WARN] Unknown type: 0x%02X\n", dataType);
             break;
     }
     index++;
 }
-// Return to RX mode to wait for next packet
-lora->startReceive();
 }
 }
\ No newline at end of file
@@ -95,8 +95,9 @@ volatile bool transmissonFlag = false;
 
 
 void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
   if (!transmissonFlag) {
-    receivedFlag = true;
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
   }
 }
 
@@ -118,6 +119,9 @@ void setup() {
   delay(100);
 
   // Register the chosen radio module globally
+  // This sketch pair parses the legacy [SrcID][Nonce] header by hand
+  setFrameFormat(FRAME_FORMAT_LEGACY);
+
   setRadioModule(&radioModule);  
   delay(1000);
 
@@ -144,6 +148,9 @@ void setup() {
 
 void loop() {
 
+  // Finish the frame on air (JoinAccepts, rejoin requests) and start the next one
+  txQueueLoop();
+
   // Wait until the LoRa module signals a packet has been received
   if (!receivedFlag) return;
 
@@ -171,6 +178,9 @@ void loop() {
   // ─────────────────────────────────────────────────────────────
   if (length == 22) {  
 
+      // JoinRequests share a gateway-wide budget (each one derives keys and writes NVS)
+      if (rxFilterCheck(buffer, length) == RXF_RATE_LIMITED) return;
+
       String srcEUI = idToHexString(buffer, 8);
       /*
          Inside of the handler for session check We have flush sessions if a device trys to rejoin and it has a session,
@@ -187,6 +197,11 @@ void loop() {
       handleJoinRequest(buffer, length);
 
       } else {
+        // Cheap checks first: drop short frames and devices over their rate
+        // budget before anything is parsed, looked up or hashed
+        RxFilterResult verdict = rxFilterCheck(buffer, length);
+        if (verdict != RXF_PASS && verdict != RXF_UNKNOWN_DEVICE) return;
+
         Serial.println("==== [RX PACKET] ====");
 
         // ───── Updated Offsets ─────
@@ -218,28 +233,27 @@ void loop() {
         SessionInfo session;
         SessionStatus status = verifySession(srcIDString, session);
         if (status != SESSION_OK) {
+        // A spamming unknown node gets one answer per minute, not one per frame
+        if (!rxFilterAllowRejoin(srcID)) {
+            Serial.println("[ACK] Rejoin suppressed (rate limit).");
+            return;
+        }
+
         uint8_t payload[12];  // 8 bytes for devEUI + 4 bytes MIC
         memcpy(payload, devEUI, 8);
 
         uint8_t mic[32];
-        computeHMAC_SHA256(hmacKey, sizeof(hmacKey), payload, 8, mic);
+        HmacSegment gatewayId = { payload, 8 };
+        hmacCompute(sharedHmacContext(), &gatewayId, 1, mic);
         memcpy(payload + 8, mic, 4);
 
         Serial.println("[ERROR] Session not found");
 
-        transmissonFlag = true;
-        lora->standby();
-        delay(5);
-
-        int result = lora->transmit(payload, sizeof(payload));
-        delay(10);
-        lora->startReceive();
-        transmissonFlag = false;
-
-        if (result == RADIOLIB_ERR_NONE) {
-            Serial.println("[ACK] Sent rejoin.");
+        // Queued; RX re-arms by itself once the frame is on air
+        if (txQueueSend(payload, sizeof(payload)) != 0) {
+            Serial.println("[ACK] Rejoin queued.");
         } else {
-            Serial.println("[ACK] Failed to send ACK.");
+            Serial.println("[ACK] TX queue full, rejoin dropped.");
         }
         return;
      }
@@ -269,7 +283,8 @@ void loop() {
         Serial.println("[INFO] Message: " + decryptedMessage);
         }
 
-  // Restart receiver properly
+  // Restart receiver properly (unless a queued frame is on air, it re-arms RX itself)
+  if (txQueueBusy()) return;
   int rx = lora->startReceive();
   if (rx != RADIOLIB_ERR_NONE) {
     Serial.print("[ERROR] Failed to restart receive: ");
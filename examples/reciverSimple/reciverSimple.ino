@@ -93,11 +93,19 @@ volatile bool transmissonFlag = false;
 unsigned long lastJoinResponseTime = 0;
 
 void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
   if (!transmissonFlag) {
-    receivedFlag = true;
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
   }
 }
 
+// ───── Records ────────────────────────────────────────
+// Called once per record, also for each record of an aggregated frame
+void onRecord(const uint8_t* devEUI, uint8_t dataType, const uint8_t* value, size_t length) {
+  Serial.printf("[APP] %s sent type 0x%02X, %zu bytes\n",
+                idToHexString((uint8_t*)devEUI).c_str(), dataType, length);
+}
+
 // ───── Setup ──────────────────────────────────────────
 void setup() {
   // Mount SPIFFS to persist sessions across reboots
@@ -133,6 +141,9 @@ void setup() {
     Serial.printf("[LoRa] startReceive failed: %d\n", state);
     while (true);
   }
+  // Read frames out of the radio in a task woken by DIO1
+  rxQueueBegin();
+  setRecordCallback(onRecord);
   Serial.println("[Setup] Setup complete.");
 
 }
@@ -121,8 +121,9 @@ bool awaitingAckForGroup1 = false;
 String globalReply = "";
 
 void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
   if (!transmissonFlag) {
-    receivedFlag = true;
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
   }
 }
 
@@ -173,6 +174,8 @@ void setup() {
     Serial.printf("[LoRa] startReceive failed: %d\n", state);
     while (true);
   }
+  // Read frames out of the radio in a task woken by DIO1
+  rxQueueBegin();
   Serial.println("[Setup] Setup complete.");
 
   // IMPORTANT: Send join request AfTER enabling receive mode
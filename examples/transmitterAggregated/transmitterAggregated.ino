@@ -0,0 +1,179 @@
+/*
+  OpenEdgeStack SX126x - Aggregated Sensor Readings Example
+
+  This example reads a sensor every few seconds and hands each reading to
+  the uplink aggregator instead of sending it on its own. The readings go
+  out together in one encrypted frame when the oldest one is 30 s old, when
+  the frame is full, or when the button is pressed.
+
+  Notes:
+  - Consecutive float readings share one TYPE_FLOATS record, so each costs
+    4 bytes instead of a full frame.
+  - The gateway splits the frame back into records (setRecordCallback()).
+      
+  Requirements:
+  - RadioLib library.
+  - LoRa module: SX126x (tested with Heltec V3).
+
+  Optional: 
+  - SPIFFS mounted for session persistence.
+*/
+
+#include <OpenEdgeStack.h>
+
+// SENDER
+#include <RadioLib.h>
+#include <Preferences.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include <map>
+
+// LoRa SX1262 pins for Heltec V3
+#define LORA_CS     8
+#define LORA_RST    12
+#define LORA_BUSY   13
+#define LORA_DIO1   14
+
+#define BUTTON_PIN 0  // Change as needed
+
+
+Module module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY); // Pin configuration
+SX1262 radioModule(&module); // Create SX1262 instance
+
+PhysicalLayer* lora = &radioModule; // Set global radio pointer
+
+float frequency_plan = 915.0; // Frequency (in MHz)
+
+/*
+  -------------------------------------------------------------------
+  IMPORTANT: Uploading a sketch without valid keys will result in a compile error.
+  
+  The key arrays below have been intentionally commented out to prevent the
+  use of default or weak keys. This measure ensures that users must provide
+  unique and secure keys before compiling.
+
+  Each device must be provisioned with its own cryptographic keys to
+  securely communicate over LoRa.
+
+  You have two options for generating these keys:
+
+  1) Use the provided Python script `generate_keys.py` located in the 'extras' folder.
+     This script outputs keys as C-style arrays ready to be copied here.
+     Rember the app and hmacKey get shared between devices.
+     Use gatewayEUI in the python script as the secnd devEUI or vice versa.
+
+  2) Use The Things Network (TTN) to generate compatible device credentials,
+     then manually paste those values into the arrays below.
+  -------------------------------------------------------------------
+*/
+
+// ───── Runtime Globals ────────────────────────────────
+
+// uint8_t devEUI[8] = {
+//   /* your devEUI */
+// };  // Device EUI (64-bit)
+
+// uint8_t appEUI[8] = {
+//   /* your AppEUI */
+// }; // Application EUI (64-bit)
+
+// uint8_t appKey[16] = {
+//   /* your appKEY */  
+// }; // AppKey (AES-128)
+
+// const uint8_t hmacKey[16] = {
+//    /* yourHMAC key */
+// }; // Shared HMAC key (16 bytes)
+
+// -------------------- State Flags -----------------------
+
+// Tracks acknowledgment (ACK) responses between the end device and gateway.
+// Declared globally to be accessible across all functions.
+String globalReply = "";
+
+// Flags used by interrupt handlers and other logic to track received messages
+// and outgoing transmissions. Required when using the receiver with an end device.
+volatile bool receivedFlag = false;
+volatile bool transmissonFlag = false;
+
+void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
+  if (!transmissonFlag) {
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
+  }
+}
+// ------------------- Application State ------------------
+#define SENSOR_PIN          1       // Analog input, change as needed
+#define SAMPLE_INTERVAL_MS  3000    // One reading every 3 s
+#define READING_DEADLINE_MS 30000   // Longest a reading waits for others
+
+int lastButtonState;
+unsigned long lastSampleAt = 0;
+
+void setup() {
+ // Mount SPIFFS to persist sessions across reboots
+ if (!SPIFFS.begin(true)) {
+    Serial.println("[ERROR] SPIFFS Mount Failed");
+    while (true);  // prevent further operation
+  }
+
+  // Start preferences for sessions  
+  preferences.begin("lora", false);
+
+  pinMode(BUTTON_PIN, INPUT_PULLUP);
+  lastButtonState = digitalRead(BUTTON_PIN);
+
+  Serial.begin(115200);
+  delay(100);
+
+  // Register the chosen radio module globally
+  setRadioModule(&radioModule);  
+  delay(1000);
+
+  // Initialize the radio module
+  Serial.println("[INFO] LoRa Init...");
+  int state = radioModule.begin(frequency_plan);
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.printf("Radio init failed: %d\n", state);
+    while (true);
+  }
+  // Set flags  
+  radioModule.setDio1Action(setFlags);
+  radioModule.setPacketReceivedAction(setFlags);
+  
+  // begin listening
+  state = radioModule.startReceive();
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.printf("[LoRa] startReceive failed: %d\n", state);
+    while (true);
+  }
+  // Read frames out of the radio in a task woken by DIO1
+  rxQueueBegin();
+  Serial.println("[Setup] Setup complete.");
+
+  // IMPORTANT: Send join request AfTER enabling receive mode
+  sendJoinRequest(3, 3000);  // Wait for session handshake
+}
+
+void loop() {
+  // Process incoming packets and send readings whose deadline has passed
+  listenForIncoming();
+
+  if (millis() - lastSampleAt >= SAMPLE_INTERVAL_MS) {
+    lastSampleAt = millis();
+    float reading = analogRead(SENSOR_PIN) * (3.3f / 4095.0f);  // Volts
+    aggregatorAdd((const uint8_t*)&reading, sizeof(reading), TYPE_FLOATS, READING_DEADLINE_MS);
+    Serial.printf("[SENSOR] %.3f V buffered, %u reading(s) waiting\n", reading, (unsigned)aggregatorPending());
+  }
+
+  // Button: send what is buffered right away
+  int currentButtonState = digitalRead(BUTTON_PIN);
+  if (currentButtonState == HIGH && lastButtonState == LOW) {
+    Serial.println("[BUTTON] Press detected. Flushing...");
+    aggregatorFlush();
+    printAggregatorStats();
+  }
+
+  lastButtonState = currentButtonState;
+  delay(50);  // Debounce
+}
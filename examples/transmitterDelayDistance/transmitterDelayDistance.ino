@@ -9,6 +9,7 @@
   - When the measured distance exceeds 20 cm, the value is read, encrypted,
     and transmitted over LoRa.
   - Utilizes `pollLora()` with a 3-second timeout for sending.
+  - Binds the keystream pool after joining, so the send path skips AES.
   
   Notes:
   - Data is encrypted using AppSKey before transmission.
@@ -92,8 +93,9 @@ volatile bool transmissonFlag = false;
 String globalReply = "";
 
 void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
   if (!transmissonFlag) {
-    receivedFlag = true;
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
   }
 }
 
@@ -144,12 +146,21 @@ void setup() {
     Serial.printf("[LoRa] startReceive failed: %d\n", state);
     while (true);
   }
+  // Read frames out of the radio in a task woken by DIO1
+  rxQueueBegin();
   Serial.println("[Setup] Setup complete.");
 
   // IMPORTANT: Send join request AfTER enabling receive mode
   int maxRetries = 3; //Number of retries
   int retryDelay = 3000; //Timeout per attempt in milliseconds
   sendJoinRequest(maxRetries, retryDelay);  // Wait for session handshake   
+
+  // Precompute the CTR keystream of the next packets so a trigger only costs
+  // an XOR + HMAC before going on air. listenForIncoming() refills it in loop().
+  SessionInfo* session = nullptr;
+  if (findSession(devEUI, session) == SESSION_OK) {
+    keystreamPoolBind(*session, devEUI);
+  }
 }
 
 // measure distance
@@ -128,8 +128,9 @@ volatile bool receivedFlag = false;
 volatile bool transmissonFlag = false;
 
 void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
   if (!transmissonFlag) {
-    receivedFlag = true;
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
   }
 }
 
@@ -197,6 +198,8 @@ void setup() {
     Serial.printf("[LoRa] startReceive failed: %d\n", state);
     while (true);
   }
+  // Read frames out of the radio in a task woken by DIO1
+  rxQueueBegin();
   Serial.println("[Setup] Setup complete.");
 
   // IMPORTANT: Send join request AfTER enabling receive mode
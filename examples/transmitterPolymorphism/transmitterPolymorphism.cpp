@@ -6,14 +6,14 @@
 
   Using the new **PolymorphicLoraSender** class, messages exceeding the
   typical LoRa payload limit (>200 bytes) are automatically split into
-  chunks and sent sequentially as a stream. The receiver can reassemble
-  the full message using the STREAM_END identifier.
+  chunks and sent sequentially as a stream. The receiver reassembles the
+  full message from the stream id and sequence number in every chunk.
 
   Features:
   - Data is encrypted using the AppSKey before transmission.
   - Messages larger than 200 bytes are split into 200-byte chunks.
   - Each chunk is encrypted and sent using the existing session system.
-  - A final chunk includes a STREAM_END marker to indicate end-of-stream.
+  - The final chunk is flagged, so the gateway knows the total length.
   - Polymorphism ensures a single runtime instance can send the entire stream.
   - Designed for continuous transmission without requiring ACK handling.
 
@@ -122,8 +122,9 @@ volatile bool receivedFlag = false;
 volatile bool transmissonFlag = false;
 
 void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
   if (!transmissonFlag) {
-    receivedFlag = true;
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
   }
 }
 // ------------------- Application State ------------------
@@ -174,6 +175,8 @@ void setup() {
     Serial.printf("[LoRa] startReceive failed: %d\n", state);
     while (true);
   }
+  // Read frames out of the radio in a task woken by DIO1
+  rxQueueBegin();
   Serial.println("[Setup] Setup complete.");
 
   // IMPORTANT: Send join request AfTER enabling receive mode
@@ -235,7 +238,7 @@ void loop() {
 
         // --- Use the polymorphic sender ---
         PolymorphicLoraSender sender;
-        sender.sendStream(groupOneData, groupOneLen);  // splits automatically into 255-byte chunks
+        sender.sendStream(groupOneData, groupOneLen);  // splits automatically into STREAM_CHUNK_SIZE chunks
 
         Serial.println("[TX] groupOne stream sent!");
     }
@@ -108,8 +108,9 @@ volatile bool receivedFlag = false;
 volatile bool transmissonFlag = false;
 
 void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
   if (!transmissonFlag) {
-    receivedFlag = true;
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
   }
 }
 // ------------------- Application State ------------------
@@ -140,6 +141,9 @@ void setup() {
   delay(100);
 
   // Register the chosen radio module globally
+  // This sketch pair parses the legacy [SrcID][Nonce] header by hand
+  setFrameFormat(FRAME_FORMAT_LEGACY);
+
   setRadioModule(&radioModule);  
   delay(1000);
 
@@ -169,6 +173,9 @@ void setup() {
 }
 
 void loop() {
+  // Finish the frame on air and start the next queued one
+  txQueueLoop();
+
   // Check if a LoRa packet was received (via ISR flag)
   if (receivedFlag) {
     receivedFlag = false;
@@ -241,15 +248,16 @@ void loop() {
       return;
     }
 
-    // Build the payload: 1 byte type header + message
-    size_t totalLen = groupOne.length() + 1;
-    uint8_t* packetData = new uint8_t[totalLen];
-    packetData[0] = 0x01; // TYPE_TEXT
-    memcpy(packetData + 1, (const uint8_t*)groupOne.c_str(), groupOne.length());
+    // Build the payload: TLV header (format, type, length) + message
+    uint8_t header[TLV_MAX_FRAME_HEADER];
+    DataSegment segments[2] = {
+      { header, tlvFrameHeader(header, TYPE_TEXT, groupOne.length()) },
+      { (const uint8_t*)groupOne.c_str(), groupOne.length() }
+    };
 
-    // Encrypt and wrap with session info
-    size_t finalLen = 0;
-    uint8_t* finalPacket = encryptAndPackage(packetData, totalLen, session, finalLen, devEUI);
+    // Encrypt and wrap with session info straight into a stack buffer
+    uint8_t finalPacket[PACKET_MAX_LEN];
+    size_t finalLen = encryptAndPackage(segments, 2, session, devEUI, finalPacket, sizeof(finalPacket));
 
     // Transmit encrypted payload
     transmissonFlag = true;
@@ -265,10 +273,6 @@ void loop() {
     } else {
       Serial.println("[ACK] Failed to send ACK.");
     }
-
-    // Clean up heap memory
-    delete[] finalPacket;
-    delete[] packetData;
   }
 
   globalReply = "";  // Clear any leftover state
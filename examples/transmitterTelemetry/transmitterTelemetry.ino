@@ -0,0 +1,202 @@
+/*
+  OpenEdgeStack SX126x - Edge Telemetry Example
+
+  This example samples an ultrasonic distance sensor and a battery voltage
+  and sends per-window summaries instead of single readings.
+
+  Functionality:
+  - Every loop takes one distance sample into channel 0 and one battery
+    sample into channel 1 (telemetrySample()).
+  - Each channel ends a window after its configured length and sends one
+    TYPE_SUMMARY record: sample count, min, max, mean and last value.
+  - Dead band: a window whose samples all stay within 2 cm (0.05 V) of the
+    value last sent is not sent at all. A heartbeat sends it anyway every
+    15 minutes so the gateway knows the device is alive.
+  - Summaries of both channels that end together share one frame.
+
+  Notes:
+  - Data is encrypted using AppSKey before transmission.
+  - reciverSimple prints the decoded summaries.
+  - Compatible with all SX126x family LoRa modules.
+*/
+
+#include <OpenEdgeStack.h>
+
+#include <RadioLib.h>
+#include <FS.h>
+#include <SPIFFS.h>
+
+// Lora SX1262 pins for Heltec V3
+#define LORA_CS     8
+#define LORA_RST    12
+#define LORA_BUSY   13
+#define LORA_DIO1   14
+
+// Ultrasonic sensor pins
+#define TRIG_PIN 7
+#define ECHO_PIN 6
+#define BATTERY_PIN 1   // Analog input behind a 1:2 divider, change as needed
+
+// Telemetry channels
+#define CH_DISTANCE 0
+#define CH_BATTERY  1
+#define SAMPLE_INTERVAL_MS 200
+
+Module module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY); // Pin configuration
+SX1262 radioModule(&module); // Create SX1262 instance
+
+PhysicalLayer* lora = &radioModule; // Set global radio pointer
+
+float frequency_plan = 915.0; // Frequency (in MHz)
+
+/*
+  -------------------------------------------------------------------
+  IMPORTANT: Uploading a sketch without valid keys will result in a compile error.
+  
+  The key arrays below have been intentionally commented out to prevent the
+  use of default or weak keys. This measure ensures that users must provide
+  unique and secure keys before compiling.
+
+  Each device must be provisioned with its own cryptographic keys to
+  securely communicate over LoRa.
+
+  You have two options for generating these keys:
+
+  1) Use the provided Python script `generate_keys.py` located in the 'extras' folder.
+     This script outputs keys as C-style arrays ready to be copied here.
+     Rember the app and hmacKey get shared between devices.
+     Use gatewayEUI in the python script as the secnd devEUI or vice versa.
+
+  2) Use The Things Network (TTN) to generate compatible device credentials,
+     then manually paste those values into the arrays below.
+  -------------------------------------------------------------------
+*/
+
+// ───── Runtime Globals ────────────────────────────────
+
+// uint8_t devEUI[8] = {
+//   /* your devEUI */
+// };  // Device EUI (64-bit)
+
+// uint8_t appEUI[8] = {
+//   /* your AppEUI */
+// }; // Application EUI (64-bit)
+
+// uint8_t appKey[16] = {
+//   /* your appKEY */  
+// }; // AppKey (AES-128)
+
+// const uint8_t hmacKey[16] = {
+//    /* yourHMAC key */
+// }; // Shared HMAC key (16 bytes)
+
+
+// ───── Interrupt ──────────────────────────────────────
+// Flags used by interrupt handlers and other logic to track received messages
+volatile bool receivedFlag = false;
+volatile bool transmissonFlag = false;
+
+
+// Tracks acknowledgment (ACK) responses between the end device and gateway.
+// Declared globally to be accessible across all functions.
+String globalReply = "";
+
+void setFlags() {
+  if (txQueueISR()) return;  // TX done of a queued frame
+  if (!transmissonFlag) {
+    rxQueueISR();  // sets receivedFlag and stamps the RX time
+  }
+}
+
+void setup() {
+ 
+  // Initialize entropy for nonces, random devNonce etc.
+  randomSeed(analogRead(0));
+
+  // Power external devices (e.g. sensors, radio modules)
+  pinMode(Vext, OUTPUT);
+  digitalWrite(Vext, LOW);  // Enable Vext
+  delay(100);
+
+  // Setup ultrasonic sensor pins
+  pinMode(TRIG_PIN, OUTPUT);
+  pinMode(ECHO_PIN, INPUT);
+
+  // Mount SPIFFS to persist sessions across reboots
+ if (!SPIFFS.begin(true)) {
+    Serial.println("[ERROR] SPIFFS Mount Failed");
+    while (true);  // prevent further operation
+  }
+
+  // Start preferences for sessions  
+  preferences.begin("lora", false);
+
+  Serial.begin(115200);
+  delay(100);
+
+  // Register the chosen radio module globally
+  setRadioModule(&radioModule);  
+  delay(1000);
+
+  // Initialize the radio module
+  Serial.println("[INFO] LoRa Init...");
+  int state = radioModule.begin(frequency_plan);
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.printf("Radio init failed: %d\n", state);
+    while (true);
+  }
+  // Set flags  
+  radioModule.setDio1Action(setFlags);
+  radioModule.setPacketReceivedAction(setFlags);
+  
+  // begin listening
+  state = radioModule.startReceive();
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.printf("[LoRa] startReceive failed: %d\n", state);
+    while (true);
+  }
+  // Read frames out of the radio in a task woken by DIO1
+  rxQueueBegin();
+  Serial.println("[Setup] Setup complete.");
+
+  // IMPORTANT: Send join request AfTER enabling receive mode
+  int maxRetries = 3; //Number of retries
+  int retryDelay = 3000; //Timeout per attempt in milliseconds
+  sendJoinRequest(maxRetries, retryDelay);  // Wait for session handshake   
+
+  // Window length, dead band and heartbeat per channel
+  telemetryConfigure(CH_DISTANCE, 60000, 2.0, 15UL * 60 * 1000);     // 1 min, 2 cm
+  telemetryConfigure(CH_BATTERY, 600000, 0.05, 60UL * 60 * 1000);    // 10 min, 50 mV
+}
+
+// measure distance
+float measureDistance() {
+  digitalWrite(TRIG_PIN, LOW);
+  delayMicroseconds(2);
+  digitalWrite(TRIG_PIN, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(TRIG_PIN, LOW);
+
+  // Wait for echo response
+  long duration = pulseIn(ECHO_PIN, HIGH, 30000);
+  return duration * 0.034 / 2.0;
+}
+
+unsigned long lastSampleAt = 0;
+unsigned long lastStatsAt = 0;
+
+void loop() {
+  // Summarizes ended windows, sends them and processes incoming packets
+  listenForIncoming();
+
+  if (millis() - lastSampleAt >= SAMPLE_INTERVAL_MS) {
+    lastSampleAt = millis();
+    telemetrySample(CH_DISTANCE, measureDistance());
+    telemetrySample(CH_BATTERY, analogRead(BATTERY_PIN) * (2 * 3.3f / 4095.0f));
+  }
+
+  if (millis() - lastStatsAt >= 60000) {
+    lastStatsAt = millis();
+    printTelemetryStats();
+  }
+}
@@ -0,0 +1,75 @@
+/*
+  OpenEdgeStack - Frame Header Time-on-Air Report (host)
+
+  Compares the time-on-air of data frames with the legacy header
+  ([Sender ID 8][Nonce 16] + HMAC 8 = 32 bytes of overhead) and the compact
+  header ([FType 1][DevAddr 4][FCnt 2] + HMAC 8 = 15 bytes), using the same
+  formula as src/Airtime.cpp.
+
+  For each spreading factor at 125 kHz, CR 4/5, 8 preamble symbols, explicit
+  header and CRC it prints, per application payload size:
+  - legacy and compact time-on-air in ms
+  - the airtime saved by the compact header in percent
+
+  It then compares N float readings sent with one sendLora() each against
+  one frame from the uplink aggregator (src/UplinkAggregator.h), compact
+  header: [format][type][length][float] = 7 bytes of payload per frame
+  alone, [format][TYPE_FLOATS][length][N floats] aggregated.
+
+  Build and run on a PC:
+    g++ -O2 -I../src airtimeReport.cpp ../src/Airtime.cpp -o airtimeReport
+    ./airtimeReport
+*/
+
+#include "Airtime.h"
+
+#include <cstdio>
+
+// PACKET_OVERHEAD and FRAME_OVERHEAD of src/PacketView.h (which needs Arduino.h)
+static const size_t LEGACY_OVERHEAD = 8 + 16 + 8;
+static const size_t COMPACT_OVERHEAD = 1 + 4 + 2 + 8;
+static const uint32_t BANDWIDTH_HZ = 125000;
+
+static void aggregationReport() {
+  const size_t readings[] = { 2, 4, 10, 30 };
+  const size_t readingCount = sizeof(readings) / sizeof(readings[0]);
+  const uint8_t spreadingFactors[] = { 7, 10, 12 };
+
+  printf("\nFloat readings: one frame each vs one aggregated frame (compact header)\n");
+  printf("SF  readings   separate ms  aggregated ms   saved\n");
+
+  for (uint8_t sf : spreadingFactors) {
+    LoRaAirtimeParams params = loraAirtimeParams(sf, BANDWIDTH_HZ);
+    for (size_t i = 0; i < readingCount; i++) {
+      size_t n = readings[i];
+      uint32_t separateUs = n * loraTimeOnAirUs(params, COMPACT_OVERHEAD + 3 + 4);
+      uint32_t aggregatedUs = loraTimeOnAirUs(params, COMPACT_OVERHEAD + 3 + 4 * n);
+      printf("%2u  %8zu  %12.1f  %13.1f  %5.1f %%\n", sf, n,
+             separateUs / 1000.0, aggregatedUs / 1000.0,
+             100.0 * (double)(separateUs - aggregatedUs) / separateUs);
+    }
+  }
+}
+
+int main() {
+  const size_t payloads[] = { 5, 12, 24, 51, 100 };
+  const size_t payloadCount = sizeof(payloads) / sizeof(payloads[0]);
+
+  printf("Overhead: legacy %zu bytes, compact %zu bytes (2-byte FCnt)\n\n",
+         LEGACY_OVERHEAD, COMPACT_OVERHEAD);
+  printf("SF  payload   legacy ms  compact ms   saved\n");
+
+  for (uint8_t sf = 7; sf <= 12; sf++) {
+    LoRaAirtimeParams params = loraAirtimeParams(sf, BANDWIDTH_HZ);
+    for (size_t i = 0; i < payloadCount; i++) {
+      uint32_t legacyUs = loraTimeOnAirUs(params, payloads[i] + LEGACY_OVERHEAD);
+      uint32_t compactUs = loraTimeOnAirUs(params, payloads[i] + COMPACT_OVERHEAD);
+      printf("%2u  %7zu  %10.1f  %10.1f  %5.1f %%\n", sf, payloads[i],
+             legacyUs / 1000.0, compactUs / 1000.0,
+             100.0 * (double)(legacyUs - compactUs) / legacyUs);
+    }
+  }
+
+  aggregationReport();
+  return 0;
+}
@@ -0,0 +1,90 @@
+/*
+  OpenEdgeStack - FEC Codec Benchmark (host)
+
+  Measures encode and decode throughput of the stream FEC codec (src/Fec.cpp)
+  for several block sizes K, using the on-air chunk size of 200 bytes.
+
+  For each K it reports:
+  - encode: MB/s of source data for computing R repair chunks
+  - decode: MB/s of source data when the first R source chunks are lost
+            (worst case: every repair chunk takes part in the elimination)
+  Every decode is checked against the original data.
+
+  Build and run on a PC:
+    g++ -O2 -I../src fecBenchmark.cpp ../src/Fec.cpp -o fecBenchmark
+    ./fecBenchmark
+*/
+
+#include "Fec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const size_t CHUNK_SIZE = 200;
+static const int ITERATIONS = 2000;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchmark(uint8_t k, uint8_t repairCount) {
+  size_t length = (size_t)k * CHUNK_SIZE - CHUNK_SIZE / 2;  // short last chunk
+  std::vector<uint8_t> source((size_t)k * CHUNK_SIZE, 0);
+  for (size_t i = 0; i < length; i++) source[i] = (uint8_t)rand();
+
+  std::vector<std::vector<uint8_t>> repair(repairCount, std::vector<uint8_t>(CHUNK_SIZE));
+  std::vector<uint8_t> repairIndex(repairCount);
+  for (uint8_t r = 0; r < repairCount; r++) repairIndex[r] = r;
+
+  // Encode
+  auto start = std::chrono::steady_clock::now();
+  for (int it = 0; it < ITERATIONS; it++) {
+    for (uint8_t r = 0; r < repairCount; r++) {
+      fecEncodeRepair(source.data(), length, CHUNK_SIZE, k, r, repair[r].data());
+    }
+  }
+  double encodeSeconds = secondsSince(start);
+
+  // Decode with the first `repairCount` source chunks lost
+  uint32_t receivedMask = (k == 32) ? 0xFFFFFFFFUL : ((1UL << k) - 1);
+  for (uint8_t i = 0; i < repairCount; i++) receivedMask &= ~(1UL << i);
+
+  std::vector<uint8_t> received(source.size());
+  std::vector<std::vector<uint8_t>> scratch(repairCount);
+  std::vector<uint8_t*> scratchPtr(repairCount);
+  bool ok = true;
+  double decodeSeconds = 0;
+
+  for (int it = 0; it < ITERATIONS; it++) {
+    received = source;
+    memset(received.data(), 0, (size_t)repairCount * CHUNK_SIZE);
+    for (uint8_t r = 0; r < repairCount; r++) {
+      scratch[r] = repair[r];
+      scratchPtr[r] = scratch[r].data();
+    }
+
+    start = std::chrono::steady_clock::now();
+    int recovered = fecDecode(received.data(), CHUNK_SIZE, k, receivedMask,
+                              scratchPtr.data(), repairIndex.data(), repairCount);
+    decodeSeconds += secondsSince(start);
+
+    ok = ok && recovered == repairCount && received == source;
+  }
+
+  double megabytes = (double)length * ITERATIONS / 1e6;
+  printf("K=%2u R=%2u  encode %8.2f MB/s  decode %8.2f MB/s  %s\n",
+         k, repairCount, megabytes / encodeSeconds, megabytes / decodeSeconds,
+         ok ? "ok" : "MISMATCH");
+}
+
+int main() {
+  const uint8_t blockSizes[] = { 4, 8, 16, 32 };
+  for (uint8_t k : blockSizes) {
+    benchmark(k, k / 4 ? k / 4 : 1);
+    benchmark(k, k / 2);
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+/*
+  OpenEdgeStack - Float Series Compression Benchmark (host)
+
+  Compares the size of float readings sent as a TYPE_FLOATS record (32 bits
+  each) with a TYPE_FLOAT_SERIES record (src/FloatSeries.cpp), lossless and
+  quantized, on synthetic sensor traces of 240 readings:
+  - temperature: DS18B20-style, 0.0625 °C resolution, slow daily drift
+  - distance:    ultrasonic level sensor in cm, mostly still, a few jumps
+  - battery:     cell voltage, slow discharge with ADC noise
+  - noisy:       uniform noise, the worst case for both encodings
+
+  For each trace and mode it prints bits per reading (header included), the
+  largest decode error, and how many readings fit in one 51-byte payload
+  (the largest EU868 payload at SF12) next to the 12 of TYPE_FLOATS.
+  Every record is decoded again and checked: bit-exact for lossless, within
+  step / 2 for quantized. Truncated records must be rejected.
+
+  Build and run on a PC:
+    g++ -O2 -I../src floatSeriesBenchmark.cpp ../src/FloatSeries.cpp -o floatSeriesBenchmark
+    ./floatSeriesBenchmark
+*/
+
+#include "FloatSeries.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const size_t READINGS = 240;
+static const size_t FRAME_PAYLOAD = 51;
+static const size_t RECORD_OVERHEAD = 1 + 1 + 1;    // [format][type][length]
+
+static float quantize(float value, float step) {
+  return roundf(value / step) * step;
+}
+
+static float noise(float amplitude) {
+  return amplitude * (2.0f * rand() / RAND_MAX - 1.0f);
+}
+
+static std::vector<float> temperatureTrace() {
+  std::vector<float> values(READINGS);
+  for (size_t i = 0; i < READINGS; i++) {
+    values[i] = quantize(21.5f + 2.0f * sinf(i / 40.0f) + noise(0.05f), 0.0625f);
+  }
+  return values;
+}
+
+static std::vector<float> distanceTrace() {
+  std::vector<float> values(READINGS);
+  float level = 142.0f;
+  for (size_t i = 0; i < READINGS; i++) {
+    if (i % 60 == 59) level -= 8.0f;
+    values[i] = quantize(level + ((rand() % 8) == 0 ? noise(1.0f) : 0), 0.5f);
+  }
+  return values;
+}
+
+static std::vector<float> batteryTrace() {
+  std::vector<float> values(READINGS);
+  for (size_t i = 0; i < READINGS; i++) {
+    values[i] = 4.10f - 0.0005f * i + noise(0.004f);
+  }
+  return values;
+}
+
+static std::vector<float> noisyTrace() {
+  std::vector<float> values(READINGS);
+  for (size_t i = 0; i < READINGS; i++) values[i] = 50.0f + noise(50.0f);
+  return values;
+}
+
+static bool truncatedRejected(const uint8_t* record, size_t length, size_t count) {
+  std::vector<float> decoded(count);
+  for (size_t cut = 0; cut < length; cut++) {
+    // The last byte may hold only padding, so dropping it can still decode
+    if (cut == length - 1) continue;
+    if (floatSeriesDecode(record, cut, decoded.data(), count) != 0) return false;
+  }
+  return true;
+}
+
+static bool report(const char* name, const std::vector<float>& values, float step) {
+  std::vector<uint8_t> record(FLOAT_SERIES_HEADER_LEN + 4 + values.size() * 9);
+  size_t count = values.size();
+  size_t length = floatSeriesEncode(values.data(), count, record.data(), record.size(), step);
+
+  std::vector<float> decoded(count);
+  bool ok = count == values.size() &&
+            floatSeriesDecode(record.data(), length, decoded.data(), decoded.size()) == count;
+
+  float maxError = 0;
+  for (size_t i = 0; ok && i < count; i++) {
+    if (step > 0) {
+      float error = fabsf(decoded[i] - values[i]);
+      if (error > maxError) maxError = error;
+      ok = error <= step / 2 * 1.001f + 1e-6f;
+    } else {
+      ok = memcmp(&decoded[i], &values[i], sizeof(float)) == 0;
+    }
+  }
+  ok = ok && truncatedRejected(record.data(), length, count);
+
+  size_t perFrame = values.size();
+  floatSeriesEncode(values.data(), perFrame, record.data(), FRAME_PAYLOAD - RECORD_OVERHEAD, step);
+
+  char mode[24];
+  if (step > 0) snprintf(mode, sizeof(mode), "step %g", step);
+  else snprintf(mode, sizeof(mode), "lossless");
+  printf("%-12s %-12s %6.2f %8u %10g %9u  %s\n", name, mode, length * 8.0 / count,
+         (unsigned)length, maxError, (unsigned)perFrame, ok ? "ok" : "MISMATCH");
+  return ok;
+}
+
+int main() {
+  srand(1);
+  struct Trace { const char* name; std::vector<float> values; float step; };
+  Trace traces[] = {
+    { "temperature", temperatureTrace(), 0.0625f },
+    { "distance", distanceTrace(), 0.5f },
+    { "battery", batteryTrace(), 0.01f },
+    { "noisy", noisyTrace(), 0.1f },
+  };
+
+  size_t floatsPerFrame = (FRAME_PAYLOAD - RECORD_OVERHEAD) / sizeof(float);
+  printf("%u readings per trace; TYPE_FLOATS: 32.00 bits/reading, %u per %u-byte payload\n\n",
+         (unsigned)READINGS, (unsigned)floatsPerFrame, (unsigned)FRAME_PAYLOAD);
+  printf("trace        mode          bits   bytes  max error  per frame\n");
+
+  bool ok = true;
+  for (const Trace& trace : traces) {
+    ok = report(trace.name, trace.values, 0) && ok;
+    ok = report(trace.name, trace.values, trace.step) && ok;
+  }
+  return ok ? 0 : 1;
+}
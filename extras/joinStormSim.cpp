@@ -0,0 +1,490 @@
+/*
+  OpenEdgeStack - Join Storm Simulator (host)
+
+  N devices power up together after an outage and join over one channel.
+  Three setups are compared:
+
+  - original: the gateway processes each JoinRequest in the RX path (key
+              derivation plus an NVS commit) and sends the JoinAccept with a
+              blocking transmit. Requests wait in the 16-frame RX queue,
+              however old they are, and a device that already has a session
+              is ignored. The device listens for one RadioLib receive()
+              (100 symbols) after its request and retries after a fixed
+              retryDelay.
+  - windows:  join queue gateway (src/JoinQueue.h) and RX1/RX2 receive
+              windows, but still a fixed retryDelay.
+  - backoff:  join queue, RX1/RX2 and the exponential backoff with equal
+              jitter of sendJoinRequest().
+
+  The join queue gateway:
+  - processes one request at a time, and only while the radio is idle
+  - starts each JoinAccept inside its device's RX1 or RX2
+  - answers a recently joined device again
+  - sends a randomized backoff hint when the queue is full
+
+  Both gateways share the same radio model:
+  - Pure ALOHA on one channel. Two uplinks that overlap are both lost.
+  - The gateway is half-duplex, so an uplink that overlaps one of its
+    transmissions is lost.
+  - Every device catches a downlink whose preamble starts while it listens.
+    A JoinAccept that does not echo the DevNonce of its last request (a
+    neighbour's, or the answer to an earlier attempt) is ignored, as
+    handleJoinAccept() does. A backoff hint names its DevEUI.
+  - Frame airtime comes from src/Airtime.cpp.
+
+  Two reports are printed:
+  - Join storm: N = 25..200 devices booting within 2 s. For each setup:
+    devices joined in 600 s, and p50 / p90 / max time to join.
+  - 50 devices booting at the same moment: success rate after 30 / 60 /
+    120 s, mean JoinRequests per joined device, p50 / p90 time to join, and
+    the JoinAccepts a device heard but ignored (mean per run). Without the
+    DevNonce check each of these would have been taken as its own.
+
+  Build and run on a PC:
+    g++ -O2 -I../src joinStormSim.cpp ../src/Airtime.cpp -o joinStormSim
+    ./joinStormSim [spreading factor, default 9]
+*/
+
+#include "Airtime.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <queue>
+#include <random>
+#include <vector>
+
+// ────── Model Parameters ──────
+// Library defaults from JoinQueue.h, RxQueue.h and EndDevice.h, and the
+// retryDelay of the example sketches.
+
+static const double RETRY_DELAY_MS = 3000;
+static const double JOIN_RETRY_MAX_MS = 60000;
+static const double RADIOLIB_RX_SYMBOLS = 100;   // single receive() timeout
+static const double INLINE_PROCESS_MS = 45;      // MIC + key derivation + NVS commit
+static const double QUEUED_PROCESS_MS = 8;       // MIC + key derivation (NVS is write-behind)
+static const size_t RX_QUEUE_CAPACITY = 16;
+static const size_t JOIN_QUEUE_CAPACITY = 16;
+static const double JOIN_RX1_DELAY_MS = 0;
+static const double JOIN_RX1_WINDOW_MS = 1000;
+static const double JOIN_RX2_DELAY_MS = 2000;
+static const double JOIN_RX2_WINDOW_MS = 1000;
+static const double JOIN_RX_GUARD_MS = 20;
+static const size_t JOIN_CACHE_ENTRIES = 32;
+static const double JOIN_CACHE_TTL_MS = 120000;
+static const double JOIN_SERVICE_MS = 250;
+static const double JOIN_BACKOFF_MIN_MS = 2000;
+static const double JOIN_BACKOFF_MAX_MS = 60000;
+static const size_t JOIN_REQUEST_LEN = 23;
+static const size_t JOIN_ACCEPT_LEN = 17;
+static const size_t JOIN_BACKOFF_LEN = 15;
+static const int RUNS = 20;
+
+enum Setup { SETUP_ORIGINAL, SETUP_WINDOWS, SETUP_BACKOFF };
+static const char* SETUP_NAMES[] = { "original", "windows", "backoff" };
+
+enum EventType { EV_SEND, EV_UPLINK_END, EV_PROCESSED, EV_TX_END, EV_WAKE };
+
+struct Event {
+  double at;
+  uint64_t seq;
+  EventType type;
+  int a;
+  int b;
+  bool operator>(const Event& other) const {
+    return at != other.at ? at > other.at : seq > other.seq;
+  }
+};
+
+struct Uplink {
+  int device;
+  int attempt;
+  double start, end;
+  bool lost;
+};
+
+struct Request {
+  int device;
+  int attempt;
+  double receivedAt;          // = the device's TX done
+};
+
+struct Downlink {
+  int device;
+  int attempt;
+  bool accept;
+  double delayMs;             // hint only
+};
+
+struct Device {
+  int attempt = 0;
+  int sendToken = 0;          // only the newest scheduled send fires
+  double txDoneAt = 0;
+  double joinedAt = -1;
+};
+
+struct CacheEntry {
+  int device;
+  double answeredAt;
+};
+
+struct Result {
+  std::vector<double> joinTimes;  // sorted, joined devices only
+  int devices = 0;
+  int attempts = 0;               // JoinRequests of the joined devices
+  int foreignAccepts = 0;         // JoinAccepts heard for another DevNonce
+};
+
+class Simulator {
+public:
+  Simulator(Setup setup, int devices, double bootWindowMs, double horizonMs,
+            const LoRaAirtimeParams& params, uint32_t seed)
+    : setup(setup), bootWindowMs(bootWindowMs), horizonMs(horizonMs),
+      state(devices), hasSession(devices, false), rng(seed) {
+    requestMs = loraTimeOnAirUs(params, JOIN_REQUEST_LEN) / 1000.0;
+    acceptMs = loraTimeOnAirUs(params, JOIN_ACCEPT_LEN) / 1000.0;
+    hintMs = loraTimeOnAirUs(params, JOIN_BACKOFF_LEN) / 1000.0;
+    singleRxMs = RADIOLIB_RX_SYMBOLS * loraSymbolTimeUs(params) / 1000.0;
+  }
+
+  Result run() {
+    std::uniform_real_distribution<double> boot(0, bootWindowMs);
+    for (size_t d = 0; d < state.size(); d++) scheduleSend((int)d, bootWindowMs > 0 ? boot(rng) : 0);
+
+    while (!events.empty()) {
+      Event ev = events.top();
+      events.pop();
+      if (ev.at > horizonMs) break;
+      now = ev.at;
+      switch (ev.type) {
+        case EV_SEND:
+          if (state[ev.a].sendToken == ev.b) deviceSend(ev.a);
+          break;
+        case EV_UPLINK_END: uplinkEnd(ev.a); break;
+        case EV_PROCESSED: processed(); break;
+        case EV_TX_END: txEnd(); break;
+        case EV_WAKE: work(); break;
+      }
+    }
+
+    Result result;
+    result.devices = (int)state.size();
+    for (const Device& dev : state) {
+      if (dev.joinedAt < 0) continue;
+      result.joinTimes.push_back(dev.joinedAt);
+      result.attempts += dev.attempt;
+    }
+    result.foreignAccepts = foreignAccepts;
+    std::sort(result.joinTimes.begin(), result.joinTimes.end());
+    return result;
+  }
+
+private:
+  Setup setup;
+  double bootWindowMs, horizonMs;
+  std::vector<Device> state;
+  std::vector<bool> hasSession;
+  std::mt19937 rng;
+  double requestMs, acceptMs, hintMs, singleRxMs;
+  double now = 0;
+  uint64_t seq = 0;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+
+  std::vector<Uplink> uplinks;
+  std::deque<Request> pending;            // RX queue (original) or join queue
+  std::vector<CacheEntry> cache;
+  std::deque<Downlink> txQueue;
+  bool processing = false;
+  Request job = {};
+  bool txActive = false;
+  double txStart = -1, txEndAt = -1;
+  Downlink onAir = {};
+  int foreignAccepts = 0;
+
+  bool queued() const { return setup != SETUP_ORIGINAL; }
+
+  void push(double at, EventType type, int a = 0, int b = 0) {
+    events.push({ at, seq++, type, a, b });
+  }
+
+  double uniform(double low, double high) {
+    return std::uniform_real_distribution<double>(low, high)(rng);
+  }
+
+  // ────── Devices ──────
+
+  void scheduleSend(int d, double at) {
+    push(at, EV_SEND, d, ++state[d].sendToken);
+  }
+
+  void deviceSend(int d) {
+    Device& dev = state[d];
+    if (dev.joinedAt >= 0) return;
+    dev.attempt++;
+    dev.txDoneAt = now + requestMs;
+    uplinks.push_back({ d, dev.attempt, now, dev.txDoneAt, false });
+    push(dev.txDoneAt, EV_UPLINK_END, (int)uplinks.size() - 1);
+    scheduleSend(d, listenEnd(dev) + retryDelayMs(dev.attempt));
+  }
+
+  // End of the last receive window after TX done
+  double listenEnd(const Device& dev) const {
+    if (setup == SETUP_ORIGINAL) return dev.txDoneAt + singleRxMs;
+    return dev.txDoneAt + JOIN_RX2_DELAY_MS + JOIN_RX2_WINDOW_MS + acceptMs + JOIN_RX_GUARD_MS;
+  }
+
+  // A downlink is caught if its preamble starts while the device listens
+  bool listening(const Device& dev, double startedAt) const {
+    double since = startedAt - dev.txDoneAt;
+    if (setup == SETUP_ORIGINAL) return since >= 0 && since <= singleRxMs;
+    return (since >= JOIN_RX1_DELAY_MS && since <= JOIN_RX1_DELAY_MS + JOIN_RX1_WINDOW_MS + JOIN_RX_GUARD_MS) ||
+           (since >= JOIN_RX2_DELAY_MS && since <= JOIN_RX2_DELAY_MS + JOIN_RX2_WINDOW_MS + JOIN_RX_GUARD_MS);
+  }
+
+  double retryDelayMs(int attempt) {
+    if (setup != SETUP_BACKOFF) return RETRY_DELAY_MS;
+    double delayMs = RETRY_DELAY_MS;
+    for (int i = 1; i < attempt && delayMs < JOIN_RETRY_MAX_MS; i++) delayMs *= 2;
+    delayMs = std::min(delayMs, JOIN_RETRY_MAX_MS);
+    return delayMs / 2 + uniform(0, delayMs / 2);
+  }
+
+  // ────── Channel ──────
+
+  void uplinkEnd(int index) {
+    Uplink& up = uplinks[index];
+    // Uplinks are stored by start time; scan back until they ended long ago
+    for (int i = (int)uplinks.size() - 1; i >= 0; i--) {
+      if (i == index) continue;
+      const Uplink& other = uplinks[i];
+      if (other.start >= up.end) continue;
+      if (other.end > up.start) up.lost = true;
+      if (other.start < up.start - 10 * requestMs) break;
+    }
+    if (txEndAt > up.start && txStart < up.end) up.lost = true;
+    if (!up.lost) receive({ up.device, up.attempt, now });
+  }
+
+  // ────── Gateway ──────
+
+  bool cached(int d) {
+    for (size_t i = 0; i < cache.size(); i++) {
+      if (cache[i].device != d) continue;
+      if (now - cache[i].answeredAt < JOIN_CACHE_TTL_MS) return true;
+      cache.erase(cache.begin() + i);
+      return false;
+    }
+    return false;
+  }
+
+  void cacheAnswer(int d) {
+    for (CacheEntry& entry : cache) {
+      if (entry.device == d) {
+        entry.answeredAt = now;
+        return;
+      }
+    }
+    if (cache.size() < JOIN_CACHE_ENTRIES) {
+      cache.push_back({ d, now });
+      return;
+    }
+    auto oldest = std::min_element(cache.begin(), cache.end(),
+                                   [](const CacheEntry& x, const CacheEntry& y) { return x.answeredAt < y.answeredAt; });
+    *oldest = { d, now };
+  }
+
+  // windowSlot() of JoinQueue.cpp: 0 = wait, 1 = RX1, 2 = RX2, 3 = missed
+  int windowSlot(double sinceRx) const {
+    double rx1Open = (JOIN_RX1_DELAY_MS == 0) ? 0 : JOIN_RX1_DELAY_MS + JOIN_RX_GUARD_MS;
+    if (sinceRx < rx1Open) return 0;
+    if (sinceRx <= JOIN_RX1_DELAY_MS + JOIN_RX1_WINDOW_MS) return 1;
+    if (sinceRx < JOIN_RX2_DELAY_MS + JOIN_RX_GUARD_MS) return 0;
+    if (sinceRx <= JOIN_RX2_DELAY_MS + JOIN_RX2_WINDOW_MS) return 2;
+    return 3;
+  }
+
+  void receive(const Request& request) {
+    if (!queued()) {
+      if (pending.size() < RX_QUEUE_CAPACITY) pending.push_back(request);  // RX_DROP_NEWEST
+      work();
+      return;
+    }
+
+    // joinQueuePush(): a newer attempt of a waiting device takes its place
+    for (Request& waiting : pending) {
+      if (waiting.device == request.device) {
+        waiting = request;
+        return;
+      }
+    }
+    if (hasSession[request.device] && !cached(request.device)) return;  // JOIN_ALREADY_JOINED
+    if (pending.size() >= JOIN_QUEUE_CAPACITY) {
+      if (!txActive && txQueue.empty()) sendHint(request);
+      return;
+    }
+    pending.push_back(request);
+    work();
+    // The request becomes sendable again when its RX2 opens
+    push(now + JOIN_RX2_DELAY_MS + JOIN_RX_GUARD_MS, EV_WAKE);
+  }
+
+  void work() {
+    if (processing) return;
+
+    if (!queued()) {
+      // The blocking transmit: nothing is processed while a frame is on the air
+      while (!txActive && !pending.empty()) {
+        Request request = pending.front();
+        pending.pop_front();
+        if (hasSession[request.device]) continue;  // handleJoinIfNeeded(): already joined
+        job = request;
+        processing = true;
+        push(now + INLINE_PROCESS_MS, EV_PROCESSED);
+        return;
+      }
+      return;
+    }
+
+    // joinQueueLoop(): drop missed requests, serve the oldest one in a window
+    int chosen = -1;
+    for (size_t i = 0; i < pending.size();) {
+      int slot = windowSlot(now - pending[i].receivedAt);
+      if (slot == 3) {
+        pending.erase(pending.begin() + i);
+        continue;
+      }
+      if (chosen < 0 && slot != 0) chosen = (int)i;
+      i++;
+    }
+    if (chosen < 0 || txActive || !txQueue.empty()) return;
+    job = pending[chosen];
+    pending.erase(pending.begin() + chosen);
+    processing = true;
+    push(now + QUEUED_PROCESS_MS, EV_PROCESSED);
+  }
+
+  void processed() {
+    processing = false;
+    hasSession[job.device] = true;
+    if (queued()) cacheAnswer(job.device);
+    txQueue.push_back({ job.device, job.attempt, true, 0 });
+    startTx();
+    work();
+  }
+
+  void sendHint(const Request& request) {
+    double wait = (pending.size() + 1) * JOIN_SERVICE_MS;
+    double delayMs = wait + uniform(0, wait);
+    if (delayMs < JOIN_BACKOFF_MIN_MS) delayMs = JOIN_BACKOFF_MIN_MS + uniform(0, JOIN_BACKOFF_MIN_MS);
+    delayMs = std::min(delayMs, JOIN_BACKOFF_MAX_MS);
+    txQueue.push_back({ request.device, request.attempt, false, delayMs });
+    startTx();
+  }
+
+  void startTx() {
+    if (txActive || txQueue.empty()) return;
+    onAir = txQueue.front();
+    txQueue.pop_front();
+    txActive = true;
+    txStart = now;
+    txEndAt = now + (onAir.accept ? acceptMs : hintMs);
+    push(txEndAt, EV_TX_END);
+  }
+
+  void txEnd() {
+    txActive = false;
+    for (size_t d = 0; d < state.size(); d++) {
+      Device& dev = state[d];
+      if (dev.joinedAt >= 0 || !listening(dev, txStart)) continue;
+      bool addressed = (int)d == onAir.device;
+
+      if (onAir.accept && addressed && dev.attempt == onAir.attempt) {
+        dev.joinedAt = now;
+      } else if (onAir.accept) {
+        foreignAccepts++;  // DevNonce mismatch, keeps listening
+      } else if (addressed) {
+        scheduleSend((int)d, now + onAir.delayMs);  // the hint replaces the retry delay
+      }
+    }
+
+    startTx();
+    work();
+  }
+};
+
+// ────── Report ──────
+
+static double percentile(const std::vector<double>& sorted, int total, double q, double missing) {
+  size_t rank = (size_t)(q * (total - 1) + 0.5);
+  return rank < sorted.size() ? sorted[rank] : missing;
+}
+
+static std::vector<Result> runAll(Setup setup, int devices, double bootWindowMs, double horizonMs,
+                                  const LoRaAirtimeParams& params) {
+  std::vector<Result> results;
+  for (int seed = 1; seed <= RUNS; seed++) {
+    Simulator sim(setup, devices, bootWindowMs, horizonMs, params, (uint32_t)(seed * 7919 + devices));
+    results.push_back(sim.run());
+  }
+  return results;
+}
+
+// Mean over the runs; devices that never joined count as the horizon
+static void stormRow(Setup setup, int devices, const LoRaAirtimeParams& params) {
+  const double horizonMs = 600000;
+  double joined = 0, p50 = 0, p90 = 0, max = 0;
+  for (const Result& r : runAll(setup, devices, 2000, horizonMs, params)) {
+    joined += r.joinTimes.size();
+    p50 += percentile(r.joinTimes, r.devices, 0.5, horizonMs);
+    p90 += percentile(r.joinTimes, r.devices, 0.9, horizonMs);
+    max += percentile(r.joinTimes, r.devices, 1.0, horizonMs);
+  }
+  printf("%6d  %-9s %7.0f %7.1f %7.1f %7.1f\n", devices, SETUP_NAMES[setup], joined / RUNS,
+         p50 / RUNS / 1000, p90 / RUNS / 1000, max / RUNS / 1000);
+}
+
+static void sameMomentRow(Setup setup, const LoRaAirtimeParams& params) {
+  const int devices = 50;
+  const double horizonMs = 120000;
+  double at30 = 0, at60 = 0, at120 = 0, attempts = 0, p50 = 0, p90 = 0, foreign = 0;
+  int joinedTotal = 0;
+  for (const Result& r : runAll(setup, devices, 0, horizonMs, params)) {
+    for (double t : r.joinTimes) {
+      at30 += t <= 30000;
+      at60 += t <= 60000;
+      at120 += t <= 120000;
+    }
+    joinedTotal += r.joinTimes.size();
+    attempts += r.attempts;
+    foreign += r.foreignAccepts;
+    p50 += percentile(r.joinTimes, devices, 0.5, horizonMs);
+    p90 += percentile(r.joinTimes, devices, 0.9, horizonMs);
+  }
+  double all = (double)devices * RUNS;
+  printf("%-9s %6.0f%% %6.0f%% %6.0f%% %9.1f %7.1f %7.1f %8.1f\n", SETUP_NAMES[setup], 100 * at30 / all,
+         100 * at60 / all, 100 * at120 / all, joinedTotal ? attempts / joinedTotal : 0.0,
+         p50 / RUNS / 1000, p90 / RUNS / 1000, foreign / RUNS);
+}
+
+int main(int argc, char** argv) {
+  uint8_t sf = (argc > 1) ? (uint8_t)atoi(argv[1]) : 9;
+  LoRaAirtimeParams params = loraAirtimeParams(sf, 125000);
+  const Setup setups[] = { SETUP_ORIGINAL, SETUP_WINDOWS, SETUP_BACKOFF };
+
+  printf("SF%u/125 kHz: JoinRequest %.0f ms, JoinAccept %.0f ms on air, mean of %d runs, times in s\n\n", sf,
+         loraTimeOnAirUs(params, JOIN_REQUEST_LEN) / 1000.0, loraTimeOnAirUs(params, JOIN_ACCEPT_LEN) / 1000.0,
+         RUNS);
+
+  printf("Join storm, devices boot within 2 s, 600 s simulated\n");
+  printf("%6s  %-9s %7s %7s %7s %7s\n", "N", "setup", "joined", "p50", "p90", "max");
+  for (int devices : { 25, 50, 100, 200 }) {
+    for (Setup setup : setups) stormRow(setup, devices, params);
+  }
+
+  printf("\n50 devices booting at the same moment\n");
+  printf("%-9s %7s %7s %7s %9s %7s %7s %8s\n", "setup", "30 s", "60 s", "120 s", "attempts", "p50", "p90",
+         "foreign");
+  for (Setup setup : setups) sameMomentRow(setup, params);
+  return 0;
+}
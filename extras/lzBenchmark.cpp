@@ -0,0 +1,124 @@
+/*
+  OpenEdgeStack - Group File Compression Benchmark (host)
+
+  Compresses synthetic group files with the stream LZSS codec (src/Lz.cpp)
+  and reports, per file:
+  - size before and after, and the ratio
+  - compress and decompress time per file (PC, average of many runs)
+  - stream chunks of STREAM_CHUNK_SIZE (200) bytes raw and compressed
+  - whether sendStoredGroupFile() would send it compressed, i.e. whether it
+    saves at least GROUP_COMPRESS_MIN_SAVING (10) percent
+  Every file is decompressed again and checked against the original.
+
+  The files are TLV group files as storePacket() writes them:
+  [TLV_FORMAT_V1] then [type][length][value] per entry (see src/Tlv.h).
+
+  Build and run on a PC:
+    g++ -O2 -I../src lzBenchmark.cpp ../src/Lz.cpp -o lzBenchmark
+    ./lzBenchmark
+*/
+
+#include "Lz.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const size_t CHUNK_SIZE = 200;
+static const size_t MIN_SAVING_PERCENT = 10;
+static const int ITERATIONS = 2000;
+
+// Values of src/Gateway.h and src/Tlv.h (which need Arduino.h)
+static const uint8_t FORMAT_V1 = 0xE1;
+static const uint8_t TYPE_TEXT = 0x01;
+static const uint8_t TYPE_BYTES = 0x02;
+static const uint8_t TYPE_FLOATS = 0x03;
+
+static void addEntry(std::vector<uint8_t>& file, uint8_t type, const void* value, size_t length) {
+  file.push_back(type);
+  file.push_back((uint8_t)length);   // entries below stay under 128 bytes: one varint byte
+  const uint8_t* bytes = (const uint8_t*)value;
+  file.insert(file.end(), bytes, bytes + length);
+}
+
+static std::vector<uint8_t> temperatureFile() {
+  std::vector<uint8_t> file(1, FORMAT_V1);
+  for (int i = 0; file.size() < 1800; i++) {
+    float reading = 21.0f + 0.0625f * (i % 9);
+    addEntry(file, TYPE_FLOATS, &reading, sizeof(reading));
+  }
+  return file;
+}
+
+static std::vector<uint8_t> multiSensorFile() {
+  std::vector<uint8_t> file(1, FORMAT_V1);
+  for (int i = 0; file.size() < 1800; i++) {
+    float readings[3] = { 21.0f + 0.0625f * (i % 7), 55.0f + (i % 4), 3.9f - 0.001f * i };
+    addEntry(file, TYPE_FLOATS, readings, sizeof(readings));
+  }
+  return file;
+}
+
+static std::vector<uint8_t> textLogFile() {
+  std::vector<uint8_t> file(1, FORMAT_V1);
+  const char* events[] = { "door opened", "door closed", "battery ok", "pump on", "pump off" };
+  for (int i = 0; file.size() < 1800; i++) {
+    std::string line = "t=" + std::to_string(1000 + i * 15) + " " + events[rand() % 5];
+    addEntry(file, TYPE_TEXT, line.data(), line.size());
+  }
+  return file;
+}
+
+static std::vector<uint8_t> randomBytesFile() {
+  std::vector<uint8_t> file(1, FORMAT_V1);
+  while (file.size() < 1800) {
+    uint8_t value[16];
+    for (uint8_t& b : value) b = (uint8_t)rand();
+    addEntry(file, TYPE_BYTES, value, sizeof(value));
+  }
+  return file;
+}
+
+static bool benchmark(const char* name, const std::vector<uint8_t>& file) {
+  std::vector<uint16_t> work(LZ_WORK_ENTRIES);
+  std::vector<uint8_t> compressed(lzCompressBound(file.size()));
+  std::vector<uint8_t> decoded(file.size());
+
+  size_t compressedLen = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int it = 0; it < ITERATIONS; it++) {
+    compressedLen = lzCompress(file.data(), file.size(), compressed.data(), compressed.size(), work.data());
+  }
+  double compressUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+
+  size_t decodedLen = 0;
+  start = std::chrono::steady_clock::now();
+  for (int it = 0; it < ITERATIONS; it++) {
+    decodedLen = lzDecompress(compressed.data(), compressedLen, decoded.data(), decoded.size());
+  }
+  double decompressUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+
+  bool ok = compressedLen > 0 && decodedLen == file.size() && decoded == file;
+  bool sendCompressed = compressedLen * 100 <= file.size() * (100 - MIN_SAVING_PERCENT);
+  size_t rawChunks = (file.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  size_t sentChunks = sendCompressed ? (compressedLen + CHUNK_SIZE - 1) / CHUNK_SIZE : rawChunks;
+
+  printf("%-14s %5zu -> %5zu  %5.1f %%  %8.1f us  %8.1f us  %2zu -> %2zu  %-10s  %s\n",
+         name, file.size(), compressedLen, 100.0 * compressedLen / file.size(), compressUs, decompressUs,
+         rawChunks, sentChunks, sendCompressed ? "compressed" : "raw", ok ? "ok" : "MISMATCH");
+  return ok;
+}
+
+int main() {
+  srand(1);
+  printf("file           bytes            ratio    compress  decompress  chunks    sent as\n");
+  bool ok = true;
+  ok = benchmark("temperature", temperatureFile()) && ok;
+  ok = benchmark("multi-sensor", multiSensorFile()) && ok;
+  ok = benchmark("text log", textLogFile()) && ok;
+  ok = benchmark("random bytes", randomBytesFile()) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,384 @@
+/*
+  OpenEdgeStack - PacketView Benchmark (host)
+
+  Runs a fixed set of legacy data frames ([Sender ID 8][Nonce 16][payload]
+  [HMAC 8], see src/PacketView.h) through the gateway's uplink path three
+  ways: parse, session lookup, HMAC check and decryption. It reports packets
+  per second for each:
+
+  - original:   handleLoRaPacket() before PacketView. The offsets are
+                derived by hand, the sender ID becomes a hex String that keys
+                a std::map, and the session and both keys are copied. The
+                HMAC key and appSKey are set up for every packet, and the
+                payload is decrypted into a stack VLA.
+  - PacketView: parsePacket() validates the length once and points into the
+                RX buffer. The session is found by its 64-bit DevEUI key,
+                and decryptInPlace() XORs the keystream over the ciphertext.
+                Crypto setup is still per packet.
+  - cached:     PacketView with the per-session AES key schedule and the
+                precomputed HMAC pads the library uses now.
+
+  The frame set is generated once from a fixed seed (64 devices, 4096
+  frames, TLV payloads of 8..120 bytes), so every run sees the same frames.
+  Every path must decrypt each frame to the same plaintext, and the
+  checksums are compared at the end.
+
+  The mbedtls calls are the ones the library makes on the ESP32 (mbedtls
+  2.28). Logging is left out of every path.
+
+  Build and run on a PC (needs libmbedtls-dev):
+    g++ -O2 packetViewBenchmark.cpp -lmbedcrypto -o packetViewBenchmark
+    ./packetViewBenchmark
+*/
+
+#include <mbedtls/aes.h>
+#include <mbedtls/md.h>
+#include <mbedtls/sha256.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+static const size_t DEVICES = 64;
+static const size_t FRAMES = 4096;
+static const int ROUNDS = 20;
+
+// Layout of src/PacketView.h (legacy frames)
+static const size_t SRC_ID_LEN = 8;
+static const size_t NONCE_LEN = 16;
+static const size_t HMAC_LEN = 8;
+static const size_t HEADER_LEN = SRC_ID_LEN + NONCE_LEN;
+static const size_t OVERHEAD = HEADER_LEN + HMAC_LEN;
+static const size_t MAX_LEN = 255;
+
+static const uint8_t HMAC_KEY[32] = {
+  0x3a, 0x91, 0x5c, 0x07, 0xe2, 0x48, 0xb6, 0x1d, 0x7f, 0x20, 0xc4, 0x9e, 0x05, 0x63, 0xda, 0x81,
+  0x12, 0xf8, 0x6b, 0x3e, 0xa7, 0x54, 0x09, 0xcd, 0x90, 0x2b, 0x76, 0xe1, 0x4f, 0xb3, 0x68, 0x1c
+};
+
+// Subset of SessionInfo (src/Sessions.h) the RX path reads
+struct Session {
+  uint8_t devEUI[8];
+  uint8_t appSKey[16];
+  uint8_t nwkSKey[16];
+  uint32_t devAddr;
+  uint32_t fcntUp;
+  uint32_t fcntDown;
+};
+
+struct Frame {
+  uint8_t data[MAX_LEN];
+  uint8_t length;
+};
+
+static std::vector<Session> sessions;
+static std::vector<Frame> frames;
+
+// ────── Frame Set ──────
+
+static void aesCtr(const uint8_t* key, const uint8_t* nonce, const uint8_t* in, size_t length, uint8_t* out) {
+  mbedtls_aes_context ctx;
+  mbedtls_aes_init(&ctx);
+  mbedtls_aes_setkey_enc(&ctx, key, 128);
+  uint8_t counter[16], block[16];
+  size_t offset = 0;
+  memcpy(counter, nonce, 16);
+  mbedtls_aes_crypt_ctr(&ctx, length, &offset, counter, block, in, out);
+  mbedtls_aes_free(&ctx);
+}
+
+static void hmacOneShot(const uint8_t* msg, size_t length, uint8_t* out) {
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), HMAC_KEY, sizeof(HMAC_KEY), msg, length, out);
+}
+
+static void buildFrameSet() {
+  srand(1);
+  sessions.resize(DEVICES);
+  for (size_t d = 0; d < DEVICES; d++) {
+    Session& s = sessions[d];
+    for (int i = 0; i < 8; i++) s.devEUI[i] = (uint8_t)rand();
+    for (int i = 0; i < 16; i++) s.appSKey[i] = (uint8_t)rand();
+    for (int i = 0; i < 16; i++) s.nwkSKey[i] = (uint8_t)rand();
+    s.devAddr = (uint32_t)rand();
+    s.fcntUp = s.fcntDown = 0;
+  }
+
+  frames.resize(FRAMES);
+  for (Frame& f : frames) {
+    const Session& s = sessions[rand() % DEVICES];
+    size_t payloadLen = 8 + rand() % 113;
+
+    // TLV payload as encryptAndPackage() would get it: [0xE1][type][len][value]
+    uint8_t plain[MAX_LEN];
+    plain[0] = 0xE1;
+    plain[1] = 0x03;
+    plain[2] = (uint8_t)(payloadLen - 3);
+    for (size_t i = 3; i < payloadLen; i++) plain[i] = (uint8_t)(0x40 + rand() % 32);
+
+    memcpy(f.data, s.devEUI, SRC_ID_LEN);
+    memcpy(f.data + SRC_ID_LEN, s.devEUI, 8);
+    for (int i = 8; i < 16; i++) f.data[SRC_ID_LEN + i] = (uint8_t)rand();
+    aesCtr(s.appSKey, f.data + SRC_ID_LEN, plain, payloadLen, f.data + HEADER_LEN);
+
+    uint8_t mac[32];
+    hmacOneShot(f.data, HEADER_LEN + payloadLen, mac);
+    memcpy(f.data + HEADER_LEN + payloadLen, mac, HMAC_LEN);
+    f.length = (uint8_t)(HEADER_LEN + payloadLen + HMAC_LEN);
+  }
+}
+
+static uint32_t checksum(const uint8_t* data, size_t length, uint32_t sum) {
+  for (size_t i = 0; i < length; i++) sum = sum * 31 + data[i];
+  return sum;
+}
+
+// ────── Original Path ──────
+
+// Arduino String stand-in: idToHexString() appended two characters per byte
+static std::string idToHexString(const uint8_t* id) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out = "";
+  for (int i = 0; i < 8; i++) {
+    out += digits[id[i] >> 4];
+    out += digits[id[i] & 0x0F];
+  }
+  return out;
+}
+
+static std::map<std::string, Session> sessionMap;
+
+static bool handleOriginal(uint8_t* buffer, size_t length, uint32_t& sum) {
+  if (length <= 18) return false;
+
+  uint8_t* srcID = buffer;
+  uint8_t* nonce = buffer + 8;
+  uint8_t* payload = buffer + 24;
+  uint8_t* receivedHMAC = buffer + length - 8;
+  size_t payloadLength = length - 8 - 8 - 16;
+
+  std::string srcIDString = idToHexString(srcID);
+  auto it = sessionMap.find(srcIDString);
+  if (it == sessionMap.end()) return false;
+  Session session = it->second;
+
+  uint8_t localAppSKey[16], localNwkSKey[16];
+  memcpy(localAppSKey, session.appSKey, 16);
+  memcpy(localNwkSKey, session.nwkSKey, 16);
+
+  uint8_t computed[32];
+  hmacOneShot(buffer, length - 8, computed);
+  for (int i = 0; i < 8; i++) {
+    if (computed[i] != receivedHMAC[i]) return false;
+  }
+
+  uint8_t decryptedPayload[payloadLength];
+  aesCtr(localAppSKey, nonce, payload, payloadLength, decryptedPayload);
+  sum = checksum(decryptedPayload, payloadLength, sum);
+  return true;
+}
+
+// ────── PacketView Path ──────
+
+struct PacketView {
+  uint8_t* raw;
+  size_t length;
+  uint8_t* srcID;
+  uint8_t* nonce;
+  uint8_t* payload;
+  size_t payloadLength;
+  uint8_t* hmac;
+};
+
+static bool parsePacket(uint8_t* buffer, size_t length, PacketView& view) {
+  if (buffer == nullptr || length <= OVERHEAD || length > MAX_LEN) return false;
+  view.raw = buffer;
+  view.length = length;
+  view.srcID = buffer;
+  view.nonce = buffer + SRC_ID_LEN;
+  view.payload = buffer + HEADER_LEN;
+  view.payloadLength = length - OVERHEAD;
+  view.hmac = buffer + length - HMAC_LEN;
+  return true;
+}
+
+static uint64_t devEUIToKey(const uint8_t* devEUI) {
+  uint64_t key = 0;
+  for (int i = 0; i < 8; i++) key = (key << 8) | devEUI[i];
+  return key;
+}
+
+// Open-addressed index over a fixed slot array, as the session table in src/Sessions.cpp
+static const size_t INDEX_SIZE = 2 * DEVICES;
+static const uint16_t INDEX_EMPTY = 0xFFFF;
+
+struct SessionEntry {
+  uint64_t key;
+  Session info;
+  mbedtls_aes_context appSKeyCtx;
+};
+
+static SessionEntry slots[DEVICES];
+static uint16_t sessionIndex[INDEX_SIZE];
+
+static size_t hashKey(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return (size_t)(key % INDEX_SIZE);
+}
+
+static SessionEntry* findEntry(uint64_t key) {
+  size_t pos = hashKey(key);
+  while (sessionIndex[pos] != INDEX_EMPTY) {
+    SessionEntry& entry = slots[sessionIndex[pos]];
+    if (entry.key == key) return &entry;
+    pos = (pos + 1) % INDEX_SIZE;
+  }
+  return nullptr;
+}
+
+static bool handlePacketView(uint8_t* buffer, size_t length, uint32_t& sum) {
+  PacketView view;
+  if (!parsePacket(buffer, length, view)) return false;
+
+  SessionEntry* entry = findEntry(devEUIToKey(view.srcID));
+  if (!entry) return false;
+
+  uint8_t computed[32];
+  hmacOneShot(view.raw, view.length - HMAC_LEN, computed);
+  uint8_t diff = 0;
+  for (size_t i = 0; i < HMAC_LEN; i++) diff |= computed[i] ^ view.hmac[i];
+  if (diff != 0) return false;
+
+  aesCtr(entry->info.appSKey, view.nonce, view.payload, view.payloadLength, view.payload);
+  sum = checksum(view.payload, view.payloadLength, sum);
+  return true;
+}
+
+// ────── Cached Contexts ──────
+// HMAC-SHA256 with the inner and outer pads hashed once (hmacKeyInit() /
+// hmacCompute() in src/CryptoUtils.cpp) and the appSKey schedule kept with
+// the session (SessionCrypto).
+
+static mbedtls_sha256_context hmacInner, hmacOuter;
+
+static void hmacInit() {
+  uint8_t keyBlock[64] = {0};
+  uint8_t pad[64];
+  memcpy(keyBlock, HMAC_KEY, sizeof(HMAC_KEY));
+
+  mbedtls_sha256_init(&hmacInner);
+  mbedtls_sha256_starts(&hmacInner, 0);
+  for (int i = 0; i < 64; i++) pad[i] = keyBlock[i] ^ 0x36;
+  mbedtls_sha256_update(&hmacInner, pad, 64);
+
+  mbedtls_sha256_init(&hmacOuter);
+  mbedtls_sha256_starts(&hmacOuter, 0);
+  for (int i = 0; i < 64; i++) pad[i] = keyBlock[i] ^ 0x5C;
+  mbedtls_sha256_update(&hmacOuter, pad, 64);
+}
+
+static void hmacCached(const uint8_t* msg, size_t length, uint8_t* out) {
+  uint8_t innerDigest[32];
+  mbedtls_sha256_context work;
+  mbedtls_sha256_init(&work);
+  mbedtls_sha256_clone(&work, &hmacInner);
+  mbedtls_sha256_update(&work, msg, length);
+  mbedtls_sha256_finish(&work, innerDigest);
+  mbedtls_sha256_clone(&work, &hmacOuter);
+  mbedtls_sha256_update(&work, innerDigest, sizeof(innerDigest));
+  mbedtls_sha256_finish(&work, out);
+  mbedtls_sha256_free(&work);
+}
+
+static bool handleCached(uint8_t* buffer, size_t length, uint32_t& sum) {
+  PacketView view;
+  if (!parsePacket(buffer, length, view)) return false;
+
+  SessionEntry* entry = findEntry(devEUIToKey(view.srcID));
+  if (!entry) return false;
+
+  uint8_t computed[32];
+  hmacCached(view.raw, view.length - HMAC_LEN, computed);
+  uint8_t diff = 0;
+  for (size_t i = 0; i < HMAC_LEN; i++) diff |= computed[i] ^ view.hmac[i];
+  if (diff != 0) return false;
+
+  uint8_t counter[16], block[16];
+  size_t offset = 0;
+  memcpy(counter, view.nonce, 16);
+  mbedtls_aes_crypt_ctr(&entry->appSKeyCtx, view.payloadLength, &offset, counter, block,
+                        view.payload, view.payload);
+  sum = checksum(view.payload, view.payloadLength, sum);
+  return true;
+}
+
+// ────── Benchmark ──────
+
+static void loadSessions() {
+  for (size_t d = 0; d < DEVICES; d++) {
+    sessionMap[idToHexString(sessions[d].devEUI)] = sessions[d];
+  }
+
+  memset(sessionIndex, 0xFF, sizeof(sessionIndex));
+  for (size_t d = 0; d < DEVICES; d++) {
+    SessionEntry& entry = slots[d];
+    entry.key = devEUIToKey(sessions[d].devEUI);
+    entry.info = sessions[d];
+    mbedtls_aes_init(&entry.appSKeyCtx);
+    mbedtls_aes_setkey_enc(&entry.appSKeyCtx, entry.info.appSKey, 128);
+
+    size_t pos = hashKey(entry.key);
+    while (sessionIndex[pos] != INDEX_EMPTY) pos = (pos + 1) % INDEX_SIZE;
+    sessionIndex[pos] = (uint16_t)d;
+  }
+  hmacInit();
+}
+
+// The in-place paths overwrite the ciphertext, so every round starts from a
+// fresh copy of the frame set (copy time is excluded)
+static double run(const char* name, bool (*handle)(uint8_t*, size_t, uint32_t&), uint32_t& sum) {
+  std::vector<Frame> work;
+  double seconds = 0;
+  size_t accepted = 0;
+  sum = 0;
+
+  for (int round = 0; round < ROUNDS; round++) {
+    work = frames;
+    auto start = std::chrono::steady_clock::now();
+    for (Frame& f : work) {
+      if (handle(f.data, f.length, sum)) accepted++;
+    }
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  double rate = accepted / seconds;
+  printf("%-12s %10.0f pkt/s  %6.2f us/pkt  %zu/%zu accepted  checksum %08x\n",
+         name, rate, 1e6 / rate, accepted, FRAMES * ROUNDS, (unsigned)sum);
+  return rate;
+}
+
+int main() {
+  buildFrameSet();
+  loadSessions();
+
+  size_t bytes = 0;
+  for (const Frame& f : frames) bytes += f.length;
+  printf("%zu frames from %zu devices, %.1f bytes average, %d rounds\n\n",
+         FRAMES, DEVICES, (double)bytes / FRAMES, ROUNDS);
+
+  uint32_t sumOriginal, sumView, sumCached;
+  double original = run("original", handleOriginal, sumOriginal);
+  double view = run("PacketView", handlePacketView, sumView);
+  double cached = run("cached", handleCached, sumCached);
+
+  printf("\nPacketView %.2fx, cached %.2fx the original rate\n", view / original, cached / original);
+
+  bool ok = sumOriginal == sumView && sumOriginal == sumCached;
+  if (!ok) printf("MISMATCH: the paths decrypted different plaintext\n");
+  return ok ? 0 : 1;
+}
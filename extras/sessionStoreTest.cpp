@@ -0,0 +1,287 @@
+/*
+  OpenEdgeStack - Session Store Host Test
+
+  Runs the session store (src/SessionStore.cpp) against FileSessionStorage
+  in a temporary directory, the file-backed stand-in for Preferences, and
+  checks:
+  - put / get of sessions whose DevEUIs share a 4-byte prefix
+  - write-behind: puts are staged, and a flush writes each touched page once
+  - a rebuilt directory (as after a reboot): scan, lookups by devAddr
+  - update and remove coalesced into one page write
+  - the SESSION_FLUSH_DELAY_MS write-behind timer of sessionStoreLoop()
+  - upgrade of a version 1 page (64-byte records) to the current layout
+  - a failing page write keeps its records staged until a later flush
+
+  The platform hooks of SessionStore.h are defined below. The record body is
+  only XOR-scrambled here; the device seals it with AES (CryptoUtils.cpp).
+
+  Build and run on a PC:
+    g++ -O2 -Wall -Wextra -I../src sessionStoreTest.cpp ../src/SessionStore.cpp -o sessionStoreTest
+    ./sessionStoreTest
+*/
+
+#include "SessionStore.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static bool verbose = false;
+static uint32_t fakeMillis = 0;
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL line %d: %s\n", __LINE__, #cond); failures++; } } while (0)
+
+// ────── Platform Hooks ──────
+
+static std::string tempDir(const char* name) {
+  char path[] = "/tmp/sessionStoreXXXXXX";
+  std::string dir = mkdtemp(path);
+  return dir + "/" + name + "_";
+}
+
+SessionStorage* sessionStoreDefaultStorage() {
+  static FileSessionStorage files(tempDir("default").c_str());
+  return &files;
+}
+
+uint32_t sessionStoreMillis() {
+  return fakeMillis;
+}
+
+void sessionStoreLog(const char* format, ...) {
+  if (!verbose) return;
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n");
+}
+
+// Same body layout as encryptSession(): devAddr | appSKey | nwkSKey |
+// joinNonce | netID | devNonce | 4 zero bytes (checked on unseal)
+void sessionStoreSeal(const SessionInfo& session, uint8_t* out) {
+  uint8_t body[SESSION_BLOB_LEN] = {0};
+  for (int i = 0; i < 4; i++) body[i] = (session.devAddr >> (8 * i)) & 0xFF;
+  memcpy(body + 4, session.appSKey, 16);
+  memcpy(body + 20, session.nwkSKey, 16);
+  memcpy(body + 36, session.joinNonce, 3);
+  memcpy(body + 39, session.netID, 3);
+  memcpy(body + 42, session.devNonce, 2);
+  for (size_t i = 0; i < SESSION_BLOB_LEN; i++) out[i] = body[i] ^ (uint8_t)(0x5A + i);
+}
+
+bool sessionStoreUnseal(const uint8_t* in, SessionInfo& session) {
+  uint8_t body[SESSION_BLOB_LEN];
+  for (size_t i = 0; i < SESSION_BLOB_LEN; i++) body[i] = in[i] ^ (uint8_t)(0x5A + i);
+  if (body[44] || body[45] || body[46] || body[47]) return false;
+  session.devAddr = (uint32_t)body[0] | ((uint32_t)body[1] << 8) | ((uint32_t)body[2] << 16) | ((uint32_t)body[3] << 24);
+  memcpy(session.appSKey, body + 4, 16);
+  memcpy(session.nwkSKey, body + 20, 16);
+  memcpy(session.joinNonce, body + 36, 3);
+  memcpy(session.netID, body + 39, 3);
+  memcpy(session.devNonce, body + 42, 2);
+  return true;
+}
+
+// ────── Helpers ──────
+
+// Devices 0..n share the first four EUI bytes, as one vendor's batch would
+static SessionInfo makeSession(int n) {
+  SessionInfo s = {};
+  const uint8_t eui[8] = { 0x70, 0xB3, 0xD5, 0x7E, 0x00, 0x00, (uint8_t)(n >> 8), (uint8_t)n };
+  memcpy(s.devEUI, eui, 8);
+  s.devAddr = 0x26010000u + n;
+  for (int i = 0; i < 16; i++) {
+    s.appSKey[i] = (uint8_t)(n + i);
+    s.nwkSKey[i] = (uint8_t)(n * 3 + i);
+  }
+  s.devNonce[0] = (uint8_t)n;
+  s.fcntUp = 64u * n;
+  s.fcntDown = 64u;
+  return s;
+}
+
+static bool sameSession(const SessionInfo& a, const SessionInfo& b) {
+  return memcmp(a.devEUI, b.devEUI, 8) == 0 && a.devAddr == b.devAddr &&
+         memcmp(a.appSKey, b.appSKey, 16) == 0 && memcmp(a.nwkSKey, b.nwkSKey, 16) == 0 &&
+         memcmp(a.devNonce, b.devNonce, 2) == 0 && a.fcntUp == b.fcntUp && a.fcntDown == b.fcntDown;
+}
+
+static size_t fileSize(const std::string& path) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fclose(f);
+  return size > 0 ? (size_t)size : 0;
+}
+
+// Backend whose page writes can be made to fail
+class FlakyStorage : public FileSessionStorage {
+public:
+    explicit FlakyStorage(const char* prefix) : FileSessionStorage(prefix) {}
+    size_t putBytes(const char* key, const void* buf, size_t len) override {
+        return failWrites ? 0 : FileSessionStorage::putBytes(key, buf, len);
+    }
+    bool failWrites = false;
+};
+
+static void countSession(const SessionInfo&, void* context) {
+  (*(size_t*)context)++;
+}
+
+// ────── Tests ──────
+
+static const int DEVICES = 20;
+
+static void testPutFlushGet(const std::string& prefix) {
+  FileSessionStorage files(prefix.c_str());
+  setSessionStorage(&files);
+  sessionStoreClear();
+
+  SessionStoreStats before = getSessionStoreStats();
+  for (int n = 0; n < DEVICES; n++) CHECK(sessionStorePut(makeSession(n)));
+  CHECK(sessionStorePending() > 0);
+  CHECK(sessionStoreCount() == DEVICES);
+
+  // Staged records are visible before the flush
+  SessionInfo s;
+  CHECK(sessionStoreGet(makeSession(DEVICES - 1).devEUI, s) && sameSession(s, makeSession(DEVICES - 1)));
+
+  CHECK(sessionStoreFlush());
+  CHECK(sessionStorePending() == 0);
+  SessionStoreStats after = getSessionStoreStats();
+  size_t pages = (DEVICES + SESSION_STORE_PAGE_RECORDS - 1) / SESSION_STORE_PAGE_RECORDS;
+  printf("put/flush: %d sessions -> %u page writes in %u flushes (%u pages)\n", DEVICES,
+         (unsigned)(after.pageWrites - before.pageWrites), (unsigned)(after.flushes - before.flushes), (unsigned)pages);
+  // The staging buffer may force one early flush; a page is written at most once per flush
+  CHECK(after.pageWrites - before.pageWrites <= 2 * pages);
+  CHECK(fileSize(prefix + "sess00") == SESSION_PAGE_LEN);
+
+  for (int n = 0; n < DEVICES; n++) {
+    CHECK(sessionStoreGet(makeSession(n).devEUI, s) && sameSession(s, makeSession(n)));
+  }
+}
+
+static void testReloadScan(const std::string& prefix) {
+  // A second backend over the same files rebuilds the directory from flash
+  FileSessionStorage files(prefix.c_str());
+  setSessionStorage(&files);
+
+  size_t visited = 0;
+  CHECK(sessionStoreScan(countSession, &visited) == DEVICES);
+  CHECK(visited == DEVICES);
+  CHECK(sessionStoreCount() == DEVICES);
+
+  uint8_t eui[8];
+  CHECK(sessionStoreFindAddr(makeSession(7).devAddr, eui) && memcmp(eui, makeSession(7).devEUI, 8) == 0);
+  CHECK(!sessionStoreFindAddr(0xDEADBEEF, eui));
+  CHECK(sessionStoreContains(makeSession(3).devEUI));
+}
+
+static void testUpdateRemove(const std::string& prefix) {
+  FileSessionStorage files(prefix.c_str());
+  setSessionStorage(&files);
+
+  SessionInfo updated = makeSession(1);
+  updated.fcntUp = 4096;
+  CHECK(sessionStorePut(updated));
+  sessionStoreRemove(makeSession(2).devEUI);
+  CHECK(sessionStorePending() == 2);
+
+  SessionStoreStats before = getSessionStoreStats();
+  CHECK(sessionStoreFlush());
+  CHECK(getSessionStoreStats().pageWrites - before.pageWrites == 1);   // same page, one write
+
+  SessionInfo s;
+  CHECK(sessionStoreGet(updated.devEUI, s) && s.fcntUp == 4096);
+  CHECK(!sessionStoreGet(makeSession(2).devEUI, s));
+  CHECK(sessionStoreCount() == DEVICES - 1);
+}
+
+static void testWriteBehind(const std::string& prefix) {
+  FileSessionStorage files(prefix.c_str());
+  setSessionStorage(&files);
+
+  CHECK(sessionStorePut(makeSession(2)));
+  fakeMillis += SESSION_FLUSH_DELAY_MS - 1;
+  sessionStoreLoop();
+  CHECK(sessionStorePending() == 1);
+  fakeMillis += 1;
+  sessionStoreLoop();
+  CHECK(sessionStorePending() == 0);
+}
+
+static void testUpgradeV1(const std::string& prefix) {
+  // Version 1 page: [0x53][1][64][0] + 8 x [DevEUI 8][flags 1][reserved 7][body 48]
+  uint8_t page[4 + SESSION_STORE_PAGE_RECORDS * 64] = { 0x53, 1, 64, 0 };
+  for (int r = 0; r < 3; r++) {
+    SessionInfo s = makeSession(100 + r);
+    uint8_t* record = page + 4 + r * 64;
+    memcpy(record, s.devEUI, 8);
+    record[8] = 0x01;
+    sessionStoreSeal(s, record + 16);
+  }
+  FILE* f = fopen((prefix + "sess00").c_str(), "wb");
+  fwrite(page, 1, sizeof(page), f);
+  fclose(f);
+
+  FileSessionStorage files(prefix.c_str());
+  setSessionStorage(&files);
+  CHECK(sessionStoreCount() == 3);
+
+  SessionInfo s;
+  for (int r = 0; r < 3; r++) {
+    SessionInfo expected = makeSession(100 + r);
+    expected.fcntUp = expected.fcntDown = 0;   // version 1 kept no counters
+    CHECK(sessionStoreGet(expected.devEUI, s) && sameSession(s, expected));
+  }
+  uint8_t eui[8];
+  CHECK(sessionStoreFindAddr(makeSession(101).devAddr, eui));
+
+  // The next write of the page stores it in the current layout
+  CHECK(sessionStorePut(makeSession(103)));
+  CHECK(sessionStoreFlush());
+  CHECK(fileSize(prefix + "sess00") == SESSION_PAGE_LEN);
+  CHECK(sessionStoreGet(makeSession(100).devEUI, s) && s.devAddr == makeSession(100).devAddr);
+  printf("upgrade: version 1 page of %u bytes rewritten as %u bytes\n",
+         (unsigned)sizeof(page), (unsigned)SESSION_PAGE_LEN);
+}
+
+static void testFailedWrite(const std::string& prefix) {
+  FlakyStorage files(prefix.c_str());
+  setSessionStorage(&files);
+  sessionStoreClear();
+
+  files.failWrites = true;
+  CHECK(sessionStorePut(makeSession(5)));
+  uint32_t failed = getSessionStoreStats().failedWrites;
+  CHECK(!sessionStoreFlush());
+  CHECK(sessionStorePending() == 1);
+  CHECK(getSessionStoreStats().failedWrites == failed + 1);
+
+  files.failWrites = false;
+  CHECK(sessionStoreFlush());
+  CHECK(sessionStorePending() == 0);
+  SessionInfo s;
+  CHECK(sessionStoreGet(makeSession(5).devEUI, s) && sameSession(s, makeSession(5)));
+  setSessionStorage(nullptr);   // flushes nothing, back to the default backend
+}
+
+int main(int argc, char** argv) {
+  verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+  std::string dir = tempDir("lora");
+  testPutFlushGet(dir);
+  testReloadScan(dir);
+  testUpdateRemove(dir);
+  testWriteBehind(dir);
+  testUpgradeV1(tempDir("v1"));
+  testFailedWrite(tempDir("flaky"));
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+/*
+  OpenEdgeStack - Stream Reassembly Host Test
+
+  Feeds chunks to the reassembler (src/StreamReassembly.cpp) in various
+  orders and checks:
+  - in-order delivery completes on the final chunk
+  - the final chunk arriving first, in the middle or last
+  - a chunk beyond the final one stored before the final chunk arrives:
+    it is dropped and the stream still completes
+  - duplicates of a completed stream and the ACK bitmap of a partial one
+  - the STREAM_TIMEOUT_MS slot timeout of streamReassemblyLoop()
+
+  The platform hooks of StreamReassembly.h are defined below.
+
+  Build and run on a PC:
+    g++ -O2 -Wall -Wextra -I../src streamReassemblyTest.cpp ../src/StreamReassembly.cpp ../src/Fec.cpp ../src/Lz.cpp -o streamReassemblyTest
+    ./streamReassemblyTest
+*/
+
+#include "StreamReassembly.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+static bool verbose = false;
+static uint32_t fakeMillis = 0;
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL line %d: %s\n", __LINE__, #cond); failures++; } } while (0)
+
+// Last stream handed to the completion callback
+static int completions = 0;
+static uint8_t completedId = 0;
+static uint8_t completedData[STREAM_MAX_LEN];
+static size_t completedLength = 0;
+
+// ────── Platform Hooks ──────
+
+uint32_t streamReassemblyMillis() {
+  return fakeMillis;
+}
+
+uint32_t streamReassemblyMicros() {
+  return fakeMillis * 1000;
+}
+
+void streamReassemblyLog(const char* format, ...) {
+  if (!verbose) return;
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n");
+}
+
+void streamReassemblyDefaultCallback(const uint8_t*, uint8_t streamId, const uint8_t* data, size_t length) {
+  completions++;
+  completedId = streamId;
+  memcpy(completedData, data, length);
+  completedLength = length;
+}
+
+// ────── Helpers ──────
+
+static const uint8_t DEV_EUI[8] = { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, 0x00, 0x01 };
+
+static uint8_t streamByte(size_t offset) {
+  return (uint8_t)(offset * 7 + 3);
+}
+
+// Pushes chunk `seq` of a `length`-byte stream, flagged final if it is the last
+static StreamResult pushChunk(uint8_t streamId, uint16_t seq, size_t length, uint8_t flags = 0) {
+  uint16_t chunks = (length + STREAM_CHUNK_SIZE - 1) / STREAM_CHUNK_SIZE;
+  size_t offset = (size_t)seq * STREAM_CHUNK_SIZE;
+  size_t dataLength = (seq == chunks - 1) ? length - offset : STREAM_CHUNK_SIZE;
+  if (seq == chunks - 1) flags |= STREAM_FLAG_FINAL;
+
+  uint8_t chunk[STREAM_CHUNK_HEADER_LEN + STREAM_CHUNK_SIZE];
+  size_t headerLen = streamChunkHeader(chunk, streamId, seq, flags);
+  for (size_t i = 0; i < dataLength; i++) chunk[headerLen + i] = streamByte(offset + i);
+  return streamReassemblyPush(DEV_EUI, chunk, headerLen + dataLength);
+}
+
+static bool completedIntact(uint8_t streamId, size_t length) {
+  if (completedId != streamId || completedLength != length) return false;
+  for (size_t i = 0; i < length; i++) {
+    if (completedData[i] != streamByte(i)) return false;
+  }
+  return true;
+}
+
+// Pushes the chunks of a stream in the given order; only the last push may complete it
+static void pushInOrder(uint8_t streamId, size_t length, const uint16_t* order, size_t count) {
+  int before = completions;
+  for (size_t i = 0; i < count; i++) {
+    StreamResult result = pushChunk(streamId, order[i], length);
+    CHECK(result == (i + 1 == count ? STREAM_COMPLETE : STREAM_CHUNK_STORED));
+  }
+  CHECK(completions == before + 1);
+  CHECK(completedIntact(streamId, length));
+}
+
+// ────── Tests ──────
+
+static void testOrders() {
+  const size_t length = 3 * STREAM_CHUNK_SIZE + 57;   // 4 chunks, short final one
+  const uint16_t inOrder[] = { 0, 1, 2, 3 };
+  const uint16_t finalFirst[] = { 3, 0, 2, 1 };
+  const uint16_t finalMiddle[] = { 1, 3, 0, 2 };
+  const uint16_t reversed[] = { 3, 2, 1, 0 };
+
+  pushInOrder(1, length, inOrder, 4);
+  pushInOrder(2, length, finalFirst, 4);
+  pushInOrder(3, length, finalMiddle, 4);
+  pushInOrder(4, length, reversed, 4);
+  CHECK(streamSlotsInUse() == 0);
+  printf("orders: in order, final first, final in the middle and reversed all complete\n");
+}
+
+static void testChunkBeyondFinal() {
+  // Chunks 0 and 2 stored, then chunk 1 arrives flagged final: chunk 2 cannot
+  // belong to a 2-chunk stream, so it is dropped and the stream completes
+  const size_t length = STREAM_CHUNK_SIZE + 40;
+  uint32_t rejected = getStreamStats().rejected;
+
+  CHECK(pushChunk(10, 0, 3 * STREAM_CHUNK_SIZE) == STREAM_CHUNK_STORED);
+  CHECK(pushChunk(10, 2, 3 * STREAM_CHUNK_SIZE) == STREAM_CHUNK_STORED);
+  CHECK(pushChunk(10, 1, length) == STREAM_COMPLETE);
+  CHECK(completedIntact(10, length));
+  CHECK(getStreamStats().rejected == rejected + 1);
+  CHECK(streamSlotsInUse() == 0);
+
+  // Final chunk alone first, then a higher chunk is refused, then the rest
+  CHECK(pushChunk(11, 2, 3 * STREAM_CHUNK_SIZE - 1) == STREAM_CHUNK_STORED);
+  CHECK(pushChunk(11, 3, 4 * STREAM_CHUNK_SIZE) == STREAM_REJECTED);
+  CHECK(pushChunk(11, 1, 3 * STREAM_CHUNK_SIZE - 1) == STREAM_CHUNK_STORED);
+  CHECK(pushChunk(11, 0, 3 * STREAM_CHUNK_SIZE - 1) == STREAM_COMPLETE);
+  CHECK(completedIntact(11, 3 * STREAM_CHUNK_SIZE - 1));
+  printf("beyond final: stray chunk dropped, stream completed; higher chunk after final refused\n");
+}
+
+static void testDuplicatesAndAcks() {
+  const size_t length = 4 * STREAM_CHUNK_SIZE;
+  uint32_t duplicates = getStreamStats().duplicates;
+
+  CHECK(pushChunk(20, 0, length) == STREAM_CHUNK_STORED);
+  CHECK(pushChunk(20, 0, length) == STREAM_DUPLICATE);
+  CHECK(pushChunk(20, 3, length) == STREAM_CHUNK_STORED);
+
+  // ACK requested on chunk 3: chunks 1 and 2 are missing
+  uint8_t chunk[STREAM_CHUNK_HEADER_LEN];
+  streamChunkHeader(chunk, 20, 3, STREAM_FLAG_ACK_REQ);
+  StreamAck ack;
+  CHECK(streamAckFor(DEV_EUI, chunk, sizeof(chunk), ack));
+  CHECK(!ack.complete && ack.missingMask == 0x06);
+
+  uint8_t encoded[STREAM_ACK_LEN];
+  StreamAck decoded;
+  CHECK(streamAckDecode(encoded, streamAckEncode(encoded, ack), decoded));
+  CHECK(decoded.streamId == 20 && !decoded.complete && decoded.missingMask == 0x06);
+
+  CHECK(pushChunk(20, 2, length) == STREAM_CHUNK_STORED);
+  CHECK(pushChunk(20, 1, length) == STREAM_COMPLETE);
+  CHECK(pushChunk(20, 1, length) == STREAM_DUPLICATE);
+  CHECK(streamAckFor(DEV_EUI, chunk, sizeof(chunk), ack) && ack.complete && ack.missingMask == 0);
+  CHECK(getStreamStats().duplicates == duplicates + 2);
+  printf("acks: missing chunks reported, completed stream acknowledged\n");
+}
+
+static void testTimeout() {
+  uint32_t timedOut = getStreamStats().timedOut;
+  CHECK(pushChunk(30, 0, 2 * STREAM_CHUNK_SIZE) == STREAM_CHUNK_STORED);
+  CHECK(streamSlotsInUse() == 1);
+
+  fakeMillis += STREAM_TIMEOUT_MS;
+  streamReassemblyLoop();
+  CHECK(streamSlotsInUse() == 1);
+  fakeMillis += 1;
+  streamReassemblyLoop();
+  CHECK(streamSlotsInUse() == 0);
+  CHECK(getStreamStats().timedOut == timedOut + 1);
+  printf("timeout: idle slot reclaimed after %u ms\n", (unsigned)STREAM_TIMEOUT_MS);
+}
+
+int main(int argc, char** argv) {
+  verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+  testOrders();
+  testChunkBeyondFinal();
+  testDuplicatesAndAcks();
+  testTimeout();
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
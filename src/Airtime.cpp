@@ -0,0 +1,47 @@
+#include "Airtime.h"
+
+// ────── Parameters ──────
+
+LoRaAirtimeParams loraAirtimeParams(uint8_t spreadingFactor, uint32_t bandwidthHz) {
+  LoRaAirtimeParams params;
+  params.spreadingFactor = spreadingFactor;
+  params.bandwidthHz = bandwidthHz;
+  params.codingRate = 5;
+  params.preambleLength = 8;
+  params.explicitHeader = true;
+  params.crc = true;
+  params.lowDataRateOptimize = false;
+  params.lowDataRateOptimize = loraSymbolTimeUs(params) >= 16000;
+  return params;
+}
+
+static bool validParams(const LoRaAirtimeParams& params) {
+  return params.spreadingFactor >= 6 && params.spreadingFactor <= 12 &&
+         params.bandwidthHz > 0 && params.codingRate >= 5 && params.codingRate <= 8;
+}
+
+// ────── Time-on-Air ──────
+// Symbols are counted in quarters (the preamble adds 4.25) and converted in
+// one 64-bit step, so non-power-of-two bandwidths stay exact to the microsecond.
+
+uint32_t loraSymbolTimeUs(const LoRaAirtimeParams& params) {
+  if (!validParams(params)) return 0;
+  return (uint32_t)(((uint64_t)1000000 << params.spreadingFactor) / params.bandwidthHz);
+}
+
+uint32_t loraTimeOnAirUs(const LoRaAirtimeParams& params, size_t length) {
+  if (!validParams(params)) return 0;
+
+  int32_t sf = params.spreadingFactor;
+  int32_t de = params.lowDataRateOptimize ? 1 : 0;
+  int32_t ih = params.explicitHeader ? 0 : 1;
+  int32_t crc = params.crc ? 1 : 0;
+
+  int32_t bits = 8 * (int32_t)length - 4 * sf + 28 + 16 * crc - 20 * ih;
+  int32_t perBlock = 4 * (sf - 2 * de);
+  int32_t blocks = (bits > 0) ? (bits + perBlock - 1) / perBlock : 0;
+  uint32_t payloadSymbols = 8 + (uint32_t)blocks * params.codingRate;
+
+  uint64_t quarterSymbols = (uint64_t)params.preambleLength * 4 + 17 + (uint64_t)payloadSymbols * 4;
+  return (uint32_t)((quarterSymbols * ((uint64_t)1000000 << sf)) / (4ULL * params.bandwidthHz));
+}
@@ -0,0 +1,58 @@
+#ifndef AIRTIME_H
+#define AIRTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * LoRa Time-on-Air
+ *
+ * Closed-form time-on-air of a LoRa frame (Semtech AN1200.13):
+ *
+ *   Tsym     = 2^SF / BW
+ *   Tpreamble = (preamble + 4.25) * Tsym
+ *   payload  = 8 + max(ceil((8 PL - 4 SF + 28 + 16 CRC - 20 IH) / (4 (SF - 2 DE))) * CR, 0)
+ *
+ * with CR the coding rate denominator (5..8 for 4/5..4/8), IH = 1 for an
+ * implicit header and DE = 1 with low data rate optimization. Computed from
+ * the modem parameters alone, so it also builds on the host (see
+ * extras/airtimeReport.cpp) and needs no radio instance.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+/**
+ * @brief Modem parameters that determine the time-on-air.
+ */
+struct LoRaAirtimeParams {
+    uint8_t spreadingFactor;    ///< 6..12
+    uint32_t bandwidthHz;       ///< e.g. 125000
+    uint8_t codingRate;         ///< Denominator 5..8 (4/5..4/8)
+    uint16_t preambleLength;    ///< Programmed preamble symbols (RadioLib default 8)
+    bool explicitHeader;        ///< Explicit PHY header (default)
+    bool crc;                   ///< Payload CRC on
+    bool lowDataRateOptimize;   ///< Required when a symbol lasts 16 ms or more
+};
+
+/**
+ * @brief Default parameters (CR 4/5, 8 preamble symbols, explicit header,
+ *        CRC on) for a spreading factor and bandwidth; low data rate
+ *        optimization is enabled where a symbol lasts 16 ms or more.
+ */
+LoRaAirtimeParams loraAirtimeParams(uint8_t spreadingFactor, uint32_t bandwidthHz);
+
+/**
+ * @brief Duration of one symbol in microseconds.
+ */
+uint32_t loraSymbolTimeUs(const LoRaAirtimeParams& params);
+
+/**
+ * @brief Time-on-air of a frame in microseconds.
+ *
+ * @param params Modem parameters
+ * @param length PHY payload length in bytes (the whole frame passed to the radio)
+ * @return Time-on-air, 0 for invalid parameters
+ */
+uint32_t loraTimeOnAirUs(const LoRaAirtimeParams& params, size_t length);
+
+#endif // AIRTIME_H
@@ -1,10 +1,12 @@
 #include <CryptoUtils.h>
 #include "Gateway.h"
 #include <Sessions.h>
+#include "KeystreamPool.h"
 
 #include <Arduino.h>
 #include "mbedtls/md.h"
 #include "mbedtls/aes.h"
+#include "mbedtls/sha256.h"
 
 
 
@@ -24,6 +26,80 @@ void computeHMAC_SHA256(const uint8_t* key, size_t keyLen, const uint8_t* msg, s
   mbedtls_md_hmac(mdInfo, key, keyLen, msg, msgLen, out);
 }
 
+// ────── Keyed HMAC-SHA256 (precomputed midstate) ──────
+
+// HMAC(K, m) = H((K ^ opad) || H((K ^ ipad) || m))
+// The two 64-byte key blocks are absorbed once here; per message the saved
+// states are cloned, so only the message and the 32-byte inner digest are hashed.
+
+#define HMAC_BLOCK_SIZE 64
+
+void hmacKeyInit(HmacKeyContext& ctx, const uint8_t* key, size_t keyLen) {
+  uint8_t keyBlock[HMAC_BLOCK_SIZE] = {0};
+
+  // Keys longer than the block size are hashed first (RFC 2104)
+  if (keyLen > HMAC_BLOCK_SIZE) {
+    mbedtls_sha256_context tmp;
+    mbedtls_sha256_init(&tmp);
+    mbedtls_sha256_starts(&tmp, 0);
+    mbedtls_sha256_update(&tmp, key, keyLen);
+    mbedtls_sha256_finish(&tmp, keyBlock);
+    mbedtls_sha256_free(&tmp);
+  } else {
+    memcpy(keyBlock, key, keyLen);
+  }
+
+  uint8_t pad[HMAC_BLOCK_SIZE];
+
+  mbedtls_sha256_init(&ctx.inner);
+  mbedtls_sha256_starts(&ctx.inner, 0);
+  for (int i = 0; i < HMAC_BLOCK_SIZE; i++) pad[i] = keyBlock[i] ^ 0x36;
+  mbedtls_sha256_update(&ctx.inner, pad, HMAC_BLOCK_SIZE);
+
+  mbedtls_sha256_init(&ctx.outer);
+  mbedtls_sha256_starts(&ctx.outer, 0);
+  for (int i = 0; i < HMAC_BLOCK_SIZE; i++) pad[i] = keyBlock[i] ^ 0x5C;
+  mbedtls_sha256_update(&ctx.outer, pad, HMAC_BLOCK_SIZE);
+
+  memset(keyBlock, 0, sizeof(keyBlock));
+  memset(pad, 0, sizeof(pad));
+  ctx.ready = true;
+}
+
+void hmacKeyFree(HmacKeyContext& ctx) {
+  if (!ctx.ready) return;
+  mbedtls_sha256_free(&ctx.inner);
+  mbedtls_sha256_free(&ctx.outer);
+  ctx.ready = false;
+}
+
+void hmacCompute(const HmacKeyContext& ctx, const HmacSegment* segments, size_t count, uint8_t* out) {
+  uint8_t innerDigest[32];
+  mbedtls_sha256_context work;
+  mbedtls_sha256_init(&work);
+
+  mbedtls_sha256_clone(&work, &ctx.inner);
+  for (size_t i = 0; i < count; i++) {
+    mbedtls_sha256_update(&work, segments[i].data, segments[i].len);
+  }
+  mbedtls_sha256_finish(&work, innerDigest);
+
+  mbedtls_sha256_clone(&work, &ctx.outer);
+  mbedtls_sha256_update(&work, innerDigest, sizeof(innerDigest));
+  mbedtls_sha256_finish(&work, out);
+
+  mbedtls_sha256_free(&work);
+}
+
+static HmacKeyContext sharedHmacCtx;
+
+const HmacKeyContext& sharedHmacContext() {
+  if (!sharedHmacCtx.ready) {
+    hmacKeyInit(sharedHmacCtx, hmacKey, sizeof(hmacKey));
+  }
+  return sharedHmacCtx;
+}
+
 // Verifies an incoming HMAC by comparing the first 8 bytes of the computed HMAC
 // against the received one.
 // Inputs:
@@ -37,7 +113,8 @@ void computeHMAC_SHA256(const uint8_t* key, size_t keyLen, const uint8_t* msg, s
 
 bool verifyHMAC(uint8_t* buffer, size_t length, uint8_t* receivedHMAC) {
   uint8_t computedHMAC[32];
-  computeHMAC_SHA256(hmacKey, sizeof(hmacKey), buffer, length - 8, computedHMAC);
+  HmacSegment message = { buffer, length - 8 };
+  hmacCompute(sharedHmacContext(), &message, 1, computedHMAC);
   printHex(computedHMAC, 8, "[INFO] Truncated for compare: ");
 
   for (int i = 0; i < 8; i++) {
@@ -50,7 +127,8 @@ bool verifyHMAC(uint8_t* buffer, size_t length, uint8_t* receivedHMAC) {
 
 bool verifyMIC(uint8_t* buffer, size_t length, uint8_t* receivedHMAC) {
   uint8_t computedHMAC[32];
-  computeHMAC_SHA256(hmacKey, sizeof(hmacKey), buffer, length - 4, computedHMAC);
+  HmacSegment message = { buffer, length - 4 };
+  hmacCompute(sharedHmacContext(), &message, 1, computedHMAC);
   printHex(computedHMAC, 4, "[INFO] Truncated for compare: ");
 
   for (int i = 0; i < 4; i++) {
@@ -104,23 +182,127 @@ void aes128_encrypt_ctr(const uint8_t* key, const uint8_t* nonce, const uint8_t*
   mbedtls_aes_free(&ctx);
 }
 
+void aes128_encrypt_block_ctx(mbedtls_aes_context* ctx, const uint8_t* input, uint8_t* output) {
+  mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, input, output);
+}
+
+void aes128_decrypt_block_ctx(mbedtls_aes_context* ctx, const uint8_t* input, uint8_t* output) {
+  mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_DECRYPT, input, output);
+}
+
+void aes128_encrypt_ctr_ctx(mbedtls_aes_context* ctx, const uint8_t* nonce, const uint8_t* input, size_t length, uint8_t* output) {
+  uint8_t stream_block[16];
+  size_t nc_off = 0;
+  uint8_t nonce_counter[16];
+  memcpy(nonce_counter, nonce, 16); // nonce should be unique per packet
+
+  mbedtls_aes_crypt_ctr(ctx, length, &nc_off, nonce_counter, stream_block, input, output);
+}
+
+// ────── Cached Key Schedules ──────
+
+// Key expansion is done once per key instead of once per packet/block.
+// - appKey: one encrypt and one decrypt context, expanded on first use
+// - Session keys: one SessionCrypto per session, owned by the session table
+
+static mbedtls_aes_context appKeyEncCtx;
+static mbedtls_aes_context appKeyDecCtx;
+static bool appKeyCtxReady = false;
+
+static void ensureAppKeyContexts() {
+  if (appKeyCtxReady) return;
+  mbedtls_aes_init(&appKeyEncCtx);
+  mbedtls_aes_init(&appKeyDecCtx);
+  mbedtls_aes_setkey_enc(&appKeyEncCtx, appKey, 128);
+  mbedtls_aes_setkey_dec(&appKeyDecCtx, appKey, 128);
+  appKeyCtxReady = true;
+}
+
+mbedtls_aes_context* appKeyEncContext() {
+  ensureAppKeyContexts();
+  return &appKeyEncCtx;
+}
+
+mbedtls_aes_context* appKeyDecContext() {
+  ensureAppKeyContexts();
+  return &appKeyDecCtx;
+}
+
+void refreshAppKeyContexts() {
+  if (appKeyCtxReady) {
+    mbedtls_aes_free(&appKeyEncCtx);
+    mbedtls_aes_free(&appKeyDecCtx);
+    appKeyCtxReady = false;
+  }
+  ensureAppKeyContexts();
+}
+
+void initSessionCrypto(SessionCrypto& crypto, const SessionInfo& session) {
+  mbedtls_aes_init(&crypto.appSKeyCtx);
+  mbedtls_aes_init(&crypto.nwkSKeyCtx);
+  mbedtls_aes_setkey_enc(&crypto.appSKeyCtx, session.appSKey, 128);
+  mbedtls_aes_setkey_enc(&crypto.nwkSKeyCtx, session.nwkSKey, 128);
+  memcpy(crypto.appSKey, session.appSKey, 16);
+  memcpy(crypto.nwkSKey, session.nwkSKey, 16);
+  crypto.ready = true;
+}
+
+void freeSessionCrypto(SessionCrypto& crypto) {
+  if (!crypto.ready) return;
+  mbedtls_aes_free(&crypto.appSKeyCtx);
+  mbedtls_aes_free(&crypto.nwkSKeyCtx);
+  memset(crypto.appSKey, 0, 16);
+  memset(crypto.nwkSKey, 0, 16);
+  crypto.ready = false;
+}
+
 // ────── Session Encryption ──────
 
-// Encrypts or decrypts an entire SessionInfo struct (32 bytes total) using two AES blocks.
+// Encrypts or decrypts the persistent fields of a SessionInfo using three AES blocks.
 // Purpose:
-//   - Used when securely storing or transmitting session data (to persistent storage or peers)
-// Inputs:
-//   - For encryption: session struct + appKey → encrypted 32 bytes
-//   - For decryption: 32-byte input + appKey → reconstructed session struct
+//   - Used when securely storing session data in persistent storage
+// Body layout (before encryption, 48 bytes):
+//   devAddr (4, little-endian) | appSKey (16) | nwkSKey (16) |
+//   joinNonce (3) | netID (3) | devNonce (2) | zero padding (4)
+// The fields are serialized explicitly so struct padding never reaches flash,
+// and the zero padding doubles as a cheap check on decryption.
 
 void encryptSession(const SessionInfo& session, uint8_t* out) {
-  aes128_encrypt_block(appKey, (uint8_t*)&session, out);  // 32 bytes → 2 AES blocks
-  aes128_encrypt_block(appKey, ((uint8_t*)&session) + 16, out + 16);
+  uint8_t body[SESSION_BLOB_LEN] = {0};
+  body[0] = session.devAddr & 0xFF;
+  body[1] = (session.devAddr >> 8) & 0xFF;
+  body[2] = (session.devAddr >> 16) & 0xFF;
+  body[3] = (session.devAddr >> 24) & 0xFF;
+  memcpy(body + 4, session.appSKey, 16);
+  memcpy(body + 20, session.nwkSKey, 16);
+  memcpy(body + 36, session.joinNonce, 3);
+  memcpy(body + 39, session.netID, 3);
+  memcpy(body + 42, session.devNonce, 2);
+
+  for (size_t i = 0; i < SESSION_BLOB_LEN; i += 16) {
+    aes128_encrypt_block_ctx(appKeyEncContext(), body + i, out + i);
+  }
+  memset(body, 0, sizeof(body));
 }
 
-void decryptSession(const uint8_t* in, SessionInfo& session) {
-  aes128_decrypt_block(appKey, in, (uint8_t*)&session);
-  aes128_decrypt_block(appKey, in + 16, ((uint8_t*)&session) + 16);
+bool decryptSession(const uint8_t* in, SessionInfo& session) {
+  uint8_t body[SESSION_BLOB_LEN];
+  for (size_t i = 0; i < SESSION_BLOB_LEN; i += 16) {
+    aes128_decrypt_block_ctx(appKeyDecContext(), in + i, body + i);
+  }
+
+  bool valid = body[44] == 0 && body[45] == 0 && body[46] == 0 && body[47] == 0;
+  if (valid) {
+    session.devAddr = (uint32_t)body[0] | ((uint32_t)body[1] << 8) |
+                      ((uint32_t)body[2] << 16) | ((uint32_t)body[3] << 24);
+    memcpy(session.appSKey, body + 4, 16);
+    memcpy(session.nwkSKey, body + 20, 16);
+    memcpy(session.joinNonce, body + 36, 3);
+    memcpy(session.netID, body + 39, 3);
+    memcpy(session.devNonce, body + 42, 2);
+  }
+  memset(body, 0, sizeof(body));
+  return valid;
 }
 
 // ────── Encrypted Payload Packet Layout ──────
@@ -138,14 +320,16 @@ void decryptSession(const uint8_t* in, SessionInfo& session) {
 // - Nonce format: [Sender ID (8B) | Random CTR (8B)]
 // - HMAC is computed over: [Sender ID + Nonce + Encrypted Payload]
 // - Final packet length = 8 (Sender) + 16 (Nonce) + payloadLen + 8 (HMAC)
-// - Caller must free returned buffer
+// - Segment overload writes into a caller buffer (no heap), the pointer
+//   overload allocates the packet once and the caller must free it
+// - With frameFormat() == FRAME_FORMAT_COMPACT the 7-byte compact header
+//   replaces [Sender ID][Nonce] (see encryptCompactFrame() below)
 //
 // Inputs:
-//   - payloadData: Raw data to encrypt
-//   - payloadLen: Length of payloadData
+//   - segments/count (or payloadData/payloadLen): Raw data to encrypt
 //   - session: Contains appSKey
-//   - finalLen: Reference set to total packet length
 //   - Sender: 8-byte devEUI
+//   - out/outCapacity: Caller-owned packet buffer (>= 8+16+N+8 bytes)
 //
 // Output:
 //   - Returns full packet: [Sender ID][Nonce][Encrypted Payload][HMAC]
@@ -153,44 +337,158 @@ void decryptSession(const uint8_t* in, SessionInfo& session) {
 
 
 
-uint8_t* encryptAndPackage(
-  const uint8_t* payloadData, size_t payloadLen,
+void makePacketNonce(uint8_t* nonce, const uint8_t* sender) {
+  memcpy(nonce, sender, 8);
+  uint64_t ctr = esp_random(); // ensure different for each packet
+  memcpy(nonce + 8, &ctr, 8);
+}
+
+void makeFrameNonce(uint8_t* nonce, uint8_t direction, uint32_t devAddr, uint32_t fcnt) {
+  memset(nonce, 0, 16);
+  for (int i = 0; i < 4; i++) {
+    nonce[i] = (devAddr >> (8 * i)) & 0xFF;
+    nonce[4 + i] = (fcnt >> (8 * i)) & 0xFF;
+  }
+  nonce[8] = direction;
+  nonce[12] = 0xC0;
+}
+
+// Moves a CTR counter block forward by `blocks` (128-bit big-endian, as mbedtls counts)
+static void ctrAdvance(uint8_t* counter, size_t blocks) {
+  while (blocks--) {
+    for (int i = 15; i >= 0; i--) {
+      if (++counter[i] != 0) break;
+    }
+  }
+}
+
+// Encrypts every segment into `cipher` as one CTR stream: XOR with the pooled
+// prefix, AES only for blocks past it
+static void encryptSegments(const DataSegment* segments, size_t count, const SessionInfo& session,
+                            const uint8_t* nonce, const uint8_t* pooled, size_t pooledLen,
+                            uint8_t* cipher) {
+  uint8_t nonceCounter[16];
+  uint8_t streamBlock[16];
+  size_t ncOff = 0;
+  memcpy(nonceCounter, nonce, 16);
+  ctrAdvance(nonceCounter, pooledLen / 16);
+
+  size_t pos = 0;
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* plain = segments[i].data;
+    size_t len = segments[i].len;
+    size_t xorLen = (pos >= pooledLen) ? 0 : (len < pooledLen - pos) ? len : pooledLen - pos;
+    for (size_t j = 0; j < xorLen; j++) {
+      cipher[j] = plain[j] ^ pooled[pos + j];
+    }
+    if (xorLen < len) {
+      SessionCrypto& crypto = sessionCryptoFor(session);
+      mbedtls_aes_crypt_ctr(&crypto.appSKeyCtx, len - xorLen, &ncOff, nonceCounter, streamBlock,
+                            plain + xorLen, cipher + xorLen);
+    }
+    cipher += len;
+    pos += len;
+  }
+}
+
+// ────── Compact Frame Packaging ──────
+// [FType][DevAddr 4][FCnt low bytes][Encrypted Payload][HMAC 8], see PacketView.h.
+// The counter is taken from the session table before anything is written,
+// so every frame built here has a counter (and nonce) of its own.
+
+static size_t encryptCompactFrame(
+  const DataSegment* segments, size_t count, size_t payloadLen,
   const SessionInfo& session,
-  size_t& finalLen,
-  const uint8_t* Sender
+  uint8_t* out
 ) {
-  uint8_t appSKey[16];
-  memcpy(appSKey, session.appSKey, 16);
+  uint8_t direction = (memcmp(session.devEUI, devEUI, 8) == 0) ? FRAME_DIR_UP : FRAME_DIR_DOWN;
+  uint32_t fcnt;
+  if (!sessionNextTxCounter(session, direction, fcnt)) return 0;
+
+  // 1. Header
+  out[0] = ((direction == FRAME_DIR_UP) ? FTYPE_DATA_UP : FTYPE_DATA_DOWN) | (FRAME_FCNT_LEN - 1);
+  for (int i = 0; i < FRAME_ADDR_LEN; i++) out[1 + i] = (session.devAddr >> (8 * i)) & 0xFF;
+  for (int i = 0; i < FRAME_FCNT_LEN; i++) out[1 + FRAME_ADDR_LEN + i] = (fcnt >> (8 * i)) & 0xFF;
+
+  // 2. Payload, nonce rebuilt from devAddr + counter; the pool only hands
+  //    out an entry computed for exactly this counter
+  uint8_t nonce[16];
+  makeFrameNonce(nonce, direction, session.devAddr, fcnt);
+  uint8_t pooled[KEYSTREAM_ENTRY_LEN];
+  size_t pooledLen = keystreamPoolTakeCounter(session, fcnt, pooled, payloadLen);
+  encryptSegments(segments, count, session, nonce, pooled, pooledLen, out + FRAME_HEADER_LEN);
+  memset(pooled, 0, sizeof(pooled));
+
+  // 3. HMAC over [header + EncryptedPayload] and the full 32-bit counter
+  uint8_t fcntBytes[4] = { (uint8_t)fcnt, (uint8_t)(fcnt >> 8), (uint8_t)(fcnt >> 16), (uint8_t)(fcnt >> 24) };
+  HmacSegment message[2] = {
+    { out, FRAME_HEADER_LEN + payloadLen },
+    { fcntBytes, sizeof(fcntBytes) }
+  };
+  uint8_t hmacResult[32];
+  hmacCompute(sharedHmacContext(), message, 2, hmacResult);
+  memcpy(out + FRAME_HEADER_LEN + payloadLen, hmacResult, PACKET_HMAC_LEN);
 
-  // 1. Prepare nonce (CTR IV): use sender ID + a counter or random value
-  uint8_t nonce[16] = {0};
-  memcpy(nonce, Sender, 8);
-  uint64_t ctr = esp_random(); // ensure different for each packet
-  memcpy(nonce + 8, &ctr, 8);
+  return FRAME_OVERHEAD + payloadLen;
+}
 
-  // 2. Encrypt with CTR
-  uint8_t* encryptedPayload = new uint8_t[payloadLen];
-  aes128_encrypt_ctr(appSKey, nonce, payloadData, payloadLen, encryptedPayload);
+size_t encryptAndPackage(
+  const DataSegment* segments, size_t count,
+  const SessionInfo& session,
+  const uint8_t* Sender,
+  uint8_t* out, size_t outCapacity
+) {
+  size_t payloadLen = 0;
+  for (size_t i = 0; i < count; i++) payloadLen += segments[i].len;
+
+  if (out == nullptr) return 0;
+  if (frameFormat() == FRAME_FORMAT_COMPACT) {
+    if (FRAME_OVERHEAD + payloadLen > outCapacity) return 0;
+    size_t compactLen = encryptCompactFrame(segments, count, payloadLen, session, out);
+    if (compactLen > 0) return compactLen;
+    // In the table but no counter: its checkpoint could not be written, and a
+    // legacy frame would dodge the counter, so nothing is sent
+    if (sessionCached(session.devEUI)) return 0;
+  }
 
-  // 3. Build [Sender ID][Nonce][Encrypted Payload]
-  size_t baseLen = 8 + 16 + payloadLen;
-  uint8_t* fullPayload = new uint8_t[baseLen];
-  memcpy(fullPayload, Sender, 8);
-  memcpy(fullPayload + 8, nonce, 16);
-  memcpy(fullPayload + 24, encryptedPayload, payloadLen);
+  size_t finalLen = PACKET_OVERHEAD + payloadLen;
+  if (finalLen > outCapacity) {
+    return 0;
+  }
+
+  // 1. Header: [Sender ID][Nonce], nonce = sender ID + a counter or random value.
+  //    A pooled entry brings its nonce and precomputed keystream along.
+  uint8_t* nonce = out + PACKET_SRC_ID_LEN;
+  memcpy(out, Sender, 8);
+  uint8_t pooled[KEYSTREAM_ENTRY_LEN];
+  size_t pooledLen = keystreamPoolTake(session, Sender, nonce, pooled, payloadLen);
+  if (pooledLen == 0) {
+    makePacketNonce(nonce, Sender);
+  }
 
-  // 4. Compute HMAC over [Sender ID + Nonce + EncryptedPayload]
+  // 2. Encrypt every segment into its final position as one CTR stream
+  encryptSegments(segments, count, session, nonce, pooled, pooledLen, out + PACKET_HEADER_LEN);
+  memset(pooled, 0, sizeof(pooled));
+
+  // 3. HMAC over [Sender ID + Nonce + EncryptedPayload], truncated 8B written in place
   uint8_t hmacResult[32];
-  computeHMAC_SHA256(hmacKey, sizeof(hmacKey), fullPayload, baseLen, hmacResult);
+  HmacSegment message = { out, PACKET_HEADER_LEN + payloadLen };
+  hmacCompute(sharedHmacContext(), &message, 1, hmacResult);
+  memcpy(out + PACKET_HEADER_LEN + payloadLen, hmacResult, PACKET_HMAC_LEN);
 
-  // 5. Final packet = fullPayload + HMAC (truncated 8B)
-  finalLen = baseLen + 8;
-  uint8_t* finalPacket = new uint8_t[finalLen];
-  memcpy(finalPacket, fullPayload, baseLen);
-  memcpy(finalPacket + baseLen, hmacResult, 8);
+  return finalLen;
+}
 
-  delete[] encryptedPayload;
-  delete[] fullPayload;
+uint8_t* encryptAndPackage(
+  const uint8_t* payloadData, size_t payloadLen,
+  const SessionInfo& session,
+  size_t& finalLen,
+  const uint8_t* Sender
+) {
+  DataSegment payload = { payloadData, payloadLen };
+  size_t capacity = PACKET_OVERHEAD + payloadLen;  // fits either header
+  uint8_t* finalPacket = new uint8_t[capacity];
+  finalLen = encryptAndPackage(&payload, 1, session, Sender, finalPacket, capacity);
   return finalPacket;
 }
 
@@ -5,7 +5,26 @@
 #include <Sessions.h>
 #include <Arduino.h>
 #include "Gateway.h"
+#include "PacketView.h"
+#include "mbedtls/aes.h"
+#include "mbedtls/sha256.h"
 
+/**
+ * @brief One contiguous piece of a message (type byte, payload, header, nonce, ...).
+ */
+struct DataSegment {
+    const uint8_t* data;
+    size_t len;
+};
+
+typedef DataSegment HmacSegment;
+
+/**
+ * @brief Encrypts a payload and returns a newly allocated packet.
+ *
+ * Caller must delete[] the returned buffer. Prefer the scatter-gather
+ * overload below on long-running devices, it does not touch the heap.
+ */
 uint8_t* encryptAndPackage(
   const uint8_t* payloadData, size_t payloadLen,
   const SessionInfo& session,
@@ -13,6 +32,55 @@ uint8_t* encryptAndPackage(
   const uint8_t* Sender
 );
 
+/**
+ * @brief Encrypts a list of payload segments straight into a caller-owned packet buffer.
+ *
+ * The segments are encrypted as one contiguous CTR stream directly at their
+ * final offset and the HMAC is computed in place. No heap allocation.
+ *
+ * The header follows frameFormat(): compact frames carry the session's
+ * devAddr and next frame counter (uplink if the session is this device's own,
+ * downlink otherwise). A session missing from the table falls back to the
+ * legacy header, which needs no counter. Returns 0 if the session's counter
+ * checkpoint cannot be written (see sessionNextTxCounter()).
+ *
+ * @param segments Plaintext pieces (e.g. {type byte}, {payload}), in order
+ * @param count Number of segments
+ * @param session Session providing appSKey
+ * @param Sender 8-byte devEUI (legacy header only)
+ * @param out Output buffer, at least PACKET_OVERHEAD + total segment length bytes
+ * @param outCapacity Size of `out`
+ * @return Final packet length, or 0 if `out` is too small or the frame is refused
+ */
+size_t encryptAndPackage(
+  const DataSegment* segments, size_t count,
+  const SessionInfo& session,
+  const uint8_t* Sender,
+  uint8_t* out, size_t outCapacity
+);
+
+/**
+ * @brief Writes a fresh packet nonce: [sender ID 8][random 8].
+ *
+ * @param nonce 16-byte destination
+ * @param sender 8-byte sender ID
+ */
+void makePacketNonce(uint8_t* nonce, const uint8_t* sender);
+
+/**
+ * @brief Writes the nonce of a compact frame, rebuilt from session state:
+ *        [devAddr 4][FCnt 4][direction 1][0 3][0xC0][0 3] (CTR block counter last).
+ *
+ * Byte 12 is never set in a legacy nonce's counter blocks, so the two
+ * layouts cannot produce the same counter block.
+ *
+ * @param nonce 16-byte destination
+ * @param direction FRAME_DIR_UP or FRAME_DIR_DOWN
+ * @param devAddr Device address of the session
+ * @param fcnt Full 32-bit frame counter
+ */
+void makeFrameNonce(uint8_t* nonce, uint8_t direction, uint32_t devAddr, uint32_t fcnt);
+
 /**
  * @brief Decrypts a full encrypted payload using AES-128 in ECB mode. 
  *
@@ -44,6 +112,51 @@ void printHex(const uint8_t* data, size_t len, const char* label);
  */
 void computeHMAC_SHA256(const uint8_t* key, size_t keyLen, const uint8_t* msg, size_t msgLen, uint8_t* out);
 
+/**
+ * @brief HMAC-SHA256 key with precomputed inner/outer midstates.
+ *
+ * The SHA-256 states after absorbing (key ^ ipad) and (key ^ opad) are
+ * computed once and cloned per message, saving two compression-function
+ * calls per HMAC.
+ */
+struct HmacKeyContext {
+    mbedtls_sha256_context inner;     ///< State after (key ^ ipad)
+    mbedtls_sha256_context outer;     ///< State after (key ^ opad)
+    bool ready;
+};
+
+/**
+ * @brief Precomputes the ipad/opad midstates for `key`.
+ *
+ * @param ctx Destination context
+ * @param key HMAC secret key
+ * @param keyLen Length of the key
+ */
+void hmacKeyInit(HmacKeyContext& ctx, const uint8_t* key, size_t keyLen);
+
+/**
+ * @brief Releases and wipes a keyed HMAC context.
+ */
+void hmacKeyFree(HmacKeyContext& ctx);
+
+/**
+ * @brief Computes HMAC-SHA256 over a message given as separate segments.
+ *
+ * Equivalent to computeHMAC_SHA256() over the concatenation of all segments,
+ * without building the concatenated buffer.
+ *
+ * @param ctx Keyed context from hmacKeyInit()
+ * @param segments Message pieces, in order
+ * @param count Number of segments
+ * @param out Output buffer (32 bytes)
+ */
+void hmacCompute(const HmacKeyContext& ctx, const HmacSegment* segments, size_t count, uint8_t* out);
+
+/**
+ * @brief Keyed context for the shared global hmacKey, initialized on first use.
+ */
+const HmacKeyContext& sharedHmacContext();
+
 /**
  * @brief Verifies an incoming HMAC by comparing the first 8 bytes of the computed HMAC
  *        against the received one. 
@@ -67,12 +180,62 @@ void aes128_encrypt_block(const uint8_t* key, const uint8_t* input, uint8_t* out
 
 void aes128_decrypt_block(const uint8_t* key, const uint8_t* input, uint8_t* output);
 
+/**
+ * @brief Encrypts a session's persistent fields with appKey.
+ *
+ * The DevEUI is not part of the body; it is stored alongside it.
+ *
+ * @param session Session to encrypt
+ * @param out SESSION_BLOB_LEN-byte destination
+ */
 void encryptSession(const SessionInfo& session, uint8_t* out);
 
-void decryptSession(const uint8_t* in, SessionInfo& session);
+/**
+ * @brief Decrypts a body produced by encryptSession().
+ *
+ * @param in SESSION_BLOB_LEN-byte encrypted body
+ * @param session Destination, devEUI is left untouched
+ * @return false if the padding does not check out (wrong appKey or corrupt)
+ */
+bool decryptSession(const uint8_t* in, SessionInfo& session);
 
 void aes128_encrypt_ctr(const uint8_t* key, const uint8_t* nonce, const uint8_t* input, size_t length, uint8_t* output);
 
+/**
+ * @brief Same as the key-based block/CTR functions, but with an already expanded context.
+ *
+ * @param ctx AES context set up with mbedtls_aes_setkey_enc()/setkey_dec()
+ */
+void aes128_encrypt_block_ctx(mbedtls_aes_context* ctx, const uint8_t* input, uint8_t* output);
+
+void aes128_decrypt_block_ctx(mbedtls_aes_context* ctx, const uint8_t* input, uint8_t* output);
+
+void aes128_encrypt_ctr_ctx(mbedtls_aes_context* ctx, const uint8_t* nonce, const uint8_t* input, size_t length, uint8_t* output);
+
+/**
+ * @brief Expands a session's appSKey and nwkSKey into `crypto`.
+ *
+ * @param crypto Destination sidecar (must not be initialized yet)
+ * @param session Session holding the keys
+ */
+void initSessionCrypto(SessionCrypto& crypto, const SessionInfo& session);
+
+/**
+ * @brief Releases and wipes the contexts in `crypto`.
+ */
+void freeSessionCrypto(SessionCrypto& crypto);
+
+/**
+ * @brief Cached encryption/decryption contexts for the global appKey.
+ *
+ * Expanded on first use. Call refreshAppKeyContexts() if appKey is changed at runtime.
+ */
+mbedtls_aes_context* appKeyEncContext();
+
+mbedtls_aes_context* appKeyDecContext();
+
+void refreshAppKeyContexts();
+
 void decryptPayloadWithKey(uint8_t* appSKey, uint8_t* nonce, uint8_t* payload, size_t payloadLength, uint8_t* out);
 
 #endif // CRYPTO_UTILS_H
@@ -0,0 +1,226 @@
+#include "DutyCycle.h"
+#include "Gateway.h"
+#include "Sessions.h"
+
+#include <Arduino.h>
+#include <RadioLib.h>
+
+// ────── Band Buckets ──────
+// Tokens are microseconds of airtime. A band with a duty cycle of p permille
+// earns p µs per elapsed ms and holds at most p * DUTY_CYCLE_WINDOW_MS µs
+// (36 000 000 for 1 % over an hour, fits in 32 bits up to 100 %).
+
+struct DutyBand {
+  float minMHz;
+  float maxMHz;
+  uint16_t permille;
+  uint32_t tokensUs;
+  uint32_t refilledAt;
+};
+
+struct DeviceSlot {
+  DeviceAirtime usage;
+  uint32_t lastSeen;
+  bool used;
+};
+
+static DutyBand bands[DUTY_CYCLE_BANDS];
+static size_t bandCount = 0;
+static DutyBand* activeBand = nullptr;
+static float activeMHz = 0;
+static DeviceSlot devices[AIRTIME_DEVICES];
+static AirtimeStats airtimeStats = {};
+
+static uint32_t capacityUs(const DutyBand& band) {
+  return (uint32_t)band.permille * DUTY_CYCLE_WINDOW_MS;
+}
+
+static void refill(DutyBand& band, uint32_t now) {
+  uint64_t earned = (uint64_t)(now - band.refilledAt) * band.permille;
+  uint32_t capacity = capacityUs(band);
+  band.tokensUs = (band.tokensUs + earned >= capacity) ? capacity : band.tokensUs + (uint32_t)earned;
+  band.refilledAt = now;
+}
+
+bool dutyCycleIsControl(uint8_t dataType) {
+  return dataType == AIRTIME_CONTROL || dataType == TYPE_STREAM_ACK;
+}
+
+bool dutyCycleAddBand(float minMHz, float maxMHz, uint16_t permille) {
+  if (bandCount >= DUTY_CYCLE_BANDS || maxMHz <= minMHz || permille == 0 || permille > 1000) {
+    return false;
+  }
+  DutyBand& band = bands[bandCount++];
+  band.minMHz = minMHz;
+  band.maxMHz = maxMHz;
+  band.permille = permille;
+  band.tokensUs = capacityUs(band);
+  band.refilledAt = millis();
+  if (activeBand == nullptr && activeMHz >= minMHz && activeMHz < maxMHz) activeBand = &band;
+  return true;
+}
+
+void dutyCycleSetRegion(DutyCycleRegion region) {
+  bandCount = 0;
+  activeBand = nullptr;
+
+  if (region == DUTY_CYCLE_EU868) {
+    // ETSI EN 300 220-2 sub-bands used by LoRa (h1.3 - h1.7 and 865-868 MHz)
+    dutyCycleAddBand(863.0f, 865.0f, 1);
+    dutyCycleAddBand(865.0f, 868.0f, 10);
+    dutyCycleAddBand(868.0f, 868.6f, 10);
+    dutyCycleAddBand(868.7f, 869.2f, 1);
+    dutyCycleAddBand(869.4f, 869.65f, 100);
+    dutyCycleAddBand(869.7f, 870.0f, 10);
+  }
+}
+
+void dutyCycleSetFrequency(float mhz) {
+  activeMHz = mhz;
+  activeBand = nullptr;
+  for (size_t i = 0; i < bandCount; i++) {
+    if (mhz >= bands[i].minMHz && mhz < bands[i].maxMHz) {
+      activeBand = &bands[i];
+      break;
+    }
+  }
+  if (activeBand == nullptr && bandCount > 0) {
+    Serial.printf("[DUTY] %.3f MHz is in no configured band, TX not limited.\n", mhz);
+  }
+}
+
+// ────── Budget Checks ──────
+
+uint32_t frameAirtimeMs(size_t length) {
+  return (lora->getTimeOnAir(length) + 999) / 1000;
+}
+
+uint32_t dutyCycleWaitMs(uint32_t airtimeMs, uint8_t dataType) {
+  if (activeBand == nullptr) return 0;
+  DutyBand& band = *activeBand;
+  refill(band, millis());
+
+  uint32_t capacity = capacityUs(band);
+  uint64_t needUs = (uint64_t)airtimeMs * 1000;
+  if (!dutyCycleIsControl(dataType)) needUs += (uint64_t)capacity * DUTY_CYCLE_RESERVE_PERCENT / 100;
+  if (needUs > capacity) needUs = capacity;  // longer than the whole budget: wait for a full bucket
+
+  if (band.tokensUs >= needUs) return 0;
+  return (uint32_t)((needUs - band.tokensUs + band.permille - 1) / band.permille);
+}
+
+uint32_t dutyCycleBudgetMs() {
+  if (activeBand == nullptr) return UINT32_MAX;
+  refill(*activeBand, millis());
+  return activeBand->tokensUs / 1000;
+}
+
+// ────── Accounting ──────
+// Device keys follow RxFilter: DevEUI keys for legacy frames and join frames,
+// devAddr tagged with 0xFFFFFFFF in the upper half for compact frames.
+// JoinAccepts are encrypted and carry neither, they count under key 0.
+
+static uint64_t deviceKeyOf(const uint8_t* frame, size_t length) {
+  uint8_t type = frameTypeOf(frame, length);
+  switch (type) {
+    case FTYPE_DATA_UP:
+    case FTYPE_DATA_DOWN: {
+      uint32_t devAddr = (uint32_t)frame[1] | ((uint32_t)frame[2] << 8) |
+                         ((uint32_t)frame[3] << 16) | ((uint32_t)frame[4] << 24);
+      return 0xFFFFFFFF00000000ULL | devAddr;
+    }
+    case FTYPE_JOIN_REQUEST:
+    case FTYPE_JOIN_BACKOFF:
+      return devEUIToKey(length == JOIN_REQUEST_LEGACY_LEN ? frame : frame + 1);
+    case FTYPE_LEGACY_DATA:
+      return devEUIToKey(frame);
+    default:
+      return 0;
+  }
+}
+
+static DeviceSlot& slotFor(uint64_t key, uint32_t now) {
+  DeviceSlot* victim = nullptr;
+  for (size_t i = 0; i < AIRTIME_DEVICES; i++) {
+    DeviceSlot& slot = devices[i];
+    if (slot.used && slot.usage.key == key) return slot;
+    if (victim != nullptr && !victim->used) continue;  // keep the free slot
+    if (victim == nullptr || !slot.used || now - slot.lastSeen > now - victim->lastSeen) {
+      victim = &slot;
+    }
+  }
+
+  victim->usage = { key, 0, 0 };
+  victim->used = true;
+  return *victim;
+}
+
+void dutyCycleCharge(const uint8_t* frame, size_t length, uint32_t airtimeMs, uint8_t dataType) {
+  uint32_t now = millis();
+
+  if (activeBand != nullptr) {
+    refill(*activeBand, now);
+    uint32_t spentUs = airtimeMs * 1000;
+    activeBand->tokensUs = (activeBand->tokensUs > spentUs) ? activeBand->tokensUs - spentUs : 0;
+  }
+
+  airtimeStats.airtimeMs += airtimeMs;
+  airtimeStats.frames++;
+  airtimeStats.byTypeMs[dataType < AIRTIME_TYPES ? dataType : AIRTIME_TYPES - 1] += airtimeMs;
+
+  DeviceSlot& slot = slotFor(deviceKeyOf(frame, length), now);
+  slot.lastSeen = now;
+  slot.usage.airtimeMs += airtimeMs;
+  slot.usage.frames++;
+}
+
+// ────── Queries ──────
+
+AirtimeStats getAirtimeStats() {
+  return airtimeStats;
+}
+
+size_t getDeviceAirtime(DeviceAirtime* out, size_t max) {
+  size_t count = 0;
+  for (size_t i = 0; i < AIRTIME_DEVICES; i++) {
+    if (!devices[i].used) continue;
+
+    // Insertion sort, most airtime first; drops the smallest once out is full
+    const DeviceAirtime& usage = devices[i].usage;
+    size_t pos = count;
+    while (pos > 0 && out[pos - 1].airtimeMs < usage.airtimeMs) pos--;
+    if (pos >= max) continue;
+    size_t last = (count < max) ? count : max - 1;
+    for (size_t j = last; j > pos; j--) out[j] = out[j - 1];
+    out[pos] = usage;
+    if (count < max) count++;
+  }
+  return count;
+}
+
+void printAirtimeStats() {
+  for (size_t i = 0; i < bandCount; i++) {
+    DutyBand& band = bands[i];
+    refill(band, millis());
+    Serial.printf("[DUTY] %s%.2f-%.2f MHz %u.%u%% budget=%lu/%lu ms\n",
+                  (&band == activeBand) ? "*" : " ", band.minMHz, band.maxMHz,
+                  band.permille / 10, band.permille % 10,
+                  (unsigned long)(band.tokensUs / 1000), (unsigned long)(capacityUs(band) / 1000));
+  }
+
+  Serial.printf("[DUTY] airtime=%lu ms frames=%lu control=%lu ms\n",
+                (unsigned long)airtimeStats.airtimeMs, (unsigned long)airtimeStats.frames,
+                (unsigned long)airtimeStats.byTypeMs[AIRTIME_CONTROL]);
+  for (uint8_t type = 1; type < AIRTIME_TYPES; type++) {
+    if (airtimeStats.byTypeMs[type] == 0) continue;
+    Serial.printf("[DUTY]   type 0x%02X: %lu ms\n", type, (unsigned long)airtimeStats.byTypeMs[type]);
+  }
+
+  DeviceAirtime top[8];
+  size_t count = getDeviceAirtime(top, 8);
+  for (size_t i = 0; i < count; i++) {
+    Serial.printf("[DUTY]   device %08lX%08lX: %lu ms in %lu frames\n",
+                  (unsigned long)(top[i].key >> 32), (unsigned long)(top[i].key & 0xFFFFFFFF),
+                  (unsigned long)top[i].airtimeMs, (unsigned long)top[i].frames);
+  }
+}
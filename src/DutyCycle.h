@@ -0,0 +1,168 @@
+#ifndef DUTY_CYCLE_H
+#define DUTY_CYCLE_H
+
+#include <Arduino.h>
+#include "PacketView.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Duty-Cycle Budget and Airtime Accounting
+ *
+ * Every frame leaves through the TX queue, which asks this module before
+ * starting it. The time-on-air comes from the radio's current SF, BW, CR
+ * and the frame length (PhysicalLayer::getTimeOnAir()), so a sketch that
+ * changes the spreading factor is accounted correctly.
+ *
+ * Each regulatory sub-band has a token bucket holding its permitted airtime
+ * per DUTY_CYCLE_WINDOW_MS (1 % of an hour = 36 s). A frame that does not
+ * fit stays queued until the bucket has refilled enough: it is deferred,
+ * never sent illegally and never dropped here.
+ *
+ * The last DUTY_CYCLE_RESERVE_PERCENT of a bucket is kept for control
+ * frames (ACKs, stream ACKs, join frames), so a gateway busy with downlink
+ * data still has budget to acknowledge its uplinks. The TX queue lets them
+ * pass a data frame that is waiting for budget.
+ *
+ * Without bands, or on a frequency outside every band, nothing is limited
+ * but airtime is still counted per DataType and per device:
+ *
+ *   dutyCycleSetRegion(DUTY_CYCLE_EU868);
+ *   dutyCycleSetFrequency(868.1);
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Sub-bands that can be configured. Build flag override, e.g. -DDUTY_CYCLE_BANDS=8.
+#ifndef DUTY_CYCLE_BANDS
+#define DUTY_CYCLE_BANDS 6
+#endif
+
+// Period the duty cycle is measured over, i.e. the bucket size (ETSI: 1 hour).
+#ifndef DUTY_CYCLE_WINDOW_MS
+#define DUTY_CYCLE_WINDOW_MS 3600000UL
+#endif
+
+// Share of each bucket only control frames may use.
+#ifndef DUTY_CYCLE_RESERVE_PERCENT
+#define DUTY_CYCLE_RESERVE_PERCENT 20
+#endif
+
+// Devices with their own airtime counter; the least recently seen one is replaced.
+#ifndef AIRTIME_DEVICES
+#define AIRTIME_DEVICES 32
+#endif
+
+// Airtime class of frames without a payload DataType (ACKs, join frames).
+#define AIRTIME_CONTROL     0x00
+
+// DataType values counted separately; larger values share the last counter.
+#define AIRTIME_TYPES       8
+
+/**
+ * @brief Built-in band plans for dutyCycleSetRegion().
+ */
+enum DutyCycleRegion {
+    DUTY_CYCLE_UNLIMITED,   ///< No bands, airtime is only counted
+    DUTY_CYCLE_EU868        ///< ETSI EN 300 220 sub-bands 863-870 MHz
+};
+
+/**
+ * @brief Airtime counters since boot.
+ */
+struct AirtimeStats {
+    uint32_t airtimeMs;                 ///< All frames started
+    uint32_t frames;                    ///< Frames started
+    uint32_t byTypeMs[AIRTIME_TYPES];   ///< Index = DataType, 0 = AIRTIME_CONTROL
+};
+
+/**
+ * @brief Airtime spent on frames to or from one device.
+ */
+struct DeviceAirtime {
+    uint64_t key;           ///< devEUIToKey(), or devAddr | 0xFFFFFFFF00000000 for compact frames
+    uint32_t airtimeMs;     ///< Total time-on-air
+    uint32_t frames;        ///< Frames counted
+};
+
+/**
+ * @brief Adds a sub-band with its own budget.
+ *
+ * @param minMHz Lower edge
+ * @param maxMHz Upper edge
+ * @param permille Duty cycle in 1/1000 (10 = 1 %)
+ * @return false if the band table is full or the values are invalid
+ */
+bool dutyCycleAddBand(float minMHz, float maxMHz, uint16_t permille);
+
+/**
+ * @brief Replaces all bands with a built-in plan; buckets start full.
+ */
+void dutyCycleSetRegion(DutyCycleRegion region);
+
+/**
+ * @brief Selects the band the radio transmits in. Call after begin() and
+ *        after every setFrequency().
+ *
+ * @param mhz Carrier frequency
+ */
+void dutyCycleSetFrequency(float mhz);
+
+/**
+ * @brief Time-on-air of a frame with the radio's current settings.
+ *
+ * @param length Frame length in bytes
+ * @return Milliseconds, rounded up
+ */
+uint32_t frameAirtimeMs(size_t length);
+
+/**
+ * @brief How long a frame has to wait for the current band's budget.
+ *
+ * @param airtimeMs Time-on-air of the frame
+ * @param dataType DataType of the payload or AIRTIME_CONTROL
+ * @return 0 if it may be sent now, else milliseconds until it may
+ */
+uint32_t dutyCycleWaitMs(uint32_t airtimeMs, uint8_t dataType);
+
+/**
+ * @brief true for frames that may use the control reserve (ACKs, stream
+ *        ACKs, join frames).
+ *
+ * @param dataType DataType of the payload or AIRTIME_CONTROL
+ */
+bool dutyCycleIsControl(uint8_t dataType);
+
+/**
+ * @brief Charges a started frame to the band, its DataType and its device.
+ *
+ * @param frame Raw frame (device taken from its header)
+ * @param length Frame length
+ * @param airtimeMs Time-on-air of the frame
+ * @param dataType DataType of the payload or AIRTIME_CONTROL
+ */
+void dutyCycleCharge(const uint8_t* frame, size_t length, uint32_t airtimeMs, uint8_t dataType);
+
+/**
+ * @brief Airtime left in the current band, UINT32_MAX if unlimited.
+ */
+uint32_t dutyCycleBudgetMs();
+
+/**
+ * @brief Returns a snapshot of the airtime counters.
+ */
+AirtimeStats getAirtimeStats();
+
+/**
+ * @brief Copies the per-device counters, most airtime first.
+ *
+ * @param out Destination
+ * @param max Entries that fit in out
+ * @return Entries copied
+ */
+size_t getDeviceAirtime(DeviceAirtime* out, size_t max);
+
+/**
+ * @brief Prints the band budgets and the airtime counters to Serial.
+ */
+void printAirtimeStats();
+
+#endif // DUTY_CYCLE_H
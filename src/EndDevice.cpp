@@ -2,6 +2,17 @@
 #include "EndDevice.h"
 #include "CryptoUtils.h"
 #include "Sessions.h"
+#include "PacketView.h"
+#include "RxQueue.h"
+#include "TxQueue.h"
+#include "JoinQueue.h"
+#include "KeystreamPool.h"
+#include "SessionStore.h"
+#include "Tlv.h"
+#include "Fec.h"
+#include "Lz.h"
+#include "UplinkAggregator.h"
+#include "Telemetry.h"
 
 #include <Arduino.h>
 #include <RadioLib.h>
@@ -20,20 +31,35 @@ String devEUIHex = idToHexString(devEUI);
 // 4      | 3    | JoinNonce   | Nonce from network for session key derivation
 // 7      | 3    | NetID       | Identifier of the LoRaWAN network
 // 10     | 2    | DevNonce    | Echo of our original devNonce (LE)
+//
+// Answers to a compact JoinRequest carry FTYPE_JOIN_ACCEPT in front (17 bytes).
+//
+// All devices share appKey, so every device listening in RX1/RX2 can decrypt
+// a neighbour's JoinAccept. Only the one echoing the DevNonce just sent is ours.
 
+static JoinStats joinStats = {};
 
-bool handleJoinAccept(uint8_t* buffer, size_t len) {
-  if (len != 16) {
+bool handleJoinAccept(uint8_t* buffer, size_t len, uint16_t expectedDevNonce) {
+  if (len == JOIN_ACCEPT_LEN && buffer[0] == FTYPE_JOIN_ACCEPT) {
+    buffer++;
+    len--;
+  }
+  if (len != JOIN_ACCEPT_LEGACY_LEN) {
     Serial.println("[ERROR] Invalid JoinAccept length.");
     return false;
   }
   
   // AES-ECB decrypt JoinAccept using AppKey (same as encrypt in ECB)
   uint8_t decrypted[16];
-  aes128_encrypt_block(appKey, buffer, decrypted); // ✅
+  aes128_encrypt_block_ctx(appKeyEncContext(), buffer, decrypted); // ✅
 
   uint16_t devNonce = 0;
   devNonce = (decrypted[11] << 8) | decrypted[10];
+  if (devNonce != expectedDevNonce) {
+    joinStats.foreignAccepts++;
+    Serial.println("[JOIN] JoinAccept for another DevNonce, ignored.");
+    return false;
+  }
 
   uint32_t devAddr;
   uint8_t joinNonce[3], netID[3];
@@ -49,7 +75,7 @@ bool handleJoinAccept(uint8_t* buffer, size_t len) {
   Serial.println("[JOIN] JoinAccept decrypted.");
   Serial.println("[JOIN] Session keys derived successfully.");
 
-  SessionInfo session;
+  SessionInfo session = {};  // frame counters start at 0 with the new keys
   session.devAddr = devAddr;
   memcpy(session.appSKey, appSKey, 16);
   memcpy(session.nwkSKey, nwkSKey, 16);
@@ -57,6 +83,10 @@ bool handleJoinAccept(uint8_t* buffer, size_t len) {
   memcpy(session.netID, netID, 3);
   memcpy(session.devNonce, &devNonce, 2); 
   storeSessionFor(devEUIHex, session);
+  sessionStoreFlush();  // single session, persist right away
+
+  // New keys: pooled keystream of the old session is useless
+  if (keystreamPoolBound()) keystreamPoolBind(session, devEUI);
   Serial.println("[JOIN] Session stored for device: " + devEUIHex);
   return true;
 }
@@ -68,6 +98,9 @@ bool handleJoinAccept(uint8_t* buffer, size_t len) {
 // 0      | 8    | devEUI      | Device unique identifier
 // 8      | 8    | appEUI      | Application identifier
 // 16     | 2    | devNonce    | Random nonce for the join request (little-endian)
+// 18     | 4    | MIC         | First 4 bytes of HMAC-SHA256 over bytes 0-17
+//
+// With compact frames the request starts with FTYPE_JOIN_REQUEST (23 bytes).
 struct JoinRequest {
   uint8_t devEUI[8];
   uint8_t appEUI[8];
@@ -83,53 +116,155 @@ uint16_t generateDevNonce() {
     return nonce;
 }
 
-void sendJoinRequest(int maxRetries, unsigned long retryDelay) {
+// ────── Join Engine ──────
+// The JoinRequest goes through the TX queue; its TX-done callback stamps the
+// time both receive windows are measured from. Between RX1 and RX2 the radio
+// sits in standby.
+
+static volatile bool joinTxFinished = false;
+static int joinTxResult = RADIOLIB_ERR_NONE;
+static uint32_t joinTxDoneAt = 0;
+
+static void onJoinTxDone(TxHandle handle, int result) {
+    joinTxDoneAt = millis();
+    joinTxResult = result;
+    joinTxFinished = true;
+}
+
+enum JoinReply { JOIN_REPLY_NONE, JOIN_REPLY_ACCEPT, JOIN_REPLY_BACKOFF };
+
+// Listens from `openMs` to `openMs + lengthMs` after TX done for the answer
+// to the JoinRequest carrying `devNonce`
+static JoinReply joinReceiveWindow(uint32_t openMs, uint32_t lengthMs, uint16_t devNonce, uint32_t& backoffMs) {
+    while (millis() - joinTxDoneAt < openMs) delay(1);
+    if (openMs > 0) {
+        radioLock();
+        lora->startReceive();
+        radioUnlock();
+    }
+
+    RxFrame frame;
+    while (millis() - joinTxDoneAt < openMs + lengthMs) {
+        captureRxFrame();
+        while (rxQueuePop(frame)) {
+            if (frame.length == JOIN_ACCEPT_LEN || frame.length == JOIN_ACCEPT_LEGACY_LEN) {
+                if (handleJoinAccept(frame.data, frame.length, devNonce)) return JOIN_REPLY_ACCEPT;
+            } else if (frame.length == JOIN_BACKOFF_LEN &&
+                       readJoinBackoff(frame.data, frame.length, devEUI, backoffMs)) {
+                return JOIN_REPLY_BACKOFF;
+            }
+        }
+        delay(1);
+    }
+    return JOIN_REPLY_NONE;
+}
+
+// Equal jitter: half of the exponential delay is fixed, the other half random
+static uint32_t joinRetryDelayMs(int attempt, uint32_t baseMs) {
+    uint32_t delayMs = baseMs;
+    for (int i = 1; i < attempt && delayMs < JOIN_RETRY_MAX_MS; i++) delayMs *= 2;
+    if (delayMs > JOIN_RETRY_MAX_MS) delayMs = JOIN_RETRY_MAX_MS;
+    return delayMs / 2 + esp_random() % (delayMs / 2 + 1);
+}
+
+bool sendJoinRequest(int maxRetries, unsigned long retryDelay) {
     SessionInfo session;
     if (verifySession(devEUIHex, session) == SESSION_OK) {
         Serial.println("[JOIN] Session already exists. Skipping join.");
-        return;
+        return true;
     }
 
-    bool ackReceived = false;
+    uint32_t startedAt = millis();
+    joinStats.attempts = 0;
 
     for (int attempt = 1; attempt <= maxRetries; attempt++) {
         uint16_t devNonce = generateDevNonce();
 
-        uint8_t buffer[22];
-        memcpy(buffer, devEUI, 8);
-        memcpy(buffer + 8, appEUI, 8);
-        buffer[16] = devNonce & 0xFF;
-        buffer[17] = (devNonce >> 8) & 0xFF;
+        uint8_t buffer[JOIN_REQUEST_LEN];
+        size_t len = 0;
+        if (frameFormat() == FRAME_FORMAT_COMPACT) buffer[len++] = FTYPE_JOIN_REQUEST;
+        memcpy(buffer + len, devEUI, 8);
+        memcpy(buffer + len + 8, appEUI, 8);
+        buffer[len + 16] = devNonce & 0xFF;
+        buffer[len + 17] = (devNonce >> 8) & 0xFF;
+        len += 18;
 
         uint8_t mic[32];
-        computeHMAC_SHA256(hmacKey, sizeof(hmacKey), buffer, 18, mic);
-        memcpy(buffer + 18, mic, 4);
-
-        // Instant TX → RX, no extra delays
-        transmissonFlag = true;
-        lora->standby();
-        lora->transmit(buffer, sizeof(buffer));
-        lora->startReceive();  // immediately back to RX
-        transmissonFlag = false;
-
-        // **Zero timeout receive** — read immediately if packet arrived
-        String joinReply;
-        int rxState = lora->receive(joinReply, 0); // 0 = non-blocking
-        if (rxState == RADIOLIB_ERR_NONE && joinReply.length() == 16) {
-            uint8_t raw[16];
-            for (int i = 0; i < 16; i++) raw[i] = joinReply[i];
-            if (handleJoinAccept(raw, 16)) {
-                Serial.println("[JOIN] Join successful.");
-                ackReceived = true;
-                break; // exit retries
+        HmacSegment request = { buffer, len };
+        hmacCompute(sharedHmacContext(), &request, 1, mic);
+        memcpy(buffer + len, mic, 4);
+        len += 4;
+
+        joinStats.attempts++;
+        joinStats.totalAttempts++;
+
+        // Send and wait for TX done; txQueueLoop() re-arms RX right after it
+        joinTxFinished = false;
+        JoinReply reply = JOIN_REPLY_NONE;
+        uint32_t waitMs = 0;
+        if (txQueueSend(buffer, len, onJoinTxDone) != 0) {
+            while (!joinTxFinished) {
+                txQueueLoop();
+                delay(1);
+            }
+        }
+
+        if (!joinTxFinished || joinTxResult != RADIOLIB_ERR_NONE) {
+            Serial.println("[JOIN] JoinRequest not sent.");
+            joinStats.txFailures++;
+        } else {
+            reply = joinReceiveWindow(JOIN_RX1_DELAY_MS, joinWindowLengthMs(JOIN_RX1_WINDOW_MS), devNonce, waitMs);
+            if (reply == JOIN_REPLY_ACCEPT) {
+                joinStats.acceptedRx1++;
+            } else if (reply == JOIN_REPLY_NONE) {
+                radioLock();
+                lora->standby();
+                radioUnlock();
+                reply = joinReceiveWindow(JOIN_RX2_DELAY_MS, joinWindowLengthMs(JOIN_RX2_WINDOW_MS), devNonce, waitMs);
+                if (reply == JOIN_REPLY_ACCEPT) joinStats.acceptedRx2++;
             }
+            radioLock();
+            lora->startReceive();
+            radioUnlock();
         }
 
-        Serial.println("[JOIN] No valid reply. Retrying...");
-        if (attempt < maxRetries) delay(retryDelay); // only between attempts
+        if (reply == JOIN_REPLY_ACCEPT) {
+            joinStats.latencyMs = millis() - startedAt;
+            joinStats.joins++;
+            Serial.printf("[JOIN] Join successful after %u attempt(s), %lu ms.\n",
+                          (unsigned)joinStats.attempts, (unsigned long)joinStats.latencyMs);
+            return true;
+        }
+
+        if (reply == JOIN_REPLY_BACKOFF) {
+            joinStats.backoffHints++;
+            Serial.printf("[JOIN] Gateway busy, backoff %lu ms\n", (unsigned long)waitMs);
+        } else {
+            waitMs = joinRetryDelayMs(attempt, retryDelay);
+            Serial.println("[JOIN] No JoinAccept in RX1/RX2.");
+        }
+        if (attempt < maxRetries) {  // only between attempts
+            Serial.printf("[JOIN] Retrying in %lu ms\n", (unsigned long)waitMs);
+            delay(waitMs);
+        }
     }
 
-    if (!ackReceived) Serial.println("[JOIN] Join failed after maximum attempts.");
+    joinStats.failures++;
+    Serial.println("[JOIN] Join failed after maximum attempts.");
+    return false;
+}
+
+JoinStats getJoinStats() {
+    return joinStats;
+}
+
+void printJoinStats() {
+    Serial.printf("[JOIN] attempts=%u latency=%lu ms total=%lu joins=%u failures=%u rx1=%u rx2=%u hints=%u txFail=%u foreign=%u\n",
+                  (unsigned)joinStats.attempts, (unsigned long)joinStats.latencyMs,
+                  (unsigned long)joinStats.totalAttempts, (unsigned)joinStats.joins,
+                  (unsigned)joinStats.failures, (unsigned)joinStats.acceptedRx1,
+                  (unsigned)joinStats.acceptedRx2, (unsigned)joinStats.backoffHints,
+                  (unsigned)joinStats.txFailures, (unsigned)joinStats.foreignAccepts);
 }
 
 // ────── Local Storage File Layout (One group per file) ──────
@@ -142,9 +277,11 @@ void sendJoinRequest(int maxRetries, unsigned long retryDelay) {
 //   - MAX_GROUP_LIMIT           → Max total group files per prefix
 //   - MAX_GROUP_PREFIX_LIMIT    → Max unique group name prefixes allowed (Grp1, Grp2, etc.)
 //
-// PacketEntry:
-//   - length                    → size_t (4 bytes, platform dependent)
-//   - data                      → dynamically allocated payload data (length bytes)
+// File content (TLV, see Tlv.h):
+//   [TLV_FORMAT_V1 (1)] once at the start of the file, then per entry:
+//   - type                      → DataType (1 byte)
+//   - length                    → varint (1-3 bytes)
+//   - data                      → payload data (length bytes)
 //
 
 // ────── StoreAge handling ───────────────────────────────
@@ -159,7 +296,8 @@ void storePacket(const uint8_t* data, size_t length, DataType dataType, const ch
         Serial.printf("[ERROR] Invalid group index: %d for path %s\n", groupIndex, pathBase);
         return;
     }
-    const size_t entryOverhead = sizeof(uint16_t) + 1;
+    // Worst case: format marker (new file) + TLV record header
+    const size_t entryOverhead = 1 + 1 + tlvVarintLength(length);
     if ((entryOverhead + length) > groupConfig.maxFileSize) {
         size_t allowedLength = groupConfig.maxFileSize - entryOverhead;
         Serial.printf("[WARN] Entry too large (%d bytes). Truncating payload to %d bytes.\n", (int)(entryOverhead + length), (int)allowedLength);
@@ -177,7 +315,7 @@ void storePacket(const uint8_t* data, size_t length, DataType dataType, const ch
         checkFile.close();
     }
 
-    if (currentFileSize + sizeof(uint16_t) + length > groupConfig.maxFileSize) {
+    if (currentFileSize + entryOverhead + length > groupConfig.maxFileSize) {
         suffix++;
         if (suffix >= groupConfig.groupPrefixLimit) {
             Serial.printf("[ERROR] No more file slots for %s (limit %d reached)\n", pathBase, groupConfig.groupPrefixLimit);
@@ -193,19 +331,23 @@ void storePacket(const uint8_t* data, size_t length, DataType dataType, const ch
         return;
       }
 
+    bool newFile = !SPIFFS.exists(path);
     File file = SPIFFS.open(path, FILE_APPEND);
     if (!file) {
         Serial.println("[ERROR] Failed to open file for writing");
         return;
     }
 
-    uint16_t len = length + 1;
-    file.write((uint8_t*)&len, sizeof(len));
-    file.write((uint8_t*)&dataType, 1);
+    // A group file is one TLV payload: the format marker once, then records
+    uint8_t header[TLV_MAX_FRAME_HEADER];
+    size_t headerLen = 0;
+    if (newFile) header[headerLen++] = TLV_FORMAT_V1;
+    headerLen += tlvRecordHeader(header + headerLen, dataType, length);
+    file.write(header, headerLen);
     file.write(data, length);
     file.close();
 
-    Serial.printf("[OK] Stored %d bytes to %s\n", (int)(2 + length), path);
+    Serial.printf("[OK] Stored %d bytes to %s\n", (int)(headerLen + length), path);
 }
 
 // ────── Stored Group Payload Layout Before Encryption ──────
@@ -217,9 +359,36 @@ void storePacket(const uint8_t* data, size_t length, DataType dataType, const ch
 // - Data is encrypted with `appSKey` before sending
 // - Transmitted buffer is: [SenderID (8)] + [Encrypted Group] + [HMAC (8)]
 // - Final format handled by `encryptAndPackage()`
+// - With compression the stream holds the LZSS output of the file instead
+//   (Lz.h) and its chunks carry STREAM_FLAG_LZ
+
+// Compresses a group file if that saves GROUP_COMPRESS_MIN_SAVING percent.
+// lzCompress() gives up once the output reaches that limit, so a file that
+// does not compress costs little CPU. Returns the compressed length, 0 = send raw.
+static size_t compressGroupFile(const char* path, const std::vector<uint8_t>& file,
+                                std::vector<uint8_t>& compressed) {
+  size_t fileSize = file.size();
+  size_t saving = fileSize * GROUP_COMPRESS_MIN_SAVING / 100;
+  size_t limit = fileSize - (saving > 0 ? saving : 1);
+
+  compressed.resize(limit);
+  std::vector<uint16_t> work(LZ_WORK_ENTRIES);
+  uint32_t start = micros();
+  size_t compressedLen = lzCompress(file.data(), fileSize, compressed.data(), limit, work.data());
+  unsigned long elapsedUs = micros() - start;
+
+  if (compressedLen == 0) {
+    Serial.printf("[LZ] %s: %zu bytes sent raw (saves < %u %%), %lu us\n",
+                  path, fileSize, (unsigned)GROUP_COMPRESS_MIN_SAVING, elapsedUs);
+    return 0;
+  }
+  Serial.printf("[LZ] %s: %zu -> %zu bytes (%.1f %%), %lu us\n",
+                path, fileSize, compressedLen, 100.0f * compressedLen / fileSize, elapsedUs);
+  return compressedLen;
+}
 
 // Helper to load, encrypt, and send a file by full path
-bool sendGroupFileAtPath(const char* path) {
+bool sendGroupFileAtPath(const char* path, uint8_t fecRepair, bool compress) {
   File file = SPIFFS.open(path, FILE_READ);
   if (!file) {
     Serial.printf("[ERROR] Failed to open file: %s\n", path);
@@ -238,9 +407,29 @@ bool sendGroupFileAtPath(const char* path) {
   file.read(buffer.data(), fileSize);
   file.close();
 
+  // The gateway inflates into a STREAM_MAX_LEN buffer, so larger files stay raw
+  std::vector<uint8_t> compressed;
+  size_t compressedLen = 0;
+  if (compress && fileSize <= STREAM_MAX_LEN) {
+    compressedLen = compressGroupFile(path, buffer, compressed);
+  }
+
   // Send using your polymorphic streamer
+  // FEC mode for one-way links, otherwise reliable mode: a lost chunk costs
+  // one retransmission, not the whole file
   PolymorphicLoraSender sender;
-  sender.sendStream(buffer.data(), fileSize, TYPE_STREAM);
+  sender.setFecRepair(fecRepair);
+  sender.setArqWindow(STREAM_ARQ_WINDOW);
+  if (compressedLen > 0) {
+    sender.setCompressed(true);
+    sender.sendStream(compressed.data(), compressedLen, TYPE_STREAM);
+  } else {
+    sender.sendStream(buffer.data(), fileSize, TYPE_STREAM);
+  }
+  if (fecRepair == 0 && !sender.lastTransfer().complete) {
+    Serial.printf("[ERROR] Group file not confirmed: %s\n", path);
+    return false;
+  }
 
   Serial.printf("[OK] Streamed group file: %s (%zu bytes)\n", path, fileSize);
 
@@ -249,7 +438,7 @@ bool sendGroupFileAtPath(const char* path) {
 }
 
 
-void sendStoredGroupFile(const char* pathBase) {
+void sendStoredGroupFile(const char* pathBase, uint8_t fecRepair, bool compress) {
   for (int suffix = 0; suffix < groupConfig.groupPrefixLimit; suffix++) {
 
     char path[32];
@@ -259,26 +448,200 @@ void sendStoredGroupFile(const char* pathBase) {
       continue;
     }
 
-    sendGroupFileAtPath(path);
+    sendGroupFileAtPath(path, fecRepair, compress);
   }
 
   Serial.println("[DONE] All group files streamed.");
 }
 
-void sender(const uint8_t* finalPacket, size_t finalLen) {
-
-  transmissonFlag = true;
-  lora->standby();
-  delay(5);
-  int result = lora->transmit(finalPacket, finalLen);
-  delay(10);                      
-  int rxState = lora->startReceive();
-  transmissonFlag = false;    
-  if (result == RADIOLIB_ERR_NONE) {
-    Serial.println("[ACK] Sent successfully.");
+void sender(const uint8_t* finalPacket, size_t finalLen, uint8_t dataType) {
+  // Queued; goes on air from txQueueLoop() and RX re-arms on TX done
+  TxHandle handle = txQueueSend(finalPacket, finalLen, nullptr, dataType);
+  if (handle != 0) {
+    Serial.println("[ACK] Queued for sending.");
   } else {
-    Serial.println("[ACK] Failed to send ACK.");
+    Serial.println("[ACK] Failed to queue, TX queue full.");
+  }
+}
+
+
+// ────── Reliable Streams (Selective Repeat) ──────
+// Each round sends up to `arqWindow` of the lowest unacknowledged chunks; the
+// last one carries STREAM_FLAG_ACK_REQ. The gateway answers with the bitmap of
+// chunks still missing up to that chunk, so the next round retransmits only
+// those and fills the rest of the window with new chunks. A lost ACK is
+// recovered by re-sending just the ACK-requesting chunk as a probe.
+
+static void handleDecryptedPacket(const PacketView& view);
+
+bool awaitStreamAck(uint8_t streamId, uint32_t timeoutMs, StreamAck& ack) {
+  unsigned long start = millis();
+  RxFrame frame;
+
+  while (millis() - start < timeoutMs) {
+    txQueueLoop();
+    captureRxFrame();
+    while (rxQueuePop(frame)) {
+      // Frames that fail before authentication have not touched the replay
+      // window, so handlePacket() can judge (and log) them from scratch
+      PacketView view;
+      SessionInfo* session = nullptr;
+      if (!parsePacket(frame.data, frame.length, view) ||
+          view.frameType == FTYPE_DATA_UP ||
+          findPacketSession(view, session) != SESSION_OK ||
+          authenticatePacket(view, *session) != SESSION_OK) {
+        handlePacket(frame.data, frame.length);
+        continue;
+      }
+
+      // Authenticated: the counter is committed now, so the frame is consumed
+      // here. Passing it to handlePacket() would drop it as a replay.
+      decryptInPlace(view, *session);
+
+      TlvReader reader;
+      TlvRecord record;
+      tlvBegin(reader, view.payload, view.payloadLength);
+      if (tlvFind(reader, TYPE_STREAM_ACK, record) &&
+          streamAckDecode(record.value, record.length, ack) &&
+          ack.streamId == streamId) {
+        return true;
+      }
+      handleDecryptedPacket(view);  // not ours, handle as usual
+    }
+    delay(1);
   }
+  return false;
+}
+
+StreamTransferStats PolymorphicLoraSender::sendStreamReliable(const uint8_t* data, size_t totalLen,
+                                                              DataType type, const SessionInfo& session) {
+  StreamTransferStats& stats = transferStats;
+  stats = {};
+  stats.streamId = allocateStreamId();
+  stats.chunks = (totalLen + STREAM_CHUNK_SIZE - 1) / STREAM_CHUNK_SIZE;
+  stats.bytes = totalLen;
+
+  const uint32_t allChunks = (stats.chunks == 32) ? 0xFFFFFFFFUL : ((1UL << stats.chunks) - 1);
+  uint32_t acked = 0;
+  uint32_t sentOnce = 0;
+  int probeSeq = -1;          // >= 0: only re-send this chunk to ask for the lost ACK
+  int idleRounds = 0;
+  unsigned long start = millis();
+
+  uint8_t chunk[STREAM_CHUNK_HEADER_LEN + STREAM_CHUNK_SIZE];
+
+  while (acked != allChunks && idleRounds < STREAM_ARQ_MAX_ROUNDS) {
+    // Pick the window: the lowest chunks that are not acknowledged yet
+    uint16_t window[32];
+    size_t windowLen = 0;
+    if (probeSeq >= 0) {
+      window[windowLen++] = (uint16_t)probeSeq;
+    } else {
+      for (uint16_t seq = 0; seq < stats.chunks && windowLen < arqWindow; seq++) {
+        if (!(acked & (1UL << seq))) window[windowLen++] = seq;
+      }
+    }
+
+    for (size_t i = 0; i < windowLen; i++) {
+      uint16_t seq = window[i];
+      size_t offset = (size_t)seq * STREAM_CHUNK_SIZE;
+      size_t chunkLen = (totalLen - offset > STREAM_CHUNK_SIZE) ? STREAM_CHUNK_SIZE : totalLen - offset;
+
+      uint8_t flags = streamFlags;
+      if (seq == stats.chunks - 1) flags |= STREAM_FLAG_FINAL;
+      if (i == windowLen - 1) flags |= STREAM_FLAG_ACK_REQ;
+
+      size_t headerLen = streamChunkHeader(chunk, stats.streamId, seq, flags);
+      memcpy(chunk + headerLen, data + offset, chunkLen);
+      sendChunk(chunk, headerLen + chunkLen, type, session);
+
+      stats.transmissions++;
+      if (sentOnce & (1UL << seq)) stats.retransmissions++;
+      sentOnce |= (1UL << seq);
+    }
+
+    // The ACK timer starts once the whole window is on air
+    txQueueFlush(STREAM_ARQ_ACK_TIMEOUT_MS * windowLen);
+
+    uint16_t lastSeq = window[windowLen - 1];
+    StreamAck ack;
+    if (!awaitStreamAck(stats.streamId, STREAM_ARQ_ACK_TIMEOUT_MS, ack)) {
+      Serial.printf("[ARQ] No ACK for stream %u, probing chunk %u\n", stats.streamId, lastSeq);
+      stats.ackTimeouts++;
+      probeSeq = lastSeq;
+      idleRounds++;
+      continue;
+    }
+    stats.ackRounds++;
+    probeSeq = -1;
+
+    if (ack.complete) {
+      acked = allChunks;
+      break;
+    }
+
+    // Everything up to the requesting chunk that is not flagged missing arrived
+    uint32_t upTo = (lastSeq == 31) ? 0xFFFFFFFFUL : ((1UL << (lastSeq + 1)) - 1);
+    uint32_t newlyAcked = (upTo & ~ack.missingMask & allChunks) & ~acked;
+    idleRounds = newlyAcked ? 0 : idleRounds + 1;
+    acked |= newlyAcked;
+    Serial.printf("[ARQ] Stream %u: missing 0x%08lX, acked 0x%08lX\n",
+                  stats.streamId, (unsigned long)ack.missingMask, (unsigned long)acked);
+  }
+
+  stats.complete = (acked == allChunks);
+  stats.elapsedMs = millis() - start;
+  stats.goodputBps = stats.elapsedMs ? (float)totalLen * 1000.0f / stats.elapsedMs : 0.0f;
+
+  Serial.printf("[ARQ] Stream %u %s: %u chunks, %u tx, %u retx, %u ACKs, %u timeouts, %lu ms, %.1f B/s\n",
+                stats.streamId, stats.complete ? "complete" : "FAILED",
+                stats.chunks, stats.transmissions, stats.retransmissions,
+                stats.ackRounds, stats.ackTimeouts, (unsigned long)stats.elapsedMs, stats.goodputBps);
+  return stats;
+}
+
+
+// ────── FEC Streams ──────
+// No back-channel: the source chunks go out unchanged, followed by repair
+// chunks computed one at a time into the chunk buffer, so encoding needs no
+// extra RAM. The gateway rebuilds the stream from any K of them.
+
+StreamTransferStats PolymorphicLoraSender::sendStreamFec(const uint8_t* data, size_t totalLen,
+                                                         DataType type, const SessionInfo& session) {
+  StreamTransferStats& stats = transferStats;
+  stats = {};
+  stats.streamId = allocateStreamId();
+  stats.chunks = (totalLen + STREAM_CHUNK_SIZE - 1) / STREAM_CHUNK_SIZE;
+  stats.repairChunks = (fecRepair > FEC_MAX_REPAIR) ? FEC_MAX_REPAIR : fecRepair;
+  stats.bytes = totalLen;
+  unsigned long start = millis();
+
+  uint8_t k = (uint8_t)stats.chunks;
+  uint8_t chunk[STREAM_FEC_HEADER_LEN + STREAM_CHUNK_SIZE];
+
+  for (uint16_t seq = 0; seq < k + stats.repairChunks; seq++) {
+    size_t headerLen = streamFecChunkHeader(chunk, stats.streamId, seq, k, totalLen, streamFlags);
+    size_t chunkLen = STREAM_CHUNK_SIZE;
+
+    if (seq < k) {
+      size_t offset = (size_t)seq * STREAM_CHUNK_SIZE;
+      if (totalLen - offset < chunkLen) chunkLen = totalLen - offset;
+      memcpy(chunk + headerLen, data + offset, chunkLen);
+    } else {
+      fecEncodeRepair(data, totalLen, STREAM_CHUNK_SIZE, k, seq - k, chunk + headerLen);
+    }
+
+    sendChunk(chunk, headerLen + chunkLen, type, session);
+    stats.transmissions++;
+  }
+
+  stats.elapsedMs = millis() - start;
+  stats.goodputBps = stats.elapsedMs ? (float)totalLen * 1000.0f / stats.elapsedMs : 0.0f;
+
+  Serial.printf("[FEC] Stream %u sent: %u source + %u repair chunks (rate %u/%u), %lu ms\n",
+                stats.streamId, stats.chunks, stats.repairChunks, stats.chunks,
+                stats.transmissions, (unsigned long)stats.elapsedMs);
+  return stats;
 }
 
 
@@ -301,21 +664,26 @@ void pollLora(
     unsigned long preDelayMillis 
 ) {
 
-  SessionInfo session;
-  SessionStatus status = verifySession(devEUIHex, session);
+  SessionInfo* session = nullptr;
+  SessionStatus status = findSession(devEUI, session);
   if (status != SESSION_OK) {
     Serial.println("[ERROR] Session not found");
     return;
   }
 
-  // Allocate space: 1 byte for type + payload
-  size_t totalLen = payloadLen + 1;
-  uint8_t* packetData = new uint8_t[totalLen];
-  packetData[0] = (uint8_t)dataType; // first byte = type
-  memcpy(packetData + 1, payloadData, payloadLen); // rest = payload
-
-  size_t finalLen = 0;
-  uint8_t* finalPacket = encryptAndPackage(packetData, totalLen, session, finalLen, devEUI);
+  // [format][type][length][payload] encrypted straight into the packet buffer, no heap
+  uint8_t header[TLV_MAX_FRAME_HEADER];
+  DataSegment segments[2] = {
+    { header, tlvFrameHeader(header, dataType, payloadLen) },
+    { payloadData, payloadLen }
+  };
+
+  uint8_t finalPacket[PACKET_MAX_LEN];
+  size_t finalLen = encryptAndPackage(segments, 2, *session, devEUI, finalPacket, sizeof(finalPacket));
+  if (finalLen == 0) {
+    Serial.printf("[ERROR] Payload too large (%zu bytes)\n", payloadLen);
+    return;
+  }
 
   // Optional delay before sending
   if (preDelayMillis > 0) {
@@ -325,21 +693,12 @@ void pollLora(
     delay(preDelayMillis);
   }
 
-  transmissonFlag = true;
-  lora->standby();
-  delay(5);
-  int result = lora->transmit(finalPacket, finalLen);
-  delay(10);                      
-  int rxState = lora->startReceive();
-  transmissonFlag = false;    
-  if (result == RADIOLIB_ERR_NONE) {
-    Serial.println("[ACK] Sent successfully.");
+  TxHandle handle = txQueueSend(finalPacket, finalLen, nullptr, dataType);
+  if (handle != 0) {
+    Serial.println("[ACK] Queued for sending.");
   } else {
-    Serial.println("[ACK] Failed to send");
+    Serial.println("[ACK] Failed to queue, TX queue full.");
   }
-
-  delete[] finalPacket;
-  delete[] packetData;
 }
 
 
@@ -356,63 +715,73 @@ void pollLora(
 // - Stores response in global variable `globalReply` if received
 
 void sendLora(const uint8_t* payloadData, size_t payloadLen, DataType dataType) {
-  SessionInfo session;
-  SessionStatus status = verifySession(devEUIHex, session);
+  SessionInfo* session = nullptr;
+  SessionStatus status = findSession(devEUI, session);
   if (status != SESSION_OK) {
     Serial.println("[ERROR] Session not found");
     return;
   }
 
-  // Allocate space: 1 byte for type + payload
-  size_t totalLen = payloadLen + 1;
-  uint8_t* packetData = new uint8_t[totalLen];
-  packetData[0] = (uint8_t)dataType; // first byte = type
-  memcpy(packetData + 1, payloadData, payloadLen); // rest = payload
-
-  // Encrypt + package
-  size_t finalLen = 0;
-  uint8_t* finalPacket = encryptAndPackage(packetData, totalLen, session, finalLen, devEUI);
+  // Encrypt + package [format][type][length][payload] straight into the packet buffer
+  uint8_t header[TLV_MAX_FRAME_HEADER];
+  DataSegment segments[2] = {
+    { header, tlvFrameHeader(header, dataType, payloadLen) },
+    { payloadData, payloadLen }
+  };
+
+  uint8_t finalPacket[PACKET_MAX_LEN];
+  size_t finalLen = encryptAndPackage(segments, 2, *session, devEUI, finalPacket, sizeof(finalPacket));
+  if (finalLen == 0) {
+    Serial.printf("[ERROR] Payload too large (%zu bytes)\n", payloadLen);
+    return;
+  }
 
   // Send
-  sender(finalPacket, finalLen);
-  delete[] finalPacket;
-  delete[] packetData;
+  sender(finalPacket, finalLen, dataType);
 }
  
 
 void handlePacket(uint8_t* buffer, size_t length) {
   Serial.println("==== [RX PACKET] ====");
 
-  // ───── Updated Offsets ─────
-  uint8_t* srcID = buffer;           // 0–7
-  uint8_t* nonce = buffer + 8;       // 8–23 (new!)
-  uint8_t* payload = buffer + 24;    // 24–(end - 8)
-  uint8_t* receivedHMAC = buffer + length - 8;
-
-  size_t payloadLength = length - 8 /*HMAC*/ - 8 /*srcID*/ - 16 /*nonce*/;
-
-  String srcIDString = idToHexString(srcID);
+  PacketView view;
+  if (!parsePacket(buffer, length, view)) {
+    Serial.println("[WARN] Packet too small for an encrypted frame");
+    return;
+  }
+  if (view.frameType == FTYPE_DATA_UP) {
+    Serial.println("[INFO] Uplink frame ignored");
+    return;
+  }
 
-  SessionInfo session;
-  SessionStatus status = verifySession(srcIDString, session);
+  SessionInfo* session = nullptr;
+  SessionStatus status = findPacketSession(view, session);
   if (status != SESSION_OK) {
     Serial.println("[ERROR] Session not found");
     return;
   }
 
-  // ───── Update HMAC Verification to match full buffer ─────
-  SessionStatus Hmac = verifyHmac(buffer, length, receivedHMAC);
+  // ───── HMAC over the full frame (and the restored frame counter) ─────
+  SessionStatus Hmac = authenticatePacket(view, *session);
+  if (Hmac == SESSION_REPLAY) {
+    Serial.printf("[WARN] Duplicate or replayed FCnt %lu dropped\n", (unsigned long)view.fcnt);
+    return;
+  }
   if (Hmac != SESSION_OK) {
   Serial.println("[WARN] HMAC MISMATCH!");
     return;
   }
   Serial.println("[OK] HMAC verified.");
 
-  uint8_t appSKey[16];
-  memcpy(appSKey, session.appSKey, 16);
   // ───── Use CTR Decryption with Nonce ─────
-  uint8_t decryptedPayload[payloadLength];
-  decryptPayload(appSKey, nonce, payload, payloadLength, decryptedPayload);
+  decryptInPlace(view, *session);
+  handleDecryptedPacket(view);
+}
+
+// Authenticated and decrypted frame: print it and keep the reply
+static void handleDecryptedPacket(const PacketView& view) {
+  const uint8_t* decryptedPayload = view.payload;
+  size_t payloadLength = view.payloadLength;
 
   printHex(decryptedPayload, payloadLength, "[INFO] Decrypted Payload: ");
   String decryptedMessage = "";
@@ -428,27 +797,24 @@ void handlePacket(uint8_t* buffer, size_t length) {
 
 // ────── LoRa Incoming Listener ───────────────────────────────
 void listenForIncoming() {
-
-  if (receivedFlag) {
-    receivedFlag = false;
-     
-    int packetLength = lora->getPacketLength();
-    if (packetLength > 0) {
-      uint8_t buffer[255];
-      int state = lora->readData(buffer, packetLength);
-      handlePacket(buffer, packetLength );
-    
-    if (state == RADIOLIB_ERR_NONE) {
-        Serial.printf("[RX] Length: %d\n[RX] Data (hex): ", packetLength);
-        for (int i = 0; i < packetLength; i++) {
-          if (buffer[i] < 0x10) Serial.print("0");
-          Serial.print(buffer[i], HEX);
-        }
-        Serial.println();
-      }
+  telemetryLoop();      // summarize sensor windows that have ended
+  aggregatorLoop();     // send buffered records whose deadline has passed
+  txQueueLoop();
+  keystreamPoolLoop();  // idle time: precompute keystream for the next send
+  captureRxFrame();
+
+  RxFrame frame;
+  while (rxQueuePop(frame)) {
+    Serial.printf("[RX] Length: %d\n[RX] Data (hex): ", frame.length);
+    for (int i = 0; i < frame.length; i++) {
+      if (frame.data[i] < 0x10) Serial.print("0");
+      Serial.print(frame.data[i], HEX);
     }
-  }
-}
-
+    Serial.println();
 
+    // Decrypts in place, so the raw frame is printed first
+    handlePacket(frame.data, frame.length);
 
+    captureRxFrame();
+  }
+}
@@ -7,6 +7,9 @@
 #include "EndDevice.h"
 #include "CryptoUtils.h"
 #include "Sessions.h"
+#include "Tlv.h"
+#include "StreamReassembly.h"
+#include "TxQueue.h"
 extern String globalReply;
 
 struct GroupConfig {
@@ -15,6 +18,12 @@ struct GroupConfig {
     int groupPrefixLimit;
 };
 
+// Group files are sent LZSS-compressed (Lz.h) only if that saves at least this
+// many percent; otherwise the raw file is cheaper for the gateway to handle.
+#ifndef GROUP_COMPRESS_MIN_SAVING
+#define GROUP_COMPRESS_MIN_SAVING 10
+#endif
+
 // Must be defined by user sketch
 extern GroupConfig groupConfig;
 extern String devEUIHex;
@@ -43,17 +52,70 @@ void listenForIncoming();
  *
  * @param finalPacket Pointer to encrypted packet
  * @param finalLen Length of packet
+ * @param dataType DataType of the payload, AIRTIME_CONTROL for ACKs
+ */
+void sender(const uint8_t* finalPacket, size_t finalLen, uint8_t dataType = AIRTIME_CONTROL);
+
+/**
+ * @brief Waits for the gateway's selective-repeat ACK of a stream.
+ *
+ * Drains the RX queue until an authenticated TYPE_STREAM_ACK for `streamId`
+ * arrives; other frames are handled as handlePacket() would, each
+ * authenticated once, so its frame counter is not mistaken for a replay.
+ *
+ * @param streamId Stream being sent
+ * @param timeoutMs Maximum wait
+ * @param ack Filled with the receiver state
+ * @return true if an ACK arrived in time
  */
-void sender(const uint8_t* finalPacket, size_t finalLen);
+bool awaitStreamAck(uint8_t streamId, uint32_t timeoutMs, StreamAck& ack);
+
+// Upper bound of the exponential join retry delay.
+#ifndef JOIN_RETRY_MAX_MS
+#define JOIN_RETRY_MAX_MS 60000
+#endif
+
+/**
+ * @brief Join latency and attempt counters of this device.
+ */
+struct JoinStats {
+    uint16_t attempts;          ///< JoinRequests sent by the last sendJoinRequest()
+    uint32_t latencyMs;         ///< First JoinRequest to JoinAccept of the last join
+    uint32_t totalAttempts;     ///< JoinRequests sent since boot
+    uint16_t joins;             ///< Successful joins
+    uint16_t failures;          ///< sendJoinRequest() calls that gave up
+    uint16_t acceptedRx1;       ///< JoinAccepts received in RX1
+    uint16_t acceptedRx2;       ///< JoinAccepts received in RX2
+    uint16_t backoffHints;      ///< Gateway backoff hints followed
+    uint16_t txFailures;        ///< JoinRequests the radio did not send
+    uint16_t foreignAccepts;    ///< JoinAccepts ignored because they echo another DevNonce
+};
 
 /**
- * @brief Sends a LoRaWAN JoinRequest and waits for JoinAccept.
+ * @brief Joins the network: sends a JoinRequest and listens for the
+ *        JoinAccept in the RX1 and RX2 windows (JoinQueue.h), timed from
+ *        the JoinRequest's TX done.
+ *
+ * Without an answer, attempt n waits a random time between half and all of
+ * retryDelay * 2^(n-1), capped at JOIN_RETRY_MAX_MS. The random part keeps
+ * devices that boot together from retrying in lockstep. A gateway backoff
+ * hint replaces that delay.
  *
- * @param maxRetries Number of retries
- * @param retryDelay Timeout per attempt in milliseconds
- * 
+ * @param maxRetries Number of JoinRequests
+ * @param retryDelay Base retry delay in milliseconds
+ * @return true if the device has a session (joined now or before)
  */
-void sendJoinRequest(int maxRetries, unsigned long retryDelay);
+bool sendJoinRequest(int maxRetries, unsigned long retryDelay);
+
+/**
+ * @brief Returns the join counters.
+ */
+JoinStats getJoinStats();
+
+/**
+ * @brief Prints the join counters to Serial.
+ */
+void printJoinStats();
 
 /**
  * @brief Polls a target device for a response using encrypted packets.
@@ -75,8 +137,10 @@ void pollLora(
  * @brief Sends one or two stored group files using LoRa.
  *
  * @param pathBase Prefix of stored group file (e.g., "Grp1")
+ * @param fecRepair FEC repair chunks per file; 0 uses ACKed retransmissions
+ * @param compress Compress each file that shrinks by GROUP_COMPRESS_MIN_SAVING percent
  */
-void sendStoredGroupFile(const char* pathBase);
+void sendStoredGroupFile(const char* pathBase, uint8_t fecRepair = 0, bool compress = true);
 
 /**
  * @brief Sends an encrypted payload with a type tag and receives ACK.
@@ -100,8 +164,6 @@ void sendLora(
  */
 void handlePacket(uint8_t* buffer, size_t length);
 
-#define STREAM_END 0xFF   // EOT
-
 class PolymorphicLoraSender {
 public:
     PolymorphicLoraSender() = default;
@@ -111,71 +173,112 @@ public:
     // Session info is now passed in so we don't verify each chunk
     virtual void sendChunk(const uint8_t* chunk, size_t len, DataType type, const SessionInfo& session) {
 
-        // Build packet: 1 byte type + payload
-        size_t totalLen = len + 1;
-        uint8_t* packetData = new uint8_t[totalLen];
-        packetData[0] = (uint8_t)type;
-        memcpy(packetData + 1, chunk, len);
-
-        // Encrypt + package
-        size_t finalLen = 0;
-        uint8_t* finalPacket = encryptAndPackage(packetData, totalLen, session, finalLen, devEUI);
-
-        // Send over LoRa
-        transmissonFlag = true;
-        lora->standby();
-        delay(5);
-        int result = lora->transmit(finalPacket, finalLen);
-        delay(10);
-        lora->startReceive();
-        transmissonFlag = false;
-
-        if (result == RADIOLIB_ERR_NONE) {
-            Serial.printf("[PolymorphicLoraSender] Sent chunk of %zu bytes successfully.\n", len);
-        } else {
-            Serial.printf("[PolymorphicLoraSender] Failed to send chunk of %zu bytes.\n", len);
+        // Encrypt + package [format][type][length][chunk] straight into the packet buffer
+        uint8_t header[TLV_MAX_FRAME_HEADER];
+        DataSegment segments[2] = {
+            { header, tlvFrameHeader(header, type, len) },
+            { chunk, len }
+        };
+
+        uint8_t finalPacket[PACKET_MAX_LEN];
+        size_t finalLen = encryptAndPackage(segments, 2, session, devEUI, finalPacket, sizeof(finalPacket));
+        if (finalLen == 0) {
+            Serial.printf("[PolymorphicLoraSender] Chunk of %zu bytes too large.\n", len);
+            return;
         }
 
-        delete[] finalPacket;
-        delete[] packetData;
+        // Queue for the radio; waits (still capturing RX) only while the queue is full
+        if (txQueueWaitForSpace(TX_QUEUE_WAIT_MS) && txQueueSend(finalPacket, finalLen, nullptr, type) != 0) {
+            Serial.printf("[PolymorphicLoraSender] Queued chunk of %zu bytes.\n", len);
+        } else {
+            Serial.printf("[PolymorphicLoraSender] Failed to queue chunk of %zu bytes.\n", len);
+        }
     }
 
-    // Send an arbitrary-length stream in 255-byte chunks
+    // Selective-repeat window in chunks for sendStream(); 0 sends without ACKs
+    void setArqWindow(uint8_t window) { arqWindow = window; }
+
+    // FEC repair chunks per sendStream() transfer; > 0 sends without ACKs and
+    // takes precedence over the ARQ window. Code rate = K / (K + repairChunks).
+    void setFecRepair(uint8_t repairChunks) { fecRepair = repairChunks; }
+
+    // Marks the stream data as LZSS-compressed (Lz.h); the gateway decompresses
+    // it after reassembly. The caller compresses the data.
+    void setCompressed(bool compressed) { streamFlags = compressed ? STREAM_FLAG_LZ : 0; }
+
+    // Statistics of the last reliable or FEC transfer
+    const StreamTransferStats& lastTransfer() const { return transferStats; }
+
+    // Send an arbitrary-length stream in STREAM_CHUNK_SIZE chunks.
+    // Each chunk carries [stream id][seq][flags] so the gateway can reassemble
+    // streams from several devices at once, in any arrival order.
     void sendStream(const uint8_t* data, size_t totalLen, DataType type = TYPE_STREAM) {
-        const size_t MAX_CHUNK = 200;
-        size_t offset = 0;
+        if (totalLen == 0 || totalLen > STREAM_MAX_LEN) {
+            Serial.printf("[PolymorphicLoraSender] Stream of %zu bytes not sent (max %u).\n",
+                          totalLen, (unsigned)STREAM_MAX_LEN);
+            return;
+        }
 
         // --- Verify session ONCE ---
-        SessionInfo session;
-        SessionStatus status = verifySession(devEUIHex, session);
+        SessionInfo* session = nullptr;
+        SessionStatus status = findSession(devEUI, session);
         if (status != SESSION_OK) {
             Serial.println("[ERROR] Session not found, cannot send stream.");
             return;
         }
 
-        while (offset < totalLen) {
-            size_t remaining = totalLen - offset;
-            size_t chunkLen = (remaining > MAX_CHUNK) ? MAX_CHUNK : remaining;
+        if (fecRepair > 0) {
+            sendStreamFec(data, totalLen, type, *session);
+            return;
+        }
+        if (arqWindow > 0) {
+            sendStreamReliable(data, totalLen, type, *session);
+            return;
+        }
 
-            // If this is the LAST chunk, append the end marker
-            if (offset + chunkLen >= totalLen) {
-                uint8_t* finalChunk = new uint8_t[chunkLen + 1];
-                memcpy(finalChunk, data + offset, chunkLen);
-                finalChunk[chunkLen] = STREAM_END;   // <-- identifier byte at end
+        uint8_t streamId = allocateStreamId();
+        uint8_t chunk[STREAM_CHUNK_HEADER_LEN + STREAM_CHUNK_SIZE];
+        size_t offset = 0;
+        uint16_t seq = 0;
 
-                sendChunk(finalChunk, chunkLen + 1, type, session);
-                delete[] finalChunk;
+        while (offset < totalLen) {
+            size_t remaining = totalLen - offset;
+            size_t chunkLen = (remaining > STREAM_CHUNK_SIZE) ? STREAM_CHUNK_SIZE : remaining;
+            bool final = (offset + chunkLen >= totalLen);
 
-            } else {
-                sendChunk(data + offset, chunkLen, type, session);
-            }
+            size_t headerLen = streamChunkHeader(chunk, streamId, seq, (final ? STREAM_FLAG_FINAL : 0) | streamFlags);
+            memcpy(chunk + headerLen, data + offset, chunkLen);
+            sendChunk(chunk, headerLen + chunkLen, type, *session);
 
             offset += chunkLen;
-            delay(5);
+            seq++;
         }
 
-        Serial.printf("[PolymorphicLoraSender] Stream sent (%zu bytes + end marker)\n", totalLen);
+        Serial.printf("[PolymorphicLoraSender] Stream %u sent (%zu bytes, %u chunks)\n",
+                      streamId, totalLen, seq);
     }
+
+    // Selective-repeat transfer: sends a window of chunks, asks the gateway for
+    // the missing-chunk bitmap and retransmits only those (see EndDevice.cpp)
+    StreamTransferStats sendStreamReliable(const uint8_t* data, size_t totalLen,
+                                           DataType type, const SessionInfo& session);
+
+    // One-way transfer: K source chunks followed by fecRepair repair chunks,
+    // any K of which rebuild the stream at the gateway (see EndDevice.cpp)
+    StreamTransferStats sendStreamFec(const uint8_t* data, size_t totalLen,
+                                      DataType type, const SessionInfo& session);
+
+protected:
+    // Random start so ids from before a reboot are not mistaken for duplicates
+    static uint8_t allocateStreamId() {
+        static uint8_t nextStreamId = (uint8_t)esp_random();
+        return nextStreamId++;
+    }
+
+    uint8_t arqWindow = 0;
+    uint8_t fecRepair = 0;
+    uint8_t streamFlags = 0;
+    StreamTransferStats transferStats = {};
 };
 
 #endif // END_DEVICE_H
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "Fec.h"
+
+#include <string.h>
+
+// ────── GF(256) Arithmetic ──────
+// Polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11D), generator 2. The exp table is
+// doubled so exp[log a + log b] needs no modulo.
+
+static uint8_t gfExp[512];
+static uint8_t gfLog[256];
+static bool gfReady = false;
+
+static void gfInit() {
+  if (gfReady) return;
+  uint16_t x = 1;
+  for (int i = 0; i < 255; i++) {
+    gfExp[i] = (uint8_t)x;
+    gfLog[x] = (uint8_t)i;
+    x <<= 1;
+    if (x & 0x100) x ^= 0x11D;
+  }
+  for (int i = 255; i < 512; i++) {
+    gfExp[i] = gfExp[i - 255];
+  }
+  gfLog[0] = 0;  // never used: zero is handled before any lookup
+  gfReady = true;
+}
+
+static inline uint8_t gfMul(uint8_t a, uint8_t b) {
+  if (a == 0 || b == 0) return 0;
+  return gfExp[gfLog[a] + gfLog[b]];
+}
+
+static inline uint8_t gfInv(uint8_t a) {
+  return gfExp[255 - gfLog[a]];
+}
+
+// dst ^= coef * src over `len` bytes
+static void gfMulAdd(uint8_t* dst, const uint8_t* src, uint8_t coef, size_t len) {
+  if (coef == 0) return;
+  if (coef == 1) {
+    for (size_t i = 0; i < len; i++) dst[i] ^= src[i];
+    return;
+  }
+  const uint8_t* expRow = gfExp + gfLog[coef];
+  for (size_t i = 0; i < len; i++) {
+    if (src[i]) dst[i] ^= expRow[gfLog[src[i]]];
+  }
+}
+
+// dst = coef * dst over `len` bytes
+static void gfScale(uint8_t* dst, uint8_t coef, size_t len) {
+  if (coef == 1) return;
+  const uint8_t* expRow = gfExp + gfLog[coef];
+  for (size_t i = 0; i < len; i++) {
+    if (dst[i]) dst[i] = expRow[gfLog[dst[i]]];
+  }
+}
+
+// Cauchy coefficient for repair row r and source column i
+static inline uint8_t cauchy(uint8_t r, uint8_t i) {
+  return gfInv((uint8_t)((FEC_MAX_REPAIR + r) ^ i));
+}
+
+// ────── Encoding ──────
+
+bool fecEncodeRepair(const uint8_t* data, size_t length, size_t chunkSize,
+                     uint8_t k, uint8_t repairIndex, uint8_t* out) {
+  if (k == 0 || k > FEC_MAX_SOURCE || repairIndex >= FEC_MAX_REPAIR) return false;
+  gfInit();
+
+  memset(out, 0, chunkSize);
+  for (uint8_t i = 0; i < k; i++) {
+    size_t offset = (size_t)i * chunkSize;
+    if (offset >= length) break;  // zero padding adds nothing
+    size_t len = (length - offset < chunkSize) ? length - offset : chunkSize;
+    gfMulAdd(out, data + offset, cauchy(repairIndex, i), len);
+  }
+  return true;
+}
+
+// ────── Decoding ──────
+// Subtracting the received source chunks from each repair chunk leaves a
+// system in the e missing chunks only; its e x e Cauchy matrix is inverted by
+// Gauss-Jordan elimination applied to the repair buffers.
+
+int fecDecode(uint8_t* data, size_t chunkSize, uint8_t k, uint32_t receivedMask,
+              uint8_t* const* repair, const uint8_t* repairIndex, size_t repairCount) {
+  if (k == 0 || k > FEC_MAX_SOURCE) return -1;
+  gfInit();
+
+  uint8_t missing[FEC_MAX_SOURCE];
+  size_t e = 0;
+  for (uint8_t i = 0; i < k; i++) {
+    if (!(receivedMask & (1UL << i))) missing[e++] = i;
+  }
+  if (e == 0) return 0;
+  if (e > repairCount) return -1;
+
+  // Syndromes: remove the known source chunks from the first e repair chunks
+  uint8_t* rows[FEC_MAX_SOURCE];
+  uint8_t matrix[FEC_MAX_SOURCE][FEC_MAX_SOURCE];
+  for (size_t r = 0; r < e; r++) {
+    rows[r] = repair[r];
+    for (uint8_t i = 0; i < k; i++) {
+      if (receivedMask & (1UL << i)) {
+        gfMulAdd(rows[r], data + (size_t)i * chunkSize, cauchy(repairIndex[r], i), chunkSize);
+      }
+    }
+    for (size_t c = 0; c < e; c++) {
+      matrix[r][c] = cauchy(repairIndex[r], missing[c]);
+    }
+  }
+
+  for (size_t c = 0; c < e; c++) {
+    size_t pivot = c;
+    while (pivot < e && matrix[pivot][c] == 0) pivot++;
+    if (pivot == e) return -1;  // only with duplicate repair indices
+    if (pivot != c) {
+      uint8_t tmp[FEC_MAX_SOURCE];
+      memcpy(tmp, matrix[c], e);
+      memcpy(matrix[c], matrix[pivot], e);
+      memcpy(matrix[pivot], tmp, e);
+      uint8_t* row = rows[c];
+      rows[c] = rows[pivot];
+      rows[pivot] = row;
+    }
+
+    uint8_t inv = gfInv(matrix[c][c]);
+    for (size_t j = 0; j < e; j++) matrix[c][j] = gfMul(matrix[c][j], inv);
+    gfScale(rows[c], inv, chunkSize);
+
+    for (size_t r = 0; r < e; r++) {
+      uint8_t factor = matrix[r][c];
+      if (r == c || factor == 0) continue;
+      for (size_t j = 0; j < e; j++) matrix[r][j] ^= gfMul(factor, matrix[c][j]);
+      gfMulAdd(rows[r], rows[c], factor, chunkSize);
+    }
+  }
+
+  for (size_t c = 0; c < e; c++) {
+    memcpy(data + (size_t)missing[c] * chunkSize, rows[c], chunkSize);
+  }
+  return (int)e;
+}
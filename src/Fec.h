@@ -0,0 +1,62 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Forward Error Correction (Cauchy Reed-Solomon erasure code)
+ *
+ * A stream of K source chunks is extended with repair chunks. Repair chunk r
+ * is a GF(256) linear combination of all source chunks:
+ *
+ *   repair[r] = sum_i C[r][i] * source[i],   C[r][i] = 1 / (x_r + y_i)
+ *
+ * with x_r = 128 + r and y_i = i. Every square submatrix of a Cauchy matrix
+ * is invertible, so ANY K of the K + R chunks rebuild the source. The code is
+ * systematic: source chunks are sent unchanged and no decoding is needed when
+ * they all arrive.
+ *
+ * The last source chunk may be short; the codec treats missing bytes as zero.
+ * No Arduino dependencies, so the codec also builds on the host (see
+ * extras/fecBenchmark.cpp).
+ * ───────────────────────────────────────────────────────────────
+ */
+
+#define FEC_MAX_SOURCE 32           // Source chunks per block (bitmask width)
+#define FEC_MAX_REPAIR 128          // Distinct repair chunk indices
+
+/**
+ * @brief Computes one repair chunk.
+ *
+ * @param data Source data, chunks of `chunkSize` bytes back to back
+ * @param length Source length; bytes past it count as zero
+ * @param chunkSize Bytes per chunk
+ * @param k Number of source chunks (1..FEC_MAX_SOURCE)
+ * @param repairIndex Repair chunk index (0..FEC_MAX_REPAIR-1)
+ * @param out Destination, `chunkSize` bytes
+ * @return false if `k` or `repairIndex` is out of range
+ */
+bool fecEncodeRepair(const uint8_t* data, size_t length, size_t chunkSize,
+                     uint8_t k, uint8_t repairIndex, uint8_t* out);
+
+/**
+ * @brief Rebuilds missing source chunks in place.
+ *
+ * The repair buffers are used as scratch space and hold garbage afterwards.
+ *
+ * @param data Source buffer, `k * chunkSize` bytes; received chunks in place,
+ *             a short last chunk zero-padded
+ * @param chunkSize Bytes per chunk
+ * @param k Number of source chunks (1..FEC_MAX_SOURCE)
+ * @param receivedMask Bit i = source chunk i present
+ * @param repair Received repair chunks
+ * @param repairIndex Repair index of each entry in `repair`
+ * @param repairCount Entries in `repair`
+ * @return Number of chunks recovered, -1 if too few chunks were received
+ */
+int fecDecode(uint8_t* data, size_t chunkSize, uint8_t k, uint32_t receivedMask,
+              uint8_t* const* repair, const uint8_t* repairIndex, size_t repairCount);
+
+#endif // FEC_H
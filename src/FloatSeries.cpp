@@ -0,0 +1,256 @@
+#include "FloatSeries.h"
+
+#include <math.h>
+#include <string.h>
+
+// ────── Bit I/O ──────
+// MSB first. Writes overwrite the bits they cover instead of OR-ing them in,
+// so a value that did not fit can be rolled back by restoring bitPos.
+
+static void putBits(FloatSeriesEncoder& enc, uint32_t value, uint8_t bits) {
+  if (enc.bitPos + bits > enc.capacity * 8) {
+    enc.overflow = true;
+    return;
+  }
+  while (bits > 0) {
+    uint8_t used = enc.bitPos & 7;
+    uint8_t take = (bits < 8 - used) ? bits : 8 - used;
+    uint8_t shift = 8 - used - take;
+    uint8_t mask = (uint8_t)(((1u << take) - 1) << shift);
+    uint8_t chunk = (uint8_t)((value >> (bits - take)) & ((1u << take) - 1));
+    uint8_t& byte = enc.out[enc.bitPos >> 3];
+    byte = (uint8_t)((byte & ~mask) | (chunk << shift));
+    enc.bitPos += take;
+    bits -= take;
+  }
+}
+
+struct BitReader {
+  const uint8_t* in;
+  size_t bitLength;
+  size_t bitPos;
+  bool error;
+};
+
+static uint32_t getBits(BitReader& reader, uint8_t bits) {
+  if (reader.bitPos + bits > reader.bitLength) {
+    reader.error = true;
+    return 0;
+  }
+  uint32_t value = 0;
+  while (bits > 0) {
+    uint8_t used = reader.bitPos & 7;
+    uint8_t take = (bits < 8 - used) ? bits : 8 - used;
+    uint8_t chunk = (uint8_t)((reader.in[reader.bitPos >> 3] >> (8 - used - take)) & ((1u << take) - 1));
+    value = (value << take) | chunk;
+    reader.bitPos += take;
+    bits -= take;
+  }
+  return value;
+}
+
+static size_t headerLength(float step) {
+  return FLOAT_SERIES_HEADER_LEN + (step > 0 ? sizeof(float) : 0);
+}
+
+static uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static uint8_t leadingZeros(uint32_t x) {
+  uint8_t n = 0;
+  while (!(x & 0x80000000u)) { x <<= 1; n++; }
+  return n;
+}
+
+static uint8_t trailingZeros(uint32_t x) {
+  uint8_t n = 0;
+  while (!(x & 1u)) { x >>= 1; n++; }
+  return n;
+}
+
+// ────── Encoder ──────
+
+bool floatSeriesBegin(FloatSeriesEncoder& enc, uint8_t* out, size_t capacity, float step) {
+  if (!(step >= 0) || capacity < headerLength(step) + sizeof(float)) return false;
+
+  enc.out = out;
+  enc.capacity = capacity;
+  enc.count = 0;
+  enc.step = step;
+  enc.prevBits = 0;
+  enc.prevLeading = 0xFF;     // no window yet
+  enc.prevTrailing = 0;
+  enc.prevQ = 0;
+  enc.overflow = false;
+
+  out[0] = (step > 0) ? FLOAT_SERIES_QUANTIZED : FLOAT_SERIES_XOR;
+  out[1] = 0;
+  out[2] = 0;
+  if (step > 0) memcpy(out + FLOAT_SERIES_HEADER_LEN, &step, sizeof(float));
+  enc.bitPos = headerLength(step) * 8;
+  return true;
+}
+
+static void appendXor(FloatSeriesEncoder& enc, float value) {
+  uint32_t bits = floatBits(value);
+  if (enc.count == 0) {
+    putBits(enc, bits, 32);
+    enc.prevBits = bits;
+    return;
+  }
+
+  uint32_t x = bits ^ enc.prevBits;
+  enc.prevBits = bits;
+  if (x == 0) {
+    putBits(enc, 0, 1);
+    return;
+  }
+
+  uint8_t leading = leadingZeros(x);
+  uint8_t trailing = trailingZeros(x);
+  if (enc.prevLeading != 0xFF && leading >= enc.prevLeading && trailing >= enc.prevTrailing) {
+    uint8_t meaningful = 32 - enc.prevLeading - enc.prevTrailing;
+    putBits(enc, 0x2, 2);
+    putBits(enc, x >> enc.prevTrailing, meaningful);
+    return;
+  }
+
+  uint8_t meaningful = 32 - leading - trailing;
+  putBits(enc, 0x3, 2);
+  putBits(enc, leading, 5);
+  putBits(enc, meaningful - 1, 5);
+  putBits(enc, x >> trailing, meaningful);
+  enc.prevLeading = leading;
+  enc.prevTrailing = trailing;
+}
+
+static void appendQuantized(FloatSeriesEncoder& enc, float value) {
+  float scaled = roundf(value / enc.step);
+  int32_t q;
+  if (!(scaled == scaled)) q = 0;                                   // NaN
+  else if (scaled > FLOAT_SERIES_MAX_Q) q = FLOAT_SERIES_MAX_Q;
+  else if (scaled < -FLOAT_SERIES_MAX_Q) q = -FLOAT_SERIES_MAX_Q;
+  else q = (int32_t)scaled;
+
+  if (enc.count == 0) {
+    putBits(enc, (uint32_t)q, 32);
+    enc.prevQ = q;
+    return;
+  }
+
+  int32_t delta = q - enc.prevQ;        // |delta| <= 2^30 thanks to the clamp
+  uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+  enc.prevQ = q;
+
+  if (zigzag == 0) {
+    putBits(enc, 0x0, 1);
+  } else if (zigzag < (1u << 2)) {
+    putBits(enc, 0x2, 2);
+    putBits(enc, zigzag, 2);
+  } else if (zigzag < (1u << 5)) {
+    putBits(enc, 0x6, 3);
+    putBits(enc, zigzag, 5);
+  } else if (zigzag < (1u << 12)) {
+    putBits(enc, 0xE, 4);
+    putBits(enc, zigzag, 12);
+  } else {
+    putBits(enc, 0xF, 4);
+    putBits(enc, zigzag, 32);
+  }
+}
+
+bool floatSeriesAppend(FloatSeriesEncoder& enc, float value) {
+  if (enc.count == FLOAT_SERIES_MAX_COUNT) return false;
+
+  FloatSeriesEncoder saved = enc;
+  if (enc.step > 0) appendQuantized(enc, value);
+  else appendXor(enc, value);
+
+  if (enc.overflow) {
+    enc = saved;
+    return false;
+  }
+  enc.count++;
+  enc.out[1] = enc.count & 0xFF;
+  enc.out[2] = enc.count >> 8;
+  return true;
+}
+
+size_t floatSeriesLength(const FloatSeriesEncoder& enc) {
+  return (enc.bitPos + 7) / 8;
+}
+
+size_t floatSeriesEncode(const float* values, size_t& count, uint8_t* out, size_t capacity, float step) {
+  FloatSeriesEncoder enc;
+  if (!floatSeriesBegin(enc, out, capacity, step)) {
+    count = 0;
+    return 0;
+  }
+  size_t n = 0;
+  while (n < count && floatSeriesAppend(enc, values[n])) n++;
+  count = n;
+  return floatSeriesLength(enc);
+}
+
+// ────── Decoder ──────
+
+size_t floatSeriesCount(const uint8_t* in, size_t length) {
+  if (length < FLOAT_SERIES_HEADER_LEN) return 0;
+  if (in[0] != FLOAT_SERIES_XOR && in[0] != FLOAT_SERIES_QUANTIZED) return 0;
+  return (size_t)in[1] | ((size_t)in[2] << 8);
+}
+
+size_t floatSeriesDecode(const uint8_t* in, size_t length, float* values, size_t maxValues) {
+  size_t count = floatSeriesCount(in, length);
+  if (count == 0 || count > maxValues) return 0;
+
+  bool quantized = in[0] == FLOAT_SERIES_QUANTIZED;
+  float step = 0;
+  if (quantized) {
+    if (length < headerLength(1)) return 0;
+    memcpy(&step, in + FLOAT_SERIES_HEADER_LEN, sizeof(float));
+    if (!(step > 0)) return 0;
+  }
+
+  BitReader reader = { in, length * 8, headerLength(step) * 8, false };
+  uint32_t bits = 0;
+  uint8_t leading = 0, trailing = 0;
+  uint32_t q = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    if (quantized) {
+      if (i == 0) {
+        q = getBits(reader, 32);
+      } else {
+        uint8_t width;
+        if (getBits(reader, 1) == 0) width = 0;
+        else if (getBits(reader, 1) == 0) width = 2;
+        else if (getBits(reader, 1) == 0) width = 5;
+        else if (getBits(reader, 1) == 0) width = 12;
+        else width = 32;
+        uint32_t zigzag = width ? getBits(reader, width) : 0;
+        q += (zigzag >> 1) ^ (0u - (zigzag & 1));
+      }
+      values[i] = (int32_t)q * step;
+    } else {
+      if (i == 0) {
+        bits = getBits(reader, 32);
+      } else if (getBits(reader, 1) == 1) {
+        if (getBits(reader, 1) == 1) {
+          leading = (uint8_t)getBits(reader, 5);
+          uint8_t meaningful = (uint8_t)getBits(reader, 5) + 1;
+          if (leading + meaningful > 32) return 0;
+          trailing = 32 - leading - meaningful;
+        }
+        uint8_t meaningful = 32 - leading - trailing;
+        bits ^= getBits(reader, meaningful) << trailing;
+      }
+      memcpy(&values[i], &bits, sizeof(float));
+    }
+    if (reader.error) return 0;
+  }
+  return count;
+}
@@ -0,0 +1,118 @@
+#ifndef FLOAT_SERIES_H
+#define FLOAT_SERIES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Compressed Float Series (TYPE_FLOAT_SERIES)
+ *
+ * Slowly varying readings share most of their bits with the previous one.
+ * Two bit-packed encodings, chosen per record:
+ *
+ * Lossless (step = 0), Gorilla XOR:
+ *   first value 32 bits, then per value x = bits ^ previous bits
+ *     x == 0                         '0'
+ *     meaningful bits fit the        '10' + those bits
+ *       previous leading/trailing window
+ *     otherwise                      '11' + leading zeros (5) + length - 1 (5) + bits
+ *
+ * Quantized (step > 0), delta of q = round(value / step):
+ *   first q 32 bits, then d = q - previous q, zigzag-coded
+ *     d == 0 '0',  < 2^2 '10' + 2,  < 2^5 '110' + 5,  < 2^12 '1110' + 12,
+ *     else '1111' + 32
+ *   (Plain deltas beat delta-of-delta here: sensor noise doubles in the
+ *   second difference, see extras/floatSeriesBenchmark.cpp.)
+ *   Decoded values are q * step, off by at most step / 2. |q| is clamped
+ *   to FLOAT_SERIES_MAX_Q.
+ *
+ * Record value:
+ *
+ *   [mode 1][count 2, little-endian][step f32, quantized only][bits, MSB first]
+ *
+ * The encoder is streaming: values are appended one at a time into a fixed
+ * buffer, and a value that does not fit leaves the buffer unchanged.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+#define FLOAT_SERIES_XOR        0x00    // Lossless mode byte
+#define FLOAT_SERIES_QUANTIZED  0x01    // Fixed-point mode byte
+
+#define FLOAT_SERIES_HEADER_LEN 3       // Mode + count, plus 4 for the step
+#define FLOAT_SERIES_MAX_COUNT  0xFFFF
+#define FLOAT_SERIES_MAX_Q      (1L << 29)
+
+// Values the gateway decodes from one record; larger records are reported and skipped.
+#ifndef FLOAT_SERIES_DECODE_MAX
+#define FLOAT_SERIES_DECODE_MAX 128
+#endif
+
+/**
+ * @brief State of one series being encoded.
+ */
+struct FloatSeriesEncoder {
+    uint8_t* out;               ///< Record value buffer
+    size_t capacity;            ///< Size of out
+    size_t bitPos;              ///< Bits written, header included
+    uint16_t count;             ///< Values appended
+    float step;                 ///< 0 = lossless
+    uint32_t prevBits;          ///< Lossless: previous value
+    uint8_t prevLeading;        ///< Lossless: window of the previous XOR
+    uint8_t prevTrailing;
+    int32_t prevQ;              ///< Quantized: previous value
+    bool overflow;              ///< A write did not fit (internal)
+};
+
+/**
+ * @brief Starts a series in a caller-owned buffer.
+ *
+ * @param enc Encoder to initialize
+ * @param out Destination, holds the whole record value
+ * @param capacity Size of out (at least 7 bytes)
+ * @param step Quantization step, 0 = lossless
+ * @return false if the buffer cannot hold the header
+ */
+bool floatSeriesBegin(FloatSeriesEncoder& enc, uint8_t* out, size_t capacity, float step = 0);
+
+/**
+ * @brief Appends one value.
+ *
+ * @return false if it does not fit (the series is unchanged and can be finished)
+ */
+bool floatSeriesAppend(FloatSeriesEncoder& enc, float value);
+
+/**
+ * @brief Bytes the series takes so far; the record value length.
+ */
+size_t floatSeriesLength(const FloatSeriesEncoder& enc);
+
+/**
+ * @brief Encodes an array in one call.
+ *
+ * @param values Values to encode
+ * @param count In: values available; out: values that fit
+ * @param out Destination
+ * @param capacity Size of out
+ * @param step Quantization step, 0 = lossless
+ * @return Record value length, 0 if not even the header fits
+ */
+size_t floatSeriesEncode(const float* values, size_t& count, uint8_t* out, size_t capacity, float step = 0);
+
+/**
+ * @brief Decodes a record value.
+ *
+ * @param in Record value
+ * @param length Value length
+ * @param values Destination
+ * @param maxValues Size of values
+ * @return Values decoded; 0 if the record is malformed or holds more than maxValues
+ */
+size_t floatSeriesDecode(const uint8_t* in, size_t length, float* values, size_t maxValues);
+
+/**
+ * @brief Values in a record without decoding it (0 if malformed).
+ */
+size_t floatSeriesCount(const uint8_t* in, size_t length);
+
+#endif // FLOAT_SERIES_H
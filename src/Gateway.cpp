@@ -8,6 +8,17 @@
 #include "CryptoUtils.h"
 #include "Sessions.h"
 #include "EndDevice.h"
+#include "PacketView.h"
+#include "RxQueue.h"
+#include "TxQueue.h"
+#include "KeystreamPool.h"
+#include "SessionStore.h"
+#include "Tlv.h"
+#include "StreamReassembly.h"
+#include "RxFilter.h"
+#include "JoinQueue.h"
+#include "Telemetry.h"
+#include "FloatSeries.h"
 
 
 
@@ -39,10 +50,11 @@ void sendDataAck(const String& srcID, uint8_t* SenderID) {
     return;
   }
 
-  String payload = "ACK:";
-  size_t finalLen = 0;
+  static const uint8_t ackPayload[] = { 'A', 'C', 'K', ':' };
+  DataSegment payload = { ackPayload, sizeof(ackPayload) };
 
-  uint8_t* finalPacket = encryptAndPackage((const uint8_t*)payload.c_str(), payload.length(), session, finalLen, SenderID);
+  uint8_t finalPacket[PACKET_OVERHEAD + sizeof(ackPayload)];
+  size_t finalLen = encryptAndPackage(&payload, 1, session, SenderID, finalPacket, sizeof(finalPacket));
   sender(finalPacket, finalLen);
 }
 
@@ -54,12 +66,16 @@ struct JoinAccept {
   // other fields like RxDelay, DLSettings can go here
 };
 
-// ────── JoinRequest Packet Layout (18 bytes, unencrypted) ──────
+// ────── JoinRequest Packet Layout (18 bytes + 4-byte MIC, unencrypted) ──────
 // Offset | Size | Field       | Description
 // -------|------|-------------|------------------------------
 // 0      | 8    | DevEUI      | Unique device identifier
 // 8      | 8    | AppEUI      | Application identifier
 // 16     | 2    | DevNonce    | Random value from device
+// 18     | 4    | MIC         | First 4 bytes of HMAC-SHA256 over bytes 0-17
+//
+// Compact devices prefix FTYPE_JOIN_REQUEST (23 bytes, MIC over bytes 0-18)
+// and get their JoinAccept prefixed with FTYPE_JOIN_ACCEPT.
 
 
 // Function Output:
@@ -70,14 +86,32 @@ struct JoinAccept {
 
  
 // Function Output: Derives and stores appSKey and nwkSKey in `SessionInfo`
-void handleJoinRequest(uint8_t* buffer, size_t len) {
-    if (len != 22) return;
-    if (!verifyMIC(buffer, len, buffer + 18)) return;
+// DevEUI position inside a JoinRequest, nullptr if `len` is not one
+static uint8_t* joinRequestBody(uint8_t* buffer, size_t len) {
+    if (len == JOIN_REQUEST_LEN && buffer[0] == FTYPE_JOIN_REQUEST) return buffer + 1;
+    if (len == JOIN_REQUEST_LEGACY_LEN) return buffer;
+    return nullptr;
+}
+
+// Picks a devAddr no other session uses, so compact frames resolve uniquely
+static uint32_t allocateDevAddr() {
+    uint32_t devAddr;
+    do {
+        devAddr = esp_random();
+    } while (devAddr == 0 || sessionAddrKnown(devAddr));
+    return devAddr;
+}
+
+size_t processJoinRequest(uint8_t* buffer, size_t len, uint8_t* joinAccept) {
+    uint8_t* body = joinRequestBody(buffer, len);
+    if (body == nullptr) return 0;
+    if (!verifyMIC(buffer, len, buffer + len - 4)) return 0;
+    bool compact = (body != buffer);
 
     uint8_t devEUI[8], appEUI[8], devNonce[2];
-    memcpy(devEUI, buffer, 8);
-    memcpy(appEUI, buffer + 8, 8);
-    memcpy(devNonce, buffer + 16, 2);
+    memcpy(devEUI, body, 8);
+    memcpy(appEUI, body + 8, 8);
+    memcpy(devNonce, body + 16, 2);
 
     // Generate joinNonce and devAddr instantly
     uint8_t joinNonce[3];
@@ -86,14 +120,14 @@ void handleJoinRequest(uint8_t* buffer, size_t len) {
     joinNonce[1] = (rnd >> 8) & 0xFF;
     joinNonce[2] = (rnd >> 16) & 0xFF;
 
-    uint32_t devAddr = esp_random();  
+    uint32_t devAddr = allocateDevAddr();
     uint8_t netID[3] = {0x01, 0x23, 0x45};
 
     uint8_t appSKey[16], nwkSKey[16];
     deriveSessionKey(appSKey, 0x02, appKey, joinNonce, netID, devNonce);
     deriveSessionKey(nwkSKey, 0x01, appKey, joinNonce, netID, devNonce);
 
-    SessionInfo session;
+    SessionInfo session = {};  // frame counters start at 0 with the new keys
     session.devAddr = devAddr;
     memcpy(session.appSKey, appSKey, 16);
     memcpy(session.nwkSKey, nwkSKey, 16);
@@ -109,100 +143,118 @@ void handleJoinRequest(uint8_t* buffer, size_t len) {
     memcpy(payload + 7, netID, 3);
     memcpy(payload + 10, devNonce, 2);
 
-    uint8_t encryptedPayload[16];
-    aes128_decrypt_block(appKey, payload, encryptedPayload); // encrypt JoinAccept
-
-    // **Instant transmit** — no delays
-    transmissonFlag = true;
-    lora->standby();
-    lora->transmit(encryptedPayload, sizeof(encryptedPayload));
-    lora->startReceive();  // back to listening immediately
-    transmissonFlag = false;
-    Serial.println("[JOIN] Sent encrypted JoinAccept instantly.");
+    // Answer in the layout of the request: [FType] only for compact devices
+    size_t acceptLen = 0;
+    if (compact) joinAccept[acceptLen++] = FTYPE_JOIN_ACCEPT;
+    aes128_decrypt_block_ctx(appKeyDecContext(), payload, joinAccept + acceptLen); // encrypt JoinAccept
+    acceptLen += 16;
+    return acceptLen;
 }
 
-bool isJoinRequest(size_t length) {
-  return length == 18;
+void handleJoinRequest(uint8_t* buffer, size_t len) {
+    uint8_t joinAccept[JOIN_ACCEPT_LEN];
+    size_t acceptLen = processJoinRequest(buffer, len, joinAccept);
+    if (acceptLen == 0) return;
+
+    // Queued, RX re-arms as soon as the JoinAccept is on air
+    if (txQueueSend(joinAccept, acceptLen) != 0) {
+      Serial.println("[JOIN] Encrypted JoinAccept queued.");
+    } else {
+      Serial.println("[JOIN] TX queue full, JoinAccept dropped.");
+    }
 }
 
+
 // ────── Normal Uplink Packet Layout (variable length) ──────
 // Offset | Size         | Field        | Description
 // -------|--------------|--------------|------------------------------
 // 0      | 8            | srcID        | Device unique ID
-// 8      | N (len-16)   | Payload      | Encrypted data content
+// 8      | 16           | Nonce        | CTR IV
+// 24     | N (len-32)   | Payload      | Encrypted data content
 // len-8  | 8            | HMAC         | Message authentication tag
+//
+// Notes:
+// - Offsets are resolved once by parsePacket(), the payload is decrypted in place
+// - Compact uplinks ([FType][DevAddr][FCnt], PacketView.h) are resolved by
+//   devAddr; from then on both layouts are handled alike
+// - Every record is handed to the RecordCallback, so aggregated frames
+//   (UplinkAggregator.h) reach the sketch as separate records
+
+static RecordCallback recordCallback = nullptr;
 
+void setRecordCallback(RecordCallback callback) {
+  recordCallback = callback;
+}
 
 void handleLoRaPacket(uint8_t* buffer, size_t length) {
-  if (length <= 18) {
+  PacketView view;
+  if (!parsePacket(buffer, length, view)) {
     Serial.println("[ERROR] Packet too small or JoinRequest size - ignoring in handleLoRaPacket");
     return;
   }
+  if (view.frameType == FTYPE_DATA_DOWN) {
+    Serial.println("[WARN] Downlink frame ignored on the gateway");
+    return;
+  }
 
- Serial.println("==== [RX PACKET] ====");
-  Serial.printf("Total length: %d bytes\n", length);
-  printHex(buffer, length, "[RAW] Data: ");
-
-  // ───── Updated Offsets ─────
-  uint8_t* srcID = buffer;           // 0–7
-  uint8_t* nonce = buffer + 8;       // 8–23 (new!)
-  uint8_t* payload = buffer + 24;    // 24–(end - 8)
-  uint8_t* receivedHMAC = buffer + length - 8;
-
-  size_t payloadLength = length - 8 /*HMAC*/ - 8 /*srcID*/ - 16 /*nonce*/;
-
-  String srcIDString = idToHexString(srcID);
-
-  SessionInfo session;
-  SessionStatus status = verifySession(srcIDString, session);
+  SessionInfo* session = nullptr;
+  SessionStatus status = findPacketSession(view, session);
+  if (status == SESSION_EXPIRED) {
+    Serial.println("[WARN] Session expired, device must rejoin");
+    return;
+  }
   if (status != SESSION_OK) {
     Serial.println("[ERROR] Session not found");
     return;
   }
-  
-  uint8_t localAppSKey[16], localNwkSKey[16];
-  memcpy(localAppSKey, session.appSKey, 16);
-
-  memcpy(localNwkSKey, session.nwkSKey, 16);
 
-  printHex(srcID, 8, "[INFO] Source ID: ");
-  printHex(payload, payloadLength, "[INFO] Payload: ");
-  printHex(receivedHMAC, 8, "[INFO] Received HMAC: ");
-
-  if (verifyHmac(buffer, length, receivedHMAC) != SESSION_OK) {
+  // Authenticate before any logging, so rejected frames cost no Serial time
+  status = authenticatePacket(view, *session);
+  if (status == SESSION_REPLAY) {
+    Serial.printf("[WARN] Duplicate or replayed FCnt %lu dropped\n", (unsigned long)view.fcnt);
+    return;
+  }
+  if (status != SESSION_OK) {
     Serial.println("[WARN] HMAC MISMATCH!");
     return;
   }
+
+  Serial.println("==== [RX PACKET] ====");
+  Serial.printf("Total length: %u bytes\n", (unsigned)length);
+  printHex(buffer, length, "[RAW] Data: ");
+  printHex(view.srcID, PACKET_SRC_ID_LEN, "[INFO] Source ID: ");
+  if (view.frameType != FTYPE_LEGACY_DATA) {
+    Serial.printf("[INFO] DevAddr: %08lX FCnt: %lu\n", (unsigned long)view.devAddr, (unsigned long)view.fcnt);
+  }
+  printHex(view.payload, view.payloadLength, "[INFO] Payload: ");
+  printHex(view.hmac, PACKET_HMAC_LEN, "[INFO] Received HMAC: ");
   Serial.println("[OK] HMAC verified.");
 
+  // Optional: print the raw payload in binary format (before it is decrypted in place)
+  printBinaryBits(view.payload, view.payloadLength);
+
   Serial.println("========== DECRYPTED DATA ==========");
-  
-  uint8_t decryptedPayload[payloadLength];
 
-  decryptPayload(localAppSKey, nonce, payload, payloadLength, decryptedPayload);
+  decryptInPlace(view, *session);
+  uint8_t* decryptedPayload = view.payload;
+  size_t payloadLength = view.payloadLength;
   printHex(decryptedPayload, payloadLength, "[INFO] Decrypted Payload: ");
-  
-    // Optional: print the raw payload in binary format
-    printBinaryBits(payload, payloadLength);
 
-    uint8_t* ptr = decryptedPayload;          // Pointer to current position in decrypted buffer
+    // Records carry explicit lengths (TLV); legacy payloads fall back to the sentinel scan
+    TlvReader reader;
+    TlvRecord record;
+    tlvBegin(reader, decryptedPayload, payloadLength);
     size_t index = 0;                  // Record index for logging
 
-    while (ptr < decryptedPayload + payloadLength) {
-      uint8_t dataType = *ptr++;       // Read current data type and advance pointer
-      uint8_t* dataStart = ptr;        // Start of data for this type
-      size_t dataLength = 0;           // Length of data for this type
-    
-      // Advance until next type or end of payload, counting data length
-      while (ptr < decryptedPayload + payloadLength &&
-             *ptr != TYPE_TEXT &&
-             *ptr != TYPE_BYTES &&
-             *ptr != TYPE_FLOATS) {
-        ptr++;
-        dataLength++;
-      }
+    while (tlvNext(reader, record)) {
+      uint8_t dataType = record.type;
+      const uint8_t* dataStart = record.value;
+      size_t dataLength = record.length;
     
       Serial.printf("[INFO] Type: 0x%02X | Length: %zu\n", dataType, dataLength);
+      if (recordCallback && dataType != TYPE_STREAM) {
+        recordCallback(view.srcID, dataType, dataStart, dataLength);
+      }
       // Decode printable text; replace 0x01 with space
       switch (dataType) {
         case TYPE_TEXT: {
@@ -240,6 +292,50 @@ void handleLoRaPacket(uint8_t* buffer, size_t length) {
           }
           break;
         }
+
+        // Compressed float readings (FloatSeries.h)
+        case TYPE_FLOAT_SERIES: {
+          float values[FLOAT_SERIES_DECODE_MAX];
+          size_t count = floatSeriesDecode(dataStart, dataLength, values, FLOAT_SERIES_DECODE_MAX);
+          if (count == 0) {
+            Serial.printf("[WARN] Float series of %zu bytes ignored (%zu values)\n",
+                          dataLength, floatSeriesCount(dataStart, dataLength));
+            break;
+          }
+          for (size_t i = 0; i < count; i++) {
+            Serial.printf("[DECRYPTED] Float[%u]: %.2f\n", (unsigned)i, values[i]);
+          }
+          Serial.printf("[INFO] %u floats in %zu bytes\n", (unsigned)count, dataLength);
+          break;
+        }
+
+        // Window summary of a sensor channel (Telemetry.h)
+        case TYPE_SUMMARY: {
+          TelemetrySummary summary;
+          if (!telemetryReadSummary(dataStart, dataLength, summary)) {
+            Serial.printf("[WARN] Summary of %zu bytes ignored\n", dataLength);
+            break;
+          }
+          Serial.printf("[DECRYPTED] Channel %u: %u samples, min %.2f max %.2f mean %.2f last %.2f\n",
+                        summary.channel, summary.count, summary.min, summary.max, summary.mean, summary.last);
+          break;
+        }
+
+        // One chunk of a stream; reassembled per device and stream id
+        case TYPE_STREAM: {
+          if (reader.version == TLV_FORMAT_LEGACY) {
+            Serial.println("[WARN] Legacy stream chunk without header ignored");
+            break;
+          }
+          streamReassemblyPush(view.srcID, dataStart, dataLength);
+
+          // Reliable streams ask for the missing-chunk bitmap once per window
+          StreamAck ack;
+          if (streamAckFor(view.srcID, dataStart, dataLength, ack)) {
+            sendStreamAck(view.srcID, *session, ack);
+          }
+          break;
+        }
       
         default:
           Serial.printf("[WARN] Unknown type: 0x%02X\n", dataType);
@@ -247,13 +343,21 @@ void handleLoRaPacket(uint8_t* buffer, size_t length) {
       }
       index++;
     }
+    if (reader.error) {
+      Serial.printf("[WARN] Truncated record after %zu record(s)\n", index);
+    }
+    if (index > 1) {
+      Serial.printf("[INFO] %zu records in one frame\n", index);
+    }
   
   Serial.println("====================\n");
 }
 
 
 void handleJoinIfNeeded(uint8_t* buffer, size_t len) {
-  String srcEUI = idToHexString(buffer, 8);
+  uint8_t* body = joinRequestBody(buffer, len);
+  if (body == nullptr) return;
+  String srcEUI = idToHexString(body, 8);
 
   if (sessionExists(srcEUI)) {
     Serial.println("[JOIN] Already joined: " + srcEUI);
@@ -265,40 +369,45 @@ void handleJoinIfNeeded(uint8_t* buffer, size_t len) {
 }
 
 
-void Recive() {
-  static unsigned long lastJoinResponseTime = 0;
-
-  if (!receivedFlag) return;
-  receivedFlag = false;
-
-  int packetLength = lora->getPacketLength();
-  if (packetLength <= 0) {
-    Serial.println("[RX] No valid packet length.");
-    return;
-  }
+// ────── Receive Worker ──────
+// Frames are captured into the RX queue and drained here. After
+// rxQueueBegin() the capture task reads each frame when DIO1 fires, while
+// this loop verifies/decrypts the previous one (see RxQueue.h). The polls
+// below capture frames for sketches that do not start the task.
 
-  uint8_t buffer[255];
-  int state = lora->readData(buffer, packetLength);
+void Recive() {
+  txQueueLoop();  // finish the frame on air, start the next one
+  captureRxFrame();
+
+  RxFrame frame;
+  while (rxQueuePop(frame)) {
+    // Drop short, unknown and flooding senders before any crypto (counted in RxFilterStats)
+    if (rxFilterCheck(frame.data, frame.length) != RXF_PASS) {
+      captureRxFrame();
+      continue;
+    }
 
-  if (state != RADIOLIB_ERR_NONE) {
-    Serial.print("[RX] Error reading data: ");
-    Serial.println(state);
-    return;
-  }
+    // Route packet by its frame type
+    switch (frameTypeOf(frame.data, frame.length)) {
+      case FTYPE_JOIN_REQUEST:
+        joinQueuePush(frame.data, frame.length, frame.timestamp);  // keys are derived by joinQueueLoop()
+        break;
+      case FTYPE_DATA_UP:
+      case FTYPE_LEGACY_DATA:
+        handleLoRaPacket(frame.data, frame.length);
+        break;
+      default:
+        Serial.printf("[RX] Ignored frame type 0x%02X (%u bytes)\n", frame.data[0], (unsigned)frame.length);
+        break;
+    }
 
-  // Route packet
-  if (packetLength == 22) {
-    handleJoinIfNeeded(buffer, packetLength);
-  } else {
-    handleLoRaPacket(buffer, packetLength);
+    captureRxFrame();
   }
 
-  // Restart receiver properly
-  int rx = lora->startReceive();
-  if (rx != RADIOLIB_ERR_NONE) {
-    Serial.print("[ERROR] Failed to restart receive: ");
-    Serial.println(rx);
-  }
+  joinQueueLoop();  // one pending join, when the TX queue has room
+  sessionStoreLoop();  // write-behind flush of sessions stored by joins
+  keystreamPoolLoop();  // refill pooled keystream, if bound
+  streamReassemblyLoop();  // reclaim abandoned streams
 }
 
 
@@ -19,6 +19,9 @@ enum DataType : uint8_t {
   TYPE_BYTES  = 0x02,
   TYPE_FLOATS = 0x03,
   TYPE_STREAM = 0x04,
+  TYPE_STREAM_ACK = 0x05,   // Gateway → device, selective-repeat ACK (StreamReassembly.h)
+  TYPE_SUMMARY = 0x06,      // Window summary of a sensor channel (Telemetry.h)
+  TYPE_FLOAT_SERIES = 0x07, // Compressed float readings (FloatSeries.h)
 };
 
 // ─────────────────────────────────────────────
@@ -52,7 +55,7 @@ void setRadioModule(PhysicalLayer* module);
 /**
  * @brief Handle JoinRequest only if device has not joined yet.
  * 
- * @param buffer Raw packet buffer (must start with DevEUI)
+ * @param buffer Raw JoinRequest (legacy 22 bytes or FTYPE_JOIN_REQUEST 23 bytes)
  * @param len    Length of buffer
  */
 void handleJoinIfNeeded(uint8_t* buffer, size_t len);
@@ -60,10 +63,21 @@ void handleJoinIfNeeded(uint8_t* buffer, size_t len);
 /**
  * @brief Handles JoinRequest .
  * 
- * @param buffer Raw packet buffer (must start with DevEUI)
+ * @param buffer Raw JoinRequest (legacy 22 bytes or FTYPE_JOIN_REQUEST 23 bytes)
  * @param len    Length of buffer
  */
 void handleJoinRequest(uint8_t* buffer, size_t len);
+
+/**
+ * @brief Verifies a JoinRequest, derives and stores the session and builds
+ *        the JoinAccept without sending it (used by the join queue).
+ *
+ * @param buffer Raw JoinRequest (legacy 22 bytes or FTYPE_JOIN_REQUEST 23 bytes)
+ * @param len    Length of buffer
+ * @param joinAccept Receives the JoinAccept, JOIN_ACCEPT_LEN bytes
+ * @return JoinAccept length, 0 if the request is invalid
+ */
+size_t processJoinRequest(uint8_t* buffer, size_t len, uint8_t* joinAccept);
 /**
  * @brief Process a received uplink LoRa packet (non-join).
  * 
@@ -72,6 +86,23 @@ void handleJoinRequest(uint8_t* buffer, size_t len);
  */
 void handleLoRaPacket(uint8_t* buffer, size_t length);
 
+/**
+ * @brief Called by handleLoRaPacket() once per decoded record, so an
+ *        aggregated frame (UplinkAggregator.h) arrives as separate records.
+ *        Stream chunks go to the stream reassembly instead.
+ *
+ * @param devEUI Sender DevEUI (8 bytes)
+ * @param dataType Record type
+ * @param value Record value, valid during the call only
+ * @param length Value length
+ */
+typedef void (*RecordCallback)(const uint8_t* devEUI, uint8_t dataType, const uint8_t* value, size_t length);
+
+/**
+ * @brief Registers the per-record callback, nullptr to remove it.
+ */
+void setRecordCallback(RecordCallback callback);
+
 /**
  * @brief Send data acknowledgment back to device.
  * 
@@ -82,7 +113,8 @@ void sendDataAck(const String& srcID, uint8_t* SenderID);
 
 /**
  * @brief Main packet receiver function (poll or ISR-driven).
- *        Handles both JoinRequest and normal packets.
+ *        Captures pending frames into the RX queue and drains it,
+ *        routing JoinRequests (to the join queue) and uplinks by frameTypeOf().
  */
 void Recive();
 
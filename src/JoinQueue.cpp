@@ -0,0 +1,284 @@
+#include "JoinQueue.h"
+#include "Gateway.h"
+#include "Sessions.h"
+#include "CryptoUtils.h"
+#include "TxQueue.h"
+
+#include <Arduino.h>
+
+// ────── Queue and Cache State ──────
+// head and tail are free-running like the TX ring; request n lives in slot
+// n % JOIN_QUEUE_CAPACITY. The cache is a small table scanned linearly, the
+// oldest answer is replaced.
+
+struct PendingJoin {
+  uint8_t data[JOIN_REQUEST_LEN];
+  uint8_t length;
+  uint64_t key;               // DevEUI
+  uint16_t devNonce;
+  uint32_t receivedAt;        // millis() at the RX interrupt, windows start here
+};
+
+struct CachedJoin {
+  uint64_t key;
+  uint16_t devNonce;
+  uint8_t accept[JOIN_ACCEPT_LEN];
+  uint8_t acceptLength;
+  uint32_t answeredAt;
+  bool used;
+};
+
+static PendingJoin joinRing[JOIN_QUEUE_CAPACITY];
+static uint32_t joinHead = 0;
+static uint32_t joinTail = 0;
+static CachedJoin joinCache[JOIN_CACHE_ENTRIES];
+static JoinQueueStats joinStats = {};
+
+// DevEUI position inside a JoinRequest, nullptr if `len` is not one
+static uint8_t* requestBody(uint8_t* buffer, size_t len) {
+  if (len == JOIN_REQUEST_LEN && buffer[0] == FTYPE_JOIN_REQUEST) return buffer + 1;
+  if (len == JOIN_REQUEST_LEGACY_LEN) return buffer;
+  return nullptr;
+}
+
+static CachedJoin* findCached(uint64_t key, uint32_t now) {
+  for (size_t i = 0; i < JOIN_CACHE_ENTRIES; i++) {
+    CachedJoin& entry = joinCache[i];
+    if (entry.used && entry.key == key) {
+      if (now - entry.answeredAt < JOIN_CACHE_TTL_MS) return &entry;
+      entry.used = false;
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+static void cacheAnswer(uint64_t key, uint16_t devNonce, const uint8_t* accept, size_t length, uint32_t now) {
+  CachedJoin* slot = nullptr;
+  for (size_t i = 0; i < JOIN_CACHE_ENTRIES && slot == nullptr; i++) {
+    if (joinCache[i].used && joinCache[i].key == key) slot = &joinCache[i];
+  }
+  for (size_t i = 0; i < JOIN_CACHE_ENTRIES && slot == nullptr; i++) {
+    if (!joinCache[i].used) slot = &joinCache[i];
+  }
+  if (slot == nullptr) {
+    slot = &joinCache[0];
+    for (size_t i = 1; i < JOIN_CACHE_ENTRIES; i++) {
+      if (now - joinCache[i].answeredAt > now - slot->answeredAt) slot = &joinCache[i];
+    }
+  }
+
+  slot->key = key;
+  slot->devNonce = devNonce;
+  memcpy(slot->accept, accept, length);
+  slot->acceptLength = (uint8_t)length;
+  slot->answeredAt = now;
+  slot->used = true;
+}
+
+// ────── Receive Windows ──────
+// Milliseconds since the request's RX interrupt decide whether its device
+// listens now, will listen later (RX2), or has given up.
+
+enum WindowSlot { SLOT_WAIT, SLOT_RX1, SLOT_RX2, SLOT_MISSED };
+
+static WindowSlot windowSlot(uint32_t sinceRx) {
+  // RX1 at 0 ms is open from TX done; a window opening later gets the guard
+  const uint32_t rx1Open = (JOIN_RX1_DELAY_MS == 0) ? 0 : JOIN_RX1_DELAY_MS + JOIN_RX_GUARD_MS;
+  if (sinceRx < rx1Open) return SLOT_WAIT;
+  if (sinceRx <= JOIN_RX1_DELAY_MS + JOIN_RX1_WINDOW_MS) return SLOT_RX1;
+  if (sinceRx < JOIN_RX2_DELAY_MS + JOIN_RX_GUARD_MS) return SLOT_WAIT;
+  if (sinceRx <= JOIN_RX2_DELAY_MS + JOIN_RX2_WINDOW_MS) return SLOT_RX2;
+  return SLOT_MISSED;
+}
+
+uint32_t joinWindowLengthMs(uint32_t windowMs) {
+  return windowMs + lora->getTimeOnAir(JOIN_ACCEPT_LEN) / 1000 + JOIN_RX_GUARD_MS;
+}
+
+// Removes request n, keeping the others in order
+static void removePending(uint32_t n) {
+  for (uint32_t i = n; i + 1 != joinHead; i++) {
+    joinRing[i % JOIN_QUEUE_CAPACITY] = joinRing[(i + 1) % JOIN_QUEUE_CAPACITY];
+  }
+  joinHead--;
+}
+
+// ────── Backoff Hints ──────
+// Expected wait is the backlog times the service time; the hint is drawn
+// uniformly from [wait, 2 * wait] so devices refused together come back apart.
+
+void makeJoinBackoff(uint8_t* out, const uint8_t* devEUI, uint32_t delayMs) {
+  uint32_t units = (delayMs + 99) / 100;
+  if (units > 0xFFFF) units = 0xFFFF;
+
+  out[0] = FTYPE_JOIN_BACKOFF;
+  memcpy(out + 1, devEUI, 8);
+  out[9] = units & 0xFF;
+  out[10] = (units >> 8) & 0xFF;
+
+  uint8_t mic[32];
+  HmacSegment message = { out, JOIN_BACKOFF_LEN - 4 };
+  hmacCompute(sharedHmacContext(), &message, 1, mic);
+  memcpy(out + JOIN_BACKOFF_LEN - 4, mic, 4);
+}
+
+bool readJoinBackoff(uint8_t* frame, size_t len, const uint8_t* devEUI, uint32_t& delayMs) {
+  if (len != JOIN_BACKOFF_LEN || frame[0] != FTYPE_JOIN_BACKOFF) return false;
+  if (memcmp(frame + 1, devEUI, 8) != 0) return false;
+  if (!verifyMIC(frame, len, frame + len - 4)) return false;
+  delayMs = ((uint32_t)frame[9] | ((uint32_t)frame[10] << 8)) * 100;
+  return true;
+}
+
+// A frame queued now starts right away: TX queue idle and the duty-cycle
+// budget covers it. Otherwise it would miss the window it is timed for.
+static bool canAnswerNow(size_t frameLen) {
+  return txQueueDepth() < JOIN_TX_BACKLOG &&
+         dutyCycleWaitMs(frameAirtimeMs(frameLen), AIRTIME_CONTROL) == 0;
+}
+
+static void sendBackoff(const uint8_t* buffer, size_t len, uint32_t sinceRx) {
+  if (len != JOIN_REQUEST_LEN) return;  // legacy devices do not understand hints
+  if (windowSlot(sinceRx) != SLOT_RX1) return;
+  if (!canAnswerNow(JOIN_BACKOFF_LEN)) return;  // JoinAccepts first
+
+  uint32_t wait = (joinQueueDepth() + 1) * JOIN_SERVICE_MS;
+  uint32_t delayMs = wait + esp_random() % (wait + 1);
+  if (delayMs < JOIN_BACKOFF_MIN_MS) delayMs = JOIN_BACKOFF_MIN_MS + esp_random() % JOIN_BACKOFF_MIN_MS;
+  if (delayMs > JOIN_BACKOFF_MAX_MS) delayMs = JOIN_BACKOFF_MAX_MS;
+
+  uint8_t hint[JOIN_BACKOFF_LEN];
+  makeJoinBackoff(hint, buffer + 1, delayMs);
+  if (txQueueSend(hint, sizeof(hint)) != 0) joinStats.backoffsSent++;
+}
+
+// ────── Queue ──────
+
+JoinQueueResult joinQueuePush(uint8_t* buffer, size_t len, uint32_t rxTimestamp) {
+  uint8_t* body = requestBody(buffer, len);
+  if (body == nullptr || !verifyMIC(buffer, len, buffer + len - 4)) {
+    joinStats.badMic++;
+    return JOIN_BAD_MIC;
+  }
+
+  uint32_t now = millis();
+  uint32_t receivedAt = (rxTimestamp == 0) ? now : now - (micros() - rxTimestamp) / 1000;
+  uint64_t key = devEUIToKey(body);
+  uint16_t devNonce = (uint16_t)body[16] | ((uint16_t)body[17] << 8);
+
+  // Repeat of an answered request: same keys again, nothing derived
+  CachedJoin* cached = findCached(key, now);
+  if (cached && cached->devNonce == devNonce) {
+    if (windowSlot(now - receivedAt) == SLOT_RX1 && canAnswerNow(cached->acceptLength)) {
+      txQueueSend(cached->accept, cached->acceptLength);
+    }
+    joinStats.resent++;
+    return JOIN_RESENT;
+  }
+
+  // Already waiting: drop a repeat, let a newer attempt take the place
+  for (uint32_t i = joinTail; i != joinHead; i++) {
+    PendingJoin& pending = joinRing[i % JOIN_QUEUE_CAPACITY];
+    if (pending.key != key) continue;
+    if (pending.devNonce == devNonce) {
+      joinStats.duplicates++;
+      return JOIN_DUPLICATE;
+    }
+    memcpy(pending.data, buffer, len);
+    pending.length = (uint8_t)len;
+    pending.devNonce = devNonce;
+    pending.receivedAt = receivedAt;
+    return JOIN_QUEUED;
+  }
+
+  // A new DevNonce is a rejoin (lost session, reboot) and gets new keys. The
+  // DevNonce that created the current session is an old request replayed
+  // after the cache forgot it. RAM only: no NVS read and no session load here.
+  uint8_t sessionNonce[2];
+  if (!cached && sessionCached(body, sessionNonce) && memcmp(sessionNonce, body + 16, 2) == 0) {
+    joinStats.alreadyJoined++;
+    return JOIN_ALREADY_JOINED;
+  }
+
+  if (joinHead - joinTail >= JOIN_QUEUE_CAPACITY) {
+    joinStats.rejectedFull++;
+    sendBackoff(buffer, len, now - receivedAt);
+    return JOIN_QUEUE_FULL;
+  }
+
+  PendingJoin& slot = joinRing[joinHead % JOIN_QUEUE_CAPACITY];
+  memcpy(slot.data, buffer, len);
+  slot.length = (uint8_t)len;
+  slot.key = key;
+  slot.devNonce = devNonce;
+  slot.receivedAt = receivedAt;
+  joinHead++;
+
+  joinStats.queued++;
+  uint32_t depth = joinHead - joinTail;
+  if (depth > joinStats.highWater) joinStats.highWater = depth;
+  return JOIN_QUEUED;
+}
+
+bool joinQueueLoop() {
+  uint32_t now = millis();
+
+  // Oldest request whose device listens now; RX1 requests are newer, so an
+  // older request waiting for its RX2 does not hold them up
+  uint32_t chosen = 0;
+  WindowSlot chosenSlot = SLOT_WAIT;
+  for (uint32_t i = joinTail; i != joinHead;) {
+    WindowSlot slot = windowSlot(now - joinRing[i % JOIN_QUEUE_CAPACITY].receivedAt);
+    if (slot == SLOT_MISSED) {
+      removePending(i);  // the device stopped listening for this answer
+      joinStats.expired++;
+      continue;
+    }
+    if (chosenSlot == SLOT_WAIT && slot != SLOT_WAIT) {
+      chosen = i;
+      chosenSlot = slot;
+    }
+    i++;
+  }
+
+  if (chosenSlot == SLOT_WAIT || !canAnswerNow(JOIN_ACCEPT_LEN)) return false;
+
+  PendingJoin job = joinRing[chosen % JOIN_QUEUE_CAPACITY];
+  removePending(chosen);
+
+  uint8_t accept[JOIN_ACCEPT_LEN];
+  size_t acceptLength = processJoinRequest(job.data, job.length, accept);
+  if (acceptLength == 0) return false;
+  cacheAnswer(job.key, job.devNonce, accept, acceptLength, now);
+
+  if (txQueueSend(accept, acceptLength) == 0) {
+    Serial.println("[JOIN] TX queue full, JoinAccept dropped.");
+    return false;
+  }
+  joinStats.processed++;
+  if (chosenSlot == SLOT_RX1) joinStats.answeredRx1++;
+  else joinStats.answeredRx2++;
+  Serial.printf("[JOIN] JoinAccept queued for RX%d, %u join(s) waiting\n", chosenSlot == SLOT_RX1 ? 1 : 2,
+                (unsigned)(joinHead - joinTail));
+  return true;
+}
+
+size_t joinQueueDepth() {
+  return joinHead - joinTail;
+}
+
+JoinQueueStats getJoinQueueStats() {
+  return joinStats;
+}
+
+void printJoinQueueStats() {
+  Serial.printf("[JOINQ] depth=%u high=%u queued=%lu processed=%lu rx1=%lu rx2=%lu dup=%lu resent=%lu joined=%lu badMic=%lu full=%lu expired=%lu backoffs=%lu\n",
+                (unsigned)(joinHead - joinTail), (unsigned)joinStats.highWater,
+                (unsigned long)joinStats.queued, (unsigned long)joinStats.processed,
+                (unsigned long)joinStats.answeredRx1, (unsigned long)joinStats.answeredRx2,
+                (unsigned long)joinStats.duplicates, (unsigned long)joinStats.resent,
+                (unsigned long)joinStats.alreadyJoined, (unsigned long)joinStats.badMic,
+                (unsigned long)joinStats.rejectedFull, (unsigned long)joinStats.expired,
+                (unsigned long)joinStats.backoffsSent);
+}
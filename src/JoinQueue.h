@@ -0,0 +1,192 @@
+#ifndef JOIN_QUEUE_H
+#define JOIN_QUEUE_H
+
+#include <Arduino.h>
+#include "PacketView.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Gateway Join Queue
+ *
+ * JoinRequests are not processed in the RX path. Recive() checks the MIC
+ * and pushes them into a bounded FIFO; joinQueueLoop() derives keys, stores
+ * the session and queues the JoinAccept one request at a time, and only
+ * while the TX queue is idle and the duty-cycle budget (DutyCycle.h) covers
+ * a JoinAccept, so every JoinAccept goes out right after it is built.
+ *
+ * The device listens in two receive windows measured from the end of its
+ * JoinRequest (= the gateway's RX timestamp):
+ *
+ *   TX done ──┬── RX1 ──┐        ┌── RX2 ──┐
+ *             0      RX1 end   RX2 delay  RX2 end
+ *
+ * A window lasts JOIN_RX*_WINDOW_MS plus the JoinAccept's time-on-air, and
+ * the gateway starts a JoinAccept only inside one: a request that missed
+ * RX1 waits for RX2, a newer request still in RX1 goes first, and a request
+ * past RX2 is dropped because its device has stopped listening.
+ *
+ * A replay cache remembers the last JOIN_CACHE_ENTRIES answered requests.
+ * A repeated request (same DevEUI and DevNonce) gets the cached JoinAccept
+ * again instead of new keys, so radio-level repeats and replays cannot
+ * reset a session. A new DevNonce from a device answered recently means
+ * the JoinAccept was missed, and that request is processed again. A new
+ * DevNonce from a device with a session is a rejoin and gets new keys; only
+ * the DevNonce that created a session held in RAM is ignored.
+ *
+ * Compact devices whose request is refused (queue full) get a
+ * FTYPE_JOIN_BACKOFF hint with a randomized delay that grows with the
+ * backlog, so a crowd booting together spreads its retries out.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Pending JoinRequests. Build flag override, e.g. -DJOIN_QUEUE_CAPACITY=32.
+#ifndef JOIN_QUEUE_CAPACITY
+#define JOIN_QUEUE_CAPACITY 16
+#endif
+
+// Receive windows after the JoinRequest's TX done, shared by the gateway
+// and sendJoinRequest(). Both sides must be built with the same values.
+#ifndef JOIN_RX1_DELAY_MS
+#define JOIN_RX1_DELAY_MS 0
+#endif
+
+#ifndef JOIN_RX1_WINDOW_MS
+#define JOIN_RX1_WINDOW_MS 1000
+#endif
+
+#ifndef JOIN_RX2_DELAY_MS
+#define JOIN_RX2_DELAY_MS 2000
+#endif
+
+#ifndef JOIN_RX2_WINDOW_MS
+#define JOIN_RX2_WINDOW_MS 1000
+#endif
+
+// The gateway starts a JoinAccept at least this long after a window opens,
+// covering interrupt latency on both sides.
+#ifndef JOIN_RX_GUARD_MS
+#define JOIN_RX_GUARD_MS 20
+#endif
+
+// Joins are processed only while fewer frames than this wait in the TX queue
+// (1 = TX idle, so the JoinAccept starts inside the window it was timed for).
+#ifndef JOIN_TX_BACKLOG
+#define JOIN_TX_BACKLOG 1
+#endif
+
+// Answered requests remembered by the replay cache, and for how long.
+#ifndef JOIN_CACHE_ENTRIES
+#define JOIN_CACHE_ENTRIES 32
+#endif
+
+#ifndef JOIN_CACHE_TTL_MS
+#define JOIN_CACHE_TTL_MS 120000
+#endif
+
+// Backoff hints: expected service time per queued join, and the clamp.
+#ifndef JOIN_SERVICE_MS
+#define JOIN_SERVICE_MS 250
+#endif
+
+#ifndef JOIN_BACKOFF_MIN_MS
+#define JOIN_BACKOFF_MIN_MS 2000
+#endif
+
+#ifndef JOIN_BACKOFF_MAX_MS
+#define JOIN_BACKOFF_MAX_MS 60000
+#endif
+
+/**
+ * @brief What joinQueuePush() did with a request.
+ */
+enum JoinQueueResult {
+    JOIN_QUEUED,            ///< Waiting for joinQueueLoop()
+    JOIN_DUPLICATE,         ///< Same request already waiting, dropped
+    JOIN_RESENT,            ///< Repeat of an answered request, cached JoinAccept queued again
+    JOIN_ALREADY_JOINED,    ///< DevNonce of the device's current session (RAM), replay ignored
+    JOIN_BAD_MIC,           ///< Malformed or MIC mismatch
+    JOIN_QUEUE_FULL         ///< No room; a backoff hint was sent if possible
+};
+
+/**
+ * @brief Join queue counters.
+ */
+struct JoinQueueStats {
+    uint32_t queued;        ///< Requests accepted into the queue
+    uint32_t processed;     ///< JoinAccepts built and queued for TX
+    uint32_t duplicates;    ///< Requests already waiting
+    uint32_t resent;        ///< Cached JoinAccepts sent again
+    uint32_t alreadyJoined; ///< Replays of the request behind a current session ignored
+    uint32_t badMic;        ///< Malformed or MIC mismatch
+    uint32_t rejectedFull;  ///< Requests refused, queue full
+    uint32_t expired;       ///< Requests dropped, both receive windows missed
+    uint32_t answeredRx1;   ///< JoinAccepts started in RX1
+    uint32_t answeredRx2;   ///< JoinAccepts started in RX2
+    uint32_t backoffsSent;  ///< FTYPE_JOIN_BACKOFF hints queued
+    uint16_t highWater;     ///< Maximum observed queue depth
+};
+
+/**
+ * @brief Checks a JoinRequest and queues it (called by Recive()).
+ *
+ * @param buffer Raw JoinRequest (legacy 22 bytes or FTYPE_JOIN_REQUEST 23 bytes)
+ * @param len Length of buffer
+ * @param rxTimestamp micros() at the RX interrupt (RxFrame::timestamp),
+ *        0 = now; the receive windows are timed from it
+ * @return What happened to the request
+ */
+JoinQueueResult joinQueuePush(uint8_t* buffer, size_t len, uint32_t rxTimestamp = 0);
+
+/**
+ * @brief Drops requests past RX2 and processes the oldest one whose device
+ *        is listening now, if the TX queue is idle and the duty cycle
+ *        allows a JoinAccept. Call from loop()
+ *        (Recive() already does).
+ *
+ * @return true if a JoinAccept was queued
+ */
+bool joinQueueLoop();
+
+/**
+ * @brief Requests waiting to be processed.
+ */
+size_t joinQueueDepth();
+
+/**
+ * @brief Length of a receive window including the JoinAccept's time-on-air.
+ *
+ * @param windowMs JOIN_RX1_WINDOW_MS or JOIN_RX2_WINDOW_MS
+ */
+uint32_t joinWindowLengthMs(uint32_t windowMs);
+
+/**
+ * @brief Builds a FTYPE_JOIN_BACKOFF frame.
+ *
+ * @param out Destination, JOIN_BACKOFF_LEN bytes
+ * @param devEUI Device the hint is for
+ * @param delayMs Delay before the device's next JoinRequest
+ */
+void makeJoinBackoff(uint8_t* out, const uint8_t* devEUI, uint32_t delayMs);
+
+/**
+ * @brief Reads a FTYPE_JOIN_BACKOFF frame addressed to `devEUI`.
+ *
+ * @param frame Received frame
+ * @param len Frame length
+ * @param devEUI Own DevEUI
+ * @param delayMs Receives the requested delay
+ * @return true if the frame is a valid hint for this device
+ */
+bool readJoinBackoff(uint8_t* frame, size_t len, const uint8_t* devEUI, uint32_t& delayMs);
+
+/**
+ * @brief Returns the join queue counters.
+ */
+JoinQueueStats getJoinQueueStats();
+
+/**
+ * @brief Prints the join queue counters to Serial.
+ */
+void printJoinQueueStats();
+
+#endif // JOIN_QUEUE_H
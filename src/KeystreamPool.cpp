@@ -0,0 +1,185 @@
+#include "KeystreamPool.h"
+#include "CryptoUtils.h"
+#include "PacketView.h"
+
+#include <Arduino.h>
+#include "mbedtls/aes.h"
+
+static KeystreamPoolStats poolStats = {};
+
+#if KEYSTREAM_POOL_ENTRIES > 0
+
+// ────── Pool State ──────
+// Ready entries form a ring: take at tail, refill at head. The pool keeps its
+// own copy of the key schedule so session-table eviction cannot pull it away.
+//
+// Entries follow frameFormat(): legacy entries carry a random nonce, compact
+// entries the nonce of consecutive frame counters starting at the session's
+// next one. A format change wipes the ring on the next refill.
+
+struct KeystreamEntry {
+  uint8_t nonce[16];
+  uint32_t fcnt;              // compact entries only
+  uint8_t keystream[KEYSTREAM_ENTRY_LEN];
+};
+
+static KeystreamEntry poolEntries[KEYSTREAM_POOL_ENTRIES];
+static size_t poolHead = 0;
+static size_t poolTail = 0;
+static size_t poolCount = 0;
+
+static bool poolBound = false;
+static uint8_t poolKey[16];
+static uint8_t poolSender[8];
+static mbedtls_aes_context poolCtx;
+
+static bool poolCompact = false;
+static uint8_t poolDirection = FRAME_DIR_UP;
+static uint32_t poolDevAddr = 0;
+static uint32_t poolNextFcnt = 0;    // counter of the next compact entry
+
+static void wipeEntries() {
+  memset(poolEntries, 0, sizeof(poolEntries));
+  poolHead = poolTail = poolCount = 0;
+}
+
+void keystreamPoolBind(const SessionInfo& session, const uint8_t* sender) {
+  keystreamPoolUnbind();
+
+  memcpy(poolKey, session.appSKey, 16);
+  memcpy(poolSender, sender, 8);
+  mbedtls_aes_init(&poolCtx);
+  mbedtls_aes_setkey_enc(&poolCtx, poolKey, 128);
+  poolBound = true;
+
+  poolCompact = frameFormat() == FRAME_FORMAT_COMPACT;
+  poolDirection = (memcmp(session.devEUI, devEUI, 8) == 0) ? FRAME_DIR_UP : FRAME_DIR_DOWN;
+  poolDevAddr = session.devAddr;
+  poolNextFcnt = (poolDirection == FRAME_DIR_UP) ? session.fcntUp : session.fcntDown;
+
+  size_t filled = keystreamPoolFill();
+  Serial.printf("[KSP] Bound, %u x %u bytes of keystream ready\n",
+                (unsigned)filled, (unsigned)KEYSTREAM_ENTRY_LEN);
+}
+
+void keystreamPoolUnbind() {
+  if (!poolBound) return;
+  mbedtls_aes_free(&poolCtx);
+  memset(poolKey, 0, sizeof(poolKey));
+  wipeEntries();
+  poolBound = false;
+}
+
+bool keystreamPoolBound() {
+  return poolBound;
+}
+
+// ────── Refill ──────
+
+bool keystreamPoolLoop() {
+  if (!poolBound) return false;
+  bool compact = frameFormat() == FRAME_FORMAT_COMPACT;
+  if (compact != poolCompact) {
+    wipeEntries();
+    poolCompact = compact;
+  }
+  if (poolCount == KEYSTREAM_POOL_ENTRIES) return false;
+
+  KeystreamEntry& entry = poolEntries[poolHead];
+  if (poolCompact) {
+    entry.fcnt = poolNextFcnt++;
+    makeFrameNonce(entry.nonce, poolDirection, poolDevAddr, entry.fcnt);
+  } else {
+    makePacketNonce(entry.nonce, poolSender);
+  }
+
+  // CTR over zeros yields the keystream itself
+  uint8_t nonceCounter[16];
+  uint8_t streamBlock[16];
+  size_t ncOff = 0;
+  memcpy(nonceCounter, entry.nonce, 16);
+  memset(entry.keystream, 0, KEYSTREAM_ENTRY_LEN);
+  mbedtls_aes_crypt_ctr(&poolCtx, KEYSTREAM_ENTRY_LEN, &ncOff, nonceCounter, streamBlock,
+                        entry.keystream, entry.keystream);
+
+  poolHead = (poolHead + 1) % KEYSTREAM_POOL_ENTRIES;
+  poolCount++;
+  poolStats.refills++;
+  return true;
+}
+
+size_t keystreamPoolFill() {
+  size_t filled = 0;
+  while (keystreamPoolLoop()) filled++;
+  return filled;
+}
+
+// ────── Use ──────
+
+static void dropTail() {
+  memset(&poolEntries[poolTail], 0, sizeof(KeystreamEntry));  // single use
+  poolTail = (poolTail + 1) % KEYSTREAM_POOL_ENTRIES;
+  poolCount--;
+}
+
+static size_t takeTail(uint8_t* keystream, size_t payloadLen) {
+  memcpy(keystream, poolEntries[poolTail].keystream, KEYSTREAM_ENTRY_LEN);
+  dropTail();
+  poolStats.hits++;
+  if (payloadLen > KEYSTREAM_ENTRY_LEN) poolStats.overflow++;
+  return KEYSTREAM_ENTRY_LEN;
+}
+
+size_t keystreamPoolTake(const SessionInfo& session, const uint8_t* sender,
+                         uint8_t* nonce, uint8_t* keystream, size_t payloadLen) {
+  if (!poolBound || poolCompact || memcmp(sender, poolSender, 8) != 0 ||
+      memcmp(session.appSKey, poolKey, 16) != 0) {
+    return 0;  // not the pooled session
+  }
+  if (poolCount == 0) {
+    poolStats.misses++;
+    return 0;
+  }
+
+  memcpy(nonce, poolEntries[poolTail].nonce, 16);
+  return takeTail(keystream, payloadLen);
+}
+
+size_t keystreamPoolTakeCounter(const SessionInfo& session, uint32_t fcnt,
+                                uint8_t* keystream, size_t payloadLen) {
+  if (!poolBound || !poolCompact || session.devAddr != poolDevAddr ||
+      memcmp(session.appSKey, poolKey, 16) != 0) {
+    return 0;  // not the pooled session
+  }
+
+  // Entries behind the counter can never be used (e.g. a checkpoint skip)
+  while (poolCount > 0 && poolEntries[poolTail].fcnt < fcnt) dropTail();
+
+  if (poolCount == 0 || poolEntries[poolTail].fcnt != fcnt) {
+    poolStats.misses++;
+    if (poolCount == 0 && poolNextFcnt <= fcnt) poolNextFcnt = fcnt + 1;  // restart after this frame
+    return 0;
+  }
+  return takeTail(keystream, payloadLen);
+}
+
+size_t keystreamPoolAvailable() {
+  return poolCount;
+}
+
+#else  // KEYSTREAM_POOL_ENTRIES == 0: pool compiled out
+
+void keystreamPoolBind(const SessionInfo&, const uint8_t*) {}
+void keystreamPoolUnbind() {}
+bool keystreamPoolBound() { return false; }
+bool keystreamPoolLoop() { return false; }
+size_t keystreamPoolFill() { return 0; }
+size_t keystreamPoolTake(const SessionInfo&, const uint8_t*, uint8_t*, uint8_t*, size_t) { return 0; }
+size_t keystreamPoolTakeCounter(const SessionInfo&, uint32_t, uint8_t*, size_t) { return 0; }
+size_t keystreamPoolAvailable() { return 0; }
+
+#endif
+
+KeystreamPoolStats getKeystreamPoolStats() {
+  return poolStats;
+}
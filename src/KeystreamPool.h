@@ -0,0 +1,132 @@
+#ifndef KEYSTREAM_POOL_H
+#define KEYSTREAM_POOL_H
+
+#include <Arduino.h>
+#include "Sessions.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * CTR Keystream Pool
+ *
+ * AES-CTR keystream depends only on the key and the nonce, never on the
+ * data. While the device is idle the pool picks the nonces of the next
+ * packets and encrypts their counter blocks ahead of time. encryptAndPackage()
+ * then takes one entry and the payload encryption is a plain XOR, leaving
+ * only the HMAC on the send path.
+ *
+ * Every entry is used for exactly one packet and wiped afterwards, so a
+ * nonce is never reused. Payloads longer than KEYSTREAM_ENTRY_LEN use the
+ * pooled prefix and compute the remaining blocks on the fly.
+ *
+ * The pool serves one session (usually the device's own); packets for any
+ * other session or sender are encrypted the normal way.
+ *
+ * With compact frames (PacketView.h) the nonce is fixed by the frame counter,
+ * so the pool computes the keystream of the next counters instead of
+ * picking random nonces, and an entry is only used for its own counter.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// RAM budget for precomputed keystream; 0 compiles the pool out.
+// Build flag override, e.g. -DKEYSTREAM_POOL_BYTES=1024.
+#ifndef KEYSTREAM_POOL_BYTES
+#define KEYSTREAM_POOL_BYTES 512
+#endif
+
+// Keystream bytes per entry (multiple of 16). Cover the usual frame:
+// TLV header + payload.
+#ifndef KEYSTREAM_ENTRY_LEN
+#define KEYSTREAM_ENTRY_LEN 64
+#endif
+
+#define KEYSTREAM_POOL_ENTRIES (KEYSTREAM_POOL_BYTES / KEYSTREAM_ENTRY_LEN)
+
+#if KEYSTREAM_ENTRY_LEN % 16 != 0
+#error "KEYSTREAM_ENTRY_LEN must be a multiple of the AES block size"
+#endif
+
+/**
+ * @brief Pool counters.
+ */
+struct KeystreamPoolStats {
+    uint32_t hits;          ///< Packets encrypted from a pooled entry
+    uint32_t misses;        ///< Packets for the bound session that found the pool empty
+    uint32_t refills;       ///< Entries computed
+    uint32_t overflow;      ///< Packets longer than KEYSTREAM_ENTRY_LEN (tail computed on the fly)
+};
+
+/**
+ * @brief Binds the pool to a session and fills it.
+ *
+ * Call after joining (handleJoinAccept() rebinds an already bound pool on a
+ * rejoin). Rebinding wipes all entries of the previous session.
+ *
+ * @param session Session whose appSKey is used
+ * @param sender 8-byte sender ID that leads a legacy nonce (devEUI)
+ */
+void keystreamPoolBind(const SessionInfo& session, const uint8_t* sender);
+
+/**
+ * @brief Wipes all entries and the key; encryption goes back to normal.
+ */
+void keystreamPoolUnbind();
+
+/**
+ * @brief true if the pool is bound to a session.
+ */
+bool keystreamPoolBound();
+
+/**
+ * @brief Computes one missing entry. Call from loop() while idle
+ *        (listenForIncoming() and Recive() already do).
+ *
+ * @return true if an entry was computed
+ */
+bool keystreamPoolLoop();
+
+/**
+ * @brief Computes all missing entries.
+ *
+ * @return Number of entries computed
+ */
+size_t keystreamPoolFill();
+
+/**
+ * @brief Takes the next entry for a packet (used by encryptAndPackage()).
+ *
+ * @param session Session the packet is encrypted for
+ * @param sender 8-byte sender ID of the packet
+ * @param nonce Receives the entry's 16-byte nonce
+ * @param keystream Receives KEYSTREAM_ENTRY_LEN keystream bytes
+ * @param payloadLen Payload length, for the overflow counter
+ * @return Keystream bytes provided, 0 if no entry matches
+ */
+size_t keystreamPoolTake(const SessionInfo& session, const uint8_t* sender,
+                         uint8_t* nonce, uint8_t* keystream, size_t payloadLen);
+
+/**
+ * @brief Takes the entry for a compact frame's counter (used by encryptAndPackage()).
+ *
+ * Entries for lower counters are discarded; if none matches the pool restarts
+ * after `fcnt` and the frame is encrypted the normal way.
+ *
+ * @param session Session the frame is encrypted for
+ * @param fcnt Frame counter taken for the frame
+ * @param keystream Receives KEYSTREAM_ENTRY_LEN keystream bytes
+ * @param payloadLen Payload length, for the overflow counter
+ * @return Keystream bytes provided, 0 if no entry matches
+ */
+size_t keystreamPoolTakeCounter(const SessionInfo& session, uint32_t fcnt,
+                                uint8_t* keystream, size_t payloadLen);
+
+/**
+ * @brief Entries ready for use.
+ */
+size_t keystreamPoolAvailable();
+
+/**
+ * @brief Returns the pool counters.
+ */
+KeystreamPoolStats getKeystreamPoolStats();
+
+#endif // KEYSTREAM_POOL_H
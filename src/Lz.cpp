@@ -0,0 +1,122 @@
+#include "Lz.h"
+
+#include <string.h>
+
+// ────── Hash Chains ──────
+// head[h] is the newest position + 1 whose next three bytes hash to h (0 =
+// none); chain[pos % LZ_WINDOW] links to the previous position + 1 with the
+// same hash. Positions older than the window are never followed.
+
+static inline uint16_t hash3(const uint8_t* p) {
+  uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+  return (uint16_t)((uint32_t)(v * 2654435761u) >> (32 - LZ_HASH_BITS));
+}
+
+static inline void insertPosition(uint16_t* head, uint16_t* chain, const uint8_t* in, size_t pos) {
+  uint16_t h = hash3(in + pos);
+  chain[pos & (LZ_WINDOW - 1)] = head[h];
+  head[h] = (uint16_t)(pos + 1);
+}
+
+size_t lzCompressBound(size_t length) {
+  return LZ_HEADER_LEN + length + (length + 7) / 8;
+}
+
+// ────── Encoder ──────
+// Greedy: at every position take the longest match found within LZ_MAX_CHAIN
+// candidates, otherwise emit a literal.
+
+size_t lzCompress(const uint8_t* in, size_t length, uint8_t* out, size_t capacity, uint16_t* work) {
+  if (length == 0 || length > LZ_MAX_LEN || capacity < LZ_HEADER_LEN + 2) return 0;
+
+  uint16_t* head = work;
+  uint16_t* chain = work + (1 << LZ_HASH_BITS);
+  memset(head, 0, sizeof(uint16_t) << LZ_HASH_BITS);
+
+  out[0] = length & 0xFF;
+  out[1] = (length >> 8) & 0xFF;
+  size_t outPos = LZ_HEADER_LEN;
+  size_t flagPos = 0;
+  uint8_t flagBit = 8;        // 8 = start a new group
+  size_t pos = 0;
+
+  while (pos < length) {
+    if (flagBit == 8) {
+      if (outPos >= capacity) return 0;
+      flagPos = outPos;
+      out[outPos++] = 0;
+      flagBit = 0;
+    }
+
+    size_t bestLen = 0, bestOffset = 0;
+    if (pos + LZ_MIN_MATCH <= length) {
+      size_t maxLen = length - pos < LZ_MAX_MATCH ? length - pos : LZ_MAX_MATCH;
+      uint16_t candidate = head[hash3(in + pos)];
+      for (int depth = 0; candidate && depth < LZ_MAX_CHAIN; depth++) {
+        size_t cand = candidate - 1;
+        if (pos - cand > LZ_WINDOW) break;
+        size_t len = 0;
+        while (len < maxLen && in[cand + len] == in[pos + len]) len++;
+        if (len > bestLen) {
+          bestLen = len;
+          bestOffset = pos - cand;
+          if (len == maxLen) break;
+        }
+        candidate = chain[cand & (LZ_WINDOW - 1)];
+      }
+    }
+
+    if (bestLen >= LZ_MIN_MATCH) {
+      if (outPos + 2 > capacity) return 0;
+      uint16_t token = (uint16_t)(((bestOffset - 1) << (16 - LZ_WINDOW_BITS)) | (bestLen - LZ_MIN_MATCH));
+      out[outPos++] = token >> 8;
+      out[outPos++] = token & 0xFF;
+      out[flagPos] |= 1 << flagBit;
+      for (size_t i = 0; i < bestLen; i++, pos++) {
+        if (pos + LZ_MIN_MATCH <= length) insertPosition(head, chain, in, pos);
+      }
+    } else {
+      if (outPos >= capacity) return 0;
+      out[outPos++] = in[pos];
+      if (pos + LZ_MIN_MATCH <= length) insertPosition(head, chain, in, pos);
+      pos++;
+    }
+    flagBit++;
+  }
+  return outPos;
+}
+
+// ────── Decoder ──────
+
+size_t lzDecompressedLength(const uint8_t* in, size_t length) {
+  if (length < LZ_HEADER_LEN) return 0;
+  return (size_t)in[0] | ((size_t)in[1] << 8);
+}
+
+size_t lzDecompress(const uint8_t* in, size_t length, uint8_t* out, size_t capacity) {
+  size_t total = lzDecompressedLength(in, length);
+  if (total == 0 || total > capacity) return 0;
+
+  size_t inPos = LZ_HEADER_LEN;
+  size_t outPos = 0;
+  while (outPos < total) {
+    if (inPos >= length) return 0;
+    uint8_t flags = in[inPos++];
+    for (uint8_t bit = 0; bit < 8 && outPos < total; bit++) {
+      if (flags & (1 << bit)) {
+        if (inPos + 2 > length) return 0;
+        uint16_t token = (uint16_t)((in[inPos] << 8) | in[inPos + 1]);
+        inPos += 2;
+        size_t offset = (token >> (16 - LZ_WINDOW_BITS)) + 1;
+        size_t len = (token & ((1 << (16 - LZ_WINDOW_BITS)) - 1)) + LZ_MIN_MATCH;
+        if (offset > outPos || outPos + len > total) return 0;
+        // Byte by byte: the source may overlap the bytes being written
+        for (size_t i = 0; i < len; i++, outPos++) out[outPos] = out[outPos - offset];
+      } else {
+        if (inPos >= length) return 0;
+        out[outPos++] = in[inPos++];
+      }
+    }
+  }
+  return (inPos == length) ? total : 0;
+}
@@ -0,0 +1,85 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * LZSS Compression (group files before streaming)
+ *
+ * Group files repeat the same record headers and similar values, so an
+ * LZ77-family codec with a small window removes most of them. Output:
+ *
+ *   [original length 2, little-endian] then groups of
+ *   [flags 1][up to 8 items]
+ *
+ * Flag bit i (LSB first) describes item i of the group:
+ *   0  literal   [byte]
+ *   1  match     [offset - 1 : 11 bits][length - LZ_MIN_MATCH : 5 bits], big-endian
+ *
+ * A match copies `length` bytes from `offset` bytes back in the output, so
+ * the window is LZ_WINDOW (2048) bytes and a match is 3..34 bytes long.
+ * Decoding needs no RAM besides the output buffer; encoding needs
+ * LZ_WORK_ENTRIES 16-bit words of hash chains, supplied by the caller.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Fixed by the format; sender and gateway must agree.
+#define LZ_WINDOW_BITS 11
+#define LZ_WINDOW (1 << LZ_WINDOW_BITS)
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + (1 << (16 - LZ_WINDOW_BITS)) - 1)
+#define LZ_HEADER_LEN 2
+#define LZ_MAX_LEN 0xFFFF
+
+// Encoder only. More hash bits or a longer chain find more matches for more
+// RAM / CPU, e.g. -DLZ_MAX_CHAIN=64.
+#ifndef LZ_HASH_BITS
+#define LZ_HASH_BITS 10
+#endif
+
+#ifndef LZ_MAX_CHAIN
+#define LZ_MAX_CHAIN 16
+#endif
+
+#define LZ_WORK_ENTRIES ((1 << LZ_HASH_BITS) + LZ_WINDOW)   // uint16_t words, 6 KB by default
+
+/**
+ * @brief Worst-case compressed length (incompressible input).
+ */
+size_t lzCompressBound(size_t length);
+
+/**
+ * @brief Compresses a buffer.
+ *
+ * Stops as soon as the output would exceed capacity, so passing the largest
+ * size that still pays off also bounds the time spent on data that does not
+ * compress.
+ *
+ * @param in Data to compress
+ * @param length Data length (at most LZ_MAX_LEN)
+ * @param out Destination
+ * @param capacity Size of out
+ * @param work LZ_WORK_ENTRIES words of scratch memory
+ * @return Compressed length; 0 if it exceeds capacity or length is out of range
+ */
+size_t lzCompress(const uint8_t* in, size_t length, uint8_t* out, size_t capacity, uint16_t* work);
+
+/**
+ * @brief Original length stored in a compressed buffer (0 if too short).
+ */
+size_t lzDecompressedLength(const uint8_t* in, size_t length);
+
+/**
+ * @brief Decompresses a buffer.
+ *
+ * @param in Compressed data
+ * @param length Compressed length
+ * @param out Destination
+ * @param capacity Size of out
+ * @return Original length; 0 if the data is malformed or does not fit
+ */
+size_t lzDecompress(const uint8_t* in, size_t length, uint8_t* out, size_t capacity);
+
+#endif // LZ_H
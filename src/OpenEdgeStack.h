@@ -5,5 +5,21 @@
 #include "Gateway.h"
 #include "Sessions.h"
 #include "EndDevice.h"
+#include "PacketView.h"
+#include "RxQueue.h"
+#include "RxFilter.h"
+#include "TxQueue.h"
+#include "JoinQueue.h"
+#include "SessionStore.h"
+#include "Tlv.h"
+#include "StreamReassembly.h"
+#include "Fec.h"
+#include "Lz.h"
+#include "KeystreamPool.h"
+#include "Airtime.h"
+#include "DutyCycle.h"
+#include "UplinkAggregator.h"
+#include "Telemetry.h"
+#include "FloatSeries.h"
 
 #endif
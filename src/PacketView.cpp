@@ -0,0 +1,183 @@
+#include "PacketView.h"
+#include "CryptoUtils.h"
+#include "Sessions.h"
+
+#include <Arduino.h>
+
+static FrameFormat txFrameFormat = FRAME_FORMAT_DEFAULT;
+
+void setFrameFormat(FrameFormat format) {
+  txFrameFormat = format;
+}
+
+FrameFormat frameFormat() {
+  return txFrameFormat;
+}
+
+static uint32_t readLE(const uint8_t* in, size_t len) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < len; i++) value |= (uint32_t)in[i] << (8 * i);
+  return value;
+}
+
+// ────── Frame Classification ──────
+
+// The type byte alone is not proof: a legacy frame starts with an arbitrary
+// DevEUI byte. Join frames are told apart by length (23/17 vs 22/16, legacy
+// data is always longer than PACKET_OVERHEAD), data frames by a devAddr that
+// belongs to a session, which is a RAM lookup.
+
+uint8_t frameTypeOf(const uint8_t* buffer, size_t length) {
+  if (buffer == nullptr || length == 0 || length > PACKET_MAX_LEN) return FTYPE_INVALID;
+
+  uint8_t type = buffer[0] & FTYPE_MASK;
+  uint8_t low = buffer[0] & ~FTYPE_MASK;
+
+  if (type == FTYPE_JOIN_REQUEST && low == 0 && length == JOIN_REQUEST_LEN) return FTYPE_JOIN_REQUEST;
+  if (type == FTYPE_JOIN_ACCEPT && low == 0 && length == JOIN_ACCEPT_LEN) return FTYPE_JOIN_ACCEPT;
+  if (type == FTYPE_JOIN_BACKOFF && low == 0 && length == JOIN_BACKOFF_LEN) return FTYPE_JOIN_BACKOFF;
+
+  if ((type == FTYPE_DATA_UP || type == FTYPE_DATA_DOWN) &&
+      (low & ~FTYPE_FCNT_MASK) == 0 && (low & FTYPE_FCNT_MASK) != 0) {
+    size_t headerLen = 1 + FRAME_ADDR_LEN + (low & FTYPE_FCNT_MASK) + 1;
+    if (length > headerLen + PACKET_HMAC_LEN &&
+        (!FRAME_LEGACY_RX || sessionAddrKnown(readLE(buffer + 1, FRAME_ADDR_LEN)))) {
+      return type;
+    }
+  }
+
+#if FRAME_LEGACY_RX
+  if (length == JOIN_REQUEST_LEGACY_LEN) return FTYPE_JOIN_REQUEST;
+  if (length == JOIN_ACCEPT_LEGACY_LEN) return FTYPE_JOIN_ACCEPT;
+  if (length > PACKET_OVERHEAD) return FTYPE_LEGACY_DATA;
+#endif
+  return FTYPE_INVALID;
+}
+
+// ────── Packet Parsing ──────
+
+// Fills a PacketView with pointers into the RX buffer.
+// Rejects anything that cannot hold a header, >= 1 byte payload and the HMAC
+// or that exceeds the radio's maximum frame size.
+
+bool parsePacket(uint8_t* buffer, size_t length, PacketView& view) {
+  uint8_t type = frameTypeOf(buffer, length);
+  if (type != FTYPE_DATA_UP && type != FTYPE_DATA_DOWN && type != FTYPE_LEGACY_DATA) {
+    return false;
+  }
+
+  view.raw = buffer;
+  view.length = length;
+  view.frameType = type;
+  view.hmac = buffer + length - PACKET_HMAC_LEN;
+
+  if (type == FTYPE_LEGACY_DATA) {
+    view.srcID = buffer;
+    view.nonce = buffer + PACKET_SRC_ID_LEN;
+    view.devAddr = 0;
+    view.fcnt = 0;
+    view.fcntLen = 0;
+    view.payload = buffer + PACKET_HEADER_LEN;
+    view.payloadLength = length - PACKET_OVERHEAD;
+    return true;
+  }
+
+  view.fcntLen = (buffer[0] & FTYPE_FCNT_MASK) + 1;
+  size_t headerLen = 1 + FRAME_ADDR_LEN + view.fcntLen;
+  view.srcID = nullptr;
+  view.nonce = nullptr;
+  view.devAddr = readLE(buffer + 1, FRAME_ADDR_LEN);
+  view.fcnt = readLE(buffer + 1 + FRAME_ADDR_LEN, view.fcntLen);  // low bytes until resolved
+  view.payload = buffer + headerLen;
+  view.payloadLength = length - headerLen - PACKET_HMAC_LEN;
+  return true;
+}
+
+// ────── Frame Counters ──────
+
+uint32_t expandFrameCounter(uint32_t low, uint8_t lenBytes, uint32_t next) {
+  if (lenBytes >= 4) return low;
+
+  uint32_t span = 1UL << (8 * lenBytes);
+  uint32_t candidate = (next & ~(span - 1)) | low;
+
+  // Move into [next - span/2, next + span/2), without wrapping below 0
+  if (candidate > next && candidate - next >= span / 2 && candidate >= span) {
+    candidate -= span;
+  } else if (candidate < next && next - candidate > span / 2) {
+    candidate += span;
+  }
+  return candidate;
+}
+
+static uint8_t directionOf(const PacketView& view) {
+  return (view.frameType == FTYPE_DATA_DOWN) ? FRAME_DIR_DOWN : FRAME_DIR_UP;
+}
+
+SessionStatus findPacketSession(PacketView& view, SessionInfo*& session) {
+  if (view.frameType == FTYPE_LEGACY_DATA) {
+    return findSession(view.srcID, session);
+  }
+
+  SessionStatus status = findSessionByAddr(view.devAddr, session);
+  if (status != SESSION_OK) return status;
+
+  view.srcID = session->devEUI;
+  uint32_t next = (directionOf(view) == FRAME_DIR_UP) ? session->fcntUp : session->fcntDown;
+  view.fcnt = expandFrameCounter(view.fcnt, view.fcntLen, next);
+  return SESSION_OK;
+}
+
+// ────── Authentication ──────
+
+// Legacy frames: HMAC over the frame. Compact frames: HMAC over the frame
+// followed by the restored 32-bit counter, so a wrongly restored counter
+// (and thus nonce) fails here instead of decrypting to garbage.
+//
+// The replay window is checked first: a retransmitted or replayed frame is
+// dropped with a bit test, before any SHA-256 work. Only an authenticated
+// frame moves the window, so a forged counter cannot block real ones.
+
+SessionStatus authenticatePacket(PacketView& view, const SessionInfo& session) {
+  if (view.frameType == FTYPE_LEGACY_DATA) {
+    return verifyHmac(view.raw, view.length, view.hmac);
+  }
+
+  SessionStatus status = sessionCounterCheck(session, directionOf(view), view.fcnt);
+  if (status != SESSION_OK) return status;
+
+  uint8_t fcnt[4] = {
+    (uint8_t)view.fcnt, (uint8_t)(view.fcnt >> 8), (uint8_t)(view.fcnt >> 16), (uint8_t)(view.fcnt >> 24)
+  };
+  HmacSegment message[2] = {
+    { view.raw, view.length - PACKET_HMAC_LEN },
+    { fcnt, sizeof(fcnt) }
+  };
+  uint8_t computed[32];
+  hmacCompute(sharedHmacContext(), message, 2, computed);
+
+  uint8_t diff = 0;
+  for (int i = 0; i < PACKET_HMAC_LEN; i++) diff |= computed[i] ^ view.hmac[i];
+  if (diff != 0) return SESSION_INVALID_HMAC;
+
+  sessionCounterReceived(session, directionOf(view), view.fcnt);
+  return SESSION_OK;
+}
+
+// ────── In-place Decryption ──────
+
+// AES-CTR is a stream cipher, so the keystream can be XORed straight over the
+// ciphertext. The CTR helper copies the nonce internally, so the nonce bytes
+// in the buffer are left intact. The session's cached key schedule is used.
+
+void decryptInPlace(PacketView& view, const SessionInfo& session) {
+  SessionCrypto& crypto = sessionCryptoFor(session);
+  if (view.nonce) {
+    aes128_encrypt_ctr_ctx(&crypto.appSKeyCtx, view.nonce, view.payload, view.payloadLength, view.payload);
+    return;
+  }
+
+  uint8_t nonce[PACKET_NONCE_LEN];
+  makeFrameNonce(nonce, directionOf(view), view.devAddr, view.fcnt);
+  aes128_encrypt_ctr_ctx(&crypto.appSKeyCtx, nonce, view.payload, view.payloadLength, view.payload);
+}
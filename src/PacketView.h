@@ -0,0 +1,192 @@
+#ifndef PACKET_VIEW_H
+#define PACKET_VIEW_H
+
+#include <Arduino.h>
+#include "Sessions.h"
+
+// ────── Encrypted Packet Layout (legacy) ──────
+// Offset | Size         | Field            | Description
+// -------|--------------|------------------|------------------------------
+// 0      | 8            | Sender ID        | Sender devEUI (used for session lookup)
+// 8      | 16           | Nonce            | CTR IV
+// 24     | N            | Encrypted Payload| AES-128-CTR encrypted data
+// 24+N   | 8            | HMAC             | First 8 bytes of HMAC-SHA256
+
+#define PACKET_SRC_ID_LEN   8
+#define PACKET_NONCE_LEN    16
+#define PACKET_HMAC_LEN     8
+#define PACKET_HEADER_LEN   (PACKET_SRC_ID_LEN + PACKET_NONCE_LEN)
+#define PACKET_OVERHEAD     (PACKET_HEADER_LEN + PACKET_HMAC_LEN)
+#define PACKET_MAX_LEN      255
+
+// ────── Compact Frame Layout ──────
+// Offset | Size         | Field            | Description
+// -------|--------------|------------------|------------------------------
+// 0      | 1            | FType            | Frame type (high nibble), FCnt bytes - 1 (low 2 bits)
+// 1      | 4            | DevAddr          | Assigned at join, little-endian (used for session lookup)
+// 5      | 2-4          | FCnt             | Low bytes of the 32-bit frame counter, little-endian
+// 7-9    | N            | Encrypted Payload| AES-128-CTR, nonce rebuilt from devAddr + FCnt
+// 7-9+N  | 8            | HMAC             | First 8 bytes of HMAC-SHA256 over [FType..payload][FCnt 32-bit]
+//
+// 15 bytes of overhead instead of 32. The receiver restores the full counter
+// from the session (nearest value to the next expected one), so the HMAC
+// covers the full 32-bit counter even though only its low bytes go on air.
+
+// FCnt bytes sent on air (2-4). Receivers read it from the FType byte, so
+// nodes with different settings interoperate. Build flag override, e.g. -DFRAME_FCNT_LEN=4.
+#ifndef FRAME_FCNT_LEN
+#define FRAME_FCNT_LEN 2
+#endif
+
+#if FRAME_FCNT_LEN < 2 || FRAME_FCNT_LEN > 4
+#error "FRAME_FCNT_LEN must be 2, 3 or 4"
+#endif
+
+#define FRAME_ADDR_LEN      4
+#define FRAME_HEADER_LEN    (1 + FRAME_ADDR_LEN + FRAME_FCNT_LEN)
+#define FRAME_OVERHEAD      (FRAME_HEADER_LEN + PACKET_HMAC_LEN)
+
+// Frame types (high nibble of the first byte)
+#define FTYPE_JOIN_REQUEST  0x10    // [FType][DevEUI 8][AppEUI 8][DevNonce 2][MIC 4]
+#define FTYPE_JOIN_ACCEPT   0x20    // [FType][encrypted JoinAccept 16]
+#define FTYPE_JOIN_BACKOFF  0x30    // [FType][DevEUI 8][delay 2, 100 ms units][MIC 4]
+#define FTYPE_DATA_UP       0x40    // Device → gateway, compact layout above
+#define FTYPE_DATA_DOWN     0x60    // Gateway → device, compact layout above
+#define FTYPE_MASK          0xF0
+#define FTYPE_FCNT_MASK     0x03
+
+// Results of frameTypeOf() that never appear on air
+#define FTYPE_INVALID       0x00    // Not a frame this stack understands
+#define FTYPE_LEGACY_DATA   0x01    // [Sender ID][Nonce] layout
+
+#define JOIN_REQUEST_LEN          23
+#define JOIN_REQUEST_LEGACY_LEN   22
+#define JOIN_ACCEPT_LEN           17
+#define JOIN_ACCEPT_LEGACY_LEN    16
+#define JOIN_BACKOFF_LEN          15
+
+/**
+ * @brief Header layout used for frames this node sends.
+ */
+enum FrameFormat : uint8_t {
+    FRAME_FORMAT_LEGACY,    ///< [Sender ID 8][Nonce 16], joins without a type byte
+    FRAME_FORMAT_COMPACT    ///< [FType][DevAddr][FCnt], typed joins
+};
+
+// Format used until setFrameFormat() is called.
+#ifndef FRAME_FORMAT_DEFAULT
+#define FRAME_FORMAT_DEFAULT FRAME_FORMAT_COMPACT
+#endif
+
+// Accept legacy frames next to compact ones (gateways with older devices).
+// Set to 0 to drop anything without a valid frame type.
+#ifndef FRAME_LEGACY_RX
+#define FRAME_LEGACY_RX 1
+#endif
+
+/**
+ * @brief Non-owning view over a raw encrypted packet in the RX buffer.
+ *
+ * All pointers refer into the buffer passed to parsePacket() (or into the
+ * session table), nothing is copied. The buffer must outlive the view.
+ */
+struct PacketView {
+    uint8_t* raw;               ///< Start of the packet
+    size_t length;              ///< Total packet length
+    uint8_t frameType;          ///< FTYPE_DATA_UP, FTYPE_DATA_DOWN or FTYPE_LEGACY_DATA
+    uint8_t* srcID;             ///< Sender devEUI (8 bytes); compact: set by findPacketSession()
+    uint8_t* nonce;             ///< CTR nonce (16 bytes); compact: nullptr, rebuilt on decrypt
+    uint32_t devAddr;           ///< Compact: device address
+    uint32_t fcnt;              ///< Compact: full frame counter, set by findPacketSession()
+    uint8_t fcntLen;            ///< Compact: FCnt bytes on air
+    uint8_t* payload;           ///< Encrypted (or decrypted in place) payload
+    size_t payloadLength;       ///< Payload length in bytes
+    uint8_t* hmac;              ///< Truncated HMAC (8 bytes)
+};
+
+/**
+ * @brief Selects the header layout for frames sent from now on.
+ *
+ * Both layouts are always accepted on receive (see FRAME_LEGACY_RX). Pair a
+ * gateway with devices that parse the legacy header by hand by setting
+ * FRAME_FORMAT_LEGACY on both.
+ */
+void setFrameFormat(FrameFormat format);
+
+/**
+ * @brief Header layout used for frames this node sends.
+ */
+FrameFormat frameFormat();
+
+/**
+ * @brief Classifies a received frame by its type byte, without any crypto.
+ *
+ * Compact data frames count only if their devAddr belongs to a session;
+ * otherwise (with FRAME_LEGACY_RX) the frame is tried as legacy: 22 bytes is
+ * a JoinRequest, 16 a JoinAccept, anything longer than PACKET_OVERHEAD data.
+ *
+ * @param buffer Raw received bytes
+ * @param length Frame length
+ * @return FTYPE_* value, FTYPE_INVALID if nothing matches
+ */
+uint8_t frameTypeOf(const uint8_t* buffer, size_t length);
+
+/**
+ * @brief Validates a data frame once and fills the view's field pointers.
+ *
+ * @param buffer Raw received bytes
+ * @param length Packet length
+ * @param view Destination view
+ * @return true for a compact or legacy data frame with at least one payload byte
+ */
+bool parsePacket(uint8_t* buffer, size_t length, PacketView& view);
+
+/**
+ * @brief Restores a full frame counter from its low bytes.
+ *
+ * Picks the value nearest to `next` (the next expected counter), so frames
+ * up to half the on-air range early or late still resolve.
+ *
+ * @param low Counter bytes from the frame
+ * @param lenBytes Number of counter bytes on air (2-4)
+ * @param next Next expected counter of the session
+ * @return Full 32-bit counter
+ */
+uint32_t expandFrameCounter(uint32_t low, uint8_t lenBytes, uint32_t next);
+
+/**
+ * @brief Looks up the sending session of a parsed frame.
+ *
+ * Legacy frames by DevEUI, compact frames by devAddr; for those srcID and
+ * fcnt are filled in as well.
+ *
+ * @param view Parsed packet view
+ * @param session Set to the session inside the table, or nullptr
+ * @return SESSION_OK, SESSION_NOT_FOUND or SESSION_EXPIRED
+ */
+SessionStatus findPacketSession(PacketView& view, SessionInfo*& session);
+
+/**
+ * @brief Drops replayed frames, verifies the frame's HMAC and records its counter.
+ *
+ * Compact frames are checked against the session's replay window before the
+ * HMAC is computed. Legacy frames carry no counter and are only authenticated.
+ *
+ * @param view View resolved by findPacketSession()
+ * @param session Sending session
+ * @return SESSION_OK, SESSION_REPLAY or SESSION_INVALID_HMAC
+ */
+SessionStatus authenticatePacket(PacketView& view, const SessionInfo& session);
+
+/**
+ * @brief Decrypts the payload in place using the session's appSKey.
+ *
+ * Uses no heap and no variable-length arrays. Must be called only after the
+ * HMAC was verified, since the ciphertext is overwritten.
+ *
+ * @param view Parsed packet view
+ * @param session Session that owns the appSKey
+ */
+void decryptInPlace(PacketView& view, const SessionInfo& session);
+
+#endif // PACKET_VIEW_H
@@ -0,0 +1,184 @@
+#include "RxFilter.h"
+#include "Sessions.h"
+
+#include <Arduino.h>
+
+// ────── Token Buckets ──────
+// Fixed table, linear scan (it is small and scanned once per frame). Keys are
+// DevEUI keys for legacy frames and devAddr tagged with 0xFFFFFFFF in the
+// upper half for compact frames, so both share one table.
+
+struct RateBucket {
+  uint64_t key;
+  uint32_t refilledAt;        // millis() the token count is valid for
+  uint32_t lastSeen;          // millis() of the last frame, for replacement
+  uint16_t tokens;
+  bool used;
+};
+
+struct RejoinRecord {
+  uint64_t key;
+  uint32_t sentAt;
+  bool used;
+};
+
+#define RX_REJOIN_MEMORY 8      // Devices remembered for the per-device rejoin limit
+
+static RateBucket buckets[RX_FILTER_BUCKETS];
+static RateBucket joinBucket = { 0, 0, 0, RX_JOIN_BURST, true };
+static RejoinRecord rejoinRing[RX_REJOIN_MEMORY];
+static size_t rejoinNext = 0;
+static uint32_t lastRejoinAt = 0;
+static bool rejoinSentOnce = false;
+static RxFilterStats filterStats = {};
+
+static bool takeToken(RateBucket& bucket, uint16_t burst, uint32_t intervalMs, uint32_t now) {
+  uint32_t add = (now - bucket.refilledAt) / intervalMs;
+  if (add > 0) {
+    bucket.tokens = (bucket.tokens + add >= burst) ? burst : (uint16_t)(bucket.tokens + add);
+    bucket.refilledAt = (bucket.tokens == burst) ? now : bucket.refilledAt + add * intervalMs;
+  }
+  if (bucket.tokens == 0) return false;
+  bucket.tokens--;
+  return true;
+}
+
+static RateBucket& bucketFor(uint64_t key, uint32_t now) {
+  RateBucket* victim = nullptr;
+  for (size_t i = 0; i < RX_FILTER_BUCKETS; i++) {
+    RateBucket& bucket = buckets[i];
+    if (bucket.used && bucket.key == key) return bucket;
+    if (victim != nullptr && !victim->used) continue;  // keep the free slot
+    if (victim == nullptr || !bucket.used || now - bucket.lastSeen > now - victim->lastSeen) {
+      victim = &bucket;
+    }
+  }
+
+  // New or replaced device starts with a full burst
+  victim->key = key;
+  victim->tokens = RX_RATE_BURST;
+  victim->refilledAt = now;
+  victim->lastSeen = now;
+  victim->used = true;
+  return *victim;
+}
+
+static uint32_t readAddr(const uint8_t* in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static uint64_t addrKey(uint32_t devAddr) {
+  return 0xFFFFFFFF00000000ULL | devAddr;
+}
+
+// A compact uplink header whose devAddr frameTypeOf() did not recognize
+static bool looksCompactUp(const uint8_t* data, size_t length) {
+  uint8_t low = data[0] & ~FTYPE_MASK;
+  return (data[0] & FTYPE_MASK) == FTYPE_DATA_UP && (low & ~FTYPE_FCNT_MASK) == 0 &&
+         (low & FTYPE_FCNT_MASK) != 0 && length > FRAME_OVERHEAD;
+}
+
+// ────── Filter Stages ──────
+
+RxFilterResult rxFilterCheck(const uint8_t* data, size_t length) {
+  // 1. Length and type
+  if (data == nullptr || length <= FRAME_OVERHEAD) {
+    filterStats.tooShort++;
+    return RXF_TOO_SHORT;
+  }
+
+  uint32_t now = millis();
+  uint8_t type = frameTypeOf(data, length);
+
+  if (type == FTYPE_JOIN_REQUEST) {
+    if (!takeToken(joinBucket, RX_JOIN_BURST, RX_JOIN_INTERVAL_MS, now)) {
+      filterStats.joinsLimited++;
+      return RXF_RATE_LIMITED;
+    }
+    filterStats.passed++;
+    return RXF_PASS;
+  }
+
+  // 2. Known device, RAM lookups only
+  uint64_t key;
+  if (type == FTYPE_DATA_UP) {
+    uint32_t devAddr = readAddr(data + 1);
+    if (!sessionAddrKnown(devAddr)) {
+      filterStats.unknownDevice++;
+      return RXF_UNKNOWN_DEVICE;
+    }
+    key = addrKey(devAddr);
+  } else if (type == FTYPE_LEGACY_DATA) {
+    if (!sessionKnown(data)) {  // also compact frames of an unknown devAddr
+      filterStats.unknownDevice++;
+      return RXF_UNKNOWN_DEVICE;
+    }
+    key = devEUIToKey(data);
+  } else if (type == FTYPE_INVALID && looksCompactUp(data, length)) {
+    filterStats.unknownDevice++;  // compact header, devAddr of no session
+    return RXF_UNKNOWN_DEVICE;
+  } else {
+    filterStats.badType++;
+    return RXF_BAD_TYPE;
+  }
+
+  // 3. Per-device budget
+  RateBucket& bucket = bucketFor(key, now);
+  bucket.lastSeen = now;
+  if (!takeToken(bucket, RX_RATE_BURST, RX_RATE_INTERVAL_MS, now)) {
+    filterStats.rateLimited++;
+    return RXF_RATE_LIMITED;
+  }
+  filterStats.passed++;
+  return RXF_PASS;
+}
+
+// ────── Rejoin Answers ──────
+
+bool rxFilterAllowRejoin(const uint8_t* devEUI) {
+  uint32_t now = millis();
+  uint64_t key = devEUIToKey(devEUI);
+
+  bool allowed = !rejoinSentOnce || now - lastRejoinAt >= RX_REJOIN_INTERVAL_MS;
+  for (size_t i = 0; allowed && i < RX_REJOIN_MEMORY; i++) {
+    const RejoinRecord& record = rejoinRing[i];
+    if (record.used && record.key == key && now - record.sentAt < RX_REJOIN_DEVICE_INTERVAL_MS) {
+      allowed = false;
+    }
+  }
+  if (!allowed) {
+    filterStats.rejoinsSuppressed++;
+    return false;
+  }
+
+  RejoinRecord& record = rejoinRing[rejoinNext];
+  rejoinNext = (rejoinNext + 1) % RX_REJOIN_MEMORY;
+  record.key = key;
+  record.sentAt = now;
+  record.used = true;
+  lastRejoinAt = now;
+  rejoinSentOnce = true;
+  filterStats.rejoinsSent++;
+  return true;
+}
+
+void rxFilterReset() {
+  memset(buckets, 0, sizeof(buckets));
+  memset(rejoinRing, 0, sizeof(rejoinRing));
+  rejoinNext = 0;
+  rejoinSentOnce = false;
+  joinBucket.tokens = RX_JOIN_BURST;
+  joinBucket.refilledAt = millis();
+}
+
+RxFilterStats getRxFilterStats() {
+  return filterStats;
+}
+
+void printRxFilterStats() {
+  Serial.printf("[RXF] passed=%lu short=%lu type=%lu unknown=%lu limited=%lu joinsLimited=%lu rejoins=%lu rejoinsSuppressed=%lu\n",
+                (unsigned long)filterStats.passed, (unsigned long)filterStats.tooShort,
+                (unsigned long)filterStats.badType, (unsigned long)filterStats.unknownDevice,
+                (unsigned long)filterStats.rateLimited, (unsigned long)filterStats.joinsLimited,
+                (unsigned long)filterStats.rejoinsSent, (unsigned long)filterStats.rejoinsSuppressed);
+}
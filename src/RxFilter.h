@@ -0,0 +1,123 @@
+#ifndef RX_FILTER_H
+#define RX_FILTER_H
+
+#include <Arduino.h>
+#include "PacketView.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Gateway RX Early-Reject Filter
+ *
+ * Runs on every queued frame before any cryptography, cheapest stage first:
+ *
+ *   1. Length / type   frameTypeOf() and the minimum frame size
+ *   2. Known device    exact lookup of DevEUI or devAddr in the session
+ *                      table and the session store directory (RAM only)
+ *   3. Rate limit      token bucket per device; JoinRequests share one
+ *                      gateway-wide bucket that caps their MIC checks (the
+ *                      join queue, JoinQueue.h, paces the key derivation)
+ *
+ * A broken or hostile node flooding at SF7 is then dropped with a few
+ * compares instead of a session load, hex dumps and an HMAC, and cannot
+ * starve the other devices. Every drop is counted by reason.
+ *
+ * Answers to unknown devices (rejoin requests) go through
+ * rxFilterAllowRejoin(), which limits them per device and gateway-wide.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Devices tracked by the rate limiter; the least recently seen one is
+// replaced. Build flag override, e.g. -DRX_FILTER_BUCKETS=64.
+#ifndef RX_FILTER_BUCKETS
+#define RX_FILTER_BUCKETS 32
+#endif
+
+// Frames a device may send back to back (stream bursts included).
+#ifndef RX_RATE_BURST
+#define RX_RATE_BURST 16
+#endif
+
+// One frame per this many ms is sustained per device once the burst is used.
+#ifndef RX_RATE_INTERVAL_MS
+#define RX_RATE_INTERVAL_MS 1000
+#endif
+
+// JoinRequests checked back to back, and the sustained interval, gateway-wide.
+#ifndef RX_JOIN_BURST
+#define RX_JOIN_BURST 32
+#endif
+
+#ifndef RX_JOIN_INTERVAL_MS
+#define RX_JOIN_INTERVAL_MS 100
+#endif
+
+// Minimum time between two rejoin answers to the same device, and between
+// any two rejoin answers.
+#ifndef RX_REJOIN_DEVICE_INTERVAL_MS
+#define RX_REJOIN_DEVICE_INTERVAL_MS 60000
+#endif
+
+#ifndef RX_REJOIN_INTERVAL_MS
+#define RX_REJOIN_INTERVAL_MS 1000
+#endif
+
+/**
+ * @brief Verdict of rxFilterCheck().
+ */
+enum RxFilterResult {
+    RXF_PASS,               ///< Worth authenticating
+    RXF_TOO_SHORT,          ///< Shorter than any frame with a payload
+    RXF_BAD_TYPE,           ///< Not a frame type the gateway handles
+    RXF_UNKNOWN_DEVICE,     ///< No session for the DevEUI / devAddr
+    RXF_RATE_LIMITED        ///< Device (or joins overall) over its budget
+};
+
+/**
+ * @brief Filter counters, one per drop reason.
+ */
+struct RxFilterStats {
+    uint32_t passed;            ///< Frames handed on to authentication
+    uint32_t tooShort;          ///< RXF_TOO_SHORT
+    uint32_t badType;           ///< RXF_BAD_TYPE
+    uint32_t unknownDevice;     ///< RXF_UNKNOWN_DEVICE
+    uint32_t rateLimited;       ///< RXF_RATE_LIMITED for data frames
+    uint32_t joinsLimited;      ///< RXF_RATE_LIMITED for JoinRequests
+    uint32_t rejoinsSent;       ///< Rejoin answers allowed
+    uint32_t rejoinsSuppressed; ///< Rejoin answers refused
+};
+
+/**
+ * @brief Classifies a received frame without any cryptography.
+ *
+ * Consumes a token of the sending device when the frame passes stages 1-2.
+ *
+ * @param data Raw received bytes
+ * @param length Frame length
+ * @return RXF_PASS or the drop reason
+ */
+RxFilterResult rxFilterCheck(const uint8_t* data, size_t length);
+
+/**
+ * @brief Asks whether an unknown device may be answered with a rejoin request.
+ *
+ * @param devEUI 8-byte DevEUI of the device
+ * @return true if the answer may be sent now (and is counted as sent)
+ */
+bool rxFilterAllowRejoin(const uint8_t* devEUI);
+
+/**
+ * @brief Forgets all rate limiter state.
+ */
+void rxFilterReset();
+
+/**
+ * @brief Returns the filter counters.
+ */
+RxFilterStats getRxFilterStats();
+
+/**
+ * @brief Prints the filter counters to Serial.
+ */
+void printRxFilterStats();
+
+#endif // RX_FILTER_H
@@ -0,0 +1,194 @@
+#include "RxQueue.h"
+#include "Gateway.h"
+
+#include <Arduino.h>
+#include <RadioLib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <atomic>
+
+// ────── Ring State ──────
+// head/tail are free-running counters; slot = counter % RX_QUEUE_CAPACITY.
+// Only the producer advances head; the capture task and loop() polls are
+// serialized by the radio lock. The consumer advances tail, and under
+// RX_DROP_OLDEST the producer may also advance it, so tail moves by CAS.
+
+static RxFrame rxRing[RX_QUEUE_CAPACITY];
+static std::atomic<uint32_t> rxHead(0);
+static std::atomic<uint32_t> rxTail(0);
+
+static volatile uint32_t rxTimestamp = 0;
+static RxOverflowPolicy rxPolicy = RX_DROP_NEWEST;
+static RxQueueStats rxStats = {};
+
+// One RX interrupt per frame the radio finished. More interrupts than reads
+// between two captures means the FIFO was overwritten in between.
+static volatile uint32_t rxInterrupts = 0;
+static uint32_t rxInterruptsHandled = 0;
+
+// ────── Capture Task & Radio Lock ──────
+
+static SemaphoreHandle_t radioMutex = nullptr;
+static TaskHandle_t volatile rxTask = nullptr;
+
+void radioLock() {
+  if (radioMutex != nullptr) xSemaphoreTakeRecursive(radioMutex, portMAX_DELAY);
+}
+
+void radioUnlock() {
+  if (radioMutex != nullptr) xSemaphoreGiveRecursive(radioMutex);
+}
+
+void IRAM_ATTR rxQueueISR() {
+  rxTimestamp = micros();
+  rxInterrupts = rxInterrupts + 1;
+  receivedFlag = true;
+
+  TaskHandle_t task = rxTask;
+  if (task != nullptr) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+}
+
+// Drains whatever is pending first, so a frame that arrived before the task
+// existed is not left waiting for the next interrupt
+static void rxCaptureTask(void* arg) {
+  for (;;) {
+    while (captureRxFrame()) {}
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+bool rxQueueBegin() {
+  if (rxTask != nullptr) return true;
+
+  if (radioMutex == nullptr) radioMutex = xSemaphoreCreateRecursiveMutex();
+  if (radioMutex == nullptr) {
+    Serial.println("[RXQ] Radio lock not created, capture stays polled.");
+    return false;
+  }
+
+  TaskHandle_t task = nullptr;
+  if (xTaskCreatePinnedToCore(rxCaptureTask, "rxCapture", RX_TASK_STACK, nullptr,
+                              RX_TASK_PRIORITY, &task, RX_TASK_CORE) != pdPASS) {
+    Serial.println("[RXQ] Capture task not created, capture stays polled.");
+    return false;
+  }
+  rxTask = task;
+  return true;
+}
+
+void setRxOverflowPolicy(RxOverflowPolicy policy) {
+  rxPolicy = policy;
+}
+
+size_t rxQueueDepth() {
+  return rxHead.load(std::memory_order_acquire) - rxTail.load(std::memory_order_acquire);
+}
+
+// ────── Producer ──────
+
+// Reads the pending frame straight into its ring slot (no intermediate copy)
+// and re-arms the receiver so the radio FIFO is free for the next uplink.
+// Called with the radio lock held.
+
+static bool readPendingFrame() {
+  if (!receivedFlag) return false;  // taken by the other producer meanwhile
+  receivedFlag = false;
+
+  uint32_t interrupts = rxInterrupts;
+  if (interrupts - rxInterruptsHandled > 1) rxStats.fifoOverruns += interrupts - rxInterruptsHandled - 1;
+  rxInterruptsHandled = interrupts;
+
+  uint32_t head = rxHead.load(std::memory_order_relaxed);
+  uint32_t tail = rxTail.load(std::memory_order_acquire);
+
+  if (head - tail >= RX_QUEUE_CAPACITY) {
+    if (rxPolicy == RX_DROP_NEWEST) {
+      rxStats.droppedNewest++;
+      lora->startReceive();
+      return false;
+    }
+    // Evict the oldest frame; if the consumer popped it meanwhile there is room anyway
+    if (rxTail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+      rxStats.droppedOldest++;
+    }
+  }
+
+  RxFrame& slot = rxRing[head % RX_QUEUE_CAPACITY];
+  int packetLength = lora->getPacketLength();
+  if (packetLength <= 0 || packetLength > PACKET_MAX_LEN) {
+    rxStats.readErrors++;
+    lora->startReceive();
+    return false;
+  }
+
+  int state = lora->readData(slot.data, packetLength);
+  if (state != RADIOLIB_ERR_NONE) {
+    rxStats.readErrors++;
+    lora->startReceive();
+    return false;
+  }
+
+  slot.length = (uint8_t)packetLength;
+  slot.timestamp = rxTimestamp;
+  slot.rssi = lora->getRSSI();
+  slot.snr = lora->getSNR();
+
+  rxHead.store(head + 1, std::memory_order_release);
+  lora->startReceive();
+
+  rxStats.captured++;
+  uint32_t depth = head + 1 - rxTail.load(std::memory_order_relaxed);
+  if (depth > rxStats.highWater) rxStats.highWater = depth;
+  return true;
+}
+
+bool captureRxFrame() {
+  if (!receivedFlag) return false;
+  radioLock();
+  bool captured = readPendingFrame();
+  radioUnlock();
+  return captured;
+}
+
+// ────── Consumer ──────
+
+// Copies the oldest frame out, then claims it with a CAS on tail. If the
+// producer evicted that slot while it was being copied the CAS fails and the
+// (possibly torn) copy is discarded.
+
+bool rxQueuePop(RxFrame& out) {
+  while (true) {
+    uint32_t tail = rxTail.load(std::memory_order_acquire);
+    uint32_t head = rxHead.load(std::memory_order_acquire);
+    if (tail == head) return false;
+
+    const RxFrame& slot = rxRing[tail % RX_QUEUE_CAPACITY];
+    out.length = slot.length;
+    out.timestamp = slot.timestamp;
+    out.rssi = slot.rssi;
+    out.snr = slot.snr;
+    memcpy(out.data, slot.data, slot.length);
+
+    if (rxTail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+      rxStats.consumed++;
+      return true;
+    }
+  }
+}
+
+RxQueueStats getRxQueueStats() {
+  return rxStats;
+}
+
+void printRxQueueStats() {
+  Serial.printf("[RXQ] depth=%u high=%u captured=%lu consumed=%lu dropNew=%lu dropOld=%lu errors=%lu overruns=%lu\n",
+                (unsigned)rxQueueDepth(), (unsigned)rxStats.highWater,
+                (unsigned long)rxStats.captured, (unsigned long)rxStats.consumed,
+                (unsigned long)rxStats.droppedNewest, (unsigned long)rxStats.droppedOldest,
+                (unsigned long)rxStats.readErrors, (unsigned long)rxStats.fifoOverruns);
+}
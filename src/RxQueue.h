@@ -0,0 +1,150 @@
+#ifndef RX_QUEUE_H
+#define RX_QUEUE_H
+
+#include <Arduino.h>
+#include "PacketView.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * RX Frame Queue
+ *
+ * Fixed-capacity single-producer/single-consumer ring of raw frames.
+ * The producer side (captureRxFrame) moves a received frame out of the
+ * radio, the consumer side (rxQueuePop) is drained by the worker that runs
+ * HMAC, decryption and logging. Back-to-back uplinks are held here instead
+ * of being overwritten in the radio's single FIFO.
+ *
+ * After rxQueueBegin() the producer is a FreeRTOS task woken by the DIO1
+ * interrupt (rxQueueISR). It preempts loop(), so a frame leaves the radio
+ * right after it arrives, even while loop() verifies or logs another one.
+ * RadioLib is not thread-safe: the task, the TX queue and the join windows
+ * make every radio call under one recursive lock (radioLock). Sketches that
+ * use the radio directly after rxQueueBegin() must take it too.
+ *
+ * Without rxQueueBegin() the frame is read by the next captureRxFrame() poll
+ * from loop(). Either way, an RX interrupt that was not followed by a read
+ * before the next one means a frame was overwritten in the radio FIFO; these
+ * are counted as fifoOverruns.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Number of frames held in the ring (power of two not required).
+// Override with a build flag, e.g. -DRX_QUEUE_CAPACITY=32, to trade RAM for burst depth.
+#ifndef RX_QUEUE_CAPACITY
+#define RX_QUEUE_CAPACITY 16
+#endif
+
+// Capture task: stack (bytes), priority (above loop()'s 1) and core (that of loop()).
+#ifndef RX_TASK_STACK
+#define RX_TASK_STACK 4096
+#endif
+#ifndef RX_TASK_PRIORITY
+#define RX_TASK_PRIORITY 5
+#endif
+#ifndef RX_TASK_CORE
+#define RX_TASK_CORE 1
+#endif
+
+/**
+ * @brief A raw frame captured from the radio with its RX metadata.
+ */
+struct RxFrame {
+    uint8_t data[PACKET_MAX_LEN];   ///< Raw received bytes
+    uint8_t length;                 ///< Valid bytes in data
+    uint32_t timestamp;             ///< micros() at the DIO1 interrupt
+    float rssi;                     ///< Packet RSSI (dBm)
+    float snr;                      ///< Packet SNR (dB)
+};
+
+/**
+ * @brief What to do when a frame arrives and the ring is full.
+ */
+enum RxOverflowPolicy {
+    RX_DROP_NEWEST,     ///< Keep the queued frames, discard the new one
+    RX_DROP_OLDEST      ///< Discard the oldest queued frame to make room
+};
+
+/**
+ * @brief Queue counters, safe to read from the consumer side.
+ */
+struct RxQueueStats {
+    uint32_t captured;      ///< Frames pushed into the ring
+    uint32_t consumed;      ///< Frames popped by the worker
+    uint32_t droppedNewest; ///< Frames discarded under RX_DROP_NEWEST
+    uint32_t droppedOldest; ///< Frames evicted under RX_DROP_OLDEST
+    uint32_t readErrors;    ///< readData()/length failures
+    uint32_t fifoOverruns;  ///< Frames overwritten in the radio FIFO before they were read
+    uint16_t highWater;     ///< Maximum observed queue depth
+};
+
+/**
+ * @brief Starts the capture task and the radio lock.
+ *
+ * Call once in setup() after the radio is receiving. Until then (or if the
+ * task cannot be created) frames are captured by polling captureRxFrame().
+ *
+ * @return true if the capture task runs
+ */
+bool rxQueueBegin();
+
+/**
+ * @brief DIO1 / packet-received interrupt hook.
+ *
+ * Sets `receivedFlag`, stamps the RX time and wakes the capture task.
+ * Safe to call from an ISR; call it from the sketch's setFlags() when not
+ * transmitting.
+ */
+void rxQueueISR();
+
+/**
+ * @brief Producer: moves a pending frame from the radio into the ring.
+ *
+ * Run by the capture task. Without rxQueueBegin(), poll it from loop()
+ * between any two long operations. Takes the radio lock and re-arms the
+ * receiver after reading.
+ *
+ * @return true if a frame was captured
+ */
+bool captureRxFrame();
+
+/**
+ * @brief Takes the radio lock (recursive). No-op before rxQueueBegin().
+ */
+void radioLock();
+
+/**
+ * @brief Releases the radio lock taken by radioLock().
+ */
+void radioUnlock();
+
+/**
+ * @brief Consumer: pops the oldest frame from the ring.
+ *
+ * @param out Destination frame
+ * @return true if a frame was available
+ */
+bool rxQueuePop(RxFrame& out);
+
+/**
+ * @brief Number of frames currently queued.
+ */
+size_t rxQueueDepth();
+
+/**
+ * @brief Sets the overflow policy (default RX_DROP_NEWEST).
+ *
+ * @param policy Policy to apply when the ring is full
+ */
+void setRxOverflowPolicy(RxOverflowPolicy policy);
+
+/**
+ * @brief Returns a snapshot of the queue counters.
+ */
+RxQueueStats getRxQueueStats();
+
+/**
+ * @brief Prints the queue counters to Serial.
+ */
+void printRxQueueStats();
+
+#endif // RX_QUEUE_H
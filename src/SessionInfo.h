@@ -0,0 +1,31 @@
+#ifndef SESSION_INFO_H
+#define SESSION_INFO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ─────────────────────────────────────────────
+// SessionInfo Structure
+// ─────────────────────────────────────────────
+// Plain data only (no Arduino or mbedtls types), so the session store can be
+// built on a host as well.
+
+/**
+ * @brief Holds cryptographic and identity info for a LoRa session.
+ */
+struct SessionInfo {
+    uint32_t devAddr;           ///< Unique device address
+    uint8_t devEUI[8];          ///< Device's EUI (64-bit)
+    uint8_t appSKey[16];        ///< Application session key
+    uint8_t nwkSKey[16];        ///< Network session key
+    uint8_t joinNonce[3];       ///< Join nonce from server
+    uint8_t netID[3];           ///< Network ID
+    uint8_t devNonce[2];        ///< Device join nonce
+    uint32_t fcntUp;            ///< Next uplink frame counter (sent by the device)
+    uint32_t fcntDown;          ///< Next downlink frame counter (sent by the gateway)
+};
+
+// Encrypted session body: devAddr, keys and join parameters padded to 3 AES blocks
+#define SESSION_BLOB_LEN 48
+
+#endif // SESSION_INFO_H
@@ -0,0 +1,525 @@
+#include "SessionStore.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// ────── File Backend ──────
+
+FileSessionStorage::FileSessionStorage(const char* prefix) {
+  snprintf(this->prefix, sizeof(this->prefix), "%s", prefix);
+}
+
+void FileSessionStorage::pathFor(const char* key, char* out, size_t cap) const {
+  snprintf(out, cap, "%s%s", prefix, key);
+}
+
+bool FileSessionStorage::begin(bool readOnly) {
+  (void)readOnly;
+  return true;
+}
+
+void FileSessionStorage::end() {
+}
+
+size_t FileSessionStorage::getBytesLength(const char* key) {
+  char path[64];
+  pathFor(key, path, sizeof(path));
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fclose(f);
+  return size > 0 ? (size_t)size : 0;
+}
+
+size_t FileSessionStorage::getBytes(const char* key, void* buf, size_t len) {
+  char path[64];
+  pathFor(key, path, sizeof(path));
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+  size_t n = fread(buf, 1, len, f);
+  fclose(f);
+  return n;
+}
+
+// Written to a temp file and renamed, so a reset mid-write keeps the old page
+size_t FileSessionStorage::putBytes(const char* key, const void* buf, size_t len) {
+  char path[64];
+  char tmp[68];
+  pathFor(key, path, sizeof(path));
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+  FILE* f = fopen(tmp, "wb");
+  if (!f) return 0;
+  size_t n = fwrite(buf, 1, len, f);
+  fclose(f);
+  if (n != len) {
+    ::remove(tmp);
+    return 0;
+  }
+  ::remove(path);
+  if (rename(tmp, path) != 0) return 0;
+  return n;
+}
+
+bool FileSessionStorage::remove(const char* key) {
+  char path[64];
+  pathFor(key, path, sizeof(path));
+  return ::remove(path) == 0;
+}
+
+// ────── Store State ──────
+// The directory mirrors which DevEUI owns which persisted record slot and is
+// built once from the page headers. It also holds when each session was last
+// used (RAM only: millis() do not survive a reboot, and writing a page per
+// packet would wear the flash). Staged records hold the encoded bytes of
+// pending writes (a cleared record stages a delete), at most one per slot.
+
+#define SESSION_PAGE_MAGIC 0x53
+#define SESSION_PAGE_VERSION 2
+#define SESSION_RECORD_USED 0x01
+#define SESSION_RECORD_KEY_OFFSET 0
+#define SESSION_RECORD_FLAGS_OFFSET 8
+#define SESSION_RECORD_ADDR_OFFSET 12
+#define SESSION_RECORD_FCNT_UP_OFFSET 16
+#define SESSION_RECORD_FCNT_DOWN_OFFSET 20
+#define SESSION_RECORD_BODY_OFFSET 24
+
+// Version 1: [DevEUI 8][flags 1][reserved 7][encrypted session 48]
+#define SESSION_PAGE_VERSION_1 1
+#define SESSION_RECORD_LEN_V1 64
+#define SESSION_RECORD_BODY_OFFSET_V1 16
+#define SESSION_PAGE_LEN_V1 (SESSION_PAGE_HEADER_LEN + SESSION_STORE_PAGE_RECORDS * SESSION_RECORD_LEN_V1)
+
+#define SESSION_PAGE_KEY_LEN 10
+
+struct StagedRecord {
+  uint16_t slot;
+  uint8_t data[SESSION_RECORD_LEN];
+};
+
+static SessionStorage* storage = nullptr;   // sessionStoreDefaultStorage() until set
+
+static uint64_t directoryKeys[SESSION_STORE_CAPACITY];
+static uint32_t directoryAddrs[SESSION_STORE_CAPACITY];
+static uint32_t directoryLastSeen[SESSION_STORE_CAPACITY];
+static bool directoryUsed[SESSION_STORE_CAPACITY];
+static bool directoryReady = false;
+
+static StagedRecord staged[SESSION_STORE_PENDING];
+static size_t stagedCount = 0;
+static uint32_t firstStagedAt = 0;
+
+static SessionStoreStats storeStats = {};
+
+// Same packing as euiKey() in Sessions.cpp (big-endian)
+static uint64_t euiKey(const uint8_t* devEUI) {
+  uint64_t key = 0;
+  for (int i = 0; i < 8; i++) key = (key << 8) | devEUI[i];
+  return key;
+}
+
+static void euiHex(const uint8_t* devEUI, char* out) {
+  for (int i = 0; i < 8; i++) snprintf(out + 2 * i, 3, "%02X", devEUI[i]);
+}
+
+static SessionStorage* backend() {
+  if (!storage) storage = sessionStoreDefaultStorage();
+  return storage;
+}
+
+// "sess" + up to 5 digits: fits SESSION_PAGE_KEY_LEN for any uint16_t page
+static void pageKey(size_t page, char* out, size_t cap) {
+  snprintf(out, cap, "sess%02u", (unsigned)(uint16_t)page);
+}
+
+static bool pageValid(const uint8_t* page) {
+  return page[0] == SESSION_PAGE_MAGIC &&
+         page[1] == SESSION_PAGE_VERSION &&
+         page[2] == SESSION_RECORD_LEN;
+}
+
+static void initPage(uint8_t* page) {
+  memset(page, 0, SESSION_PAGE_LEN);
+  page[0] = SESSION_PAGE_MAGIC;
+  page[1] = SESSION_PAGE_VERSION;
+  page[2] = SESSION_RECORD_LEN;
+}
+
+static uint8_t* recordIn(uint8_t* page, size_t slot) {
+  return page + SESSION_PAGE_HEADER_LEN + (slot % SESSION_STORE_PAGE_RECORDS) * SESSION_RECORD_LEN;
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (value >> (8 * i)) & 0xFF;
+}
+
+static uint32_t get32(const uint8_t* in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// Rewrites a version 1 page (already in `page`) in the current layout.
+// devAddr is taken from the encrypted body, the counters start at 0: those
+// sessions never sent a compact frame. Written back by the next flush.
+static bool upgradePageV1(uint8_t* page) {
+  if (page[0] != SESSION_PAGE_MAGIC || page[1] != SESSION_PAGE_VERSION_1 ||
+      page[2] != SESSION_RECORD_LEN_V1) {
+    return false;
+  }
+
+  uint8_t old[SESSION_PAGE_LEN_V1];
+  memcpy(old, page, SESSION_PAGE_LEN_V1);
+  initPage(page);
+
+  SessionInfo session;
+  for (size_t r = 0; r < SESSION_STORE_PAGE_RECORDS; r++) {
+    const uint8_t* from = old + SESSION_PAGE_HEADER_LEN + r * SESSION_RECORD_LEN_V1;
+    uint8_t* to = recordIn(page, r);
+    if (!(from[SESSION_RECORD_FLAGS_OFFSET] & SESSION_RECORD_USED)) continue;
+
+    memcpy(to, from, SESSION_RECORD_FLAGS_OFFSET + 1);
+    memcpy(to + SESSION_RECORD_BODY_OFFSET, from + SESSION_RECORD_BODY_OFFSET_V1, SESSION_BLOB_LEN);
+    if (sessionStoreUnseal(from + SESSION_RECORD_BODY_OFFSET_V1, session)) {
+      put32(to + SESSION_RECORD_ADDR_OFFSET, session.devAddr);
+    }
+  }
+  memset(&session, 0, sizeof(session));
+  return true;
+}
+
+// Reads a page blob; an absent or foreign-layout page reads as empty
+static bool readPage(size_t page, uint8_t* out) {
+  char key[SESSION_PAGE_KEY_LEN];
+  pageKey(page, key, sizeof(key));
+  size_t blobLen = backend()->getBytesLength(key);
+  if (blobLen == SESSION_PAGE_LEN_V1 &&
+      backend()->getBytes(key, out, SESSION_PAGE_LEN_V1) == SESSION_PAGE_LEN_V1 &&
+      upgradePageV1(out)) {
+    storeStats.pageReads++;
+    return true;
+  }
+  if (blobLen != SESSION_PAGE_LEN ||
+      backend()->getBytes(key, out, SESSION_PAGE_LEN) != SESSION_PAGE_LEN ||
+      !pageValid(out)) {
+    initPage(out);
+    return false;
+  }
+  storeStats.pageReads++;
+  return true;
+}
+
+static void loadDirectory() {
+  if (!directoryReady) sessionStoreScan(nullptr, nullptr);
+}
+
+static int findSlot(uint64_t key) {
+  for (size_t i = 0; i < SESSION_STORE_CAPACITY; i++) {
+    if (directoryUsed[i] && directoryKeys[i] == key) return (int)i;
+  }
+  return -1;
+}
+
+static int findFreeSlot() {
+  for (size_t i = 0; i < SESSION_STORE_CAPACITY; i++) {
+    if (!directoryUsed[i]) return (int)i;
+  }
+  return -1;
+}
+
+static StagedRecord* findStaged(uint16_t slot) {
+  for (size_t i = 0; i < stagedCount; i++) {
+    if (staged[i].slot == slot) return &staged[i];
+  }
+  return nullptr;
+}
+
+// Returns the staged record for `slot`, flushing first if the buffer is full;
+// nullptr if the flush could not make room
+static StagedRecord* stageSlot(uint16_t slot) {
+  StagedRecord* record = findStaged(slot);
+  if (record) return record;
+  if (stagedCount == SESSION_STORE_PENDING) sessionStoreFlush();
+  if (stagedCount == SESSION_STORE_PENDING) return nullptr;
+  if (stagedCount == 0) firstStagedAt = sessionStoreMillis();
+  record = &staged[stagedCount++];
+  record->slot = slot;
+  return record;
+}
+
+// ────── Record Encoding ──────
+
+static void encodeRecord(const SessionInfo& session, uint8_t* record) {
+  memset(record, 0, SESSION_RECORD_LEN);
+  memcpy(record + SESSION_RECORD_KEY_OFFSET, session.devEUI, 8);
+  record[SESSION_RECORD_FLAGS_OFFSET] = SESSION_RECORD_USED;
+  put32(record + SESSION_RECORD_ADDR_OFFSET, session.devAddr);
+  put32(record + SESSION_RECORD_FCNT_UP_OFFSET, session.fcntUp);
+  put32(record + SESSION_RECORD_FCNT_DOWN_OFFSET, session.fcntDown);
+  sessionStoreSeal(session, record + SESSION_RECORD_BODY_OFFSET);
+}
+
+static bool decodeRecord(const uint8_t* record, SessionInfo& session) {
+  if (!(record[SESSION_RECORD_FLAGS_OFFSET] & SESSION_RECORD_USED)) return false;
+  if (!sessionStoreUnseal(record + SESSION_RECORD_BODY_OFFSET, session)) {
+    storeStats.rejected++;
+    return false;
+  }
+  memcpy(session.devEUI, record + SESSION_RECORD_KEY_OFFSET, 8);
+  session.fcntUp = get32(record + SESSION_RECORD_FCNT_UP_OFFSET);
+  session.fcntDown = get32(record + SESSION_RECORD_FCNT_DOWN_OFFSET);
+  return true;
+}
+
+// ────── Public API ──────
+
+void setSessionStorage(SessionStorage* newStorage) {
+  if (stagedCount > 0) sessionStoreFlush();
+  storage = newStorage ? newStorage : sessionStoreDefaultStorage();
+  directoryReady = false;
+}
+
+bool sessionStorePut(const SessionInfo& session) {
+  loadDirectory();
+  uint64_t key = euiKey(session.devEUI);
+  int slot = findSlot(key);
+  bool added = slot < 0;
+  if (added) {
+    slot = findFreeSlot();
+    if (slot < 0) {
+      char hex[17];
+      euiHex(session.devEUI, hex);
+      sessionStoreLog("[NVS] Session store full, not persisted: %s", hex);
+      return false;
+    }
+  }
+
+  StagedRecord* record = stageSlot((uint16_t)slot);
+  if (!record) {
+    char hex[17];
+    euiHex(session.devEUI, hex);
+    sessionStoreLog("[NVS] Session store backend failing, not staged: %s", hex);
+    return false;
+  }
+  if (added) {
+    directoryUsed[slot] = true;
+    directoryKeys[slot] = key;
+    directoryLastSeen[slot] = sessionStoreMillis();
+  }
+  directoryAddrs[slot] = session.devAddr;
+  encodeRecord(session, record->data);
+  storeStats.staged++;
+  return true;
+}
+
+bool sessionStoreGet(const uint8_t* devEUI, SessionInfo& session) {
+  loadDirectory();
+  int slot = findSlot(euiKey(devEUI));
+  if (slot < 0) return false;
+
+  StagedRecord* record = findStaged((uint16_t)slot);
+  if (record) return decodeRecord(record->data, session);
+
+  uint8_t page[SESSION_PAGE_LEN];
+  backend()->begin(true);
+  bool found = readPage(slot / SESSION_STORE_PAGE_RECORDS, page);
+  backend()->end();
+  return found && decodeRecord(recordIn(page, slot), session);
+}
+
+bool sessionStoreFindAddr(uint32_t devAddr, uint8_t* devEUI) {
+  loadDirectory();
+  for (size_t i = 0; i < SESSION_STORE_CAPACITY; i++) {
+    if (directoryUsed[i] && directoryAddrs[i] == devAddr) {
+      uint64_t key = directoryKeys[i];
+      for (int b = 7; b >= 0; b--) {
+        devEUI[b] = key & 0xFF;
+        key >>= 8;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool sessionStoreContains(const uint8_t* devEUI) {
+  loadDirectory();
+  return findSlot(euiKey(devEUI)) >= 0;
+}
+
+void sessionStoreSetLastSeen(const uint8_t* devEUI, uint32_t lastSeen) {
+  loadDirectory();
+  int slot = findSlot(euiKey(devEUI));
+  if (slot >= 0) directoryLastSeen[slot] = lastSeen;
+}
+
+bool sessionStoreLastSeen(const uint8_t* devEUI, uint32_t& lastSeen) {
+  loadDirectory();
+  int slot = findSlot(euiKey(devEUI));
+  if (slot < 0) return false;
+  lastSeen = directoryLastSeen[slot];
+  return true;
+}
+
+void sessionStoreRemove(const uint8_t* devEUI) {
+  loadDirectory();
+  int slot = findSlot(euiKey(devEUI));
+  if (slot < 0) return;
+
+  StagedRecord* record = stageSlot((uint16_t)slot);
+  if (!record) {
+    char hex[17];
+    euiHex(devEUI, hex);
+    sessionStoreLog("[NVS] Session store backend failing, removal not staged: %s", hex);
+    return;
+  }
+  directoryUsed[slot] = false;
+  memset(record->data, 0, SESSION_RECORD_LEN);
+  storeStats.staged++;
+}
+
+void sessionStoreClear() {
+  stagedCount = 0;
+  char key[SESSION_PAGE_KEY_LEN];
+  backend()->begin(false);
+  for (size_t p = 0; p < SESSION_STORE_PAGES; p++) {
+    pageKey(p, key, sizeof(key));
+    backend()->remove(key);
+  }
+  backend()->end();
+  memset(directoryUsed, 0, sizeof(directoryUsed));
+  directoryReady = true;
+}
+
+// Groups staged records by page: each touched page is read once, patched with
+// all of its staged records and written once. Pages left empty are removed.
+// The records of a page that fails to write stay staged (moved to the front,
+// before `next`) and are retried by the next flush.
+bool sessionStoreFlush() {
+  if (stagedCount == 0) return true;
+
+  if (!backend()->begin(false)) {
+    sessionStoreLog("[NVS] Failed to open session store for writing");
+    storeStats.failedWrites++;
+    firstStagedAt = sessionStoreMillis();
+    return false;
+  }
+
+  uint8_t page[SESSION_PAGE_LEN];
+  char key[SESSION_PAGE_KEY_LEN];
+  size_t pagesWritten = 0;
+  size_t next = 0;
+
+  while (next < stagedCount) {
+    size_t pageNo = staged[next].slot / SESSION_STORE_PAGE_RECORDS;
+
+    // Gather the staged records of this page into staged[next, end)
+    size_t end = next;
+    for (size_t i = next; i < stagedCount; i++) {
+      if (staged[i].slot / SESSION_STORE_PAGE_RECORDS != pageNo) continue;
+      if (i != end) {
+        StagedRecord tmp = staged[end];
+        staged[end] = staged[i];
+        staged[i] = tmp;
+      }
+      end++;
+    }
+
+    readPage(pageNo, page);
+    for (size_t i = next; i < end; i++) {
+      memcpy(recordIn(page, staged[i].slot), staged[i].data, SESSION_RECORD_LEN);
+    }
+
+    bool empty = true;
+    for (size_t r = 0; r < SESSION_STORE_PAGE_RECORDS && empty; r++) {
+      if (recordIn(page, r)[SESSION_RECORD_FLAGS_OFFSET] & SESSION_RECORD_USED) empty = false;
+    }
+
+    pageKey(pageNo, key, sizeof(key));
+    bool written = empty
+        ? (backend()->remove(key) || backend()->getBytesLength(key) == 0)
+        : (backend()->putBytes(key, page, SESSION_PAGE_LEN) == SESSION_PAGE_LEN);
+
+    if (written) {
+      memmove(&staged[next], &staged[end], (stagedCount - end) * sizeof(StagedRecord));
+      stagedCount -= end - next;
+      storeStats.pageWrites++;
+      pagesWritten++;
+    } else {
+      sessionStoreLog("[NVS] Failed to write session page %u, kept staged", (unsigned)pageNo);
+      storeStats.failedWrites++;
+      next = end;
+    }
+  }
+  backend()->end();
+
+  if (pagesWritten > 0) {
+    storeStats.flushes++;
+    sessionStoreLog("[NVS] Flushed %u session page(s)", (unsigned)pagesWritten);
+  }
+  if (stagedCount > 0) {
+    firstStagedAt = sessionStoreMillis();   // retry after another SESSION_FLUSH_DELAY_MS
+    return false;
+  }
+  return true;
+}
+
+void sessionStoreLoop() {
+  if (stagedCount > 0 && sessionStoreMillis() - firstStagedAt >= SESSION_FLUSH_DELAY_MS) {
+    sessionStoreFlush();
+  }
+}
+
+// Doubles as the directory loader (visit == nullptr): both need the same
+// sequential read of every page, so a preload costs no extra flash reads.
+size_t sessionStoreScan(void (*visit)(const SessionInfo& session, void* context), void* context) {
+  memset(directoryUsed, 0, sizeof(directoryUsed));
+  uint32_t now = sessionStoreMillis();
+
+  uint8_t page[SESSION_PAGE_LEN];
+  SessionInfo session;
+  size_t visited = 0;
+
+  backend()->begin(true);
+  for (size_t p = 0; p < SESSION_STORE_PAGES; p++) {
+    bool present = readPage(p, page);
+    for (size_t r = 0; r < SESSION_STORE_PAGE_RECORDS; r++) {
+      size_t slot = p * SESSION_STORE_PAGE_RECORDS + r;
+      if (slot >= SESSION_STORE_CAPACITY) break;
+
+      StagedRecord* pending = findStaged((uint16_t)slot);
+      const uint8_t* record = pending ? pending->data : recordIn(page, slot);
+      if (!pending && !present) continue;
+      if (!(record[SESSION_RECORD_FLAGS_OFFSET] & SESSION_RECORD_USED)) continue;
+
+      directoryUsed[slot] = true;
+      directoryKeys[slot] = euiKey(record + SESSION_RECORD_KEY_OFFSET);
+      directoryAddrs[slot] = get32(record + SESSION_RECORD_ADDR_OFFSET);
+      if (!directoryReady) directoryLastSeen[slot] = now;   // a rescan keeps known times
+      if (visit && decodeRecord(record, session)) {
+        visit(session, context);
+        visited++;
+      }
+    }
+  }
+  backend()->end();
+
+  directoryReady = true;
+  return visited;
+}
+
+size_t sessionStorePending() {
+  return stagedCount;
+}
+
+size_t sessionStoreCount() {
+  loadDirectory();
+  size_t count = 0;
+  for (size_t i = 0; i < SESSION_STORE_CAPACITY; i++) {
+    if (directoryUsed[i]) count++;
+  }
+  return count;
+}
+
+SessionStoreStats getSessionStoreStats() {
+  return storeStats;
+}
@@ -0,0 +1,284 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SessionInfo.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Persistent Session Store
+ *
+ * Sessions are persisted as fixed-size binary records packed into pages:
+ *
+ *   Page blob "sessNN": [magic 1][version 1][record len 1][reserved 1]
+ *                       [SESSION_STORE_PAGE_RECORDS x 72-byte record]
+ *
+ *   Record: [DevEUI 8][flags 1][reserved 3][devAddr 4][FCntUp 4][FCntDown 4]
+ *           [encrypted session 48]
+ *
+ * The full 8-byte DevEUI is kept in every record, so devices can never
+ * overwrite each other regardless of shared EUI prefixes. devAddr and the
+ * frame counter checkpoints are public on air and stored in clear, so the
+ * directory can map devAddr to DevEUI without decrypting anything. Version 1
+ * pages (64-byte records without them) are upgraded when read. Writes are staged
+ * (dirty-tracked per record) and flushed write-behind: all dirty records of a
+ * page are coalesced into one page write, and one flush opens the backend once.
+ *
+ * The store itself uses no Arduino, Serial or mbedtls API. The platform
+ * hooks at the end of this file (NVS, time, log, session encryption) are
+ * defined in SessionStoreNvs.cpp on the device; a host build defines its
+ * own, see extras/sessionStoreTest.cpp.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Number of sessions that can be persisted. Build flag override, e.g. -DSESSION_STORE_CAPACITY=256.
+#ifndef SESSION_STORE_CAPACITY
+#define SESSION_STORE_CAPACITY 128
+#endif
+
+// Records per page blob (4 + 8 x 72 = 580-byte blobs).
+#ifndef SESSION_STORE_PAGE_RECORDS
+#define SESSION_STORE_PAGE_RECORDS 8
+#endif
+
+// Staged records kept in RAM before a flush is forced.
+#ifndef SESSION_STORE_PENDING
+#define SESSION_STORE_PENDING 16
+#endif
+
+// Write-behind delay after the first staged record, in milliseconds.
+#ifndef SESSION_FLUSH_DELAY_MS
+#define SESSION_FLUSH_DELAY_MS 2000
+#endif
+
+#define SESSION_RECORD_LEN 72
+#define SESSION_PAGE_HEADER_LEN 4
+#define SESSION_PAGE_LEN (SESSION_PAGE_HEADER_LEN + SESSION_STORE_PAGE_RECORDS * SESSION_RECORD_LEN)
+#define SESSION_STORE_PAGES ((SESSION_STORE_CAPACITY + SESSION_STORE_PAGE_RECORDS - 1) / SESSION_STORE_PAGE_RECORDS)
+
+/**
+ * @brief Key/value backend used by the session store.
+ *
+ * Mirrors the subset of the Preferences API the store needs, so the same
+ * store code runs against NVS on the device and against files on a host.
+ */
+class SessionStorage {
+public:
+    virtual ~SessionStorage() {}
+    virtual bool begin(bool readOnly) = 0;
+    virtual void end() = 0;
+    virtual size_t getBytesLength(const char* key) = 0;
+    virtual size_t getBytes(const char* key, void* buf, size_t len) = 0;
+    virtual size_t putBytes(const char* key, const void* buf, size_t len) = 0;
+    virtual bool remove(const char* key) = 0;
+};
+
+/**
+ * @brief NVS backend (Preferences namespace "lora"). Default backend on the
+ *        device, defined in SessionStoreNvs.cpp.
+ */
+class NvsSessionStorage : public SessionStorage {
+public:
+    bool begin(bool readOnly) override;
+    void end() override;
+    size_t getBytesLength(const char* key) override;
+    size_t getBytes(const char* key, void* buf, size_t len) override;
+    size_t putBytes(const char* key, const void* buf, size_t len) override;
+    bool remove(const char* key) override;
+};
+
+/**
+ * @brief File-backed stand-in for Preferences, one file per key.
+ *
+ * Works with any stdio path: "/spiffs/lora_" on the device (SPIFFS mounted),
+ * or a temp directory when exercising the store on a host.
+ */
+class FileSessionStorage : public SessionStorage {
+public:
+    /**
+     * @param prefix Path prefix, the key is appended to form the file name
+     */
+    explicit FileSessionStorage(const char* prefix);
+
+    bool begin(bool readOnly) override;
+    void end() override;
+    size_t getBytesLength(const char* key) override;
+    size_t getBytes(const char* key, void* buf, size_t len) override;
+    size_t putBytes(const char* key, const void* buf, size_t len) override;
+    bool remove(const char* key) override;
+
+private:
+    void pathFor(const char* key, char* out, size_t cap) const;
+    char prefix[48];
+};
+
+/**
+ * @brief Session store counters.
+ */
+struct SessionStoreStats {
+    uint32_t staged;        ///< Records staged by put/remove
+    uint32_t flushes;       ///< Flushes that wrote at least one page
+    uint32_t pageWrites;    ///< Page blobs written (≈ NVS commits)
+    uint32_t failedWrites;  ///< Page writes (or backend opens) that failed; their records stay staged
+    uint32_t pageReads;     ///< Page blobs read
+    uint32_t rejected;      ///< Records that failed to decode (wrong key / corrupt)
+};
+
+/**
+ * @brief Replaces the storage backend (default: NVS).
+ *
+ * Pending records are flushed to the old backend first. The directory is
+ * rebuilt from the new backend on next use.
+ *
+ * @param storage Backend to use, must outlive the store
+ */
+void setSessionStorage(SessionStorage* storage);
+
+/**
+ * @brief Stages a session for persistence (write-behind).
+ *
+ * @param session Session to persist, keyed by session.devEUI
+ * @return false if the store is full, or the staging buffer is full and
+ *         cannot be flushed
+ */
+bool sessionStorePut(const SessionInfo& session);
+
+/**
+ * @brief Reads a persisted (or staged) session.
+ *
+ * @param devEUI Pointer to the 8-byte DevEUI
+ * @param session Destination, devEUI is filled in as well
+ * @return true if found and decoded
+ */
+bool sessionStoreGet(const uint8_t* devEUI, SessionInfo& session);
+
+/**
+ * @brief Finds the DevEUI of the persisted session that owns `devAddr`.
+ *
+ * Uses the in-RAM directory only, never the backend.
+ *
+ * @param devAddr Device address
+ * @param devEUI Receives the 8-byte DevEUI
+ * @return true if found
+ */
+bool sessionStoreFindAddr(uint32_t devAddr, uint8_t* devEUI);
+
+/**
+ * @brief true if a session for `devEUI` is persisted. Uses the in-RAM directory only.
+ */
+bool sessionStoreContains(const uint8_t* devEUI);
+
+/**
+ * @brief Records when a persisted session was last used (in-RAM directory).
+ *
+ * The session cache calls it when it evicts a session, so the idle TTL
+ * still applies when the session is reloaded. Not written to the backend:
+ * after a reboot (directory rebuilt) sessions count as seen at that moment.
+ *
+ * @param devEUI Pointer to the 8-byte DevEUI
+ * @param lastSeen sessionStoreMillis() time of the last use
+ */
+void sessionStoreSetLastSeen(const uint8_t* devEUI, uint32_t lastSeen);
+
+/**
+ * @brief Returns when a persisted session was last used. Uses the in-RAM directory only.
+ *
+ * @param devEUI Pointer to the 8-byte DevEUI
+ * @param lastSeen Receives the sessionStoreMillis() time
+ * @return true if the session is persisted
+ */
+bool sessionStoreLastSeen(const uint8_t* devEUI, uint32_t& lastSeen);
+
+/**
+ * @brief Stages the removal of a persisted session.
+ *
+ * @param devEUI Pointer to the 8-byte DevEUI
+ */
+void sessionStoreRemove(const uint8_t* devEUI);
+
+/**
+ * @brief Removes every persisted session and drops staged writes.
+ */
+void sessionStoreClear();
+
+/**
+ * @brief Writes all staged records, one page write per touched page.
+ *
+ * Records of a page that fails to write stay staged for the next flush.
+ *
+ * @return true if every staged record was written
+ */
+bool sessionStoreFlush();
+
+/**
+ * @brief Write-behind timer; flushes once SESSION_FLUSH_DELAY_MS has passed
+ *        since the first staged record. Call from loop().
+ */
+void sessionStoreLoop();
+
+/**
+ * @brief Visits every persisted session in one sequential pass.
+ *
+ * Opens the backend once and reads each page a single time; staged records
+ * take precedence over their persisted copies. Also builds the directory, so
+ * later lookups of unknown DevEUIs never touch the backend.
+ *
+ * @param visit Called once per decoded session
+ * @param context Passed through to visit
+ * @return Number of sessions visited
+ */
+size_t sessionStoreScan(void (*visit)(const SessionInfo& session, void* context), void* context);
+
+/**
+ * @brief Number of staged, not yet flushed records.
+ */
+size_t sessionStorePending();
+
+/**
+ * @brief Number of sessions held by the store (persisted + staged).
+ */
+size_t sessionStoreCount();
+
+/**
+ * @brief Returns the store counters.
+ */
+SessionStoreStats getSessionStoreStats();
+
+// ─────────────────────────────────────────────
+// Platform Hooks
+// ─────────────────────────────────────────────
+
+/**
+ * @brief Backend used until setSessionStorage() is called (NVS on the device).
+ */
+SessionStorage* sessionStoreDefaultStorage();
+
+/**
+ * @brief Milliseconds since boot, for the write-behind delay and last-seen times.
+ */
+uint32_t sessionStoreMillis();
+
+/**
+ * @brief Logs one line, printf-style (Serial on the device).
+ */
+void sessionStoreLog(const char* format, ...);
+
+/**
+ * @brief Encrypts a session's persistent fields into a record body.
+ *
+ * @param session Session to encrypt (devEUI and counters are not included)
+ * @param out SESSION_BLOB_LEN-byte destination
+ */
+void sessionStoreSeal(const SessionInfo& session, uint8_t* out);
+
+/**
+ * @brief Decrypts a record body written by sessionStoreSeal().
+ *
+ * @param in SESSION_BLOB_LEN-byte body
+ * @param session Destination, devEUI and counters are left untouched
+ * @return false if the body does not decrypt (wrong key or corrupt)
+ */
+bool sessionStoreUnseal(const uint8_t* in, SessionInfo& session);
+
+#endif // SESSION_STORE_H
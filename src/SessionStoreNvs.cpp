@@ -0,0 +1,64 @@
+#include "SessionStore.h"
+#include "CryptoUtils.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <stdarg.h>
+
+// ────── NVS Backend ──────
+// One Preferences handle for the "lora" namespace; begin()/end() bracket
+// every batch of store operations.
+
+static Preferences prefs;
+
+bool NvsSessionStorage::begin(bool readOnly) {
+  return prefs.begin("lora", readOnly);
+}
+
+void NvsSessionStorage::end() {
+  prefs.end();
+}
+
+size_t NvsSessionStorage::getBytesLength(const char* key) {
+  return prefs.getBytesLength(key);
+}
+
+size_t NvsSessionStorage::getBytes(const char* key, void* buf, size_t len) {
+  return prefs.getBytes(key, buf, len);
+}
+
+size_t NvsSessionStorage::putBytes(const char* key, const void* buf, size_t len) {
+  return prefs.putBytes(key, buf, len);
+}
+
+bool NvsSessionStorage::remove(const char* key) {
+  return prefs.remove(key);
+}
+
+// ────── Platform Hooks ──────
+
+SessionStorage* sessionStoreDefaultStorage() {
+  static NvsSessionStorage nvsStorage;
+  return &nvsStorage;
+}
+
+uint32_t sessionStoreMillis() {
+  return millis();
+}
+
+void sessionStoreLog(const char* format, ...) {
+  char line[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  Serial.println(line);
+}
+
+void sessionStoreSeal(const SessionInfo& session, uint8_t* out) {
+  encryptSession(session, out);
+}
+
+bool sessionStoreUnseal(const uint8_t* in, SessionInfo& session) {
+  return decryptSession(in, session);
+}
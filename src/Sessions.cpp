@@ -1,6 +1,7 @@
 #include "CryptoUtils.h"
 #include "Gateway.h"
 #include "Sessions.h"
+#include "SessionStore.h"
 
 #include <Arduino.h>
 #include <RadioLib.h>
@@ -12,7 +13,358 @@
 
 
 Preferences preferences;
-std::map<String, SessionInfo> sessionMap;
+
+// ────── Session Table ──────
+// Sessions live in a fixed slot array; a separate open-addressing index
+// (linear probing, 2x the slot count) maps DevEUI keys to slot numbers.
+// Only the 16-bit index entries move on delete (backward shift), the slots
+// themselves never do, so SessionInfo pointers and AES contexts stay put.
+//
+// Used slots are also threaded on an intrusive LRU list (head = most recent).
+// Once the entry budget is reached the tail is evicted; NVS holds every
+// stored session, so an evicted one is simply reloaded on its next packet.
+//
+// A second index of the same shape maps devAddr to slot for compact frames,
+// which carry the devAddr instead of the DevEUI.
+
+#define SESSION_INDEX_SIZE (SESSION_TABLE_CAPACITY * 2)
+#define SESSION_INDEX_EMPTY 0xFFFF
+#define SESSION_LRU_NONE 0xFFFF
+
+static SessionEntry sessionSlots[SESSION_TABLE_CAPACITY];
+static uint16_t sessionIndex[SESSION_INDEX_SIZE];
+static uint16_t addrIndex[SESSION_INDEX_SIZE];
+static uint16_t freeSlots[SESSION_TABLE_CAPACITY];
+static size_t freeSlotCount = 0;
+static bool sessionTableReady = false;
+
+static uint16_t lruHead = SESSION_LRU_NONE;
+static uint16_t lruTail = SESSION_LRU_NONE;
+static size_t sessionCacheLimit = SESSION_TABLE_CAPACITY;
+static uint32_t sessionTTL = 0;
+static SessionCacheStats cacheStats = {};
+
+static void initSessionTable() {
+  if (sessionTableReady) return;
+  for (size_t i = 0; i < SESSION_INDEX_SIZE; i++) {
+    sessionIndex[i] = SESSION_INDEX_EMPTY;
+    addrIndex[i] = SESSION_INDEX_EMPTY;
+  }
+  for (size_t i = 0; i < SESSION_TABLE_CAPACITY; i++) {
+    freeSlots[i] = SESSION_TABLE_CAPACITY - 1 - i;
+  }
+  freeSlotCount = SESSION_TABLE_CAPACITY;
+  lruHead = SESSION_LRU_NONE;
+  lruTail = SESSION_LRU_NONE;
+  sessionTableReady = true;
+}
+
+static uint16_t slotOf(const SessionEntry& entry) {
+  return (uint16_t)(&entry - sessionSlots);
+}
+
+static void lruUnlink(uint16_t slot) {
+  SessionEntry& entry = sessionSlots[slot];
+  if (entry.lruPrev != SESSION_LRU_NONE) sessionSlots[entry.lruPrev].lruNext = entry.lruNext;
+  else lruHead = entry.lruNext;
+  if (entry.lruNext != SESSION_LRU_NONE) sessionSlots[entry.lruNext].lruPrev = entry.lruPrev;
+  else lruTail = entry.lruPrev;
+  entry.lruPrev = SESSION_LRU_NONE;
+  entry.lruNext = SESSION_LRU_NONE;
+}
+
+static void lruPushFront(uint16_t slot) {
+  SessionEntry& entry = sessionSlots[slot];
+  entry.lruPrev = SESSION_LRU_NONE;
+  entry.lruNext = lruHead;
+  if (lruHead != SESSION_LRU_NONE) sessionSlots[lruHead].lruPrev = slot;
+  lruHead = slot;
+  if (lruTail == SESSION_LRU_NONE) lruTail = slot;
+}
+
+// Marks an entry as just used: refresh lastSeen and move it to the LRU head
+static void touchEntry(SessionEntry& entry) {
+  entry.lastSeen = millis();
+  uint16_t slot = slotOf(entry);
+  if (lruHead == slot) return;
+  lruUnlink(slot);
+  lruPushFront(slot);
+}
+
+static bool idleTooLong(uint32_t lastSeen) {
+  return sessionTTL != 0 && (uint32_t)(millis() - lastSeen) > sessionTTL;
+}
+
+static bool isExpired(const SessionEntry& entry) {
+  return idleTooLong(entry.lastSeen);
+}
+
+static size_t hashKey(uint64_t key) {
+  // splitmix64 finalizer; EUIs often share vendor prefixes
+  key ^= key >> 30;
+  key *= 0xBF58476D1CE4E5B9ULL;
+  key ^= key >> 27;
+  key *= 0x94D049BB133111EBULL;
+  key ^= key >> 31;
+  return (size_t)(key % SESSION_INDEX_SIZE);
+}
+
+// Home positions of a slot in the two indexes
+static size_t keyHome(uint16_t slot) {
+  return hashKey(sessionSlots[slot].key);
+}
+
+static size_t addrHome(uint16_t slot) {
+  return hashKey(sessionSlots[slot].info.devAddr);
+}
+
+// Empties index position `pos`. Backward-shift deletion keeps probe chains
+// intact without tombstones.
+static void indexRemoveAt(uint16_t* index, size_t pos, size_t (*home)(uint16_t)) {
+  index[pos] = SESSION_INDEX_EMPTY;
+  size_t next = (pos + 1) % SESSION_INDEX_SIZE;
+  while (index[next] != SESSION_INDEX_EMPTY) {
+    uint16_t moving = index[next];
+    size_t movingHome = home(moving);
+    // Move back if `pos` lies cyclically in [movingHome, next)
+    bool shift = (next > pos) ? (movingHome <= pos || movingHome > next)
+                              : (movingHome <= pos && movingHome > next);
+    if (shift) {
+      index[pos] = moving;
+      index[next] = SESSION_INDEX_EMPTY;
+      pos = next;
+    }
+    next = (next + 1) % SESSION_INDEX_SIZE;
+  }
+}
+
+// The addr index is keyed by info.devAddr, so a slot is unlinked before its
+// info changes and linked again afterwards.
+static void addrIndexInsert(uint16_t slot) {
+  size_t pos = addrHome(slot);
+  while (addrIndex[pos] != SESSION_INDEX_EMPTY) {
+    pos = (pos + 1) % SESSION_INDEX_SIZE;
+  }
+  addrIndex[pos] = slot;
+}
+
+static void addrIndexErase(uint16_t slot) {
+  size_t pos = addrHome(slot);
+  while (addrIndex[pos] != SESSION_INDEX_EMPTY) {
+    if (addrIndex[pos] == slot) {
+      indexRemoveAt(addrIndex, pos, addrHome);
+      return;
+    }
+    pos = (pos + 1) % SESSION_INDEX_SIZE;
+  }
+}
+
+static SessionEntry* findEntryByAddr(uint32_t devAddr) {
+  initSessionTable();
+  size_t pos = hashKey(devAddr);
+  while (addrIndex[pos] != SESSION_INDEX_EMPTY) {
+    SessionEntry& entry = sessionSlots[addrIndex[pos]];
+    if (entry.info.devAddr == devAddr) return &entry;
+    pos = (pos + 1) % SESSION_INDEX_SIZE;
+  }
+  return nullptr;
+}
+
+static SessionEntry* findEntry(uint64_t key) {
+  initSessionTable();
+  size_t pos = hashKey(key);
+  while (sessionIndex[pos] != SESSION_INDEX_EMPTY) {
+    SessionEntry& entry = sessionSlots[sessionIndex[pos]];
+    if (entry.key == key) return &entry;
+    pos = (pos + 1) % SESSION_INDEX_SIZE;
+  }
+  return nullptr;
+}
+
+static bool eraseEntry(uint64_t key);
+static bool persistCounters(SessionEntry& entry);
+
+// Drops the least-recently-used session from RAM (its NVS copy stays).
+// A receive checkpoint lags the live counter by up to FCNT_CHECKPOINT_INTERVAL
+// frames, and a reload from it would accept those counters again, so the
+// live counters are written back first. Send checkpoints are already ahead.
+// lastSeen goes to the store's directory, so the idle TTL survives the reload.
+static void evictLRU() {
+  if (lruTail == SESSION_LRU_NONE) return;
+  SessionEntry& entry = sessionSlots[lruTail];
+  sessionStoreSetLastSeen(entry.info.devEUI, entry.lastSeen);
+  if (entry.info.fcntUp > entry.fcntUpSaved || entry.info.fcntDown > entry.fcntDownSaved) {
+    if (entry.info.fcntUp > entry.fcntUpSaved) entry.fcntUpSaved = entry.info.fcntUp;
+    if (entry.info.fcntDown > entry.fcntDownSaved) entry.fcntDownSaved = entry.info.fcntDown;
+    persistCounters(entry);
+  }
+  eraseEntry(entry.key);
+  cacheStats.evictions++;
+}
+
+// Returns the existing entry for `key` or claims a slot for it, evicting the
+// least-recently-used session if the entry budget is used up.
+static SessionEntry* insertEntry(uint64_t key) {
+  SessionEntry* existing = findEntry(key);
+  if (existing) return existing;
+  while (freeSlotCount > 0 && SESSION_TABLE_CAPACITY - freeSlotCount >= sessionCacheLimit) {
+    evictLRU();
+  }
+  if (freeSlotCount == 0) evictLRU();
+  if (freeSlotCount == 0) return nullptr;
+
+  uint16_t slot = freeSlots[--freeSlotCount];
+  SessionEntry& entry = sessionSlots[slot];
+  entry.key = key;
+  entry.used = true;
+  entry.crypto.ready = false;
+  entry.fcntUpSaved = 0;
+  entry.fcntDownSaved = 0;
+  entry.replayUp = 0;
+  entry.replayDown = 0;
+  entry.lastSeen = millis();
+  lruPushFront(slot);
+
+  size_t pos = hashKey(key);
+  while (sessionIndex[pos] != SESSION_INDEX_EMPTY) {
+    pos = (pos + 1) % SESSION_INDEX_SIZE;
+  }
+  sessionIndex[pos] = slot;
+  return &entry;
+}
+
+static bool eraseEntry(uint64_t key) {
+  initSessionTable();
+  size_t pos = hashKey(key);
+  while (sessionIndex[pos] != SESSION_INDEX_EMPTY) {
+    uint16_t slot = sessionIndex[pos];
+    if (sessionSlots[slot].key == key) {
+      SessionEntry& entry = sessionSlots[slot];
+      lruUnlink(slot);
+      addrIndexErase(slot);
+      freeSessionCrypto(entry.crypto);
+      memset(&entry.info, 0, sizeof(entry.info));
+      entry.used = false;
+      freeSlots[freeSlotCount++] = slot;
+
+      indexRemoveAt(sessionIndex, pos, keyHome);
+      return true;
+    }
+    pos = (pos + 1) % SESSION_INDEX_SIZE;
+  }
+  return false;
+}
+
+// Replaces the session held by an entry; persisted counters are those of `info`.
+// Everything below the restored counters counts as received, so a reload
+// never reopens the window behind them.
+static void setEntryInfo(SessionEntry& entry, const SessionInfo& info) {
+  uint16_t slot = slotOf(entry);
+  addrIndexErase(slot);
+  entry.info = info;
+  entry.fcntUpSaved = info.fcntUp;
+  entry.fcntDownSaved = info.fcntDown;
+  entry.replayUp = 0xFFFFFFFFUL;
+  entry.replayDown = 0xFFFFFFFFUL;
+  addrIndexInsert(slot);
+}
+
+static void clearSessionTable() {
+  initSessionTable();
+  for (size_t i = 0; i < SESSION_TABLE_CAPACITY; i++) {
+    if (sessionSlots[i].used) freeSessionCrypto(sessionSlots[i].crypto);
+    memset(&sessionSlots[i].info, 0, sizeof(SessionInfo));
+    sessionSlots[i].used = false;
+  }
+  sessionTableReady = false;
+  initSessionTable();
+}
+
+uint64_t devEUIToKey(const uint8_t* devEUI) {
+  uint64_t key = 0;
+  for (int i = 0; i < 8; i++) key = (key << 8) | devEUI[i];
+  return key;
+}
+
+static void keyToDevEUI(uint64_t key, uint8_t* devEUI) {
+  for (int i = 7; i >= 0; i--) {
+    devEUI[i] = key & 0xFF;
+    key >>= 8;
+  }
+}
+
+// Parses the 16-char hex form produced by idToHexString()
+static uint64_t hexToKey(const String& devEUI) {
+  uint64_t key = 0;
+  for (size_t i = 0; i < devEUI.length() && i < 16; i++) {
+    char c = devEUI[i];
+    uint8_t nibble = 0;
+    if (c >= '0' && c <= '9') nibble = c - '0';
+    else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+    key = (key << 4) | nibble;
+  }
+  return key;
+}
+
+size_t sessionCount() {
+  initSessionTable();
+  return SESSION_TABLE_CAPACITY - freeSlotCount;
+}
+
+void setSessionCacheLimit(size_t maxEntries) {
+  initSessionTable();
+  if (maxEntries == 0) maxEntries = 1;
+  if (maxEntries > SESSION_TABLE_CAPACITY) maxEntries = SESSION_TABLE_CAPACITY;
+  sessionCacheLimit = maxEntries;
+  while (sessionCount() > sessionCacheLimit) {
+    evictLRU();
+  }
+}
+
+void setSessionTTL(uint32_t ttlMillis) {
+  sessionTTL = ttlMillis;
+}
+
+SessionCacheStats getSessionCacheStats() {
+  return cacheStats;
+}
+
+// ────── Startup Preload ──────
+
+static void preloadVisit(const SessionInfo& session, void* context) {
+  SessionPreloadStats* stats = (SessionPreloadStats*)context;
+  uint64_t key = devEUIToKey(session.devEUI);
+
+  // Never evict during preload, the first sessions are as good as the last
+  if (!findEntry(key) && sessionCount() >= sessionCacheLimit) {
+    stats->skipped++;
+    return;
+  }
+  SessionEntry* entry = insertEntry(key);
+  if (!entry) {
+    stats->skipped++;
+    return;
+  }
+  setEntryInfo(*entry, session);
+  touchEntry(*entry);
+  sessionCryptoFor(entry->info);  // build key schedules now, not on the first packet
+  stats->loaded++;
+}
+
+SessionPreloadStats preloadSessions() {
+  initSessionTable();
+  SessionPreloadStats stats = {};
+
+  unsigned long start = micros();
+  sessionStoreScan(preloadVisit, &stats);
+  stats.elapsedMicros = micros() - start;
+
+  Serial.printf("[MEM] Preloaded %u session(s), %u left in NVS, warm-up %lu.%03lu ms\n",
+                (unsigned)stats.loaded, (unsigned)stats.skipped,
+                (unsigned long)(stats.elapsedMicros / 1000), (unsigned long)(stats.elapsedMicros % 1000));
+  return stats;
+}
 
 String encodeDevEUI() {
   return bytesToHex(devEUI, 8);
@@ -86,80 +438,273 @@ void deriveSessionKey(uint8_t* outKey, uint8_t keyType, const uint8_t* appKey,
   memcpy(input + 7, devNonce, 2);    // bytes 7–8
   // bytes 9–15 remain zero
 
-  aes128_encrypt_block(appKey, input, outKey);
+  if (appKey == ::appKey) {
+    aes128_encrypt_block_ctx(appKeyEncContext(), input, outKey);
+  } else {
+    aes128_encrypt_block(appKey, input, outKey);
+  }
+}
+
+// Sessions held in the table carry their own contexts. A detached copy that
+// is not (or no longer) in the table falls back to a scratch context.
+SessionCrypto& sessionCryptoFor(const SessionInfo& session) {
+  static SessionCrypto scratch;
+
+  SessionEntry* entry = findEntry(devEUIToKey(session.devEUI));
+  SessionCrypto& crypto = entry ? entry->crypto : scratch;
+
+  // Rebuild only if this is a new session or its keys changed
+  if (!crypto.ready ||
+      memcmp(crypto.appSKey, session.appSKey, 16) != 0 ||
+      memcmp(crypto.nwkSKey, session.nwkSKey, 16) != 0) {
+    freeSessionCrypto(crypto);
+    initSessionCrypto(crypto, session);
+  }
+  return crypto;
 }
 
 void flushSessionFor(const String& devEUI) {
-  sessionMap.erase(devEUI);  // remove from RAM
+  uint64_t key = hexToKey(devEUI);
+  eraseEntry(key);  // remove from RAM
 
-  String key = devEUI.substring(0, 8);
-  preferences.begin("lora", false);
-  preferences.remove(key.c_str());
-  preferences.end();
+  uint8_t eui[8];
+  keyToDevEUI(key, eui);
+  sessionStoreRemove(eui);  // staged, written by the next flush
 
   Serial.println("[NVS] Session flushed for: " + devEUI);
 }
 
-
+// Staged in the session store and written by the next write-behind flush
 void saveSessionToNVS(const String& devEUI, SessionInfo session) {
-  uint8_t encrypted[sizeof(SessionInfo)];
-  encryptSession(session, encrypted);
-  preferences.begin("lora", false);
-  String key = devEUI.substring(0, 8);  // Truncate to 8 characters
-  preferences.putBytes(key.c_str(), encrypted, 32);
-  preferences.end();
+  keyToDevEUI(hexToKey(devEUI), session.devEUI);
+  sessionStorePut(session);
 }
 
-
 bool loadSessionFromNVS(const String& devEUI, SessionInfo& session) {
-  uint8_t encrypted[32];
-  String key = devEUI.substring(0, 8);  // Truncate to 8 characters
-  
-  preferences.begin("lora", true);
-  if (preferences.getBytesLength(key.c_str()) != 32) {
-    preferences.end();
-    return false;
+  uint8_t eui[8];
+  keyToDevEUI(hexToKey(devEUI), eui);
+  return sessionStoreGet(eui, session);
+}
+
+void storeSessionFor(String devEUI, const SessionInfo& session) {
+  uint64_t key = hexToKey(devEUI);
+  SessionEntry* entry = insertEntry(key);
+  if (entry) {
+    setEntryInfo(*entry, session);
+    keyToDevEUI(key, entry->info.devEUI);
+    touchEntry(*entry);
+    Serial.println("[MEM] Session cached in memory for device: " + devEUI);
+  } else {
+    Serial.println("[WARN] Session table full, not cached in RAM: " + devEUI);
+  }
+  saveSessionToNVS(devEUI, session);
+
+  uint8_t eui[8];
+  keyToDevEUI(key, eui);
+  sessionStoreSetLastSeen(eui, millis());  // a new session starts its idle TTL now
+}
+
+SessionStatus findSession(const uint8_t* devEUI, SessionInfo*& session) {
+  uint64_t key = devEUIToKey(devEUI);
+  SessionEntry* entry = findEntry(key);
+  if (entry) {
+    if (isExpired(*entry)) {
+      cacheStats.expired++;
+      session = nullptr;
+      flushSessionFor(devEUIToString(devEUI));  // device has to rejoin
+      return SESSION_EXPIRED;
+    }
+    cacheStats.hits++;
+    touchEntry(*entry);
+    session = &entry->info;
+    return SESSION_OK;
+  }
+
+  // Evicted sessions keep their lastSeen in the store's directory; an idle
+  // one expires here, before it is read back or counts as used
+  uint32_t lastSeen;
+  if (sessionStoreLastSeen(devEUI, lastSeen) && idleTooLong(lastSeen)) {
+    cacheStats.expired++;
+    session = nullptr;
+    flushSessionFor(devEUIToString(devEUI));  // device has to rejoin
+    return SESSION_EXPIRED;
+  }
+
+  // The store's directory is in RAM, so unknown devices never reach NVS here
+  SessionInfo loaded;
+  if (!sessionStoreGet(devEUI, loaded)) {
+    Serial.println("[WARN] Session not found for: " + devEUIToString(devEUI));
+    session = nullptr;
+    return SESSION_NOT_FOUND;
+  }
+
+  String devEUIString = devEUIToString(devEUI);
+  Serial.println("[INFO] Session loaded from NVS: " + devEUIString);
+  cacheStats.reloads++;
+  entry = insertEntry(key);  // cache in RAM, may evict the LRU session
+  if (!entry) {
+    Serial.println("[WARN] Session table full, cannot cache: " + devEUIString);
+    session = nullptr;
+    return SESSION_NOT_FOUND;
+  }
+  memcpy(loaded.devEUI, devEUI, 8);
+  setEntryInfo(*entry, loaded);
+  touchEntry(*entry);
+  session = &entry->info;
+  return SESSION_OK;
+}
+
+SessionStatus findSessionByAddr(uint32_t devAddr, SessionInfo*& session) {
+  uint8_t eui[8];
+  SessionEntry* entry = findEntryByAddr(devAddr);
+  if (entry) {
+    memcpy(eui, entry->info.devEUI, 8);
+    return findSession(eui, session);  // expiry, LRU and stats as usual
+  }
+
+  // Evicted from RAM: the store's directory knows which DevEUI to reload
+  if (!sessionStoreFindAddr(devAddr, eui)) {
+    session = nullptr;
+    return SESSION_NOT_FOUND;
+  }
+  SessionStatus status = findSession(eui, session);
+  if (status == SESSION_OK && session->devAddr != devAddr) {
+    session = nullptr;  // directory hint was stale
+    return SESSION_NOT_FOUND;
   }
-  preferences.getBytes(key.c_str(), encrypted, 32);
-  preferences.end();
-  decryptSession(encrypted, session);
+  return status;
+}
+
+bool sessionAddrKnown(uint32_t devAddr) {
+  uint8_t eui[8];
+  return findEntryByAddr(devAddr) != nullptr || sessionStoreFindAddr(devAddr, eui);
+}
+
+bool sessionKnown(const uint8_t* devEUI) {
+  return findEntry(devEUIToKey(devEUI)) != nullptr || sessionStoreContains(devEUI);
+}
+
+bool sessionCached(const uint8_t* devEUI, uint8_t* devNonce) {
+  SessionEntry* entry = findEntry(devEUIToKey(devEUI));
+  if (!entry) return false;
+  if (devNonce) memcpy(devNonce, entry->info.devNonce, 2);
   return true;
 }
 
+// ────── Frame Counters ──────
+// fcntUp/fcntDown hold the next counter of each direction: the next one to
+// send on the sending side, highest received + 1 on the receiving side. The
+// record only holds checkpoints. A sender checkpoints ahead of itself and
+// writes it through before using any counter past the old one, so the resume
+// value is always above every counter used. A receiver checkpoints what it
+// has seen (write-behind is fine, a stale value only lags). Both resume from
+// the checkpoint after a reboot.
+//
+// The receiving side also keeps a bitmap of the FCNT_REPLAY_WINDOW counters
+// below `next` (RAM only). A receiver checkpoint lags by less than
+// FCNT_CHECKPOINT_INTERVAL frames, so after a gateway reboot only that many
+// old counters could be accepted once more; the sender skips ahead past its
+// own checkpoint, so its fresh frames are never mistaken for replays. An LRU
+// eviction writes the live counters back (evictLRU()), so a reload does not
+// reopen that window.
+
+// false only if the checkpoint could not be staged. A session the store never
+// held (store full) has no checkpoint that could go stale, so that is fine.
+static bool persistCounters(SessionEntry& entry) {
+  SessionInfo record = entry.info;
+  record.fcntUp = entry.fcntUpSaved;
+  record.fcntDown = entry.fcntDownSaved;
+  return sessionStorePut(record) || !sessionStoreContains(entry.info.devEUI);
+}
 
+bool sessionNextTxCounter(const SessionInfo& session, uint8_t direction, uint32_t& fcnt) {
+  SessionEntry* entry = findEntry(devEUIToKey(session.devEUI));
+  if (!entry) return false;
+
+  uint32_t& next = (direction == FRAME_DIR_UP) ? entry->info.fcntUp : entry->info.fcntDown;
+  uint32_t& saved = (direction == FRAME_DIR_UP) ? entry->fcntUpSaved : entry->fcntDownSaved;
+  if (next >= saved) {
+    // Must be durable before the frame goes out; otherwise refuse the frame
+    // and try again on the next one
+    uint32_t previous = saved;
+    saved = next + FCNT_CHECKPOINT_INTERVAL;
+    if (!persistCounters(*entry) || !sessionStoreFlush()) {
+      saved = previous;
+      Serial.println("[NVS] Counter checkpoint not written, frame refused");
+      return false;
+    }
+  }
+  fcnt = next++;
+  return true;
+}
 
-void storeSessionFor(String devEUI, const SessionInfo& session) {
-  sessionMap[devEUI] = session;
-  Serial.println("[MEM] Session cached in memory for device: " + devEUI);
-  saveSessionToNVS(devEUI, session);
+SessionStatus sessionCounterCheck(const SessionInfo& session, uint8_t direction, uint32_t fcnt) {
+  SessionEntry* entry = findEntry(devEUIToKey(session.devEUI));
+  if (!entry) return SESSION_NOT_FOUND;
+
+  uint32_t next = (direction == FRAME_DIR_UP) ? entry->info.fcntUp : entry->info.fcntDown;
+  uint32_t window = (direction == FRAME_DIR_UP) ? entry->replayUp : entry->replayDown;
+  if (fcnt >= next) return SESSION_OK;
+
+  uint32_t behind = next - 1 - fcnt;
+  if (behind < FCNT_REPLAY_WINDOW && !(window & (1UL << behind))) return SESSION_OK;
+
+  cacheStats.replays++;
+  return SESSION_REPLAY;
 }
 
-bool getSessionFor(String devEUI, SessionInfo& session) {
-  if (sessionMap.find(devEUI) != sessionMap.end()) {
-    session = sessionMap[devEUI];
-    Serial.println("[INFO] Session found in RAM for: " + devEUI);
-    return true;
+void sessionCounterReceived(const SessionInfo& session, uint8_t direction, uint32_t fcnt) {
+  SessionEntry* entry = findEntry(devEUIToKey(session.devEUI));
+  if (!entry) return;
+
+  uint32_t& next = (direction == FRAME_DIR_UP) ? entry->info.fcntUp : entry->info.fcntDown;
+  uint32_t& saved = (direction == FRAME_DIR_UP) ? entry->fcntUpSaved : entry->fcntDownSaved;
+  uint32_t& window = (direction == FRAME_DIR_UP) ? entry->replayUp : entry->replayDown;
+  if (fcnt < next) {
+    uint32_t behind = next - 1 - fcnt;
+    if (behind < FCNT_REPLAY_WINDOW) window |= 1UL << behind;
+    return;
   }
 
-  Serial.println("[INFO] Session not found in RAM, trying NVS...");
-  if (loadSessionFromNVS(devEUI, session)) {
-    Serial.println("[INFO] Session loaded from NVS");
-    sessionMap[devEUI] = session;  // cache in RAM
-    return true;
+  uint32_t shift = fcnt - next + 1;
+  window = (shift >= 32) ? 1 : ((window << shift) | 1);
+  next = fcnt + 1;
+  if (next - saved >= FCNT_CHECKPOINT_INTERVAL) {
+    saved = next;
+    persistCounters(*entry);
   }
+}
 
-  Serial.println("[WARN] Session not found in RAM or NVS for:" + devEUI);
-  return false;
+bool getSessionFor(String devEUI, SessionInfo& session) {
+  uint8_t eui[8];
+  keyToDevEUI(hexToKey(devEUI), eui);
+
+  SessionInfo* found = nullptr;
+  if (findSession(eui, found) != SESSION_OK) {
+    return false;
+  }
+  session = *found;
+  return true;
 }
 
 bool sessionExists(const String& devEUI) {
-  return sessionMap.find(devEUI) != sessionMap.end();
+  SessionEntry* entry = findEntry(hexToKey(devEUI));
+  return entry != nullptr && !isExpired(*entry);
 }
+
 SessionStatus verifySession(const String& srcID, SessionInfo& session) {
-  if (!getSessionFor(srcID, session)) {
-    return SESSION_NOT_FOUND;
+  uint8_t eui[8];
+  keyToDevEUI(hexToKey(srcID), eui);
+  return verifySession(eui, session);
+}
+
+SessionStatus verifySession(const uint8_t* srcID, SessionInfo& session) {
+  SessionInfo* found = nullptr;
+  SessionStatus status = findSession(srcID, found);
+  if (status == SESSION_OK) {
+    session = *found;
   }
-  return SESSION_OK;
+  return status;
 }
 
 SessionStatus verifyHmac(uint8_t* buffer, size_t length, uint8_t* receivedHMAC) {
@@ -172,13 +717,11 @@ SessionStatus verifyHmac(uint8_t* buffer, size_t length, uint8_t* receivedHMAC)
 
 void flushAllSessions() {
   // Clear RAM cache
-  sessionMap.clear();
+  clearSessionTable();
   Serial.println("[MEM] All sessions cleared from RAM.");
 
-  // Clear NVS stored sessions
-  preferences.begin("lora", false);
-  preferences.clear();  // wipes all keys in the 'lora' namespace
-  preferences.end();
+  // Clear persisted sessions
+  sessionStoreClear();
 
   Serial.println("[NVS] All sessions cleared from NVS.");
 }
\ No newline at end of file
@@ -4,7 +4,8 @@
 #include <Arduino.h>
 #include "Gateway.h"
 #include <Preferences.h>
-#include <map>
+#include "mbedtls/aes.h"
+#include "SessionInfo.h"
 
 // ─────────────────────────────────────────────
 // Utilities
@@ -53,28 +54,77 @@ String idToHexString(uint8_t* id, size_t len = 8);
  */
 size_t trimTrailingZeros(const uint8_t* data, size_t len);
 
+/**
+ * @brief Pre-expanded AES-128 encryption contexts for one session.
+ *
+ * Runtime sidecar to SessionInfo: built once per session and reused for every
+ * packet instead of running mbedtls_aes_setkey_enc() per call. CTR mode only
+ * ever needs the encryption schedule, for both directions.
+ * Must not be copied by value once initialized.
+ */
+struct SessionCrypto {
+    mbedtls_aes_context appSKeyCtx;   ///< Expanded appSKey
+    mbedtls_aes_context nwkSKeyCtx;   ///< Expanded nwkSKey
+    uint8_t appSKey[16];              ///< Key appSKeyCtx was expanded from
+    uint8_t nwkSKey[16];              ///< Key nwkSKeyCtx was expanded from
+    bool ready;                       ///< Contexts are initialized
+};
+
 // ─────────────────────────────────────────────
-// SessionInfo Structure
+// Session Table
 // ─────────────────────────────────────────────
 
+// Maximum number of sessions held in RAM. Storage is static, nothing is
+// allocated per session. Override with a build flag, e.g.
+// -DSESSION_TABLE_CAPACITY=256 in platformio.ini build_flags.
+#ifndef SESSION_TABLE_CAPACITY
+#define SESSION_TABLE_CAPACITY 64
+#endif
+
+/**
+ * @brief One slot of the in-memory session table.
+ *
+ * Slots never move, so pointers returned by findSession() stay valid until
+ * the session is flushed.
+ */
+struct SessionEntry {
+    uint64_t key;               ///< DevEUI packed big-endian into 64 bits
+    SessionInfo info;           ///< Session data
+    SessionCrypto crypto;       ///< Cached key schedules for info
+    uint32_t lastSeen;          ///< millis() of the last lookup/store
+    uint32_t fcntUpSaved;       ///< fcntUp as held by the persisted record
+    uint32_t fcntDownSaved;     ///< fcntDown as held by the persisted record
+    uint32_t replayUp;          ///< Bit i set: uplink counter fcntUp - 1 - i was received
+    uint32_t replayDown;        ///< Bit i set: downlink counter fcntDown - 1 - i was received
+    uint16_t lruPrev;           ///< More recently used slot
+    uint16_t lruNext;           ///< Less recently used slot
+    bool used;                  ///< Slot holds a session
+};
+
+/**
+ * @brief Result of a startup preload.
+ */
+struct SessionPreloadStats {
+    uint32_t loaded;            ///< Sessions placed in RAM with key schedules built
+    uint32_t skipped;           ///< Persisted sessions left in NVS (cache limit reached)
+    uint32_t elapsedMicros;     ///< Warm-up time
+};
+
 /**
- * @brief Holds cryptographic and identity info for a LoRa session.
+ * @brief Session cache counters.
  */
-struct SessionInfo {
-    uint32_t devAddr;           ///< Unique device address
-    uint8_t devEUI[8];          ///< Device's EUI (64-bit)
-    uint8_t appSKey[16];        ///< Application session key
-    uint8_t nwkSKey[16];        ///< Network session key
-    uint8_t joinNonce[3];       ///< Join nonce from server
-    uint8_t netID[3];           ///< Network ID
-    uint8_t devNonce[2];        ///< Device join nonce
+struct SessionCacheStats {
+    uint32_t hits;              ///< Lookups served from RAM
+    uint32_t reloads;           ///< Sessions reloaded from NVS on demand
+    uint32_t evictions;         ///< Least-recently-used sessions dropped from RAM
+    uint32_t expired;           ///< Sessions that exceeded the idle TTL
+    uint32_t replays;           ///< Frames dropped by the replay window before the HMAC
 };
 
 // ─────────────────────────────────────────────
 // Globals
 // ─────────────────────────────────────────────
 
-extern std::map<String, SessionInfo> sessionMap;
 extern Preferences preferences;
 
 enum SessionStatus {
@@ -82,7 +132,8 @@ enum SessionStatus {
     SESSION_NOT_FOUND,
     SESSION_INVALID_HMAC,
     SESSION_EXPIRED,
-    SESSION_CORRUPTED
+    SESSION_CORRUPTED,
+    SESSION_REPLAY
 };
 
 // ─────────────────────────────────────────────
@@ -105,6 +156,9 @@ void deriveSessionKey(uint8_t* outKey, uint8_t keyType, const uint8_t* appKey,
 /**
  * @brief Saves a session to NVS (non-volatile storage).
  *
+ * The write is staged and committed by the session store's write-behind
+ * flush (see SessionStore.h); call sessionStoreFlush() to force it.
+ *
  * @param devEUI String version of device EUI
  * @param session SessionInfo struct to save
  */
@@ -153,6 +207,114 @@ bool sessionExists(const String& devEUI);
  */
 SessionStatus verifySession(const String& srcID, SessionInfo& session);
 
+/**
+ * @brief Verifies a session using the raw 8-byte device EUI.
+ *
+ * @param srcID Pointer to the 8-byte DevEUI (e.g. PacketView::srcID)
+ * @param session Reference to session
+ * @return SessionStatus enum
+ */
+SessionStatus verifySession(const uint8_t* srcID, SessionInfo& session);
+
+/**
+ * @brief Looks up a session by raw DevEUI without copying it.
+ *
+ * Checks RAM first and falls back to NVS. No String is built and nothing
+ * is allocated on the RAM path.
+ *
+ * @param devEUI Pointer to the 8-byte DevEUI
+ * @param session Set to the session inside the table, or nullptr
+ * @return SESSION_OK, SESSION_NOT_FOUND or SESSION_EXPIRED
+ */
+SessionStatus findSession(const uint8_t* devEUI, SessionInfo*& session);
+
+/**
+ * @brief Looks up a session by the devAddr assigned at join.
+ *
+ * RAM sessions are found through a second hash index (O(1)); sessions only
+ * held in NVS are located through the store's directory and reloaded.
+ *
+ * @param devAddr Device address from a compact frame header
+ * @param session Set to the session inside the table, or nullptr
+ * @return SESSION_OK, SESSION_NOT_FOUND or SESSION_EXPIRED
+ */
+SessionStatus findSessionByAddr(uint32_t devAddr, SessionInfo*& session);
+
+/**
+ * @brief true if some session (in RAM or NVS) owns `devAddr`. Loads nothing.
+ */
+bool sessionAddrKnown(uint32_t devAddr);
+
+/**
+ * @brief true if some session (in RAM or NVS) belongs to `devEUI`. Loads nothing.
+ */
+bool sessionKnown(const uint8_t* devEUI);
+
+/**
+ * @brief true if the session of `devEUI` is held in RAM.
+ *
+ * Never touches the store and does not count as a use: LRU order and TTL are
+ * left alone.
+ *
+ * @param devEUI Pointer to the 8-byte DevEUI
+ * @param devNonce If not nullptr, receives the 2-byte DevNonce of the join
+ *        that created the session
+ */
+bool sessionCached(const uint8_t* devEUI, uint8_t* devNonce = nullptr);
+
+/**
+ * @brief Packs an 8-byte DevEUI into the 64-bit table key.
+ *
+ * @param devEUI Pointer to the 8-byte DevEUI
+ * @return Big-endian 64-bit value
+ */
+uint64_t devEUIToKey(const uint8_t* devEUI);
+
+/**
+ * @brief Number of sessions currently held in RAM.
+ */
+size_t sessionCount();
+
+/**
+ * @brief Limits how many sessions are kept in RAM.
+ *
+ * When the limit is reached the least-recently-used session is evicted from
+ * RAM; its persisted copy is reloaded from NVS on the next packet. Values
+ * above SESSION_TABLE_CAPACITY are clamped.
+ *
+ * @param maxEntries Entry budget (default SESSION_TABLE_CAPACITY)
+ */
+void setSessionCacheLimit(size_t maxEntries);
+
+/**
+ * @brief Sets the idle time after which a session reports SESSION_EXPIRED.
+ *
+ * Idle time is measured from the last lookup. An evicted session keeps its
+ * last-seen time in the session store's directory and is checked before it
+ * is reloaded. After a reboot, idle time counts from the directory load.
+ * Expired sessions are removed from RAM and NVS, the device has to rejoin.
+ *
+ * @param ttlMillis Idle timeout in milliseconds, 0 disables expiry (default)
+ */
+void setSessionTTL(uint32_t ttlMillis);
+
+/**
+ * @brief Returns the session cache counters.
+ */
+SessionCacheStats getSessionCacheStats();
+
+/**
+ * @brief Loads every persisted session into RAM in one sequential scan.
+ *
+ * Call once in setup() instead of flushAllSessions(). Each session is
+ * decrypted, cached and gets its AES key schedules built, so steady-state
+ * lookups never touch NVS. Sessions beyond the cache limit stay in NVS and
+ * are loaded on demand. The warm-up time is printed and returned.
+ *
+ * @return Loaded/skipped counts and elapsed time
+ */
+SessionPreloadStats preloadSessions();
+
 /**
  * @brief Verifies an HMAC against session keys.
  *
@@ -163,6 +325,80 @@ SessionStatus verifySession(const String& srcID, SessionInfo& session);
  */
 SessionStatus verifyHmac(uint8_t* buffer, size_t length, uint8_t* receivedHMAC);
 
+/**
+ * @brief Returns the cached AES key schedules for a session.
+ *
+ * The contexts are expanded the first time a session is seen and rebuilt only
+ * when its keys change (e.g. after a rejoin).
+ *
+ * @param session Session whose appSKey/nwkSKey should be used
+ * @return Reference to the session's runtime crypto sidecar
+ */
+SessionCrypto& sessionCryptoFor(const SessionInfo& session);
+
+// ─────────────────────────────────────────────
+// Frame Counters
+// ─────────────────────────────────────────────
+
+#define FRAME_DIR_UP   0        // Device → gateway, counted by fcntUp
+#define FRAME_DIR_DOWN 1        // Gateway → device, counted by fcntDown
+
+// Counters are persisted with the session only every this many frames.
+// After a reboot the sending side resumes at the last checkpoint, which is
+// always ahead of every counter it used, so no CTR nonce is ever repeated.
+#ifndef FCNT_CHECKPOINT_INTERVAL
+#define FCNT_CHECKPOINT_INTERVAL 64
+#endif
+
+// Received counters this far below the highest one are still accepted once
+// (out-of-order delivery); older ones and repeats are dropped. At most 32.
+#ifndef FCNT_REPLAY_WINDOW
+#define FCNT_REPLAY_WINDOW 32
+#endif
+
+#if FCNT_REPLAY_WINDOW < 1 || FCNT_REPLAY_WINDOW > 32
+#error "FCNT_REPLAY_WINDOW must be between 1 and 32"
+#endif
+
+/**
+ * @brief Takes the next frame counter for a frame this node sends.
+ *
+ * Written through to the session store when the counter reaches its
+ * checkpoint (one record write per FCNT_CHECKPOINT_INTERVAL frames). If that
+ * write fails the counter is not taken and the frame must not be sent.
+ *
+ * @param session Session in the table (matched by devEUI)
+ * @param direction FRAME_DIR_UP on the device, FRAME_DIR_DOWN on the gateway
+ * @param fcnt Receives the counter to use
+ * @return false if the session is not in the table or the checkpoint could
+ *         not be written
+ */
+bool sessionNextTxCounter(const SessionInfo& session, uint8_t direction, uint32_t& fcnt);
+
+/**
+ * @brief Checks a received counter against the replay window, without any crypto.
+ *
+ * Call before the HMAC so duplicates and replays cost a table lookup and a
+ * bit test. Counters at or above the next expected one always pass.
+ *
+ * @param session Session in the table (matched by devEUI)
+ * @param direction Direction of the received frame
+ * @param fcnt Full 32-bit counter of the frame
+ * @return SESSION_OK, or SESSION_REPLAY for a repeated or too old counter
+ */
+SessionStatus sessionCounterCheck(const SessionInfo& session, uint8_t direction, uint32_t fcnt);
+
+/**
+ * @brief Records the counter of an authenticated received frame.
+ *
+ * Advances the next expected counter and marks the counter in the replay window.
+ *
+ * @param session Session in the table (matched by devEUI)
+ * @param direction Direction of the received frame
+ * @param fcnt Full 32-bit counter of the frame
+ */
+void sessionCounterReceived(const SessionInfo& session, uint8_t direction, uint32_t fcnt);
+
 /**
  * @brief Removes a session from memory and storage.
  *
@@ -0,0 +1,383 @@
+#include "StreamReassembly.h"
+#include "Fec.h"
+#include "Lz.h"
+
+#include <string.h>
+
+// ────── Slot Pool ──────
+// Every slot owns a fixed buffer from the pool, so reassembly never allocates.
+// Buffers hold whole chunks so a short last chunk can be zero-padded for FEC.
+// Completed streams are remembered in a small ring so late retransmissions of
+// their chunks are recognized as duplicates instead of opening a new slot.
+
+struct StreamSlot {
+  uint64_t key;               // Sender DevEUI
+  uint8_t streamId;
+  bool active;
+  uint32_t receivedMask;      // Bit n = chunk n stored
+  int16_t finalSeq;           // -1 until the final chunk arrived
+  size_t length;              // Total length, known once finalSeq is
+  uint32_t lastActivity;      // streamReassemblyMillis() of the last stored chunk
+  uint8_t fecK;               // Source chunks of an FEC stream, 0 = plain stream
+  bool compressed;            // Chunks carry STREAM_FLAG_LZ
+  uint8_t repairCount;        // FEC repair chunks stored
+  uint8_t repairIndex[STREAM_FEC_REPAIR_SLOTS];
+};
+
+struct CompletedStream {
+  uint64_t key;
+  uint8_t streamId;
+  bool valid;
+};
+
+static uint8_t streamPool[STREAM_SLOTS][STREAM_MAX_CHUNKS * STREAM_CHUNK_SIZE];
+static uint8_t repairPool[STREAM_SLOTS][STREAM_FEC_REPAIR_SLOTS][STREAM_CHUNK_SIZE];
+static StreamSlot streamSlots[STREAM_SLOTS];
+static CompletedStream completedRing[STREAM_SLOTS];
+static size_t completedNext = 0;
+static StreamStats streamStats = {};
+static uint8_t inflateBuffer[STREAM_MAX_LEN];   // Original bytes of a compressed stream
+
+static StreamCompleteCallback completeCallback = streamReassemblyDefaultCallback;
+
+// Same key as devEUIToKey() in Sessions.cpp
+static uint64_t streamKey(const uint8_t* devEUI) {
+  uint64_t key = 0;
+  for (int i = 0; i < 8; i++) key = (key << 8) | devEUI[i];
+  return key;
+}
+
+// Bits 0..seq set
+static uint32_t chunksUpTo(int seq) {
+  return (seq >= 31) ? 0xFFFFFFFFUL : ((1UL << (seq + 1)) - 1);
+}
+
+static StreamSlot* findSlot(uint64_t key, uint8_t streamId) {
+  for (size_t i = 0; i < STREAM_SLOTS; i++) {
+    if (streamSlots[i].active && streamSlots[i].key == key && streamSlots[i].streamId == streamId) {
+      return &streamSlots[i];
+    }
+  }
+  return nullptr;
+}
+
+static bool wasCompleted(uint64_t key, uint8_t streamId) {
+  for (size_t i = 0; i < STREAM_SLOTS; i++) {
+    if (completedRing[i].valid && completedRing[i].key == key && completedRing[i].streamId == streamId) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void rememberCompleted(uint64_t key, uint8_t streamId) {
+  completedRing[completedNext].key = key;
+  completedRing[completedNext].streamId = streamId;
+  completedRing[completedNext].valid = true;
+  completedNext = (completedNext + 1) % STREAM_SLOTS;
+}
+
+static StreamSlot* allocateSlot(uint64_t key, uint8_t streamId) {
+  StreamSlot* slot = nullptr;
+  for (size_t i = 0; i < STREAM_SLOTS && !slot; i++) {
+    if (!streamSlots[i].active) slot = &streamSlots[i];
+  }
+  if (!slot) {
+    streamReassemblyLoop();  // reclaim abandoned streams, then retry
+    for (size_t i = 0; i < STREAM_SLOTS && !slot; i++) {
+      if (!streamSlots[i].active) slot = &streamSlots[i];
+    }
+  }
+  if (!slot) return nullptr;
+
+  slot->key = key;
+  slot->streamId = streamId;
+  slot->active = true;
+  slot->receivedMask = 0;
+  slot->finalSeq = -1;
+  slot->length = 0;
+  slot->fecK = 0;
+  slot->compressed = false;
+  slot->repairCount = 0;
+  return slot;
+}
+
+// ────── Chunk Handling ──────
+
+size_t streamChunkHeader(uint8_t* out, uint8_t streamId, uint16_t seq, uint8_t flags) {
+  out[0] = streamId;
+  out[1] = seq & 0xFF;
+  out[2] = (seq >> 8) & 0xFF;
+  out[3] = flags;
+  return STREAM_CHUNK_HEADER_LEN;
+}
+
+size_t streamFecChunkHeader(uint8_t* out, uint8_t streamId, uint16_t seq, uint8_t k, size_t totalLen,
+                            uint8_t flags) {
+  streamChunkHeader(out, streamId, seq, STREAM_FLAG_FEC | flags);
+  out[4] = k;
+  out[5] = totalLen & 0xFF;
+  out[6] = (totalLen >> 8) & 0xFF;
+  return STREAM_FEC_HEADER_LEN;
+}
+
+// Source chunks are full except the last; repair chunks are always full
+static bool validFecChunk(uint16_t seq, uint8_t k, size_t totalLen, size_t dataLength) {
+  if (k == 0 || k > STREAM_MAX_CHUNKS || totalLen == 0 || totalLen > STREAM_MAX_LEN ||
+      (totalLen + STREAM_CHUNK_SIZE - 1) / STREAM_CHUNK_SIZE != k ||
+      seq >= (uint16_t)k + FEC_MAX_REPAIR) {
+    return false;
+  }
+  size_t expected = (seq == k - 1) ? totalLen - (size_t)seq * STREAM_CHUNK_SIZE : STREAM_CHUNK_SIZE;
+  return dataLength == expected;
+}
+
+// Stores a repair chunk; surplus ones are useless since the slot can only
+// rebuild STREAM_FEC_REPAIR_SLOTS missing chunks anyway
+static StreamResult storeRepair(StreamSlot* slot, uint8_t repairIndex, const uint8_t* data) {
+  for (uint8_t i = 0; i < slot->repairCount; i++) {
+    if (slot->repairIndex[i] == repairIndex) {
+      streamStats.duplicates++;
+      return STREAM_DUPLICATE;
+    }
+  }
+  if (slot->repairCount >= STREAM_FEC_REPAIR_SLOTS) {
+    streamStats.duplicates++;
+    return STREAM_DUPLICATE;
+  }
+
+  memcpy(repairPool[slot - streamSlots][slot->repairCount], data, STREAM_CHUNK_SIZE);
+  slot->repairIndex[slot->repairCount++] = repairIndex;
+  slot->lastActivity = streamReassemblyMillis();
+  streamStats.chunks++;
+  return STREAM_CHUNK_STORED;
+}
+
+// Rebuilds the missing source chunks once enough repair chunks are stored
+static bool decodeFecSlot(StreamSlot* slot, uint8_t* buffer) {
+  if ((size_t)__builtin_popcount(slot->receivedMask) + slot->repairCount < slot->fecK) return false;
+
+  size_t index = slot - streamSlots;
+  uint8_t* repair[STREAM_FEC_REPAIR_SLOTS];
+  for (size_t i = 0; i < STREAM_FEC_REPAIR_SLOTS; i++) {
+    repair[i] = repairPool[index][i];
+  }
+
+  int recovered = fecDecode(buffer, STREAM_CHUNK_SIZE, slot->fecK, slot->receivedMask,
+                            repair, slot->repairIndex, slot->repairCount);
+  if (recovered < 0) return false;
+
+  streamReassemblyLog("[STREAM] Stream %u: rebuilt %d chunk(s) from repair data", slot->streamId, recovered);
+  streamStats.fecDecoded++;
+  streamStats.fecRecovered += recovered;
+  slot->repairCount = 0;  // repair buffers now hold scratch data
+  return true;
+}
+
+// Decompresses a completed stream into inflateBuffer
+static bool inflateSlot(const StreamSlot* slot, const uint8_t* buffer, const uint8_t*& data, size_t& length) {
+  uint32_t start = streamReassemblyMicros();
+  size_t inflated = lzDecompress(buffer, slot->length, inflateBuffer, sizeof(inflateBuffer));
+  if (inflated == 0) {
+    streamReassemblyLog("[STREAM] Stream %u: compressed data invalid (%zu bytes, %zu announced), dropped",
+                        slot->streamId, slot->length, lzDecompressedLength(buffer, slot->length));
+    streamStats.inflateFailed++;
+    return false;
+  }
+
+  streamReassemblyLog("[STREAM] Stream %u: inflated %zu -> %zu bytes in %lu us",
+                      slot->streamId, slot->length, inflated,
+                      (unsigned long)(streamReassemblyMicros() - start));
+  streamStats.inflated++;
+  data = inflateBuffer;
+  length = inflated;
+  return true;
+}
+
+StreamResult streamReassemblyPush(const uint8_t* devEUI, const uint8_t* chunk, size_t length) {
+  if (length < STREAM_CHUNK_HEADER_LEN) {
+    streamStats.rejected++;
+    return STREAM_REJECTED;
+  }
+
+  uint8_t streamId = chunk[0];
+  uint16_t seq = chunk[1] | (chunk[2] << 8);
+  bool final = chunk[3] & STREAM_FLAG_FINAL;
+  bool fec = chunk[3] & STREAM_FLAG_FEC;
+  size_t headerLen = fec ? STREAM_FEC_HEADER_LEN : STREAM_CHUNK_HEADER_LEN;
+  if (length < headerLen) {
+    streamStats.rejected++;
+    return STREAM_REJECTED;
+  }
+
+  const uint8_t* data = chunk + headerLen;
+  size_t dataLength = length - headerLen;
+  uint8_t fecK = fec ? chunk[4] : 0;
+  size_t fecLength = fec ? (size_t)(chunk[5] | (chunk[6] << 8)) : 0;
+
+  // Only the final chunk may be short; anything else would leave a gap
+  bool valid = fec ? validFecChunk(seq, fecK, fecLength, dataLength)
+                   : (seq < STREAM_MAX_CHUNKS && dataLength <= STREAM_CHUNK_SIZE &&
+                      (final || dataLength == STREAM_CHUNK_SIZE));
+  if (!valid) {
+    streamReassemblyLog("[STREAM] Rejected chunk %u (%zu bytes)", seq, dataLength);
+    streamStats.rejected++;
+    return STREAM_REJECTED;
+  }
+
+  uint64_t key = streamKey(devEUI);
+  if (wasCompleted(key, streamId)) {
+    streamStats.duplicates++;
+    return STREAM_DUPLICATE;
+  }
+
+  StreamSlot* slot = findSlot(key, streamId);
+  if (!slot) {
+    slot = allocateSlot(key, streamId);
+    if (!slot) {
+      streamReassemblyLog("[STREAM] No free slot, chunk dropped");
+      streamStats.noSlot++;
+      return STREAM_NO_SLOT;
+    }
+    if (fec) {
+      // Every FEC chunk carries the geometry, so any of them opens the slot
+      slot->fecK = fecK;
+      slot->finalSeq = fecK - 1;
+      slot->length = fecLength;
+    }
+  }
+
+  if (fec != (slot->fecK != 0) || (fec && (slot->fecK != fecK || slot->length != fecLength))) {
+    streamStats.rejected++;
+    return STREAM_REJECTED;
+  }
+
+  if (chunk[3] & STREAM_FLAG_LZ) slot->compressed = true;
+
+  uint8_t* buffer = streamPool[slot - streamSlots];
+  if (fec && seq >= fecK) {
+    StreamResult result = storeRepair(slot, seq - fecK, data);
+    if (result != STREAM_CHUNK_STORED) return result;
+  } else {
+    uint32_t bit = 1UL << seq;
+    if (slot->receivedMask & bit) {
+      streamStats.duplicates++;
+      return STREAM_DUPLICATE;
+    }
+    if (slot->finalSeq >= 0 && seq > slot->finalSeq) {
+      streamStats.rejected++;
+      return STREAM_REJECTED;
+    }
+
+    uint8_t* dest = buffer + (size_t)seq * STREAM_CHUNK_SIZE;
+    memcpy(dest, data, dataLength);
+    memset(dest + dataLength, 0, STREAM_CHUNK_SIZE - dataLength);
+    slot->receivedMask |= bit;
+    slot->lastActivity = streamReassemblyMillis();
+    streamStats.chunks++;
+
+    if (final && !fec) {
+      slot->finalSeq = seq;
+      slot->length = (size_t)seq * STREAM_CHUNK_SIZE + dataLength;
+      // Chunks stored beyond the final one (sender bug or a stale stream id)
+      // can never be part of this stream; drop them so it can still complete
+      uint32_t beyond = slot->receivedMask & ~chunksUpTo(seq);
+      if (beyond) {
+        streamReassemblyLog("[STREAM] Stream %u: dropped %d chunk(s) beyond final chunk %u",
+                            streamId, __builtin_popcount(beyond), seq);
+        streamStats.rejected += __builtin_popcount(beyond);
+        slot->receivedMask &= ~beyond;
+      }
+    }
+  }
+
+  // Checked after every stored chunk, so the order in which the final chunk
+  // and the rest arrive does not matter
+  if (slot->finalSeq < 0) return STREAM_CHUNK_STORED;
+  uint32_t expected = chunksUpTo(slot->finalSeq);
+  if ((slot->receivedMask & expected) != expected) {
+    if (!slot->fecK || !decodeFecSlot(slot, buffer)) return STREAM_CHUNK_STORED;
+    slot->receivedMask = expected;
+  }
+
+  // Complete: hand out the contiguous buffer, then release the slot
+  slot->active = false;
+  rememberCompleted(key, streamId);
+  streamStats.completed++;
+
+  const uint8_t* stream = buffer;
+  size_t streamLength = slot->length;
+  if (slot->compressed && !inflateSlot(slot, buffer, stream, streamLength)) return STREAM_COMPLETE;
+  if (completeCallback) completeCallback(devEUI, streamId, stream, streamLength);
+  return STREAM_COMPLETE;
+}
+
+// ────── Selective-Repeat ACKs ──────
+
+bool streamAckFor(const uint8_t* devEUI, const uint8_t* chunk, size_t length, StreamAck& ack) {
+  if (length < STREAM_CHUNK_HEADER_LEN || !(chunk[3] & STREAM_FLAG_ACK_REQ)) return false;
+
+  uint8_t streamId = chunk[0];
+  uint16_t seq = chunk[1] | (chunk[2] << 8);
+  if (seq >= STREAM_MAX_CHUNKS) seq = STREAM_MAX_CHUNKS - 1;
+  uint32_t upTo = chunksUpTo(seq);
+
+  uint64_t key = streamKey(devEUI);
+  ack.streamId = streamId;
+  ack.complete = wasCompleted(key, streamId);
+  ack.missingMask = 0;
+  if (ack.complete) return true;
+
+  StreamSlot* slot = findSlot(key, streamId);
+  ack.missingMask = upTo & ~(slot ? slot->receivedMask : 0);
+  return true;
+}
+
+size_t streamAckEncode(uint8_t* out, const StreamAck& ack) {
+  out[0] = ack.streamId;
+  out[1] = ack.complete ? STREAM_ACK_COMPLETE : 0;
+  out[2] = ack.missingMask & 0xFF;
+  out[3] = (ack.missingMask >> 8) & 0xFF;
+  out[4] = (ack.missingMask >> 16) & 0xFF;
+  out[5] = (ack.missingMask >> 24) & 0xFF;
+  return STREAM_ACK_LEN;
+}
+
+bool streamAckDecode(const uint8_t* value, size_t length, StreamAck& ack) {
+  if (length < STREAM_ACK_LEN) return false;
+  ack.streamId = value[0];
+  ack.complete = value[1] & STREAM_ACK_COMPLETE;
+  ack.missingMask = (uint32_t)value[2] | ((uint32_t)value[3] << 8) |
+                    ((uint32_t)value[4] << 16) | ((uint32_t)value[5] << 24);
+  return true;
+}
+
+// ────── Housekeeping ──────
+
+void setStreamCompleteCallback(StreamCompleteCallback callback) {
+  completeCallback = callback;
+}
+
+void streamReassemblyLoop() {
+  uint32_t now = streamReassemblyMillis();
+  for (size_t i = 0; i < STREAM_SLOTS; i++) {
+    StreamSlot& slot = streamSlots[i];
+    if (slot.active && now - slot.lastActivity > STREAM_TIMEOUT_MS) {
+      streamReassemblyLog("[STREAM] Stream %u timed out, slot reclaimed", slot.streamId);
+      slot.active = false;
+      streamStats.timedOut++;
+    }
+  }
+}
+
+size_t streamSlotsInUse() {
+  size_t count = 0;
+  for (size_t i = 0; i < STREAM_SLOTS; i++) {
+    if (streamSlots[i].active) count++;
+  }
+  return count;
+}
+
+StreamStats getStreamStats() {
+  return streamStats;
+}
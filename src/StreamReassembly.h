@@ -0,0 +1,286 @@
+#ifndef STREAM_REASSEMBLY_H
+#define STREAM_REASSEMBLY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SessionInfo.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Stream Reassembly
+ *
+ * Streams (e.g. group files) are sent as TYPE_STREAM records, one chunk per
+ * packet. Every chunk value starts with a small header:
+ *
+ *   [stream id 1][sequence 2, little-endian][flags 1][chunk data]
+ *
+ * All chunks except the final one carry exactly STREAM_CHUNK_SIZE data bytes,
+ * so chunk `seq` lands at offset seq * STREAM_CHUNK_SIZE and chunks may arrive
+ * in any order. The chunk flagged STREAM_FLAG_FINAL fixes the total length.
+ *
+ * The gateway keeps one slot per (device, stream id). Buffers come from a
+ * preallocated pool, abandoned slots are reclaimed after STREAM_TIMEOUT_MS.
+ *
+ * Reliable streams (selective repeat): the sender sets STREAM_FLAG_ACK_REQ on
+ * the last chunk of each window. The gateway answers with a TYPE_STREAM_ACK
+ * record holding the bitmap of chunks still missing up to that chunk, and the
+ * sender retransmits only those:
+ *
+ *   [stream id 1][flags 1][missing bitmap 4, little-endian]
+ *
+ * FEC streams (one-way links): chunks flagged STREAM_FLAG_FEC extend the header
+ * with the source chunk count K and the stream length,
+ *
+ *   [stream id 1][sequence 2][flags 1][K 1][length 2, little-endian][chunk data]
+ *
+ * Sequences 0..K-1 are the source chunks, K+r is repair chunk r (see Fec.h).
+ * Any K distinct chunks rebuild the stream, so no ACKs are needed.
+ *
+ * Compressed streams: chunks flagged STREAM_FLAG_LZ carry LZSS-compressed data
+ * (Lz.h). The gateway decompresses the stream once it is complete, so the
+ * callback always gets the original bytes (at most STREAM_MAX_LEN).
+ *
+ * StreamReassembly.cpp depends only on the C library (plus Fec and Lz), so it
+ * also builds on a host. millis(), Serial, the default callback and the ACK
+ * radio path live in StreamReassemblyArduino.cpp (see Platform Hooks below).
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Data bytes per chunk; sender and gateway must agree.
+#ifndef STREAM_CHUNK_SIZE
+#define STREAM_CHUNK_SIZE 200
+#endif
+
+// Concurrent streams the gateway reassembles. Build flag override, e.g. -DSTREAM_SLOTS=8.
+#ifndef STREAM_SLOTS
+#define STREAM_SLOTS 4
+#endif
+
+// Largest stream that fits a slot (pool RAM = STREAM_SLOTS x STREAM_MAX_LEN).
+#ifndef STREAM_MAX_LEN
+#define STREAM_MAX_LEN 2048
+#endif
+
+// Idle time after which an incomplete stream is discarded.
+#ifndef STREAM_TIMEOUT_MS
+#define STREAM_TIMEOUT_MS 30000
+#endif
+
+// Chunks in flight before the sender asks for an ACK.
+#ifndef STREAM_ARQ_WINDOW
+#define STREAM_ARQ_WINDOW 4
+#endif
+
+// How long the sender waits for an ACK before probing again.
+#ifndef STREAM_ARQ_ACK_TIMEOUT_MS
+#define STREAM_ARQ_ACK_TIMEOUT_MS 2000
+#endif
+
+// Consecutive rounds without progress before a transfer is abandoned.
+#ifndef STREAM_ARQ_MAX_ROUNDS
+#define STREAM_ARQ_MAX_ROUNDS 6
+#endif
+
+// Repair chunks the gateway keeps per FEC stream, i.e. the most source chunks
+// it can rebuild (pool RAM = STREAM_SLOTS x this x STREAM_CHUNK_SIZE).
+#ifndef STREAM_FEC_REPAIR_SLOTS
+#define STREAM_FEC_REPAIR_SLOTS 4
+#endif
+
+#define STREAM_CHUNK_HEADER_LEN 4
+#define STREAM_FEC_HEADER_LEN 7
+#define STREAM_FLAG_FINAL 0x01
+#define STREAM_FLAG_ACK_REQ 0x02
+#define STREAM_FLAG_FEC 0x04
+#define STREAM_FLAG_LZ 0x08
+#define STREAM_ACK_LEN 6
+#define STREAM_ACK_COMPLETE 0x01
+#define STREAM_MAX_CHUNKS ((STREAM_MAX_LEN + STREAM_CHUNK_SIZE - 1) / STREAM_CHUNK_SIZE)
+
+#if STREAM_MAX_CHUNKS > 32
+#error "STREAM_MAX_LEN / STREAM_CHUNK_SIZE must not exceed 32 chunks"
+#endif
+
+/**
+ * @brief Outcome of feeding one chunk to the reassembler.
+ */
+enum StreamResult {
+    STREAM_CHUNK_STORED,    ///< Chunk stored, stream still incomplete
+    STREAM_COMPLETE,        ///< Last missing chunk arrived, callback ran
+    STREAM_DUPLICATE,       ///< Chunk (or whole stream) already received
+    STREAM_REJECTED,        ///< Malformed header or stream too large
+    STREAM_NO_SLOT          ///< All slots busy with other streams
+};
+
+/**
+ * @brief Receiver state for one stream, as carried by a TYPE_STREAM_ACK record.
+ */
+struct StreamAck {
+    uint8_t streamId;       ///< Stream being acknowledged
+    bool complete;          ///< All chunks received
+    uint32_t missingMask;   ///< Bit n = chunk n still missing (up to the requesting chunk)
+};
+
+/**
+ * @brief Per-transfer statistics of a reliable stream (sender side).
+ */
+struct StreamTransferStats {
+    uint8_t streamId;           ///< Stream id used
+    uint16_t chunks;            ///< Distinct chunks in the stream
+    uint16_t transmissions;     ///< Chunk transmissions including retransmissions
+    uint16_t retransmissions;   ///< Chunks sent more than once
+    uint16_t ackRounds;         ///< ACKs received
+    uint16_t ackTimeouts;       ///< Windows that got no ACK in time
+    uint16_t repairChunks;      ///< FEC repair chunks sent
+    size_t bytes;               ///< Stream length
+    uint32_t elapsedMs;         ///< Time from first chunk to completion/abort
+    float goodputBps;           ///< Stream bytes per second of elapsedMs
+    bool complete;              ///< Receiver confirmed every chunk
+};
+
+/**
+ * @brief Reassembly counters.
+ */
+struct StreamStats {
+    uint32_t chunks;        ///< Chunks stored
+    uint32_t completed;     ///< Streams delivered to the callback
+    uint32_t duplicates;    ///< Chunks received more than once
+    uint32_t rejected;      ///< Malformed or oversized chunks
+    uint32_t noSlot;        ///< Chunks dropped because every slot was busy
+    uint32_t timedOut;      ///< Incomplete streams reclaimed after the timeout
+    uint32_t fecDecoded;    ///< FEC streams that needed repair chunks
+    uint32_t fecRecovered;  ///< Source chunks rebuilt from repair chunks
+    uint32_t inflated;      ///< Compressed streams decompressed
+    uint32_t inflateFailed; ///< Compressed streams that did not decompress
+};
+
+/**
+ * @brief Called once per completed stream.
+ *
+ * @param devEUI Sender DevEUI (8 bytes)
+ * @param streamId Sender's stream id
+ * @param data Contiguous stream data, valid only during the call
+ * @param length Stream length in bytes
+ */
+typedef void (*StreamCompleteCallback)(const uint8_t* devEUI, uint8_t streamId,
+                                       const uint8_t* data, size_t length);
+
+/**
+ * @brief Writes a chunk header.
+ *
+ * @param out Destination, STREAM_CHUNK_HEADER_LEN bytes
+ * @param streamId Stream id chosen by the sender
+ * @param seq Chunk sequence number (0-based)
+ * @param flags STREAM_FLAG_FINAL, STREAM_FLAG_ACK_REQ and/or STREAM_FLAG_LZ
+ * @return STREAM_CHUNK_HEADER_LEN
+ */
+size_t streamChunkHeader(uint8_t* out, uint8_t streamId, uint16_t seq, uint8_t flags);
+
+/**
+ * @brief Writes the header of an FEC chunk.
+ *
+ * @param out Destination, STREAM_FEC_HEADER_LEN bytes
+ * @param streamId Stream id chosen by the sender
+ * @param seq 0..k-1 for source chunks, k + r for repair chunk r
+ * @param k Number of source chunks
+ * @param totalLen Stream length in bytes
+ * @param flags Extra flags besides STREAM_FLAG_FEC, e.g. STREAM_FLAG_LZ
+ * @return STREAM_FEC_HEADER_LEN
+ */
+size_t streamFecChunkHeader(uint8_t* out, uint8_t streamId, uint16_t seq, uint8_t k, size_t totalLen,
+                            uint8_t flags = 0);
+
+/**
+ * @brief Feeds the value of a TYPE_STREAM record to the reassembler.
+ *
+ * @param devEUI Sender DevEUI (8 bytes)
+ * @param chunk Record value: chunk header + data
+ * @param length Record length
+ * @return What happened to the chunk
+ */
+StreamResult streamReassemblyPush(const uint8_t* devEUI, const uint8_t* chunk, size_t length);
+
+/**
+ * @brief Builds the ACK for a chunk that carries STREAM_FLAG_ACK_REQ.
+ *
+ * Call after streamReassemblyPush() with the same chunk. Streams that were
+ * completed recently report complete; unknown streams report every chunk up
+ * to the requesting one as missing.
+ *
+ * @param devEUI Sender DevEUI (8 bytes)
+ * @param chunk Record value: chunk header + data
+ * @param length Record length
+ * @param ack Filled with the receiver state
+ * @return false if the chunk did not request an ACK
+ */
+bool streamAckFor(const uint8_t* devEUI, const uint8_t* chunk, size_t length, StreamAck& ack);
+
+/**
+ * @brief Sends an ACK to the streaming device (gateway side).
+ *
+ * @param devEUI Device DevEUI (8 bytes), also used as the packet sender ID
+ * @param session The device's session
+ * @param ack Receiver state from streamAckFor()
+ */
+void sendStreamAck(const uint8_t* devEUI, const SessionInfo& session, const StreamAck& ack);
+
+/**
+ * @brief Encodes an ACK record value (STREAM_ACK_LEN bytes).
+ */
+size_t streamAckEncode(uint8_t* out, const StreamAck& ack);
+
+/**
+ * @brief Decodes an ACK record value.
+ *
+ * @return false if the value is too short
+ */
+bool streamAckDecode(const uint8_t* value, size_t length, StreamAck& ack);
+
+/**
+ * @brief Sets the completion callback (default: print a summary to Serial).
+ */
+void setStreamCompleteCallback(StreamCompleteCallback callback);
+
+/**
+ * @brief Reclaims slots idle for longer than STREAM_TIMEOUT_MS. Call from loop().
+ */
+void streamReassemblyLoop();
+
+/**
+ * @brief Number of streams currently being reassembled.
+ */
+size_t streamSlotsInUse();
+
+/**
+ * @brief Returns the reassembly counters.
+ */
+StreamStats getStreamStats();
+
+// ─────────────────────────────────────────────
+// Platform Hooks
+// ─────────────────────────────────────────────
+
+/**
+ * @brief Milliseconds since boot, for the slot timeout.
+ */
+uint32_t streamReassemblyMillis();
+
+/**
+ * @brief Microseconds since boot, for the decompression time in the log.
+ */
+uint32_t streamReassemblyMicros();
+
+/**
+ * @brief Logs one line, printf-style (Serial on the device).
+ */
+void streamReassemblyLog(const char* format, ...);
+
+/**
+ * @brief Completion callback used until setStreamCompleteCallback() is called.
+ *
+ * On the device it prints a summary and the TLV entries of the stream to Serial.
+ */
+void streamReassemblyDefaultCallback(const uint8_t* devEUI, uint8_t streamId,
+                                     const uint8_t* data, size_t length);
+
+#endif // STREAM_REASSEMBLY_H
@@ -0,0 +1,63 @@
+#include "StreamReassembly.h"
+#include "Sessions.h"
+#include "CryptoUtils.h"
+#include "Tlv.h"
+#include "EndDevice.h"
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+// ────── ACK Downlink ──────
+
+void sendStreamAck(const uint8_t* devEUI, const SessionInfo& session, const StreamAck& ack) {
+  uint8_t header[TLV_MAX_FRAME_HEADER];
+  uint8_t value[STREAM_ACK_LEN];
+  DataSegment segments[2] = {
+    { header, tlvFrameHeader(header, TYPE_STREAM_ACK, STREAM_ACK_LEN) },
+    { value, streamAckEncode(value, ack) }
+  };
+
+  uint8_t finalPacket[PACKET_MAX_LEN];
+  size_t finalLen = encryptAndPackage(segments, 2, session, devEUI, finalPacket, sizeof(finalPacket));
+  Serial.printf("[STREAM] ACK stream %u: %s, missing 0x%08lX\n", ack.streamId,
+                ack.complete ? "complete" : "partial", (unsigned long)ack.missingMask);
+  sender(finalPacket, finalLen, TYPE_STREAM_ACK);
+}
+
+// ────── Platform Hooks ──────
+
+uint32_t streamReassemblyMillis() {
+  return millis();
+}
+
+uint32_t streamReassemblyMicros() {
+  return micros();
+}
+
+void streamReassemblyLog(const char* format, ...) {
+  char line[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  Serial.println(line);
+}
+
+// Group files are TLV payloads, so list their entries
+void streamReassemblyDefaultCallback(const uint8_t* devEUI, uint8_t streamId,
+                                     const uint8_t* data, size_t length) {
+  Serial.printf("[STREAM] Stream %u complete from %s: %zu bytes\n",
+                streamId, devEUIToString(devEUI).c_str(), length);
+
+  TlvReader reader;
+  TlvRecord record;
+  tlvBegin(reader, data, length);
+  if (reader.version != TLV_FORMAT_V1) {
+    printHex(data, length, "[STREAM] Data: ");
+    return;
+  }
+  while (tlvNext(reader, record)) {
+    Serial.printf("[STREAM] Entry type 0x%02X, %zu bytes: ", record.type, record.length);
+    printHex(record.value, record.length, "");
+  }
+}
@@ -0,0 +1,180 @@
+#include "Telemetry.h"
+#include "UplinkAggregator.h"
+
+#include <Arduino.h>
+#include <atomic>
+#include <math.h>
+
+// ────── Sample Ring ──────
+// Single producer (telemetrySample, may be an ISR), single consumer
+// (telemetryLoop). head/tail are free-running counters like the RX queue;
+// a full ring drops the newest sample.
+
+struct RawSample {
+  uint8_t channel;
+  float value;
+};
+
+struct ChannelWindow {
+  uint32_t windowMs;          // 0 = not configured, TELEMETRY_WINDOW_MS
+  float deadBand;
+  uint32_t heartbeatMs;
+  uint32_t openedAt;          // millis() of the window's first sample
+  uint16_t count;             // 0 = no window open
+  float min;
+  float max;
+  float sum;
+  float last;
+  bool reported;              // a summary was sent, sentMean is valid
+  float sentMean;
+  uint32_t sentAt;
+};
+
+static RawSample sampleRing[TELEMETRY_RING_SIZE];
+static std::atomic<uint32_t> sampleHead(0);
+static std::atomic<uint32_t> sampleTail(0);
+static volatile uint32_t ringDropped = 0;
+
+static ChannelWindow channels[TELEMETRY_CHANNELS];
+static TelemetryStats telemetryStats = {};
+
+bool telemetryConfigure(uint8_t channel, uint32_t windowMs, float deadBand, uint32_t heartbeatMs) {
+  if (channel >= TELEMETRY_CHANNELS || windowMs == 0) return false;
+  ChannelWindow& window = channels[channel];
+  window.windowMs = windowMs;
+  window.deadBand = deadBand;
+  window.heartbeatMs = heartbeatMs;
+  window.count = 0;
+  window.reported = false;
+  return true;
+}
+
+bool IRAM_ATTR telemetrySample(uint8_t channel, float value) {
+  if (channel >= TELEMETRY_CHANNELS) return false;
+  uint32_t head = sampleHead.load(std::memory_order_relaxed);
+  if (head - sampleTail.load(std::memory_order_acquire) >= TELEMETRY_RING_SIZE) {
+    ringDropped = ringDropped + 1;
+    return false;
+  }
+  sampleRing[head % TELEMETRY_RING_SIZE] = { channel, value };
+  sampleHead.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+// ────── Windows ──────
+
+static void addToWindow(ChannelWindow& window, float value, uint32_t now) {
+  if (window.count == 0) {
+    window.openedAt = now;
+    window.min = window.max = window.sum = value;
+  } else {
+    if (value < window.min) window.min = value;
+    if (value > window.max) window.max = value;
+    window.sum += value;
+  }
+  window.last = value;
+  window.count++;
+  telemetryStats.samples++;
+}
+
+// All samples within the dead band around the mean sent last: nothing new
+static bool insideDeadBand(const ChannelWindow& window, uint32_t now) {
+  if (window.deadBand <= 0 || !window.reported) return false;
+  if (window.heartbeatMs > 0 && now - window.sentAt >= window.heartbeatMs) return false;
+  return window.max - window.sentMean < window.deadBand && window.sentMean - window.min < window.deadBand;
+}
+
+static bool closeWindow(uint8_t channel, uint32_t now) {
+  ChannelWindow& window = channels[channel];
+  if (window.count == 0) return false;
+
+  TelemetrySummary summary = { channel, window.count, window.min, window.max,
+                               window.sum / window.count, window.last };
+  telemetryStats.windows++;
+
+  bool suppressed = insideDeadBand(window, now);
+  window.count = 0;
+  if (suppressed) {
+    telemetryStats.suppressed++;
+    return true;
+  }
+
+  uint8_t record[TELEMETRY_SUMMARY_LEN];
+  telemetryWriteSummary(summary, record);
+  if (!aggregatorAdd(record, sizeof(record), TYPE_SUMMARY, TELEMETRY_SEND_DELAY_MS)) {
+    telemetryStats.failed++;
+    return true;  // next window compares against the last summary that was sent
+  }
+  telemetryStats.sent++;
+  window.reported = true;
+  window.sentMean = summary.mean;
+  window.sentAt = now;
+  return true;
+}
+
+void telemetryLoop() {
+  uint32_t now = millis();
+
+  uint32_t tail = sampleTail.load(std::memory_order_relaxed);
+  uint32_t head = sampleHead.load(std::memory_order_acquire);
+  for (; tail != head; tail++) {
+    const RawSample& sample = sampleRing[tail % TELEMETRY_RING_SIZE];
+    ChannelWindow& window = channels[sample.channel];
+    if (window.count == UINT16_MAX) closeWindow(sample.channel, now);
+    addToWindow(window, sample.value, now);
+  }
+  sampleTail.store(tail, std::memory_order_release);
+
+  for (uint8_t channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+    ChannelWindow& window = channels[channel];
+    uint32_t windowMs = window.windowMs ? window.windowMs : TELEMETRY_WINDOW_MS;
+    if (window.count > 0 && now - window.openedAt >= windowMs) closeWindow(channel, now);
+  }
+}
+
+bool telemetryCloseWindow(uint8_t channel) {
+  if (channel >= TELEMETRY_CHANNELS) return false;
+  return closeWindow(channel, millis());
+}
+
+// ────── Summary Record ──────
+// [channel 1][count 2, little-endian][min][max][mean][last], IEEE 754 floats
+// in the byte order of the device (little-endian on ESP32, like TYPE_FLOATS)
+
+size_t telemetryWriteSummary(const TelemetrySummary& summary, uint8_t* out) {
+  out[0] = summary.channel;
+  out[1] = summary.count & 0xFF;
+  out[2] = summary.count >> 8;
+  memcpy(out + 3, &summary.min, sizeof(float));
+  memcpy(out + 7, &summary.max, sizeof(float));
+  memcpy(out + 11, &summary.mean, sizeof(float));
+  memcpy(out + 15, &summary.last, sizeof(float));
+  return TELEMETRY_SUMMARY_LEN;
+}
+
+bool telemetryReadSummary(const uint8_t* value, size_t length, TelemetrySummary& summary) {
+  if (length != TELEMETRY_SUMMARY_LEN) return false;
+  summary.channel = value[0];
+  summary.count = (uint16_t)value[1] | ((uint16_t)value[2] << 8);
+  memcpy(&summary.min, value + 3, sizeof(float));
+  memcpy(&summary.max, value + 7, sizeof(float));
+  memcpy(&summary.mean, value + 11, sizeof(float));
+  memcpy(&summary.last, value + 15, sizeof(float));
+  return true;
+}
+
+// ────── Queries ──────
+
+TelemetryStats getTelemetryStats() {
+  TelemetryStats stats = telemetryStats;
+  stats.ringDropped = ringDropped;
+  return stats;
+}
+
+void printTelemetryStats() {
+  TelemetryStats stats = getTelemetryStats();
+  Serial.printf("[TELEM] samples=%lu dropped=%lu windows=%lu sent=%lu suppressed=%lu failed=%lu\n",
+                (unsigned long)stats.samples, (unsigned long)stats.ringDropped,
+                (unsigned long)stats.windows, (unsigned long)stats.sent,
+                (unsigned long)stats.suppressed, (unsigned long)stats.failed);
+}
@@ -0,0 +1,140 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "Gateway.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Edge Telemetry: Windowed Summaries and Dead-Band Reporting
+ *
+ * Sensors are sampled far more often than values are worth sending.
+ * telemetrySample() only puts the raw value into a sample ring (safe from
+ * a timer ISR); telemetryLoop() drains the ring into per-channel windows
+ * and, when a channel's window ends, reduces it to one summary:
+ *
+ *   [channel 1][count 2][min f32][max f32][mean f32][last f32]   (TYPE_SUMMARY)
+ *
+ * Dead band: a window whose samples all stay within the channel's dead
+ * band around the mean last sent is dropped, so a steady value is not sent
+ * again while a short spike still is. An optional heartbeat sends one
+ * anyway after a while, so the gateway can tell a steady sensor from a
+ * dead device.
+ *
+ * Summaries go through the uplink aggregator (UplinkAggregator.h); windows
+ * of several channels that end together share one frame.
+ * listenForIncoming() runs telemetryLoop(); other loops call it themselves.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Channels, numbered 0 .. TELEMETRY_CHANNELS - 1. Build flag override, e.g. -DTELEMETRY_CHANNELS=8.
+#ifndef TELEMETRY_CHANNELS
+#define TELEMETRY_CHANNELS 4
+#endif
+
+// Raw samples waiting for telemetryLoop(), all channels together.
+#ifndef TELEMETRY_RING_SIZE
+#define TELEMETRY_RING_SIZE 64
+#endif
+
+// Window length of channels that were not configured.
+#ifndef TELEMETRY_WINDOW_MS
+#define TELEMETRY_WINDOW_MS 60000
+#endif
+
+// Aggregator deadline of a summary; > 0 lets summaries of windows that end
+// close together share a frame.
+#ifndef TELEMETRY_SEND_DELAY_MS
+#define TELEMETRY_SEND_DELAY_MS 0
+#endif
+
+#define TELEMETRY_SUMMARY_LEN 19    // Value length of a TYPE_SUMMARY record
+
+/**
+ * @brief One window of one channel.
+ */
+struct TelemetrySummary {
+    uint8_t channel;        ///< Channel the samples were taken on
+    uint16_t count;         ///< Samples in the window
+    float min;              ///< Smallest sample
+    float max;              ///< Largest sample
+    float mean;             ///< Average of the samples
+    float last;             ///< Newest sample
+};
+
+/**
+ * @brief Telemetry counters.
+ */
+struct TelemetryStats {
+    uint32_t samples;       ///< Samples taken into windows
+    uint32_t ringDropped;   ///< Samples lost, ring full (call telemetryLoop() more often)
+    uint32_t windows;       ///< Windows closed with at least one sample
+    uint32_t sent;          ///< Summaries handed to the aggregator
+    uint32_t suppressed;    ///< Windows dropped inside the dead band
+    uint32_t failed;        ///< Summaries the aggregator did not accept
+};
+
+/**
+ * @brief Sets the window and dead band of a channel and starts a new window.
+ *
+ * @param channel Channel number
+ * @param windowMs Window length; a summary is sent when it ends
+ * @param deadBand Minimum distance of any sample from the mean last sent; 0 sends every window
+ * @param heartbeatMs Send a suppressed summary anyway after this long; 0 = never
+ * @return false if the channel number is out of range or windowMs is 0
+ */
+bool telemetryConfigure(uint8_t channel, uint32_t windowMs, float deadBand = 0, uint32_t heartbeatMs = 0);
+
+/**
+ * @brief Takes one raw sample. Safe to call from an ISR.
+ *
+ * @param channel Channel number
+ * @param value Sample value
+ * @return false if the ring is full or the channel is out of range
+ */
+bool telemetrySample(uint8_t channel, float value);
+
+/**
+ * @brief Drains the sample ring into the windows and sends the summaries of
+ *        windows that have ended.
+ */
+void telemetryLoop();
+
+/**
+ * @brief Ends the window of a channel now (e.g. before deep sleep).
+ *
+ * @param channel Channel number
+ * @return true if the window held samples
+ */
+bool telemetryCloseWindow(uint8_t channel);
+
+/**
+ * @brief Encodes a summary as the value of a TYPE_SUMMARY record.
+ *
+ * @param summary Summary to encode
+ * @param out Destination, TELEMETRY_SUMMARY_LEN bytes
+ * @return TELEMETRY_SUMMARY_LEN
+ */
+size_t telemetryWriteSummary(const TelemetrySummary& summary, uint8_t* out);
+
+/**
+ * @brief Decodes the value of a TYPE_SUMMARY record (gateway side).
+ *
+ * @param value Record value
+ * @param length Value length
+ * @param summary Filled on success
+ * @return false if the length does not match
+ */
+bool telemetryReadSummary(const uint8_t* value, size_t length, TelemetrySummary& summary);
+
+/**
+ * @brief Returns a snapshot of the telemetry counters.
+ */
+TelemetryStats getTelemetryStats();
+
+/**
+ * @brief Prints the telemetry counters to Serial.
+ */
+void printTelemetryStats();
+
+#endif // TELEMETRY_H
@@ -0,0 +1,104 @@
+#include "Tlv.h"
+#include "Gateway.h"
+
+#include <Arduino.h>
+
+// ────── Varints ──────
+
+size_t tlvVarintLength(size_t value) {
+  size_t len = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    len++;
+  }
+  return len;
+}
+
+size_t tlvWriteVarint(uint8_t* out, size_t value) {
+  if (tlvVarintLength(value) > TLV_MAX_VARINT_LEN) return 0;
+
+  size_t i = 0;
+  while (value >= 0x80) {
+    out[i++] = (uint8_t)(value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[i++] = (uint8_t)value;
+  return i;
+}
+
+size_t tlvReadVarint(const uint8_t* in, const uint8_t* end, size_t& value) {
+  value = 0;
+  for (size_t i = 0; i < TLV_MAX_VARINT_LEN && in + i < end; i++) {
+    value |= (size_t)(in[i] & 0x7F) << (7 * i);
+    if (!(in[i] & 0x80)) return i + 1;
+  }
+  return 0;
+}
+
+// ────── Encoding ──────
+
+size_t tlvRecordHeader(uint8_t* out, uint8_t type, size_t length) {
+  out[0] = type;
+  size_t varintLen = tlvWriteVarint(out + 1, length);
+  return varintLen ? 1 + varintLen : 0;
+}
+
+size_t tlvFrameHeader(uint8_t* out, uint8_t type, size_t length) {
+  out[0] = TLV_FORMAT_V1;
+  size_t recordLen = tlvRecordHeader(out + 1, type, length);
+  return recordLen ? 1 + recordLen : 0;
+}
+
+// ────── Decoding ──────
+
+void tlvBegin(TlvReader& reader, const uint8_t* payload, size_t length) {
+  reader.pos = payload;
+  reader.end = payload + length;
+  reader.error = false;
+  reader.version = TLV_FORMAT_LEGACY;
+  if (length > 0 && payload[0] == TLV_FORMAT_V1) {
+    reader.version = TLV_FORMAT_V1;
+    reader.pos++;
+  }
+}
+
+// Legacy framing: a record runs until the next byte that looks like a DataType.
+// Kept only for payloads from devices that predate the format marker.
+static bool legacyNext(TlvReader& reader, TlvRecord& record) {
+  record.type = *reader.pos++;
+  record.value = reader.pos;
+  while (reader.pos < reader.end &&
+         *reader.pos != TYPE_TEXT &&
+         *reader.pos != TYPE_BYTES &&
+         *reader.pos != TYPE_FLOATS &&
+         *reader.pos != TYPE_STREAM) {
+    reader.pos++;
+  }
+  record.length = reader.pos - record.value;
+  return true;
+}
+
+bool tlvNext(TlvReader& reader, TlvRecord& record) {
+  if (reader.error || reader.pos >= reader.end) return false;
+  if (reader.version == TLV_FORMAT_LEGACY) return legacyNext(reader, record);
+
+  size_t length = 0;
+  size_t varintLen = tlvReadVarint(reader.pos + 1, reader.end, length);
+  if (varintLen == 0 || (size_t)(reader.end - reader.pos) < 1 + varintLen + length) {
+    reader.error = true;
+    return false;
+  }
+
+  record.type = reader.pos[0];
+  record.value = reader.pos + 1 + varintLen;
+  record.length = length;
+  reader.pos = record.value + length;
+  return true;
+}
+
+bool tlvFind(TlvReader& reader, uint8_t type, TlvRecord& record) {
+  while (tlvNext(reader, record)) {
+    if (record.type == type) return true;
+  }
+  return false;
+}
@@ -0,0 +1,126 @@
+#ifndef TLV_H
+#define TLV_H
+
+#include <Arduino.h>
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Payload Record Framing (TLV)
+ *
+ * Decrypted payloads carry one or more typed records:
+ *
+ *   [TLV_FORMAT_V1 1][type 1][length varint 1-3][value length] [type][length][value] ...
+ *
+ * Lengths are unsigned LEB128 varints (7 bits per byte, MSB = continue), so
+ * records up to 127 bytes cost a single length byte. The value bytes are
+ * never inspected, so floats and binary data may contain any byte value.
+ *
+ * Versioning: the first payload byte is the format marker. Legacy payloads
+ * start directly with a DataType (0x01-0x04) and are still decoded by the
+ * old sentinel scan, so gateways keep accepting devices that are not updated.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+#define TLV_FORMAT_V1 0xE1          // Format marker, never a valid DataType
+#define TLV_FORMAT_LEGACY 0x00      // Reader version for sentinel-framed payloads
+
+#define TLV_MAX_VARINT_LEN 3        // Lengths up to 2^21 - 1
+#define TLV_MAX_RECORD_HEADER (1 + TLV_MAX_VARINT_LEN)
+#define TLV_MAX_FRAME_HEADER (1 + TLV_MAX_RECORD_HEADER)
+
+/**
+ * @brief One decoded record. `value` points into the payload buffer.
+ */
+struct TlvRecord {
+    uint8_t type;               ///< DataType of the record
+    const uint8_t* value;       ///< First value byte
+    size_t length;              ///< Value length in bytes
+};
+
+/**
+ * @brief Cursor over the records of a payload.
+ */
+struct TlvReader {
+    const uint8_t* pos;         ///< Next unread byte
+    const uint8_t* end;         ///< One past the last payload byte
+    uint8_t version;            ///< TLV_FORMAT_V1 or TLV_FORMAT_LEGACY
+    bool error;                 ///< Set if a record was truncated or malformed
+};
+
+/**
+ * @brief Number of bytes the varint encoding of `value` takes.
+ */
+size_t tlvVarintLength(size_t value);
+
+/**
+ * @brief Writes `value` as a varint.
+ *
+ * @param out Destination, at least TLV_MAX_VARINT_LEN bytes
+ * @param value Value to encode (< 2^21)
+ * @return Bytes written, 0 if the value is too large
+ */
+size_t tlvWriteVarint(uint8_t* out, size_t value);
+
+/**
+ * @brief Reads a varint.
+ *
+ * @param in First byte
+ * @param end One past the last readable byte
+ * @param value Decoded value
+ * @return Bytes consumed, 0 if truncated or longer than TLV_MAX_VARINT_LEN
+ */
+size_t tlvReadVarint(const uint8_t* in, const uint8_t* end, size_t& value);
+
+/**
+ * @brief Writes a record header: [type][length varint].
+ *
+ * @param out Destination, at least TLV_MAX_RECORD_HEADER bytes
+ * @return Header length, 0 if `length` is too large
+ */
+size_t tlvRecordHeader(uint8_t* out, uint8_t type, size_t length);
+
+/**
+ * @brief Writes the header of a single-record payload: [format][type][length].
+ *
+ * Meant to be sent as the first DataSegment in front of the value bytes.
+ *
+ * @param out Destination, at least TLV_MAX_FRAME_HEADER bytes
+ * @return Header length, 0 if `length` is too large
+ */
+size_t tlvFrameHeader(uint8_t* out, uint8_t type, size_t length);
+
+/**
+ * @brief Starts reading a decrypted payload.
+ *
+ * Detects the format marker; payloads without it are read as legacy
+ * sentinel-framed records.
+ *
+ * @param reader Reader to initialize
+ * @param payload Decrypted payload
+ * @param length Payload length
+ */
+void tlvBegin(TlvReader& reader, const uint8_t* payload, size_t length);
+
+/**
+ * @brief Returns the next record.
+ *
+ * For TLV_FORMAT_V1 this is O(1) per record: the length says where the next
+ * record starts, unwanted records are skipped without touching their value.
+ *
+ * @param reader Reader started with tlvBegin()
+ * @param record Filled with the next record
+ * @return false at the end of the payload or on error (see reader.error)
+ */
+bool tlvNext(TlvReader& reader, TlvRecord& record);
+
+/**
+ * @brief Skips to the next record of a given type.
+ *
+ * @param reader Reader started with tlvBegin()
+ * @param type DataType to look for
+ * @param record Filled with the matching record
+ * @return true if found
+ */
+bool tlvFind(TlvReader& reader, uint8_t type, TlvRecord& record);
+
+#endif // TLV_H
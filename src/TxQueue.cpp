@@ -0,0 +1,225 @@
+#include "TxQueue.h"
+#include "RxQueue.h"
+#include "Gateway.h"
+
+#include <Arduino.h>
+#include <RadioLib.h>
+
+// ────── Ring State ──────
+// Producer (txQueueSend) and state machine (txQueueLoop) both run in loop
+// context; only txActive/txDoneFlag are shared with the ISR. head and tail
+// are free-running counters, frame n has handle n + 1 and is queued in slot
+// n % TX_QUEUE_CAPACITY. A control frame moved ahead of a deferred data
+// frame changes slots, so status lookups search the ring by handle.
+
+struct TxFrame {
+  uint8_t data[PACKET_MAX_LEN];
+  uint8_t length;
+  TxHandle handle;
+  TxStatus status;
+  TxDoneCallback callback;
+  uint8_t dataType;
+  uint32_t deferredAt;        // millis() the duty cycle first held it back, 0 = never
+};
+
+static TxFrame txRing[TX_QUEUE_CAPACITY];
+static uint32_t txHead = 0;
+static uint32_t txTail = 0;
+
+static volatile bool txActive = false;
+static volatile bool txDoneFlag = false;
+static uint32_t txStarted = 0;
+static uint32_t txDeadlineMs = 0;
+static TxQueueStats txStats = {};
+
+bool IRAM_ATTR txQueueISR() {
+  if (!txActive) return false;
+  txDoneFlag = true;
+  return true;
+}
+
+TxHandle txQueueSend(const uint8_t* data, size_t length, TxDoneCallback callback, uint8_t dataType) {
+  if (length == 0 || length > PACKET_MAX_LEN || txHead - txTail >= TX_QUEUE_CAPACITY) {
+    txStats.rejected++;
+    return 0;
+  }
+
+  TxFrame& frame = txRing[txHead % TX_QUEUE_CAPACITY];
+  memcpy(frame.data, data, length);
+  frame.length = (uint8_t)length;
+  frame.handle = txHead + 1;
+  frame.status = TX_QUEUED;
+  frame.callback = callback;
+  frame.dataType = dataType;
+  frame.deferredAt = 0;
+  txHead++;
+
+  txStats.queued++;
+  uint32_t depth = txHead - txTail;
+  if (depth > txStats.highWater) txStats.highWater = depth;
+
+  TxHandle handle = frame.handle;  // the slot may change hands in txQueueLoop()
+  txQueueLoop();  // start right away if the radio is idle
+  return handle;
+}
+
+// ────── State Machine ──────
+
+static void finishFrame(int result) {
+  TxFrame& frame = txRing[txTail % TX_QUEUE_CAPACITY];
+  frame.status = (result == RADIOLIB_ERR_NONE) ? TX_DONE : TX_FAILED;
+  txTail++;
+  if (frame.callback) frame.callback(frame.handle, result);
+}
+
+// Moves the first queued control frame to the head, ahead of the deferred
+// data frame there, if the control reserve covers it. Control frames keep
+// their order among themselves, data frames too.
+static bool promoteControlFrame() {
+  for (uint32_t i = txTail + 1; i != txHead; i++) {
+    TxFrame& candidate = txRing[i % TX_QUEUE_CAPACITY];
+    if (!dutyCycleIsControl(candidate.dataType)) continue;
+    if (dutyCycleWaitMs(frameAirtimeMs(candidate.length), candidate.dataType) > 0) return false;
+
+    TxFrame promoted = candidate;
+    for (uint32_t j = i; j != txTail; j--) {
+      txRing[j % TX_QUEUE_CAPACITY] = txRing[(j - 1) % TX_QUEUE_CAPACITY];
+    }
+    txRing[txTail % TX_QUEUE_CAPACITY] = promoted;
+    txStats.promoted++;
+    return true;
+  }
+  return false;
+}
+
+void txQueueLoop() {
+  if (txActive) {
+    uint32_t elapsed = millis() - txStarted;
+    if (!txDoneFlag && elapsed < txDeadlineMs) return;
+
+    bool timedOut = !txDoneFlag;
+    radioLock();
+    lora->finishTransmit();
+    txActive = false;
+    txDoneFlag = false;
+    transmissonFlag = false;
+    lora->startReceive();  // back to RX before anything else runs
+    radioUnlock();
+
+    txStats.airtimeMs += elapsed;
+    if (timedOut) {
+      Serial.println("[TXQ] No TX-done interrupt, is txQueueISR() called from setFlags()?");
+      txStats.timeouts++;
+      finishFrame(RADIOLIB_ERR_TX_TIMEOUT);
+    } else {
+      txStats.sent++;
+      finishFrame(RADIOLIB_ERR_NONE);
+    }
+  }
+
+  while (!txActive && txTail != txHead) {
+    TxFrame& frame = txRing[txTail % TX_QUEUE_CAPACITY];
+    uint32_t airtimeMs = frameAirtimeMs(frame.length);
+
+    // Over the band's duty-cycle budget: stays queued, asked again next loop.
+    // A control frame behind a deferred data frame may go first.
+    uint32_t now = millis();
+    if (dutyCycleWaitMs(airtimeMs, frame.dataType) > 0) {
+      if (frame.deferredAt == 0) {
+        frame.deferredAt = now | 1;
+        txStats.deferred++;
+        Serial.printf("[TXQ] Duty-cycle budget used up, frame of %u ms deferred.\n", (unsigned)airtimeMs);
+      }
+      if (dutyCycleIsControl(frame.dataType) || !promoteControlFrame()) return;
+      continue;
+    }
+    if (frame.deferredAt != 0) txStats.deferredMs += now - frame.deferredAt;
+    txDeadlineMs = airtimeMs + TX_QUEUE_TIMEOUT_MARGIN_MS;
+
+    // Held from here to startTransmit(): the capture task must not touch
+    // the radio in between. A frame that arrived just before the TX starts
+    // would be lost in standby, so it is read first.
+    radioLock();
+    captureRxFrame();
+
+    // Armed before startTransmit() so the TX-done interrupt is never missed.
+    // transmissonFlag keeps sketches without the txQueueISR() hook from
+    // mistaking TX done for a received frame.
+    frame.status = TX_ACTIVE;
+    transmissonFlag = true;
+    txDoneFlag = false;
+    txActive = true;
+    txStarted = now;
+
+    lora->standby();
+    int state = lora->startTransmit(frame.data, frame.length);
+    if (state != RADIOLIB_ERR_NONE) {
+      txActive = false;
+      transmissonFlag = false;
+      lora->startReceive();
+    }
+    radioUnlock();
+
+    if (state != RADIOLIB_ERR_NONE) {
+      Serial.printf("[TXQ] startTransmit failed: %d\n", state);
+      txStats.failed++;
+      finishFrame(state);
+    } else {
+      dutyCycleCharge(frame.data, frame.length, airtimeMs, frame.dataType);
+    }
+  }
+}
+
+// ────── Queries ──────
+
+TxStatus txQueueStatus(TxHandle handle) {
+  if (handle == 0) return TX_UNKNOWN;
+  for (size_t i = 0; i < TX_QUEUE_CAPACITY; i++) {
+    if (txRing[i].handle == handle) return txRing[i].status;
+  }
+  return TX_UNKNOWN;
+}
+
+bool txQueueBusy() {
+  return txActive || txTail != txHead;
+}
+
+size_t txQueueDepth() {
+  return txHead - txTail;
+}
+
+bool txQueueWaitForSpace(uint32_t timeoutMs) {
+  uint32_t start = millis();
+  while (txHead - txTail >= TX_QUEUE_CAPACITY) {
+    if (millis() - start >= timeoutMs) return false;
+    txQueueLoop();
+    captureRxFrame();
+    delay(1);
+  }
+  return true;
+}
+
+bool txQueueFlush(uint32_t timeoutMs) {
+  uint32_t start = millis();
+  while (txQueueBusy()) {
+    if (millis() - start >= timeoutMs) return false;
+    txQueueLoop();
+    captureRxFrame();
+    delay(1);
+  }
+  return true;
+}
+
+TxQueueStats getTxQueueStats() {
+  return txStats;
+}
+
+void printTxQueueStats() {
+  Serial.printf("[TXQ] depth=%u high=%u queued=%lu sent=%lu failed=%lu timeouts=%lu rejected=%lu airtime=%lu ms deferred=%lu (%lu ms) promoted=%lu\n",
+                (unsigned)(txHead - txTail), (unsigned)txStats.highWater,
+                (unsigned long)txStats.queued, (unsigned long)txStats.sent,
+                (unsigned long)txStats.failed, (unsigned long)txStats.timeouts,
+                (unsigned long)txStats.rejected, (unsigned long)txStats.airtimeMs,
+                (unsigned long)txStats.deferred, (unsigned long)txStats.deferredMs,
+                (unsigned long)txStats.promoted);
+}
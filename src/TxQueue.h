@@ -0,0 +1,163 @@
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include <Arduino.h>
+#include "PacketView.h"
+#include "DutyCycle.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * TX Frame Queue (non-blocking transmit)
+ *
+ * Frames are copied into a fixed ring and sent one at a time with the
+ * radio's startTransmit(). The TX-done interrupt (txQueueISR) marks the
+ * active frame finished; txQueueLoop() then re-arms the receiver and starts
+ * the next frame. The CPU is free during the time-on-air, so the gateway
+ * keeps decrypting and logging queued RX frames while it transmits.
+ *
+ * The sketch's DIO1 callback must route the interrupt:
+ *
+ *   void setFlags() {
+ *     if (txQueueISR()) return;     // TX done of a queued frame
+ *     if (!transmissonFlag) rxQueueISR();
+ *   }
+ *
+ * Without that hook a frame is finished after its time-on-air plus
+ * TX_QUEUE_TIMEOUT_MARGIN_MS and reported as RADIOLIB_ERR_TX_TIMEOUT.
+ *
+ * Before a frame starts, its time-on-air is checked against the duty-cycle
+ * budget (DutyCycle.h). A frame over budget stays at the head of the queue
+ * until the budget allows it. Data frames leave in order; a control frame
+ * (ACK, stream ACK, join frame) that fits the reserve is moved ahead of a
+ * deferred data frame, so ACKs are not held up by downlink data.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Frames waiting to be sent. Build flag override, e.g. -DTX_QUEUE_CAPACITY=16.
+#ifndef TX_QUEUE_CAPACITY
+#define TX_QUEUE_CAPACITY 8
+#endif
+
+// Grace period after the computed time-on-air before a TX counts as lost.
+#ifndef TX_QUEUE_TIMEOUT_MARGIN_MS
+#define TX_QUEUE_TIMEOUT_MARGIN_MS 200
+#endif
+
+// How long stream senders wait for a free slot before giving up on a chunk.
+#ifndef TX_QUEUE_WAIT_MS
+#define TX_QUEUE_WAIT_MS 10000
+#endif
+
+/**
+ * @brief Handle of a queued frame, 0 = not queued.
+ */
+typedef uint32_t TxHandle;
+
+/**
+ * @brief State of a queued frame.
+ */
+enum TxStatus {
+    TX_QUEUED,      ///< Waiting for the radio
+    TX_ACTIVE,      ///< On air
+    TX_DONE,        ///< Sent, receiver re-armed
+    TX_FAILED,      ///< startTransmit() failed or TX-done never came
+    TX_UNKNOWN      ///< Invalid handle, or too old to be tracked
+};
+
+/**
+ * @brief Called from txQueueLoop() when a frame has finished.
+ *
+ * @param handle Handle returned by txQueueSend()
+ * @param result RADIOLIB_ERR_NONE or the RadioLib error
+ */
+typedef void (*TxDoneCallback)(TxHandle handle, int result);
+
+/**
+ * @brief Queue counters.
+ */
+struct TxQueueStats {
+    uint32_t queued;        ///< Frames accepted by txQueueSend()
+    uint32_t sent;          ///< Frames finished by the TX-done interrupt
+    uint32_t failed;        ///< startTransmit() errors
+    uint32_t timeouts;      ///< Frames without a TX-done interrupt
+    uint32_t rejected;      ///< txQueueSend() calls refused (full or too long)
+    uint32_t airtimeMs;     ///< Total time spent transmitting
+    uint32_t deferred;      ///< Frames held back by the duty-cycle budget
+    uint32_t deferredMs;    ///< Total time frames were held back
+    uint32_t promoted;      ///< Control frames sent ahead of a deferred data frame
+    uint16_t highWater;     ///< Maximum observed queue depth
+};
+
+/**
+ * @brief TX-done interrupt hook. Safe to call from an ISR.
+ *
+ * @return true if a queued frame was on air, i.e. the interrupt was TX done
+ */
+bool txQueueISR();
+
+/**
+ * @brief Queues a frame for transmission and returns immediately.
+ *
+ * @param data Raw frame (copied)
+ * @param length Frame length, at most PACKET_MAX_LEN
+ * @param callback Optional completion callback
+ * @param dataType DataType of the payload for airtime accounting;
+ *        AIRTIME_CONTROL (ACKs, join frames) may use the duty-cycle reserve
+ * @return Handle for txQueueStatus(), 0 if the queue is full or the frame too long
+ */
+TxHandle txQueueSend(const uint8_t* data, size_t length, TxDoneCallback callback = nullptr,
+                     uint8_t dataType = AIRTIME_CONTROL);
+
+/**
+ * @brief Runs the TX state machine: finishes the active frame, re-arms RX,
+ *        starts the next one. Call from loop() (Recive() and
+ *        listenForIncoming() already do).
+ */
+void txQueueLoop();
+
+/**
+ * @brief Returns the state of a queued frame.
+ *
+ * Finished frames are tracked until TX_QUEUE_CAPACITY newer frames are queued.
+ */
+TxStatus txQueueStatus(TxHandle handle);
+
+/**
+ * @brief true while a frame is on air or waiting.
+ */
+bool txQueueBusy();
+
+/**
+ * @brief Frames queued or on air.
+ */
+size_t txQueueDepth();
+
+/**
+ * @brief Runs txQueueLoop() and RX capture until a slot is free.
+ *
+ * For producers that queue faster than the radio sends (e.g. streams).
+ *
+ * @param timeoutMs Maximum wait
+ * @return true if a slot is free
+ */
+bool txQueueWaitForSpace(uint32_t timeoutMs);
+
+/**
+ * @brief Runs txQueueLoop() and RX capture until the queue is empty.
+ *
+ * @param timeoutMs Maximum wait
+ * @return true if every frame has finished
+ */
+bool txQueueFlush(uint32_t timeoutMs);
+
+/**
+ * @brief Returns a snapshot of the queue counters.
+ */
+TxQueueStats getTxQueueStats();
+
+/**
+ * @brief Prints the queue counters to Serial.
+ */
+void printTxQueueStats();
+
+#endif // TX_QUEUE_H
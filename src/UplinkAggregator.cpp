@@ -0,0 +1,140 @@
+#include "UplinkAggregator.h"
+#include "CryptoUtils.h"
+#include "Sessions.h"
+#include "Tlv.h"
+#include "TxQueue.h"
+
+#include <Arduino.h>
+
+// ────── Buffer State ──────
+// The buffer holds the plaintext payload as it will be encrypted: the format
+// marker, then the records. lastRecordAt is the offset of the newest record
+// header, so TYPE_FLOATS readings can be appended to it.
+
+static uint8_t aggBuffer[AGGREGATOR_MAX_PAYLOAD];
+static size_t aggLength = 0;        // 0 = empty
+static size_t aggRecords = 0;
+static size_t lastRecordAt = 0;
+static uint8_t aggType = 0;         // Type of all records, TYPE_BYTES once mixed
+static uint32_t flushAt = 0;        // millis() of the earliest deadline
+static uint32_t soloBytes = 0;      // Bytes the records would take as separate frames
+static AggregatorStats aggStats = {};
+
+#define AGGREGATOR_RETRY_MS 1000    // Deadline flush retry while no session / TX queue full
+#define AGGREGATOR_MIN_RECORD 6     // [type][length][float]: less room left counts as full
+
+static size_t frameOverhead() {
+  return (frameFormat() == FRAME_FORMAT_COMPACT) ? FRAME_OVERHEAD : PACKET_OVERHEAD;
+}
+
+static bool sendBuffer(uint32_t& reason) {
+  if (aggLength == 0) return true;
+
+  // Checked before encrypting, so a retry does not burn frame counters
+  if (txQueueDepth() >= TX_QUEUE_CAPACITY) {
+    aggStats.failed++;
+    return false;
+  }
+  SessionInfo* session = nullptr;
+  if (findSession(devEUI, session) != SESSION_OK) {
+    Serial.println("[AGG] Session not found, records kept.");
+    aggStats.failed++;
+    return false;
+  }
+
+  DataSegment payload = { aggBuffer, aggLength };
+  uint8_t finalPacket[PACKET_MAX_LEN];
+  size_t finalLen = encryptAndPackage(&payload, 1, *session, devEUI, finalPacket, sizeof(finalPacket));
+  if (finalLen == 0 || txQueueSend(finalPacket, finalLen, nullptr, aggType) == 0) {
+    Serial.println("[AGG] Frame could not be queued, records kept.");
+    aggStats.failed++;
+    return false;
+  }
+
+  Serial.printf("[AGG] Queued %u record(s) in one %u-byte frame\n", (unsigned)aggRecords, (unsigned)finalLen);
+  reason++;
+  aggStats.frames++;
+  if (soloBytes > finalLen) aggStats.bytesSaved += soloBytes - finalLen;
+  aggLength = 0;
+  aggRecords = 0;
+  soloBytes = 0;
+  return true;
+}
+
+// ────── Producer ──────
+
+bool aggregatorAdd(const uint8_t* data, size_t length, DataType dataType, uint32_t deadlineMs) {
+  size_t headerLen = 1 + tlvVarintLength(length);
+  if (1 + headerLen + length > AGGREGATOR_MAX_PAYLOAD) {
+    Serial.printf("[AGG] Record of %u bytes never fits, use sendStream().\n", (unsigned)length);
+    return false;
+  }
+
+  // Appending floats to a TYPE_FLOATS record whose length byte stays a single byte
+  bool merge = aggLength > 0 && dataType == TYPE_FLOATS && aggBuffer[lastRecordAt] == TYPE_FLOATS &&
+               (aggBuffer[lastRecordAt + 1] & 0x80) == 0 && aggBuffer[lastRecordAt + 1] + length <= 0x7F &&
+               aggBuffer[lastRecordAt + 1] % sizeof(float) == 0;
+  size_t needed = merge ? length : headerLen + length + (aggLength == 0 ? 1 : 0);
+
+  if (aggLength + needed > AGGREGATOR_MAX_PAYLOAD) {
+    if (!sendBuffer(aggStats.flushFull)) return false;
+    merge = false;
+  }
+
+  uint32_t now = millis();
+  uint32_t deadline = now + deadlineMs;
+  if (aggLength == 0) {
+    aggBuffer[aggLength++] = TLV_FORMAT_V1;
+    aggType = dataType;
+    flushAt = deadline;
+  } else {
+    if (aggType != dataType) aggType = TYPE_BYTES;
+    if ((int32_t)(deadline - flushAt) < 0) flushAt = deadline;
+  }
+
+  if (merge) {
+    aggBuffer[lastRecordAt + 1] += (uint8_t)length;
+    aggStats.merged++;
+  } else {
+    lastRecordAt = aggLength;
+    aggLength += tlvRecordHeader(aggBuffer + aggLength, dataType, length);
+  }
+  memcpy(aggBuffer + aggLength, data, length);
+  aggLength += length;
+  aggRecords++;
+  aggStats.records++;
+  soloBytes += frameOverhead() + 1 + headerLen + length;
+
+  // No room for even one more float: send now instead of waiting for the deadline
+  if (AGGREGATOR_MAX_PAYLOAD - aggLength < AGGREGATOR_MIN_RECORD) sendBuffer(aggStats.flushFull);
+  return true;
+}
+
+bool aggregatorFlush() {
+  return sendBuffer(aggStats.flushForced);
+}
+
+void aggregatorLoop() {
+  if (aggLength == 0) return;
+  uint32_t now = millis();
+  if ((int32_t)(now - flushAt) < 0) return;
+  if (!sendBuffer(aggStats.flushDeadline)) flushAt = now + AGGREGATOR_RETRY_MS;
+}
+
+// ────── Queries ──────
+
+size_t aggregatorPending() {
+  return aggRecords;
+}
+
+AggregatorStats getAggregatorStats() {
+  return aggStats;
+}
+
+void printAggregatorStats() {
+  Serial.printf("[AGG] pending=%u records=%lu merged=%lu frames=%lu full=%lu deadline=%lu forced=%lu saved=%lu bytes failed=%lu\n",
+                (unsigned)aggRecords, (unsigned long)aggStats.records, (unsigned long)aggStats.merged,
+                (unsigned long)aggStats.frames, (unsigned long)aggStats.flushFull,
+                (unsigned long)aggStats.flushDeadline, (unsigned long)aggStats.flushForced,
+                (unsigned long)aggStats.bytesSaved, (unsigned long)aggStats.failed);
+}
@@ -0,0 +1,98 @@
+#ifndef UPLINK_AGGREGATOR_H
+#define UPLINK_AGGREGATOR_H
+
+#include <Arduino.h>
+#include "Gateway.h"
+#include "PacketView.h"
+
+/*
+ * ───────────────────────────────────────────────────────────────
+ * Uplink Aggregation (end device)
+ *
+ * Every sendLora() is one frame: 15-32 bytes of header and HMAC, plus the
+ * preamble and PHY header, around a few bytes of data. The aggregator
+ * buffers typed records instead and sends them together as one TLV payload
+ * (Tlv.h), which the gateway already splits back into records:
+ *
+ *   [TLV_FORMAT_V1][type][length][value] [type][length][value] ...
+ *
+ * Consecutive TYPE_FLOATS records are merged into one record, so each
+ * further reading costs its 4 bytes only.
+ *
+ * A frame is sent when
+ *   - the next record would not fit in AGGREGATOR_MAX_PAYLOAD,
+ *   - the oldest deadline of a buffered record has passed (aggregatorLoop()),
+ *   - or the sketch calls aggregatorFlush().
+ *
+ * listenForIncoming() runs aggregatorLoop(); other loops call it themselves.
+ * ───────────────────────────────────────────────────────────────
+ */
+
+// Largest aggregated payload; fits a legacy frame (PACKET_MAX_LEN - PACKET_OVERHEAD).
+// Lower it to keep frames short at high spreading factors, e.g. -DAGGREGATOR_MAX_PAYLOAD=51.
+#ifndef AGGREGATOR_MAX_PAYLOAD
+#define AGGREGATOR_MAX_PAYLOAD (PACKET_MAX_LEN - PACKET_OVERHEAD)
+#endif
+
+// Longest a record waits for others unless aggregatorAdd() is given a deadline.
+#ifndef AGGREGATOR_DEADLINE_MS
+#define AGGREGATOR_DEADLINE_MS 10000
+#endif
+
+/**
+ * @brief Aggregator counters.
+ */
+struct AggregatorStats {
+    uint32_t records;           ///< Records accepted by aggregatorAdd()
+    uint32_t merged;            ///< Records appended to the previous TYPE_FLOATS record
+    uint32_t frames;            ///< Aggregated frames queued for TX
+    uint32_t flushFull;         ///< Frames sent because the buffer was full
+    uint32_t flushDeadline;     ///< Frames sent because a deadline passed
+    uint32_t flushForced;       ///< Frames sent by aggregatorFlush()
+    uint32_t bytesSaved;        ///< Frame bytes saved against one sendLora() per record
+    uint32_t failed;            ///< Flushes retried later (no session or TX queue full)
+};
+
+/**
+ * @brief Buffers one record for the next aggregated frame.
+ *
+ * Sends the buffered records first if this one does not fit.
+ *
+ * @param data Record value (copied)
+ * @param length Value length
+ * @param dataType Record type
+ * @param deadlineMs Longest the record may wait before it is sent
+ * @return false if the record can never fit (use sendStream()) or the
+ *         buffer is full and could not be sent
+ */
+bool aggregatorAdd(const uint8_t* data, size_t length, DataType dataType,
+                   uint32_t deadlineMs = AGGREGATOR_DEADLINE_MS);
+
+/**
+ * @brief Sends the buffered records as one frame now.
+ *
+ * @return true if a frame was queued or nothing was buffered
+ */
+bool aggregatorFlush();
+
+/**
+ * @brief Sends the buffered records once the oldest deadline has passed.
+ */
+void aggregatorLoop();
+
+/**
+ * @brief Records waiting in the buffer.
+ */
+size_t aggregatorPending();
+
+/**
+ * @brief Returns a snapshot of the aggregator counters.
+ */
+AggregatorStats getAggregatorStats();
+
+/**
+ * @brief Prints the aggregator counters to Serial.
+ */
+void printAggregatorStats();
+
+#endif // UPLINK_AGGREGATOR_H